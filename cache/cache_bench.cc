@@ -57,6 +57,9 @@ DEFINE_uint32(erase_percent, 1,
               "Ratio of erase to total workload (expressed as a percentage)");
 
 DEFINE_bool(use_clock_cache, false, "");
+DEFINE_bool(use_lock_free_clock_cache, false,
+            "Use NewLockFreeClockCache, with value_bytes as the estimated "
+            "entry charge.");
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -183,7 +186,10 @@ class CacheBench {
       fprintf(stderr, "Percentages must add to 100.\n");
       exit(1);
     }
-    if (FLAGS_use_clock_cache) {
+    if (FLAGS_use_lock_free_clock_cache) {
+      cache_ = NewLockFreeClockCache(FLAGS_cache_size, FLAGS_value_bytes,
+                                     FLAGS_num_shard_bits);
+    } else if (FLAGS_use_clock_cache) {
       cache_ = NewClockCache(FLAGS_cache_size, FLAGS_num_shard_bits);
       if (!cache_) {
         fprintf(stderr, "Clock cache not supported.\n");
@@ -342,6 +348,7 @@ class CacheBench {
     printf("RocksDB version     : %d.%d\n", kMajorVersion, kMinorVersion);
     printf("Number of threads   : %u\n", FLAGS_threads);
     printf("Ops per thread      : %" PRIu64 "\n", FLAGS_ops_per_thread);
+    printf("Cache               : %s\n", cache_->Name());
     printf("Cache size          : %" PRIu64 "\n", FLAGS_cache_size);
     printf("Num shard bits      : %u\n", FLAGS_num_shard_bits);
     printf("Max key             : %" PRIu64 "\n", max_key_);
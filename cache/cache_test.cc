@@ -9,15 +9,19 @@
 
 #include "rocksdb/cache.h"
 
+#include <atomic>
 #include <forward_list>
 #include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "cache/clock_cache.h"
+#include "cache/lock_free_clock_cache.h"
 #include "cache/lru_cache.h"
 #include "test_util/testharness.h"
+#include "port/port.h"
 #include "util/coding.h"
+#include "util/random.h"
 #include "util/string_util.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -39,6 +43,7 @@ static int DecodeValue(void* v) {
 
 const std::string kLRU = "lru";
 const std::string kClock = "clock";
+const std::string kLockFreeClock = "lock_free_clock";
 
 void dumbDeleter(const Slice& /*key*/, void* /*value*/) {}
 
@@ -47,6 +52,19 @@ void eraseDeleter(const Slice& /*key*/, void* value) {
   cache->Erase("foo");
 }
 
+// Records whether the cache it was inserted into was draining when the
+// entry got deleted
+struct DrainingProbe {
+  const Cache* cache;
+  std::vector<bool>* draining;
+};
+
+void drainingDeleter(const Slice& /*key*/, void* value) {
+  DrainingProbe* probe = reinterpret_cast<DrainingProbe*>(value);
+  probe->draining->push_back(probe->cache->IsDraining());
+  delete probe;
+}
+
 class CacheTest : public testing::TestWithParam<std::string> {
  public:
   static CacheTest* current_;
@@ -83,6 +101,9 @@ class CacheTest : public testing::TestWithParam<std::string> {
     if (type == kClock) {
       return NewClockCache(capacity);
     }
+    if (type == kLockFreeClock) {
+      return NewLockFreeClockCache(capacity, 1024 /*estimated_entry_charge*/);
+    }
     return nullptr;
   }
 
@@ -103,6 +124,12 @@ class CacheTest : public testing::TestWithParam<std::string> {
       return NewClockCache(capacity, num_shard_bits, strict_capacity_limit,
                            charge_policy);
     }
+    if (type == kLockFreeClock) {
+      // Most tests insert entries of charge 1.
+      return NewLockFreeClockCache(capacity, 1 /*estimated_entry_charge*/,
+                                   num_shard_bits, strict_capacity_limit,
+                                   charge_policy);
+    }
     return nullptr;
   }
 
@@ -148,6 +175,14 @@ class CacheTest : public testing::TestWithParam<std::string> {
   void Erase2(int key) {
     Erase(cache2_, key);
   }
+
+  // Number of inserts into cache_ after which entries that were never looked
+  // up are expected to be gone. A CLOCK hand has to pass an unused entry
+  // twice before evicting it, so the first pass over a full cache evicts
+  // nothing.
+  int NumInsertsToEvictUnused() const {
+    return GetParam() == kLockFreeClock ? kCacheSize * 4 : kCacheSize * 2;
+  }
 };
 CacheTest* CacheTest::current_;
 
@@ -330,6 +365,31 @@ TEST_P(CacheTest, Erase) {
   ASSERT_EQ(1U, deleted_keys_.size());
 }
 
+TEST_P(CacheTest, EraseAfterReinsert) {
+  // A single small shard, so that keys share slots
+  std::shared_ptr<Cache> cache = NewCache(16, 0, false);
+  for (int round = 0; round < 100; round++) {
+    const int key = 100000 + round;
+    // Entries inserted first may take the slots key would go to
+    for (int i = 0; i < 15; i++) {
+      Insert(cache, round * 100 + i, i);
+    }
+    Cache::Handle* handle = nullptr;
+    ASSERT_OK(cache->Insert(EncodeKey(key), EncodeValue(1), 1,
+                            &CacheTest::Deleter, &handle));
+    // Evict all of them but key, which is pinned
+    cache->SetCapacity(1);
+    cache->SetCapacity(16);
+    cache->Release(handle);
+    ASSERT_EQ(1, Lookup(cache, key));
+
+    Insert(cache, key, 2);
+    ASSERT_EQ(2, Lookup(cache, key));
+    Erase(cache, key);
+    ASSERT_EQ(-1, Lookup(cache, key));
+  }
+}
+
 TEST_P(CacheTest, EntriesArePinned) {
   Insert(100, 101);
   Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
@@ -365,7 +425,7 @@ TEST_P(CacheTest, EvictionPolicy) {
   Insert(200, 201);
 
   // Frequently used entry must be kept around
-  for (int i = 0; i < kCacheSize * 2; i++) {
+  for (int i = 0; i < NumInsertsToEvictUnused(); i++) {
     Insert(1000+i, 2000+i);
     ASSERT_EQ(101, Lookup(100));
   }
@@ -418,7 +478,7 @@ TEST_P(CacheTest, EvictionPolicyRef) {
   Insert(303, 104);
 
   // Insert entries much more than Cache capacity
-  for (int i = 0; i < kCacheSize * 2; i++) {
+  for (int i = 0; i < NumInsertsToEvictUnused(); i++) {
     Insert(1000 + i, 2000 + i);
   }
 
@@ -464,6 +524,32 @@ TEST_P(CacheTest, EraseFromDeleter) {
   ASSERT_EQ(nullptr, cache->Lookup("bar"));
 }
 
+TEST_P(CacheTest, DrainingInDeleters) {
+  std::vector<bool> draining;
+  std::shared_ptr<Cache> cache = NewCache(2, 0, false);
+  auto insert = [&](const std::string& key) {
+    ASSERT_OK(cache->Insert(key, new DrainingProbe{cache.get(), &draining}, 1,
+                            drainingDeleter));
+  };
+  // Entries evicted to make room or erased
+  insert("a");
+  insert("b");
+  insert("c");
+  cache->Erase("c");
+  ASSERT_FALSE(cache->IsDraining());
+  ASSERT_EQ(2U, draining.size());
+  ASSERT_EQ(std::vector<bool>({false, false}), draining);
+
+  // Entries dropped by SetCapacity() and by the destructor
+  cache->SetCapacity(0);
+  ASSERT_FALSE(cache->IsDraining());
+  ASSERT_EQ(3U, draining.size());
+  cache->SetCapacity(2);
+  insert("d");
+  cache.reset();
+  ASSERT_EQ(std::vector<bool>({false, false, true, true}), draining);
+}
+
 TEST_P(CacheTest, ErasedHandleState) {
   // insert a key and get two handles
   Insert(100, 1000);
@@ -731,6 +817,78 @@ TEST_P(CacheTest, ApplyToAllCacheEntiresTest) {
   ASSERT_TRUE(inserted == callback_state);
 }
 
+namespace {
+std::atomic<int> live_values(0);
+void checkedDeleter(const Slice& key, void* value) {
+  int* v = static_cast<int*>(value);
+  assert(*v == DecodeKey(key));
+  delete v;
+  live_values.fetch_sub(1);
+}
+}  // namespace
+
+TEST_P(CacheTest, ConcurrentOperations) {
+  const int kNumThreads = 8;
+  const int kNumKeys = 2000;
+  const int kOpsPerThread = 20000;
+  std::shared_ptr<Cache> cache = NewCache(kNumKeys / 4, 2, false);
+  live_values.store(0);
+
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&cache, t]() {
+      Random rnd(301 + t);
+      Cache::Handle* pinned = nullptr;
+      for (int i = 0; i < kOpsPerThread; i++) {
+        int key = static_cast<int>(rnd.Skewed(11)) % kNumKeys;
+        std::string encoded = EncodeKey(key);
+        switch (rnd.Uniform(10)) {
+          case 0:
+            cache->Erase(encoded);
+            break;
+          case 1:
+          case 2: {
+            live_values.fetch_add(1);
+            Cache::Handle* h = nullptr;
+            Status s = cache->Insert(encoded, new int(key), 1, &checkedDeleter,
+                                     rnd.OneIn(2) ? &h : nullptr);
+            ASSERT_OK(s);
+            if (h != nullptr) {
+              ASSERT_EQ(key, *static_cast<int*>(cache->Value(h)));
+              cache->Release(h, rnd.OneIn(4) /* force_erase */);
+            }
+            break;
+          }
+          default: {
+            Cache::Handle* h = cache->Lookup(encoded);
+            if (h != nullptr) {
+              ASSERT_EQ(key, *static_cast<int*>(cache->Value(h)));
+              // Keep some handles across other operations.
+              if (pinned != nullptr) {
+                cache->Release(pinned);
+              }
+              pinned = h;
+            }
+            break;
+          }
+        }
+      }
+      if (pinned != nullptr) {
+        cache->Release(pinned);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(0U, cache->GetPinnedUsage());
+  ASSERT_LE(cache->GetUsage(), cache->GetCapacity());
+  cache->EraseUnRefEntries();
+  ASSERT_EQ(0U, cache->GetUsage());
+  ASSERT_EQ(0, live_values.load());
+}
+
 TEST_P(CacheTest, DefaultShardBits) {
   // test1: set the flag to false. Insert more keys than capacity. See if they
   // all go through.
@@ -759,9 +917,10 @@ TEST_P(CacheTest, GetCharge) {
 std::shared_ptr<Cache> (*new_clock_cache_func)(
     size_t, int, bool, CacheMetadataChargePolicy) = NewClockCache;
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest,
-                        testing::Values(kLRU, kClock));
+                        testing::Values(kLRU, kClock, kLockFreeClock));
 #else
-INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest, testing::Values(kLRU));
+INSTANTIATE_TEST_CASE_P(CacheTestInstance, CacheTest,
+                        testing::Values(kLRU, kLockFreeClock));
 #endif  // SUPPORT_CLOCK_CACHE
 INSTANTIATE_TEST_CASE_P(CacheTestInstance, LRUCacheTest, testing::Values(kLRU));
 
@@ -714,7 +714,10 @@ class ClockCache final : public ShardedCache {
     SetStrictCapacityLimit(strict_capacity_limit);
   }
 
-  ~ClockCache() override { delete[] shards_; }
+  ~ClockCache() override {
+    StartDraining();
+    delete[] shards_;
+  }
 
   const char* Name() const override { return "ClockCache"; }
 
@@ -0,0 +1,667 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "cache/lock_free_clock_cache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+// Layout of LockFreeClockHandle::meta, see lock_free_clock_cache.h.
+const int kCounterNumBits = 30;
+const uint64_t kCounterMask = (uint64_t{1} << kCounterNumBits) - 1;
+const uint64_t kCounterTopBit = uint64_t{1} << (kCounterNumBits - 1);
+const int kAcquireCounterShift = 0;
+const uint64_t kAcquireIncrement = uint64_t{1} << kAcquireCounterShift;
+const int kReleaseCounterShift = kCounterNumBits;
+const uint64_t kReleaseIncrement = uint64_t{1} << kReleaseCounterShift;
+const int kStateShift = 2 * kCounterNumBits + 1;
+
+const uint8_t kStateOccupiedBit = 0x4;
+const uint8_t kStateShareableBit = 0x2;
+const uint8_t kStateVisibleBit = 0x1;
+
+// Free slot.
+const uint8_t kStateEmpty = 0;
+// Owned by a single thread which is filling or freeing it.
+const uint8_t kStateConstruction = kStateOccupiedBit;
+// Erased or replaced, freed when the last reference goes away.
+const uint8_t kStateInvisible = kStateOccupiedBit | kStateShareableBit;
+// Can be found by Lookup.
+const uint8_t kStateVisible =
+    kStateOccupiedBit | kStateShareableBit | kStateVisibleBit;
+
+// Countdown of high priority entries, and the cap applied by the clock hand
+// to entries that were hit more often. An entry survives at most this many
+// passes of the hand without being hit.
+const uint64_t kMaxCountdown = 3;
+// Low priority entries start out close to eviction so that blocks read once
+// by a scan leave the cache before the ones being hit repeatedly.
+const uint64_t kLowPriCountdown = 1;
+
+// Slots visited by the clock hand per atomic increment.
+const uint64_t kClockStep = 4;
+
+// Tables are sized for this load factor at the estimated entry charge, and
+// inserts fail above kStrictLoadFactor.
+const double kLoadFactor = 0.7;
+const double kStrictLoadFactor = 0.84;
+const int kMinLengthBits = 4;
+const int kMaxLengthBits = 30;
+
+inline uint8_t GetState(uint64_t meta) {
+  return static_cast<uint8_t>(meta >> kStateShift);
+}
+
+inline uint64_t GetAcquireCounter(uint64_t meta) {
+  return (meta >> kAcquireCounterShift) & kCounterMask;
+}
+
+inline uint64_t GetReleaseCounter(uint64_t meta) {
+  return (meta >> kReleaseCounterShift) & kCounterMask;
+}
+
+inline uint64_t GetRefcount(uint64_t meta) {
+  return (GetAcquireCounter(meta) - GetReleaseCounter(meta)) & kCounterMask;
+}
+
+inline uint64_t MakeMeta(uint8_t state, uint64_t acquire_counter,
+                         uint64_t release_counter) {
+  return (uint64_t{state} << kStateShift) |
+         (acquire_counter << kAcquireCounterShift) |
+         (release_counter << kReleaseCounterShift);
+}
+
+// Called with a reference held on `h` and the meta value seen when it was
+// taken. Entries that are hit a lot without ever meeting the clock hand
+// would eventually overflow their counters; clearing the same top bit of
+// both keeps the reference count intact.
+inline void CorrectNearOverflow(uint64_t meta, LockFreeClockHandle* h) {
+  if (meta & (kCounterTopBit << kReleaseCounterShift)) {
+    h->meta.fetch_and(~((kCounterTopBit << kAcquireCounterShift) |
+                        (kCounterTopBit << kReleaseCounterShift)),
+                      std::memory_order_relaxed);
+  }
+}
+
+int CalcLengthBits(size_t capacity, size_t estimated_entry_charge) {
+  double num_slots = static_cast<double>(capacity) /
+                     static_cast<double>(estimated_entry_charge) / kLoadFactor;
+  int length_bits = kMinLengthBits;
+  while (length_bits < kMaxLengthBits &&
+         static_cast<double>(uint64_t{1} << length_bits) < num_slots) {
+    length_bits++;
+  }
+  return length_bits;
+}
+
+}  // namespace
+
+LockFreeClockCacheShard::LockFreeClockCacheShard(
+    size_t capacity, size_t estimated_entry_charge, bool strict_capacity_limit,
+    CacheMetadataChargePolicy metadata_charge_policy)
+    : length_bits_(CalcLengthBits(capacity, estimated_entry_charge)),
+      length_mask_((size_t{1} << length_bits_) - 1),
+      occupancy_limit_(
+          static_cast<size_t>((length_mask_ + 1) * kStrictLoadFactor)),
+      estimated_entry_charge_(estimated_entry_charge),
+      table_(new LockFreeClockHandle[length_mask_ + 1]),
+      capacity_(capacity),
+      strict_capacity_limit_(strict_capacity_limit),
+      usage_(0),
+      occupancy_(0),
+      clock_pointer_(0) {
+  set_metadata_charge_policy(metadata_charge_policy);
+}
+
+LockFreeClockCacheShard::~LockFreeClockCacheShard() {
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[i];
+    uint64_t meta = h->meta.load(std::memory_order_acquire);
+    if (GetState(meta) == kStateEmpty) {
+      continue;
+    }
+    // Like LRUCache, entries still referenced by someone are leaked rather
+    // than deleted under their feet.
+    if ((GetState(meta) & kStateShareableBit) && GetRefcount(meta) == 0 &&
+        h->deleter != nullptr) {
+      (*h->deleter)(h->key(), h->value);
+    }
+    delete[] h->key_data;
+  }
+}
+
+size_t LockFreeClockCacheShard::CalcTotalCharge(const Slice& key,
+                                                size_t charge) const {
+  size_t meta_charge = 0;
+  if (metadata_charge_policy_ == kFullChargeCacheMetadata) {
+    // The slot is preallocated but only one entry can use it at a time; the
+    // key copy is allocated per entry.
+    meta_charge += sizeof(LockFreeClockHandle) + key.size();
+  }
+  return charge + meta_charge;
+}
+
+size_t LockFreeClockCacheShard::ProbeStart(uint32_t hash) const {
+  // The top bits of the hash select the shard, so mix it before taking the
+  // top bits for the slot.
+  uint64_t h = uint64_t{hash} * 0x9E3779B97F4A7C15ULL;
+  return static_cast<size_t>(h >> (64 - length_bits_));
+}
+
+size_t LockFreeClockCacheShard::ProbeStep(uint32_t hash) const {
+  // Odd, so that the probe sequence visits every slot of the table.
+  uint64_t h = uint64_t{hash} * 0xC2B2AE3D27D4EB4FULL;
+  return static_cast<size_t>(h >> (64 - length_bits_)) | 1;
+}
+
+LockFreeClockHandle* LockFreeClockCacheShard::FindVisible(const Slice& key,
+                                                          uint32_t hash) {
+  const size_t step = ProbeStep(hash);
+  size_t pos = ProbeStart(hash);
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[pos];
+    // Cheap filter so that lookups do not write to slots of other keys.
+    if (h->hash.load(std::memory_order_relaxed) == hash &&
+        GetState(h->meta.load(std::memory_order_relaxed)) == kStateVisible) {
+      uint64_t old_meta =
+          h->meta.fetch_add(kAcquireIncrement, std::memory_order_acquire);
+      uint8_t state = GetState(old_meta);
+      if (state == kStateVisible) {
+        if (h->hash.load(std::memory_order_relaxed) == hash &&
+            h->key() == key) {
+          CorrectNearOverflow(old_meta, h);
+          return h;
+        }
+        h->meta.fetch_sub(kAcquireIncrement, std::memory_order_release);
+      } else if (state == kStateInvisible) {
+        // This may drop the last reference of an erased entry without
+        // freeing it; the clock hand frees it later.
+        h->meta.fetch_sub(kAcquireIncrement, std::memory_order_release);
+      }
+      // In the other states the slot is owned by one thread, which
+      // overwrites the counters before publishing it, so the increment is
+      // harmless and must not be undone.
+    }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    pos = (pos + step) & length_mask_;
+  }
+  return nullptr;
+}
+
+void LockFreeClockCacheShard::HideAndRelease(LockFreeClockHandle* h) {
+  h->meta.fetch_and(~(uint64_t{kStateVisibleBit} << kStateShift),
+                    std::memory_order_acq_rel);
+  uint64_t meta =
+      h->meta.fetch_add(kReleaseIncrement, std::memory_order_release) +
+      kReleaseIncrement;
+  MaybeFreeUnreferenced(h, meta, false /* erase_visible */);
+}
+
+void LockFreeClockCacheShard::HideIfMatches(LockFreeClockHandle* h,
+                                            const Slice& key, uint32_t hash) {
+  if (h->hash.load(std::memory_order_relaxed) != hash ||
+      GetState(h->meta.load(std::memory_order_relaxed)) != kStateVisible) {
+    return;
+  }
+  uint64_t old_meta =
+      h->meta.fetch_add(kAcquireIncrement, std::memory_order_acquire);
+  uint8_t state = GetState(old_meta);
+  if (state == kStateVisible &&
+      h->hash.load(std::memory_order_relaxed) == hash && h->key() == key) {
+    HideAndRelease(h);
+  } else if (state & kStateShareableBit) {
+    h->meta.fetch_sub(kAcquireIncrement, std::memory_order_release);
+  }
+  // See FindVisible() for the other states.
+}
+
+LockFreeClockHandle* LockFreeClockCacheShard::ClaimSlot(const Slice& key,
+                                                        uint32_t hash) {
+  const size_t step = ProbeStep(hash);
+  size_t pos = ProbeStart(hash);
+  LockFreeClockHandle* claimed = nullptr;
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[pos];
+    // Hide the entries being replaced. They are freed right away unless
+    // somebody still holds them, and their slots may then be reused below.
+    HideIfMatches(h, key, hash);
+    if (claimed == nullptr) {
+      if (GetState(h->meta.load(std::memory_order_relaxed)) == kStateEmpty) {
+        uint64_t old_meta =
+            h->meta.fetch_or(uint64_t{kStateOccupiedBit} << kStateShift,
+                             std::memory_order_acquire);
+        if (GetState(old_meta) == kStateEmpty) {
+          claimed = h;
+        }
+      }
+      if (claimed == nullptr) {
+        h->displacements.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    // An older entry with the same key may sit further along, in a slot that
+    // was taken when it was inserted and has been freed since. Nothing of
+    // this hash lies past a slot no entry was displaced from.
+    if (claimed != nullptr &&
+        h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    pos = (pos + step) & length_mask_;
+  }
+  if (claimed == nullptr) {
+    RollbackDisplacements(hash, nullptr);
+  }
+  return claimed;
+}
+
+void LockFreeClockCacheShard::RollbackDisplacements(
+    uint32_t hash, const LockFreeClockHandle* end) {
+  const size_t step = ProbeStep(hash);
+  size_t pos = ProbeStart(hash);
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[pos];
+    if (h == end) {
+      break;
+    }
+    h->displacements.fetch_sub(1, std::memory_order_relaxed);
+    pos = (pos + step) & length_mask_;
+  }
+}
+
+void LockFreeClockCacheShard::FreeEntry(LockFreeClockHandle* h) {
+  assert(GetState(h->meta.load(std::memory_order_relaxed)) ==
+         kStateConstruction);
+  if (h->deleter != nullptr) {
+    (*h->deleter)(h->key(), h->value);
+  }
+  delete[] h->key_data;
+  h->key_data = nullptr;
+  const size_t total_charge = h->total_charge;
+  RollbackDisplacements(h->hash.load(std::memory_order_relaxed), h);
+  h->meta.store(0, std::memory_order_release);
+  usage_.fetch_sub(total_charge, std::memory_order_relaxed);
+  // Only after the slot became empty, so that occupancy_ never undercounts
+  // the slots in use.
+  occupancy_.fetch_sub(1, std::memory_order_release);
+}
+
+bool LockFreeClockCacheShard::MaybeFreeUnreferenced(LockFreeClockHandle* h,
+                                                    uint64_t meta,
+                                                    bool erase_visible) {
+  for (;;) {
+    uint8_t state = GetState(meta);
+    if (!(state & kStateShareableBit) || GetRefcount(meta) != 0) {
+      return false;
+    }
+    if (state == kStateVisible && !erase_visible) {
+      return false;
+    }
+    if (h->meta.compare_exchange_weak(
+            meta, uint64_t{kStateConstruction} << kStateShift,
+            std::memory_order_acquire, std::memory_order_relaxed)) {
+      FreeEntry(h);
+      return true;
+    }
+  }
+}
+
+bool LockFreeClockCacheShard::ClockUpdate(LockFreeClockHandle* h,
+                                          size_t* freed_charge) {
+  uint64_t meta = h->meta.load(std::memory_order_relaxed);
+  uint8_t state = GetState(meta);
+  if (!(state & kStateShareableBit)) {
+    return false;
+  }
+  uint64_t acquire_counter = GetAcquireCounter(meta);
+  if (acquire_counter != GetReleaseCounter(meta)) {
+    // Referenced.
+    return false;
+  }
+  if (state == kStateVisible && acquire_counter > 0) {
+    uint64_t countdown = std::min(acquire_counter - 1, kMaxCountdown - 1);
+    // Losing the race to a reader or to another clock hand is fine.
+    h->meta.compare_exchange_strong(meta, MakeMeta(state, countdown, countdown),
+                                    std::memory_order_relaxed);
+    return false;
+  }
+  if (!h->meta.compare_exchange_strong(
+          meta, uint64_t{kStateConstruction} << kStateShift,
+          std::memory_order_acquire, std::memory_order_relaxed)) {
+    return false;
+  }
+  *freed_charge = h->total_charge;
+  FreeEntry(h);
+  return true;
+}
+
+void LockFreeClockCacheShard::Evict(size_t charge_to_free) {
+  size_t freed_charge = 0;
+  const uint64_t max_clock = clock_pointer_.load(std::memory_order_relaxed) +
+                             (kMaxCountdown + 1) * (length_mask_ + 1);
+  for (;;) {
+    uint64_t start =
+        clock_pointer_.fetch_add(kClockStep, std::memory_order_relaxed);
+    for (uint64_t i = 0; i < kClockStep; i++) {
+      size_t charge = 0;
+      if (ClockUpdate(&table_[(start + i) & length_mask_], &charge)) {
+        freed_charge += charge;
+        if (freed_charge >= charge_to_free) {
+          return;
+        }
+      }
+    }
+    if (start + kClockStep >= max_clock) {
+      return;
+    }
+  }
+}
+
+void LockFreeClockCacheShard::SetCapacity(size_t capacity) {
+  capacity_.store(capacity, std::memory_order_relaxed);
+  size_t usage = usage_.load(std::memory_order_relaxed);
+  if (usage > capacity) {
+    Evict(usage - capacity);
+  }
+}
+
+void LockFreeClockCacheShard::SetStrictCapacityLimit(
+    bool strict_capacity_limit) {
+  strict_capacity_limit_.store(strict_capacity_limit,
+                               std::memory_order_relaxed);
+}
+
+Status LockFreeClockCacheShard::Insert(
+    const Slice& key, uint32_t hash, void* value, size_t charge,
+    void (*deleter)(const Slice& key, void* value), Cache::Handle** handle,
+    Cache::Priority priority) {
+  const size_t total_charge = CalcTotalCharge(key, charge);
+  const size_t capacity = capacity_.load(std::memory_order_relaxed);
+  // Like LRUCache, an entry nobody holds a handle to is not inserted past
+  // the capacity even without strict_capacity_limit.
+  const bool must_fit =
+      strict_capacity_limit_.load(std::memory_order_relaxed) ||
+      handle == nullptr;
+
+  size_t usage = usage_.load(std::memory_order_relaxed);
+  size_t charge_to_free =
+      usage + total_charge > capacity ? usage + total_charge - capacity : 0;
+  bool need_slot =
+      occupancy_.load(std::memory_order_relaxed) >= occupancy_limit_;
+  if (charge_to_free > 0 || need_slot) {
+    Evict(charge_to_free);
+  }
+
+  bool reserved = false;
+  if (occupancy_.fetch_add(1, std::memory_order_acquire) < occupancy_limit_) {
+    reserved = true;
+    if (must_fit) {
+      usage = usage_.load(std::memory_order_relaxed);
+      do {
+        if (usage + total_charge > capacity) {
+          reserved = false;
+          break;
+        }
+      } while (!usage_.compare_exchange_weak(usage, usage + total_charge,
+                                             std::memory_order_relaxed));
+    } else {
+      usage_.fetch_add(total_charge, std::memory_order_relaxed);
+    }
+    if (!reserved) {
+      occupancy_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  } else {
+    occupancy_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  LockFreeClockHandle* h = reserved ? ClaimSlot(key, hash) : nullptr;
+  if (h == nullptr) {
+    if (reserved) {
+      usage_.fetch_sub(total_charge, std::memory_order_relaxed);
+      occupancy_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (handle == nullptr) {
+      // Don't insert the entry but still return ok, as if the entry inserted
+      // into cache and get evicted immediately.
+      if (deleter != nullptr) {
+        (*deleter)(key, value);
+      }
+      return Status::OK();
+    }
+    *handle = nullptr;
+    return Status::Incomplete("Insert failed due to CLOCK cache being full.");
+  }
+
+  // The slot is ours until meta is published below.
+  h->key_data = new char[key.size()];
+  memcpy(h->key_data, key.data(), key.size());
+  h->key_length = key.size();
+  h->hash.store(hash, std::memory_order_relaxed);
+  h->value = value;
+  h->deleter = deleter;
+  h->charge = charge;
+  h->total_charge = total_charge;
+  uint64_t countdown =
+      priority == Cache::Priority::HIGH ? kMaxCountdown : kLowPriCountdown;
+  h->meta.store(MakeMeta(kStateVisible, countdown,
+                         handle != nullptr ? countdown - 1 : countdown),
+                std::memory_order_release);
+  if (handle != nullptr) {
+    *handle = reinterpret_cast<Cache::Handle*>(h);
+  }
+  return Status::OK();
+}
+
+Cache::Handle* LockFreeClockCacheShard::Lookup(const Slice& key,
+                                               uint32_t hash) {
+  return reinterpret_cast<Cache::Handle*>(FindVisible(key, hash));
+}
+
+bool LockFreeClockCacheShard::Ref(Cache::Handle* handle) {
+  LockFreeClockHandle* h = reinterpret_cast<LockFreeClockHandle*>(handle);
+  uint64_t old_meta =
+      h->meta.fetch_add(kAcquireIncrement, std::memory_order_acquire);
+  assert(GetState(old_meta) & kStateShareableBit);
+  assert(GetRefcount(old_meta) > 0);
+  CorrectNearOverflow(old_meta, h);
+  return true;
+}
+
+bool LockFreeClockCacheShard::Release(Cache::Handle* handle,
+                                      bool force_erase) {
+  if (handle == nullptr) {
+    return false;
+  }
+  LockFreeClockHandle* h = reinterpret_cast<LockFreeClockHandle*>(handle);
+  uint64_t meta =
+      h->meta.fetch_add(kReleaseIncrement, std::memory_order_release) +
+      kReleaseIncrement;
+  assert(GetState(meta) & kStateShareableBit);
+  // Same as LRUCache: the last reference going away erases the entry if it
+  // was asked for or if the cache is over capacity.
+  bool erase_visible =
+      force_erase || usage_.load(std::memory_order_relaxed) >
+                         capacity_.load(std::memory_order_relaxed);
+  return MaybeFreeUnreferenced(h, meta, erase_visible);
+}
+
+void LockFreeClockCacheShard::Erase(const Slice& key, uint32_t hash) {
+  // Replacing an entry hides the old one, but a racing insert of the same
+  // key may leave more than one visible, so look at the whole probe
+  // sequence.
+  const size_t step = ProbeStep(hash);
+  size_t pos = ProbeStart(hash);
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[pos];
+    HideIfMatches(h, key, hash);
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+    pos = (pos + step) & length_mask_;
+  }
+}
+
+size_t LockFreeClockCacheShard::GetUsage() const {
+  return usage_.load(std::memory_order_relaxed);
+}
+
+template <typename Func>
+void LockFreeClockCacheShard::ApplyToShareableEntries(Func func,
+                                                      bool visible_only) const {
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[i];
+    uint8_t state = GetState(h->meta.load(std::memory_order_relaxed));
+    if (!(state & kStateShareableBit)) {
+      continue;
+    }
+    // Hold a reference so that the entry cannot be freed while `func` looks
+    // at it.
+    uint64_t meta =
+        h->meta.fetch_add(kAcquireIncrement, std::memory_order_acquire) +
+        kAcquireIncrement;
+    state = GetState(meta);
+    if (state & kStateShareableBit) {
+      if (!visible_only || state == kStateVisible) {
+        func(h, meta);
+      }
+      h->meta.fetch_sub(kAcquireIncrement, std::memory_order_release);
+    }
+  }
+}
+
+size_t LockFreeClockCacheShard::GetPinnedUsage() const {
+  size_t pinned_usage = 0;
+  ApplyToShareableEntries(
+      [&pinned_usage](LockFreeClockHandle* h, uint64_t meta) {
+        // Not counting the reference held by ApplyToShareableEntries.
+        if (GetRefcount(meta) > 1) {
+          pinned_usage += h->total_charge;
+        }
+      },
+      false /* visible_only */);
+  return pinned_usage;
+}
+
+void LockFreeClockCacheShard::ApplyToAllCacheEntries(
+    void (*callback)(void*, size_t), bool /*thread_safe*/) {
+  ApplyToShareableEntries(
+      [callback](LockFreeClockHandle* h, uint64_t /*meta*/) {
+        (*callback)(h->value, h->charge);
+      },
+      true /* visible_only */);
+}
+
+void LockFreeClockCacheShard::EraseUnRefEntries() {
+  for (size_t i = 0; i <= length_mask_; i++) {
+    LockFreeClockHandle* h = &table_[i];
+    MaybeFreeUnreferenced(h, h->meta.load(std::memory_order_relaxed),
+                          true /* erase_visible */);
+  }
+}
+
+std::string LockFreeClockCacheShard::GetPrintableOptions() const {
+  const int kBufferSize = 200;
+  char buffer[kBufferSize];
+  snprintf(buffer, kBufferSize,
+           "    estimated_entry_charge : %" ROCKSDB_PRIszt
+           "\n    table_length : %" ROCKSDB_PRIszt "\n",
+           estimated_entry_charge_, length_mask_ + 1);
+  return std::string(buffer);
+}
+
+LockFreeClockCache::LockFreeClockCache(
+    size_t capacity, size_t estimated_entry_charge, int num_shard_bits,
+    bool strict_capacity_limit,
+    CacheMetadataChargePolicy metadata_charge_policy)
+    : ShardedCache(capacity, num_shard_bits, strict_capacity_limit) {
+  num_shards_ = 1 << num_shard_bits;
+  shards_ = reinterpret_cast<LockFreeClockCacheShard*>(
+      port::cacheline_aligned_alloc(sizeof(LockFreeClockCacheShard) *
+                                    num_shards_));
+  size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+  for (int i = 0; i < num_shards_; i++) {
+    new (&shards_[i])
+        LockFreeClockCacheShard(per_shard, estimated_entry_charge,
+                                strict_capacity_limit, metadata_charge_policy);
+  }
+}
+
+LockFreeClockCache::~LockFreeClockCache() {
+  StartDraining();
+  if (shards_ != nullptr) {
+    assert(num_shards_ > 0);
+    for (int i = 0; i < num_shards_; i++) {
+      shards_[i].~LockFreeClockCacheShard();
+    }
+    port::cacheline_aligned_free(shards_);
+  }
+}
+
+CacheShard* LockFreeClockCache::GetShard(int shard) {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+const CacheShard* LockFreeClockCache::GetShard(int shard) const {
+  return reinterpret_cast<CacheShard*>(&shards_[shard]);
+}
+
+void* LockFreeClockCache::Value(Handle* handle) {
+  return reinterpret_cast<const LockFreeClockHandle*>(handle)->value;
+}
+
+size_t LockFreeClockCache::GetCharge(Handle* handle) const {
+  return reinterpret_cast<const LockFreeClockHandle*>(handle)->charge;
+}
+
+uint32_t LockFreeClockCache::GetHash(Handle* handle) const {
+  return reinterpret_cast<const LockFreeClockHandle*>(handle)->hash.load(
+      std::memory_order_relaxed);
+}
+
+void LockFreeClockCache::DisownData() {
+// Do not drop data if compile with ASAN to suppress leak warning.
+#if defined(__clang__)
+#if !defined(__has_feature) || !__has_feature(address_sanitizer)
+  shards_ = nullptr;
+  num_shards_ = 0;
+#endif
+#else  // __clang__
+#ifndef __SANITIZE_ADDRESS__
+  shards_ = nullptr;
+  num_shards_ = 0;
+#endif  // !__SANITIZE_ADDRESS__
+#endif  // __clang__
+}
+
+std::shared_ptr<Cache> NewLockFreeClockCache(
+    size_t capacity, size_t estimated_entry_charge, int num_shard_bits,
+    bool strict_capacity_limit,
+    CacheMetadataChargePolicy metadata_charge_policy) {
+  if (num_shard_bits >= 20) {
+    return nullptr;  // the cache cannot be sharded into too many fine pieces
+  }
+  if (estimated_entry_charge == 0) {
+    return nullptr;
+  }
+  if (num_shard_bits < 0) {
+    num_shard_bits = GetDefaultCacheShardBits(capacity);
+  }
+  return std::make_shared<LockFreeClockCache>(
+      capacity, estimated_entry_charge, num_shard_bits, strict_capacity_limit,
+      metadata_charge_policy);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,188 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "cache/sharded_cache.h"
+
+#include "port/port.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// CLOCK cache whose Lookup, Ref and Release never take a lock.
+//
+// Every shard keeps its entries in a fixed-size open-addressed table, sized
+// from the capacity and an estimated charge per entry. Each slot carries one
+// atomic word (`meta`) holding:
+//
+//   bits  0..29  acquire counter
+//   bits 30..59  release counter
+//   bits 61..63  state: empty, under construction (owned by one thread),
+//                invisible (erased but still referenced) or visible
+//
+// The number of outstanding references is acquire - release. A lookup takes
+// a reference with a single fetch_add on the acquire counter and checks the
+// state it got back; a release is a fetch_add on the release counter. While
+// an entry is unreferenced the counters are equal and their common value is
+// the CLOCK countdown: every hit raises it by one, the clock hand lowers it
+// (capped at kMaxCountdown) and evicts the entry once it reaches zero. A
+// slot can only be freed or reused by the thread that moves it from an
+// unreferenced shareable state to "under construction" with a CAS, so a
+// reader holding a reference can safely read the key and value.
+//
+// Each slot also counts how many entries were probed past it on insertion
+// (`displacements`), which lets a lookup stop at the first slot that no entry
+// was ever displaced beyond instead of scanning the whole probe sequence.
+struct LockFreeClockHandle {
+  std::atomic<uint64_t> meta{0};
+  std::atomic<uint32_t> displacements{0};
+  // Only written under construction; read racily as a filter before taking
+  // a reference, hence atomic.
+  std::atomic<uint32_t> hash{0};
+  void* value = nullptr;
+  void (*deleter)(const Slice&, void* value) = nullptr;
+  size_t charge = 0;
+  size_t total_charge = 0;
+  char* key_data = nullptr;
+  size_t key_length = 0;
+
+  Slice key() const { return Slice(key_data, key_length); }
+};
+
+class ALIGN_AS(CACHE_LINE_SIZE) LockFreeClockCacheShard final
+    : public CacheShard {
+ public:
+  LockFreeClockCacheShard(size_t capacity, size_t estimated_entry_charge,
+                          bool strict_capacity_limit,
+                          CacheMetadataChargePolicy metadata_charge_policy);
+  virtual ~LockFreeClockCacheShard() override;
+
+  // The table is not resized: raising the capacity well above the initial
+  // one leaves the shard bounded by its slot count rather than by charge.
+  virtual void SetCapacity(size_t capacity) override;
+
+  virtual void SetStrictCapacityLimit(bool strict_capacity_limit) override;
+
+  virtual Status Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Handle** handle,
+                        Cache::Priority priority) override;
+  virtual Cache::Handle* Lookup(const Slice& key, uint32_t hash) override;
+  virtual bool Ref(Cache::Handle* handle) override;
+  virtual bool Release(Cache::Handle* handle,
+                       bool force_erase = false) override;
+  virtual void Erase(const Slice& key, uint32_t hash) override;
+
+  virtual size_t GetUsage() const override;
+  virtual size_t GetPinnedUsage() const override;
+
+  virtual void ApplyToAllCacheEntries(void (*callback)(void*, size_t),
+                                      bool thread_safe) override;
+
+  virtual void EraseUnRefEntries() override;
+
+  virtual std::string GetPrintableOptions() const override;
+
+ private:
+  size_t CalcTotalCharge(const Slice& key, size_t charge) const;
+
+  // First slot and (odd) step of the probe sequence of `hash`.
+  size_t ProbeStart(uint32_t hash) const;
+  size_t ProbeStep(uint32_t hash) const;
+
+  // Looks up a visible entry and returns it with a reference held.
+  LockFreeClockHandle* FindVisible(const Slice& key, uint32_t hash);
+
+  // Claims the first empty slot on the probe sequence of `hash`, and hides
+  // every visible entry with the same key on the sequence, including the
+  // ones past the claimed slot. Returns nullptr if every slot was taken.
+  LockFreeClockHandle* ClaimSlot(const Slice& key, uint32_t hash);
+
+  // Hides `h` if it is a visible entry with the given key, freeing it
+  // unless somebody still holds a reference.
+  void HideIfMatches(LockFreeClockHandle* h, const Slice& key, uint32_t hash);
+
+  // Undoes the displacement counts left by an entry of `hash` sitting in
+  // slot `end` (or by a failed insertion if `end` is nullptr).
+  void RollbackDisplacements(uint32_t hash, const LockFreeClockHandle* end);
+
+  // Drops the caller's reference to a visible entry after hiding it from
+  // lookups, freeing it if that was the last reference.
+  void HideAndRelease(LockFreeClockHandle* h);
+
+  // Drops the entry of a slot the caller moved to the construction state
+  // and marks the slot empty.
+  void FreeEntry(LockFreeClockHandle* h);
+
+  // Frees `h` if it is unreferenced and either invisible or
+  // `erase_visible` is set. `meta` is the value the caller last saw in the
+  // slot. Returns true if the entry was freed.
+  bool MaybeFreeUnreferenced(LockFreeClockHandle* h, uint64_t meta,
+                             bool erase_visible);
+
+  // One step of the clock hand over `h`: lowers its countdown, or frees it
+  // if the countdown ran out. Returns true and sets `freed_charge` if the
+  // entry was freed.
+  bool ClockUpdate(LockFreeClockHandle* h, size_t* freed_charge);
+
+  // Moves the clock hand until at least one entry and `charge_to_free` were
+  // freed, or until every entry had its chance to be evicted.
+  void Evict(size_t charge_to_free);
+
+  // Calls func(handle, meta) on every entry that can be referenced, holding
+  // a reference to it for the duration of the call.
+  template <typename Func>
+  void ApplyToShareableEntries(Func func, bool visible_only) const;
+
+  const int length_bits_;
+  const size_t length_mask_;
+  // Inserts fail once this many slots are in use, which keeps probe
+  // sequences short.
+  const size_t occupancy_limit_;
+  const size_t estimated_entry_charge_;
+  std::unique_ptr<LockFreeClockHandle[]> table_;
+
+  std::atomic<size_t> capacity_;
+  std::atomic<bool> strict_capacity_limit_;
+
+  // Frequently modified, kept on their own cache line.
+  ALIGN_AS(CACHE_LINE_SIZE) std::atomic<size_t> usage_;
+  std::atomic<size_t> occupancy_;
+  std::atomic<uint64_t> clock_pointer_;
+};
+
+class LockFreeClockCache
+#ifdef NDEBUG
+    final
+#endif
+    : public ShardedCache {
+ public:
+  LockFreeClockCache(size_t capacity, size_t estimated_entry_charge,
+                     int num_shard_bits, bool strict_capacity_limit,
+                     CacheMetadataChargePolicy metadata_charge_policy =
+                         kDontChargeCacheMetadata);
+  virtual ~LockFreeClockCache();
+  virtual const char* Name() const override { return "LockFreeClockCache"; }
+  virtual CacheShard* GetShard(int shard) override;
+  virtual const CacheShard* GetShard(int shard) const override;
+  virtual void* Value(Handle* handle) override;
+  virtual size_t GetCharge(Handle* handle) const override;
+  virtual uint32_t GetHash(Handle* handle) const override;
+  virtual void DisownData() override;
+
+ private:
+  LockFreeClockCacheShard* shards_ = nullptr;
+  int num_shards_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -22,15 +22,18 @@ ShardedCache::ShardedCache(size_t capacity, int num_shard_bits,
       num_shard_bits_(num_shard_bits),
       capacity_(capacity),
       strict_capacity_limit_(strict_capacity_limit),
-      last_id_(1) {}
+      last_id_(1),
+      draining_(false) {}
 
 void ShardedCache::SetCapacity(size_t capacity) {
   int num_shards = 1 << num_shard_bits_;
   const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
   MutexLock l(&capacity_mutex_);
+  draining_.store(true, std::memory_order_relaxed);
   for (int s = 0; s < num_shards; s++) {
     GetShard(s)->SetCapacity(per_shard);
   }
+  draining_.store(false, std::memory_order_relaxed);
   capacity_ = capacity;
 }
 
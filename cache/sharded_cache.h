@@ -67,6 +67,9 @@ class ShardedCache : public Cache {
   virtual void DisownData() override = 0;
 
   virtual void SetCapacity(size_t capacity) override;
+  virtual bool IsDraining() const override {
+    return draining_.load(std::memory_order_relaxed);
+  }
   virtual void SetStrictCapacityLimit(bool strict_capacity_limit) override;
 
   virtual Status Insert(const Slice& key, void* value, size_t charge,
@@ -89,6 +92,11 @@ class ShardedCache : public Cache {
 
   int GetNumShardBits() const { return num_shard_bits_; }
 
+ protected:
+  // Called by the destructors of the implementations before their shards
+  // free the entries
+  void StartDraining() { draining_.store(true, std::memory_order_relaxed); }
+
  private:
   static inline uint32_t HashSlice(const Slice& s) {
     return static_cast<uint32_t>(GetSliceNPHash64(s));
@@ -104,6 +112,7 @@ class ShardedCache : public Cache {
   size_t capacity_;
   bool strict_capacity_limit_;
   std::atomic<uint64_t> last_id_;
+  std::atomic<bool> draining_;
 };
 
 extern int GetDefaultCacheShardBits(size_t capacity);
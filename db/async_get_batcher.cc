@@ -0,0 +1,102 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/async_get_batcher.h"
+
+#include <vector>
+
+#include "table/multiget_context.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// Requests can only share a MultiGet() if they read the same data the same
+// way.
+bool SameLookupOptions(const ReadOptions& a, const ReadOptions& b) {
+  return a.snapshot == b.snapshot && a.read_tier == b.read_tier &&
+         a.verify_checksums == b.verify_checksums &&
+         a.fill_cache == b.fill_cache &&
+         a.ignore_range_deletions == b.ignore_range_deletions &&
+         a.timestamp == b.timestamp && a.async_io == b.async_io;
+}
+}  // namespace
+
+AsyncGetBatcher::AsyncGetBatcher(DB* db, Env* env) : db_(db), env_(env) {}
+
+AsyncGetBatcher::~AsyncGetBatcher() {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return num_threads_ == 0; });
+  assert(queue_.empty());
+}
+
+void AsyncGetBatcher::GetAsync(const ReadOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key, DB::GetCallback callback) {
+  const int max_threads = env_->GetBackgroundThreads(Env::Priority::USER);
+  if (max_threads <= 0) {
+    PinnableSlice value;
+    Status s = db_->Get(options, column_family, key, &value);
+    callback(s, value);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  queue_.push_back(
+      Request{options, column_family, key.ToString(), std::move(callback)});
+  // Requests that arrive while all the threads are busy wait in the queue
+  // and are then served in batches.
+  if (num_threads_ < max_threads) {
+    num_threads_++;
+    env_->Schedule(&AsyncGetBatcher::BGWork, this, Env::Priority::USER);
+  }
+}
+
+void AsyncGetBatcher::BGWork(void* arg) {
+  reinterpret_cast<AsyncGetBatcher*>(arg)->ServeRequests();
+}
+
+void AsyncGetBatcher::ServeRequests() {
+  std::vector<Request> batch;
+  // Keeps `first` below valid while the batch grows
+  batch.reserve(MultiGetContext::MAX_BATCH_SIZE);
+  std::vector<Slice> keys;
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!queue_.empty()) {
+    batch.clear();
+    batch.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+    const Request& first = batch.front();
+    for (auto it = queue_.begin();
+         it != queue_.end() &&
+         batch.size() < static_cast<size_t>(MultiGetContext::MAX_BATCH_SIZE);) {
+      if (it->column_family == first.column_family &&
+          SameLookupOptions(it->options, first.options)) {
+        batch.push_back(std::move(*it));
+        it = queue_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    lock.unlock();
+
+    keys.clear();
+    for (const Request& request : batch) {
+      keys.emplace_back(request.key);
+    }
+    std::vector<PinnableSlice> values(batch.size());
+    std::vector<Status> statuses(batch.size());
+    db_->MultiGet(batch.front().options, batch.front().column_family,
+                  keys.size(), keys.data(), values.data(), statuses.data());
+    for (size_t i = 0; i < batch.size(); i++) {
+      batch[i].callback(statuses[i], values[i]);
+    }
+
+    lock.lock();
+  }
+  num_threads_--;
+  cv_.notify_all();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
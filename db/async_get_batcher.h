@@ -0,0 +1,58 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/options.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Serves DB::GetAsync(). Requests are queued and picked up by threads of the
+// Env::Priority::USER pool. Each thread takes the oldest request together
+// with the queued requests for the same column family and read options and
+// looks them up with a single MultiGet(), so the reads of the whole batch go
+// out together. A blocked thread thus keeps many reads in flight instead of
+// one, and a few threads are enough to keep the device busy.
+class AsyncGetBatcher {
+ public:
+  AsyncGetBatcher(DB* db, Env* env);
+
+  // Serves the queued requests before returning
+  ~AsyncGetBatcher();
+
+  AsyncGetBatcher(const AsyncGetBatcher&) = delete;
+  AsyncGetBatcher& operator=(const AsyncGetBatcher&) = delete;
+
+  void GetAsync(const ReadOptions& options, ColumnFamilyHandle* column_family,
+                const Slice& key, DB::GetCallback callback);
+
+ private:
+  struct Request {
+    ReadOptions options;
+    ColumnFamilyHandle* column_family;
+    std::string key;
+    DB::GetCallback callback;
+  };
+
+  static void BGWork(void* arg);
+  void ServeRequests();
+
+  DB* db_;
+  Env* env_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  // Threads scheduled on the USER pool that did not exit yet
+  int num_threads_ = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -524,7 +524,8 @@ ColumnFamilyData::ColumnFamilyData(
       prev_compaction_needed_bytes_(0),
       allow_2pc_(db_options.allow_2pc),
       last_memtable_id_(0),
-      db_paths_registered_(false) {
+      db_paths_registered_(false),
+      pmem_arena_(nullptr) {
   if (id_ != kDummyColumnFamilyDataId) {
     // TODO(cc): RegisterDbPaths can be expensive, considering moving it
     // outside of this constructor which might be called with db mutex held.
@@ -542,15 +543,13 @@ ColumnFamilyData::ColumnFamilyData(
   }
   Ref();
 
-  // 在此处初始化创建 Persistent Arena 
-  // 需要在 ImmutableCFOptions 中添加关于是否开启 Tiered Mode 的参数
-  // 以及关于 persistent 文件的 path
-  if (ioptions_.is_tiered) {
-    char buf[100];
-    snprintf(buf, sizeof(buf), "%s/cf_%u_%s_cuckoo_filters.pool",
-             ioptions_.persistent_file_path_.c_str(), id, name.c_str());
-    std::string path(buf);
-    pmem_arena_ = new PersistentArena(path);
+  // Tier 模式下使用 ColumnFamilySet 中共享的 filter pool,
+  // dummy column family 不会分配 filter
+  if (ioptions_.is_tiered && column_family_set_ != nullptr) {
+    pmem_arena_ = column_family_set_->GetPersistentArena();
+    if (pmem_arena_ != nullptr) {
+      pmem_arena_->RegisterColumnFamily(id_);
+    }
   }
 
   // Convert user defined table properties collector factories to internal ones.
@@ -648,6 +647,11 @@ ColumnFamilyData::~ColumnFamilyData() {
     delete m;
   }
 
+  if (pmem_arena_ != nullptr) {
+    // drop 掉的 column family 的 filter block 会在下一次回收时释放
+    pmem_arena_->UnregisterColumnFamily(id_);
+  }
+
   if (db_paths_registered_) {
     // TODO(cc): considering using ioptions_.fs, currently some tests rely on
     // EnvWrapper, that's the main reason why we use env here.
@@ -879,6 +883,25 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
     write_stall_condition = write_stall_condition_and_cause.first;
     auto write_stall_cause = write_stall_condition_and_cause.second;
 
+    // Tier 模式下 L1+ 的 group 深度同样决定了点查需要读的文件数,
+    // 像 L0 文件数一样, group 过深时需要减缓或停止写入
+    const int tier_group_depth = vstorage->tier_max_group_depth();
+    if (ioptions_.compaction_style == kCompactionStyleTier &&
+        !mutable_cf_options.disable_auto_compactions) {
+      if (write_stall_condition != WriteStallCondition::kStopped &&
+          ioptions_.tier_group_depth_stop_writes_trigger > 0 &&
+          tier_group_depth >= ioptions_.tier_group_depth_stop_writes_trigger) {
+        write_stall_condition = WriteStallCondition::kStopped;
+        write_stall_cause = WriteStallCause::kTierGroupDepthLimit;
+      } else if (write_stall_condition == WriteStallCondition::kNormal &&
+                 ioptions_.tier_group_depth_slowdown_writes_trigger > 0 &&
+                 tier_group_depth >=
+                     ioptions_.tier_group_depth_slowdown_writes_trigger) {
+        write_stall_condition = WriteStallCondition::kDelayed;
+        write_stall_cause = WriteStallCause::kTierGroupDepthLimit;
+      }
+    }
+
     bool was_stopped = write_controller->IsStopped();
     bool needed_delay = write_controller->NeedsDelay();
 
@@ -913,6 +936,15 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
           "[%s] Stopping writes because of estimated pending compaction "
           "bytes %" PRIu64,
           name_.c_str(), compaction_needed_bytes);
+    } else if (write_stall_condition == WriteStallCondition::kStopped &&
+               write_stall_cause == WriteStallCause::kTierGroupDepthLimit) {
+      write_controller_token_ = write_controller->GetStopToken();
+      internal_stats_->AddCFStats(InternalStats::TIER_GROUP_DEPTH_LIMIT_STOPS,
+                                  1);
+      ROCKS_LOG_WARN(ioptions_.info_log,
+                     "[%s] Stopping writes because a vertical group is %d "
+                     "files deep",
+                     name_.c_str(), tier_group_depth);
     } else if (write_stall_condition == WriteStallCondition::kDelayed &&
                write_stall_cause == WriteStallCause::kMemtableLimit) {
       write_controller_token_ =
@@ -973,9 +1005,40 @@ WriteStallCondition ColumnFamilyData::RecalculateWriteStallConditions(
           "bytes %" PRIu64 " rate %" PRIu64,
           name_.c_str(), vstorage->estimated_compaction_needed_bytes(),
           write_controller->delayed_write_rate());
+    } else if (write_stall_condition == WriteStallCondition::kDelayed &&
+               write_stall_cause == WriteStallCause::kTierGroupDepthLimit) {
+      // The group is the last two files from stopping.
+      bool near_stop = ioptions_.tier_group_depth_stop_writes_trigger > 0 &&
+                       tier_group_depth >=
+                           ioptions_.tier_group_depth_stop_writes_trigger - 2;
+      write_controller_token_ =
+          SetupDelay(write_controller, compaction_needed_bytes,
+                     prev_compaction_needed_bytes_, was_stopped || near_stop,
+                     mutable_cf_options.disable_auto_compactions);
+      internal_stats_->AddCFStats(
+          InternalStats::TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS, 1);
+      ROCKS_LOG_WARN(ioptions_.info_log,
+                     "[%s] Stalling writes because a vertical group is %d "
+                     "files deep rate %" PRIu64,
+                     name_.c_str(), tier_group_depth,
+                     write_controller->delayed_write_rate());
     } else {
       assert(write_stall_condition == WriteStallCondition::kNormal);
-      if (vstorage->l0_delay_trigger_count() >=
+      if (ioptions_.compaction_style == kCompactionStyleTier &&
+          ioptions_.tier_max_group_depth_trigger > 0 &&
+          ioptions_.tier_group_depth_slowdown_writes_trigger > 0 &&
+          tier_group_depth >=
+              GetL0ThresholdSpeedupCompaction(
+                  ioptions_.tier_max_group_depth_trigger,
+                  ioptions_.tier_group_depth_slowdown_writes_trigger)) {
+        write_controller_token_ =
+            write_controller->GetCompactionPressureToken();
+        ROCKS_LOG_INFO(
+            ioptions_.info_log,
+            "[%s] Increasing compaction threads because a vertical group is "
+            "%d files deep",
+            name_.c_str(), tier_group_depth);
+      } else if (vstorage->l0_delay_trigger_count() >=
           GetL0ThresholdSpeedupCompaction(
               mutable_cf_options.level0_file_num_compaction_trigger,
               mutable_cf_options.level0_slowdown_writes_trigger)) {
@@ -1437,6 +1500,52 @@ ColumnFamilySet::ColumnFamilySet(const std::string& dbname,
   dummy_cfd_->next_ = dummy_cfd_;
 }
 
+void ColumnFamilySet::OpenPersistentArena(const std::string& db_id,
+                                          bool new_db) {
+  assert(pmem_arena_ == nullptr);
+  assert(column_family_data_.empty());
+  if (db_options_->is_tiered) {
+    const std::string pool_path =
+        db_options_->persistent_file_path_ + "/cuckoo_filters.pool";
+    std::string pool_db_id;
+    if (PersistentArena::ReadPoolDbId(pool_path, &pool_db_id) &&
+        !pool_db_id.empty() &&
+        pool_db_id != db_id.substr(0, POOL_DB_ID_SIZE - 1)) {
+      if (!new_db) {
+        ROCKS_LOG_WARN(db_options_->info_log.get(),
+                       "Group filter pool %s belongs to DB %s, not to %s; "
+                       "opening without group filters",
+                       pool_path.c_str(), pool_db_id.c_str(),
+                       db_id.empty() ? "(unknown)" : db_id.c_str());
+        return;
+      }
+      ROCKS_LOG_WARN(db_options_->info_log.get(),
+                     "Group filter pool %s belongs to DB %s; recreating it "
+                     "for the new DB",
+                     pool_path.c_str(), pool_db_id.c_str());
+      remove(pool_path.c_str());
+    }
+    PmemEmulationOptions emulation;
+    emulation.read_latency_ns = db_options_->persistent_emulate_read_latency_ns_;
+    emulation.write_latency_ns =
+        db_options_->persistent_emulate_write_latency_ns_;
+    emulation.flush_latency_ns =
+        db_options_->persistent_emulate_flush_latency_ns_;
+    emulation.access_granularity =
+        db_options_->persistent_emulate_access_granularity_;
+    PmemMappingOptions mapping;
+    mapping.prefault_threads = db_options_->persistent_map_prefault_threads_;
+    mapping.huge_pages = db_options_->persistent_map_huge_pages_;
+    mapping.numa_node = db_options_->persistent_map_numa_node_;
+    mapping.numa_interleave = db_options_->persistent_map_numa_interleave_;
+    pmem_arena_.reset(new PersistentArena(
+        pool_path,
+        db_options_->persistent_file_size_, db_options_->persistent_block_size_,
+        db_options_->persistent_file_max_size_, emulation,
+        db_options_->statistics.get(), mapping));
+  }
+}
+
 ColumnFamilySet::~ColumnFamilySet() {
   while (column_family_data_.size() > 0) {
     // cfd destructor will delete itself from column_family_data_
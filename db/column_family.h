@@ -474,6 +474,7 @@ class ColumnFamilyData {
     kMemtableLimit,
     kL0FileCountLimit,
     kPendingCompactionBytes,
+    kTierGroupDepthLimit,
   };
   static std::pair<WriteStallCondition, WriteStallCause>
   GetWriteStallConditionAndCause(int num_unflushed_memtables, int num_l0_files,
@@ -602,7 +603,8 @@ class ColumnFamilyData {
 
   bool db_paths_registered_;
 
-  // 每一个 ColumnFamilyData 拥有一个专属的用于存放 cuckoo filter 的 pmem 区
+  // 存放 group cuckoo filter 的 pmem 区, 由 ColumnFamilySet 持有,
+  // 所有 column family 共享
   PersistentArena *pmem_arena_;
 };
 
@@ -688,6 +690,23 @@ class ColumnFamilySet {
 
   WriteController* write_controller() { return write_controller_; }
 
+  // Tier 模式下打开整个 DB 共享的 group filter pool. 只有主实例 (DB::Open)
+  // 会打开它: 只读实例, secondary 实例以及 repair 等工具创建的 VersionSet
+  // 不应该写入正在使用的 pool, 它们的文件都按 key range 判断.
+  //
+  // pool 头中记录了使用它的 DB 的 id. db_id 为打开之前从 IDENTITY 文件读到的
+  // id (没有时为空), new_db 表示 DB 目录中还没有 CURRENT 文件.
+  // pool 属于其他 DB 时 (例如用相同的 persistent_file_path_ 打开 checkpoint),
+  // 新建的 DB 重新创建 pool; 已有的 DB 的文件可能引用其中的 block 号, 不能
+  // 使用别的 pool 的内容, 此时不打开 pool, 该 DB 的文件都按 key range 判断.
+  // 还没有所属 DB 的 pool 由 DBImpl::Open 在 Recover 之后写入 DB id.
+  // REQUIRES: 还没有创建任何 column family
+  void OpenPersistentArena(const std::string& db_id, bool new_db);
+
+  // Tier 模式下整个 DB 共享的 group filter pool, 非 Tier 模式或者没有打开
+  // pool 时为 nullptr
+  PersistentArena* GetPersistentArena() { return pmem_arena_.get(); }
+
  private:
   friend class ColumnFamilyData;
   // helper function that gets called from cfd destructor
@@ -719,6 +738,8 @@ class ColumnFamilySet {
   WriteBufferManager* write_buffer_manager_;
   WriteController* write_controller_;
   BlockCacheTracer* const block_cache_tracer_;
+  // 在所有 ColumnFamilyData 析构之后才释放
+  std::unique_ptr<PersistentArena> pmem_arena_;
 };
 
 // We use ColumnFamilyMemTablesImpl to provide WriteBatch a way to access
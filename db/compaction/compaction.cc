@@ -176,6 +176,13 @@ bool Compaction::IsBottommostLevel(
   }
   Slice smallest_key, largest_key;
   GetBoundaryKeys(vstorage, inputs, &smallest_key, &largest_key);
+  // A tier compaction does not rewrite the output level, its outputs join
+  // the vertical groups they overlap, whose files may hold older versions
+  if (vstorage->compaction_style() == kCompactionStyleTier &&
+      output_level > 0 &&
+      vstorage->OverlapInLevel(output_level, &smallest_key, &largest_key)) {
+    return false;
+  }
   return !vstorage->RangeMightExistAfterSortedRun(smallest_key, largest_key,
                                                   output_level, output_l0_idx);
 }
@@ -372,7 +379,14 @@ bool Compaction::KeyNotExistsBeyondOutputLevel(
               cfd_->ioptions()->compaction_style == kCompactionStyleTier)) {
     // Maybe use binary search to find right entry instead of linear search?
     const Comparator* user_cmp = cfd_->user_comparator();
-    for (int lvl = output_level_ + 1; lvl < number_levels_; lvl++) {
+    // The files of the output level are not inputs of a tier compaction.
+    // They are sorted by smallest key but may overlap, which the scan below
+    // still handles since the keys come in increasing order
+    int first_level =
+        cfd_->ioptions()->compaction_style == kCompactionStyleTier
+            ? output_level_
+            : output_level_ + 1;
+    for (int lvl = first_level; lvl < number_levels_; lvl++) {
       const std::vector<FileMetaData*>& files =
           input_vstorage_->LevelFiles(lvl);
       for (; level_ptrs->at(lvl) < files.size(); level_ptrs->at(lvl)++) {
@@ -155,6 +155,9 @@ struct CompactionJob::SubcompactionState {
   uint64_t overlapped_bytes = 0;
   // A flag determine whether the key has been seen in ShouldStopBefore()
   bool seen_key = false;
+  // Tier 模式下本次 subcompaction 为输出 group 新分配的 filter block,
+  // 在 Install 之后提交给 filter pool
+  uint64_t new_group_filter_block_num = 0;
 
   SubcompactionState(Compaction* c, Slice* _start, Slice* _end,
                      uint64_t size = 0)
@@ -169,7 +172,8 @@ struct CompactionJob::SubcompactionState {
         approx_size(size),
         grandparent_index(0),
         overlapped_bytes(0),
-        seen_key(false) {
+        seen_key(false),
+        new_group_filter_block_num(0) {
     assert(compaction != nullptr);
   }
 
@@ -191,6 +195,7 @@ struct CompactionJob::SubcompactionState {
     grandparent_index = std::move(o.grandparent_index);
     overlapped_bytes = std::move(o.overlapped_bytes);
     seen_key = std::move(o.seen_key);
+    new_group_filter_block_num = std::move(o.new_group_filter_block_num);
     return *this;
   }
 
@@ -696,17 +701,15 @@ Status CompactionJob::Run() {
   thread_pool.reserve(num_threads - 1);
 
   auto* pre_cfd = compact_->compaction->column_family_data();
-  uint64_t input_group_filter_block_num = compact_->compaction->GetInputGroupFilterBlockNum();
   for (size_t i = 1; i < compact_->sub_compact_states.size(); i++) {
     if (pre_cfd->ioptions()->compaction_style == kCompactionStyleTier) {
       thread_pool.emplace_back(&CompactionJob::ProcessKeyValueCompaction, this,
                              &compact_->sub_compact_states[i],
       (i >= output_level_group_filter_block_nums_.size()) ? 0 : 
-                            output_level_group_filter_block_nums_[i],
-                             input_group_filter_block_num);
+                            output_level_group_filter_block_nums_[i]);
     } else {
       thread_pool.emplace_back(&CompactionJob::ProcessKeyValueCompaction, this,
-                             &compact_->sub_compact_states[i], 0, 0);
+                             &compact_->sub_compact_states[i], 0);
     }
   }
 
@@ -715,8 +718,7 @@ Status CompactionJob::Run() {
     // others) in the current thread to be efficient with resources
     ProcessKeyValueCompaction(&compact_->sub_compact_states[0],
     (output_level_group_filter_block_nums_.size() == 0) ? 0 : 
-                            output_level_group_filter_block_nums_[0],
-                            input_group_filter_block_num);
+                            output_level_group_filter_block_nums_[0]);
   } else {
     ProcessKeyValueCompaction(&compact_->sub_compact_states[0]);
   }
@@ -857,6 +859,16 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
   if (status.ok()) {
     status = InstallCompactionResults(mutable_cf_options);
   }
+  // 新分配的 filter block 此时要么已经被当前 Version 引用,
+  // 要么 compaction 失败没有被引用, 都交给 filter pool 的回收逻辑处理
+  if (cfd->GetPersistentArena() != nullptr) {
+    for (const auto& sub_compact : compact_->sub_compact_states) {
+      if (sub_compact.new_group_filter_block_num != 0) {
+        cfd->GetPersistentArena()->CommitBlock(
+            sub_compact.new_group_filter_block_num);
+      }
+    }
+  }
   if (!versions_->io_status().ok()) {
     io_status_ = versions_->io_status();
   }
@@ -946,8 +958,7 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
 }
 
 void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact,
-                                              uint64_t group_filter_block_num,
-                                              uint64_t input_group_filter_block_num) {
+                                              uint64_t group_filter_block_num) {
   assert(sub_compact != nullptr);
 
   uint64_t prev_cpu_micros = env_->NowCPUNanos() / 1000;
@@ -1045,24 +1056,83 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact,
   }
   const auto& c_iter_stats = c_iter->iter_stats();
 
-  // 将 input 的 group filter 中的指定 key 删除
-  // 加入到 output 的 group filter 中
-  CuckooFilter *input_level_cuckoo_filter = nullptr;
+  // 将 key 加入到 output 的 group filter 中.
+  // input 的 group filter 保持不变: 旧的 Version 以及 snapshot 仍然可能通过它
+  // 读取 input 文件, 在其中删除 key 会造成误判. input 的 block 在不再被任何
+  // Version 引用之后由 ReclaimBlocks 整体回收
   CuckooFilter *output_level_cuckoo_filter = nullptr;
-
-  if (cfd->ioptions()->compaction_style == kCompactionStyleTier) {
-    if (input_group_filter_block_num != 0) {
-      input_level_cuckoo_filter = new CuckooFilter(cfd->GetPersistentArena(), 
-                                      input_group_filter_block_num);
+  // 开启 tier_prefix_filter 时同时插入 key 的 prefix 指纹. 已有的 filter
+  // 只有在其中的 prefix 指纹来自同一个 prefix_extractor 时才继续插入,
+  // 否则清除它的 prefix 标识, 该 group 在 prefix seek 时退化为按 key range
+  // 判断. range tombstone 无法用 prefix 表示, 带有 range tombstone 的输出
+  // 同样不使用 prefix 指纹
+  const SliceTransform* prefix_extractor = nullptr;
+  std::string last_prefix;
+  bool has_last_prefix = false;
+
+  PersistentArena* arena = cfd->GetPersistentArena();
+  if (cfd->ioptions()->compaction_style == kCompactionStyleTier &&
+      arena == nullptr) {
+    // 没有开启 is_tiered 时没有 filter pool, 输出文件不带 group filter.
+    // input 中记录的 block 可能来自之前以 is_tiered 打开的 pool, 不再沿用
+    group_filter_block_num = 0;
+  } else if (cfd->ioptions()->compaction_style == kCompactionStyleTier) {
+    uint32_t prefix_id = 0;
+    if (cfd->ioptions()->tier_prefix_filter && range_del_agg.IsEmpty()) {
+      prefix_id = TierPrefixFilterId(
+          sub_compact->compaction->mutable_cf_options()->prefix_extractor.get());
+    }
+    if (!arena->IsFilterBlock(cfd->GetID(), group_filter_block_num)) {
+      // 输出 group 没有可用的 filter (新 group 或者降级的 group), 重新分配
+      group_filter_block_num = 0;
+    } else {
+      // 复用的 filter 已经饱和, 或者放不下 input 中的 key 时, 输出文件使用
+      // 新的 block. group 中已有的文件仍然引用原来的 block, 查询结果不变
+      CuckooFilter reused_filter(arena, group_filter_block_num);
+      uint64_t input_entries = 0;
+      for (size_t i = 0; i < sub_compact->compaction->num_input_levels(); i++) {
+        for (const FileMetaData* f : *sub_compact->compaction->inputs(i)) {
+          input_entries += f->num_entries;
+        }
+      }
+      if (prefix_id != 0) {
+        // 最坏情况下每个 key 都有自己的 prefix 指纹
+        input_entries *= 2;
+      }
+      if (reused_filter.IsSaturated() ||
+          reused_filter.OccupiedSlotNum() + input_entries >
+              CuckooFilter::MaxKeyNum(arena->GetBlockSize())) {
+        RecordTick(stats_, TIER_GROUP_FILTER_GROWN);
+        group_filter_block_num = 0;
+      }
     }
     if (group_filter_block_num == 0) {
       output_level_cuckoo_filter = new CuckooFilter(cfd->GetPersistentArena(),
+                                       cfd->GetID(),
                                        sub_compact->compaction->output_level(), 
                                        group_filter_block_num);
+      if (output_level_cuckoo_filter->IsValid()) {
+        sub_compact->new_group_filter_block_num = group_filter_block_num;
+        arena->SetPrefixId(group_filter_block_num, prefix_id);
+      } else {
+        // filter pool 空间紧张, 该 group 不带 filter (降级模式)
+        RecordTick(stats_, TIER_GROUP_FILTER_DEGRADED);
+        delete output_level_cuckoo_filter;
+        output_level_cuckoo_filter = nullptr;
+      }
     } else {
       output_level_cuckoo_filter = new CuckooFilter(cfd->GetPersistentArena(),
                                        group_filter_block_num);
     }
+    if (output_level_cuckoo_filter != nullptr) {
+      uint32_t block_prefix_id = arena->GetPrefixId(group_filter_block_num);
+      if (prefix_id != 0 && block_prefix_id == prefix_id) {
+        prefix_extractor =
+            sub_compact->compaction->mutable_cf_options()->prefix_extractor.get();
+      } else if (block_prefix_id != 0) {
+        arena->SetPrefixId(group_filter_block_num, 0);
+      }
+    }
   }
 
   while (status.ok() && !cfd->IsDropped() && c_iter->Valid()) {
@@ -1106,11 +1176,19 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact,
     sub_compact->num_output_records++;
 
     if (cfd->ioptions()->compaction_style == kCompactionStyleTier) {
-      if (input_level_cuckoo_filter) {
-        input_level_cuckoo_filter->CuckooDeleteKey(ikey.user_key.data(), ikey.user_key.size());
-      }
       if (output_level_cuckoo_filter) {
         output_level_cuckoo_filter->CuckooPutKey(ikey.user_key.data(), ikey.user_key.size());
+        if (prefix_extractor != nullptr &&
+            prefix_extractor->InDomain(ikey.user_key)) {
+          // 输出有序, 相同 prefix 的 key 相邻, 只在 prefix 变化时插入
+          Slice prefix = prefix_extractor->Transform(ikey.user_key);
+          if (!has_last_prefix || prefix != Slice(last_prefix)) {
+            output_level_cuckoo_filter->CuckooPutPrefix(prefix.data(),
+                                                        prefix.size());
+            last_prefix.assign(prefix.data(), prefix.size());
+            has_last_prefix = true;
+          }
+        }
       }
     }
     // Close output file if it is big enough. Two possibilities determine it's
@@ -1164,7 +1242,6 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact,
     }
   }
 
-  delete input_level_cuckoo_filter;
   delete output_level_cuckoo_filter;
 
   sub_compact->compaction_job_stats.num_input_deletion_records =
@@ -122,8 +122,7 @@ class CompactionJob {
   // kv-pairs
   // 针对 Tier 读流程进行修改
   void ProcessKeyValueCompaction(SubcompactionState* sub_compact,
-                                 uint64_t group_filter_block_num = 0,
-                                 uint64_t input_group_filter_block_num = 0);
+                                 uint64_t group_filter_block_num = 0);
 
   Status FinishCompactionOutputFile(
       const Status& input_status, SubcompactionState* sub_compact,
@@ -80,6 +80,24 @@ bool FindIntraL0Compaction(const std::vector<FileMetaData*>& level_files,
     }
     compact_bytes_per_del_file = new_compact_bytes_per_del_file;
   }
+  // Do not split the files of one sub-flushed memtable, whose sequence
+  // number ranges interleave. The output would be ordered before the files
+  // left behind and overlap them while holding older entries.
+  if (limit < level_files.size() && limit > start + 1 &&
+      level_files[limit]->fd.largest_seqno >=
+          level_files[limit - 1]->fd.smallest_seqno) {
+    // compact_bytes also counts the file the loop above stopped at
+    compact_bytes -= static_cast<size_t>(level_files[limit]->fd.file_size);
+    do {
+      --limit;
+      compact_bytes -= static_cast<size_t>(level_files[limit]->fd.file_size);
+    } while (limit > start + 1 &&
+             level_files[limit]->fd.largest_seqno >=
+                 level_files[limit - 1]->fd.smallest_seqno);
+    compact_bytes_per_del_file = limit - start > 1
+                                     ? compact_bytes / (limit - start - 1)
+                                     : port::kMaxSizet;
+  }
 
   if ((limit - start) >= min_files_to_compact &&
       compact_bytes_per_del_file < max_compact_bytes_per_del_file) {
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "db/compaction/compaction_picker_tier.h"
+#include "db/tier_vertical_group.h"
 #include "logging/log_buffer.h"
 #include "logging/logging.h"
 
@@ -19,6 +20,7 @@ namespace {
         InternalKey smallest;                     // 整个 group 中的文件的最小 InternalKey
         InternalKey largest;                      // 整个 group 中的文件的最大 InternalKey
         uint64_t group_file_size_;                // 整个 group 中的文件总大小   
+        int group_depth_;                         // group 的深度, 即一次点查最多需要读的文件数
     };
 
     // 定义 VerticalGroup 结构的排序索引结构
@@ -26,9 +28,11 @@ namespace {
     {
         int group_index_;                         // 指示 VerticalGroup 在 TierCompactionBuilder::start_level_groups_ 的索引位置
         uint64_t group_file_size_;                // 整个 group 中的文件总大小 
+        int group_depth_;                         // group 的深度
 
-        GroupSize(int group_index, uint64_t group_file_size) :
-            group_index_(group_index), group_file_size_(group_file_size) {}
+        GroupSize(int group_index, uint64_t group_file_size, int group_depth) :
+            group_index_(group_index), group_file_size_(group_file_size),
+            group_depth_(group_depth) {}
     };
 
     // 定义 compaction_picker_builder
@@ -119,7 +123,8 @@ namespace {
                         // L0 score = `num L0 files` / `level0_file_num_compaction_trigger`
                         compaction_reason_ = CompactionReason::kLevelL0FilesNum;
                     } else {
-                        // L1+ score = `Level files size` / `MaxBytesForLevel`
+                        // L1+ score = max(`Level files size` / `MaxBytesForLevel`,
+                        //                 group 的最大/平均深度 / 对应的阈值)
                         compaction_reason_ = CompactionReason::kLevelMaxLevelSize;
                     }
                     break;
@@ -265,13 +270,18 @@ namespace {
 #endif
     }
 
-        // 对 start_level_groups_size_pri 关于 group size 从大到小进行排序
+        // 对 start_level_groups_size_pri 进行排序
+        // 点查的代价由 group 的深度决定, 所以优先选择最深的 group,
+        // 深度相同时再选择 group size 最大的
         std::sort(start_level_groups_size_pri.begin(), start_level_groups_size_pri.end(),
                   [](const GroupSize& first, const GroupSize& second) -> bool {
+                      if (first.group_depth_ != second.group_depth_) {
+                          return first.group_depth_ > second.group_depth_;
+                      }
                       return first.group_file_size_ > second.group_file_size_;
                   });
 
-        // 选择文件大小最大的 group
+        // 选择最深(其次文件大小最大)的 group
         start_level_inputs_.level = start_level_;
         int max_size_group_index = start_level_groups_size_pri[0].group_index_;
         const std::vector<FileMetaData*>& max_size_group_files = 
@@ -318,64 +328,23 @@ namespace {
     {
         start_level_groups_.clear();
         start_level_groups_size_pri.clear();
-        // 获得 level 层的 File 元数据
-        std::vector<FileMetaData*> level_files(vstorage_->LevelFiles(start_level_));
-  
-        InternalKeyComparator comparator = ioptions_.internal_comparator;
-        // 对元数据按照 smallest InternalKey 从小到大进行排序
-        std::sort(level_files.begin(), level_files.end(), 
-                [comparator](FileMetaData* ptr1, FileMetaData* ptr2)
-                {
-                    int cmp_res = comparator.Compare(ptr1->smallest, ptr2->smallest);
-                    if (!cmp_res)
-                        return comparator.Compare(ptr1->largest, ptr2->largest) > 0;
-                    else
-                        return cmp_res < 0;
-                });
 
-        // 确保 start_level_ 存在有文件
-        if (!level_files.empty()) {
+        // 划分 group 时跳过正在从上层刷下来的文件
+        std::vector<TierVerticalGroup> groups;
+        BuildTierVerticalGroups(ioptions_.internal_comparator,
+                                vstorage_->LevelFiles(start_level_),
+                                true /* skip_being_compacted */, &groups);
+        for (auto& group : groups) {
             VerticalGroup vgroup;
-            vgroup.group_files_.clear();
-            assert(vgroup.group_files_.empty());
-            vgroup.group_files_.push_back(level_files[0]);
-            vgroup.smallest = level_files[0]->smallest;
-            vgroup.largest = level_files[0]->largest;
-            vgroup.group_file_size_ = level_files[0]->compensated_file_size;
-            for (size_t i = 1; i < level_files.size(); i++) {
-                // 跳过正在从上层刷下来的文件
-                if (level_files[i]->being_compacted) {
-                    continue;
-                }
-                // 判断此文件是否落在当前 group 范围内
-                // 注意：需要判断的是 UserKey
-                if (ioptions_.internal_comparator.CompareWithUserKey(
-                            vgroup.smallest, level_files[i]->smallest) <= 0 &&
-                    ioptions_.internal_comparator.CompareWithUserKey(
-                            vgroup.largest, level_files[i]->smallest) >= 0) {
-                    vgroup.group_files_.push_back(level_files[i]);
-                    vgroup.group_file_size_ += level_files[i]->compensated_file_size;
-                    if (ioptions_.internal_comparator.Compare(
-                            vgroup.largest, level_files[i]->largest) < 0) {
-                        // 扩展 largest 边界
-                        vgroup.largest = level_files[i]->largest;
-                    }
-                } else {
-                    // 不在当前 group 范围内, 保存旧信息
-                    start_level_groups_.push_back(vgroup);
-                    start_level_groups_size_pri.emplace_back(start_level_groups_.size() - 1,
-                                                             vgroup.group_file_size_);
-                    // 创建新的 group 信息
-                    vgroup.group_files_.clear();
-                    vgroup.group_files_.push_back(level_files[i]);
-                    vgroup.smallest = level_files[i]->smallest;
-                    vgroup.largest = level_files[i]->largest;
-                    vgroup.group_file_size_ = level_files[i]->compensated_file_size;
-                }
-            }
-            start_level_groups_.push_back(vgroup);
+            vgroup.group_files_ = std::move(group.files);
+            vgroup.smallest = group.smallest;
+            vgroup.largest = group.largest;
+            vgroup.group_file_size_ = group.total_file_size;
+            vgroup.group_depth_ = group.depth;
+            start_level_groups_.push_back(std::move(vgroup));
             start_level_groups_size_pri.emplace_back(start_level_groups_.size() - 1,
-                                                     vgroup.group_file_size_);
+                                                     group.total_file_size,
+                                                     group.depth);
         }
     }
 
@@ -1411,6 +1411,134 @@ TEST_F(DBBasicTest, MultiGetBatchedMultiLevel) {
   }
 }
 
+TEST_F(DBBasicTest, MultiGetBatchedMultiLevelAsyncIO) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  BlockBasedTableOptions bbto;
+  bbto.filter_policy.reset(NewBloomFilterPolicy(10, false));
+  options.table_factory.reset(NewBlockBasedTableFactory(bbto));
+  Reopen(options);
+  env_->SetBackgroundThreads(2, Env::Priority::USER);
+
+  // Every key is in L2, every second one in L1 and every third one in L0,
+  // with a few files per level.
+  for (int level = 2; level >= 0; level--) {
+    int num_keys = 0;
+    for (int i = 0; i < 128; i += 3 - level) {
+      ASSERT_OK(Put("key_" + std::to_string(i),
+                    "val_l" + std::to_string(level) + "_" +
+                        std::to_string(i)));
+      if (++num_keys % 16 == 0) {
+        ASSERT_OK(Flush());
+      }
+    }
+    ASSERT_OK(Flush());
+    if (level > 0) {
+      MoveFilesToLevel(level);
+    }
+  }
+
+  // Hold the lookups back until a pool thread started prefetching a file.
+  std::atomic<int> num_prefetched_files{0};
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"MultiGetFilePrefetcher::Prefetch",
+        "MultiGetFilePrefetcher::WaitForFile"}});
+  SyncPoint::GetInstance()->SetCallBack(
+      "MultiGetFilePrefetcher::Prefetch",
+      [&](void* /*arg*/) { num_prefetched_files++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  std::vector<std::string> key_strs;
+  std::vector<Slice> keys;
+  for (int i = 32; i < 64; ++i) {
+    key_strs.push_back("key_" + std::to_string(i));
+  }
+  for (const auto& k : key_strs) {
+    keys.push_back(k);
+  }
+  ReadOptions ro;
+  ro.async_io = true;
+  std::vector<PinnableSlice> values(keys.size());
+  std::vector<Status> statuses(keys.size());
+  db_->MultiGet(ro, dbfull()->DefaultColumnFamily(), keys.size(),
+                keys.data(), values.data(), statuses.data());
+  for (size_t j = 0; j < keys.size(); ++j) {
+    int key = static_cast<int>(j) + 32;
+    int level = key % 3 == 0 ? 0 : (key % 2 == 0 ? 1 : 2);
+    ASSERT_OK(statuses[j]);
+    ASSERT_EQ("val_l" + std::to_string(level) + "_" + std::to_string(key),
+              values[j].ToString());
+  }
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_GT(num_prefetched_files.load(), 0);
+  env_->SetBackgroundThreads(0, Env::Priority::USER);
+}
+
+TEST_F(DBBasicTest, GetAsync) {
+  Options options = CurrentOptions();
+  Reopen(options);
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 != 0) {
+      ASSERT_OK(Put("key_" + std::to_string(i), "val_" + std::to_string(i)));
+    }
+    if (i % 25 == 24) {
+      ASSERT_OK(Flush());
+    }
+  }
+
+  // Without USER threads the lookup is done before GetAsync() returns.
+  bool called = false;
+  db_->GetAsync(ReadOptions(), db_->DefaultColumnFamily(), "key_1",
+                [&](const Status& s, const Slice& value) {
+                  ASSERT_OK(s);
+                  ASSERT_EQ("val_1", value.ToString());
+                  called = true;
+                });
+  ASSERT_TRUE(called);
+
+  env_->SetBackgroundThreads(2, Env::Priority::USER);
+  std::mutex mu;
+  std::condition_variable cv;
+  int num_done = 0;
+  std::vector<std::string> results(100);
+  for (int i = 0; i < 100; ++i) {
+    db_->GetAsync(ReadOptions(), db_->DefaultColumnFamily(),
+                  "key_" + std::to_string(i),
+                  [&, i](const Status& s, const Slice& value) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    results[i] = s.ok() ? value.ToString() : s.ToString();
+                    num_done++;
+                    cv.notify_all();
+                  });
+  }
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return num_done == 100; });
+  }
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 != 0) {
+      ASSERT_EQ("val_" + std::to_string(i), results[i]);
+    } else {
+      ASSERT_EQ(Status::NotFound().ToString(), results[i]);
+    }
+  }
+
+  // Lookups still queued when the DB is closed are served first.
+  num_done = 0;
+  for (int i = 0; i < 100; ++i) {
+    db_->GetAsync(ReadOptions(), db_->DefaultColumnFamily(),
+                  "key_" + std::to_string(i),
+                  [&](const Status& /*s*/, const Slice& /*value*/) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    num_done++;
+                  });
+  }
+  Close();
+  ASSERT_EQ(100, num_done);
+  env_->SetBackgroundThreads(0, Env::Priority::USER);
+}
+
 TEST_F(DBBasicTest, MultiGetBatchedMultiLevelMerge) {
   Options options = CurrentOptions();
   options.disable_auto_compactions = true;
@@ -283,6 +283,151 @@ TEST_F(DBBlockCacheTest, TestWithCompressedBlockCache) {
   delete iter;
   iter = nullptr;
 }
+
+TEST_F(DBBlockCacheTest, DemoteEvictedBlocksToCompressedCache) {
+  ReadOptions read_options;
+  auto table_options = GetTableOptions();
+  auto options = GetOptions(table_options);
+  options.compression = CompressionType::kNoCompression;
+  InitTable(options);
+
+  // Blocks released by the primary cache are evicted right away.
+  std::shared_ptr<Cache> cache = NewLRUCache(0, 0, false);
+  std::shared_ptr<Cache> compressed_cache = NewLRUCache(1 << 25, 0, false);
+  table_options.block_cache = cache;
+  table_options.block_cache_compressed = compressed_cache;
+  table_options.block_cache_compressed_compression = kSnappyCompression;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+  RecordCacheCounters(options);
+
+  // The blocks are uncompressed on disk but move to the compressed cache
+  // when the primary cache evicts them.
+  for (size_t i = 0; i < kNumBlocks - 1; i++) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    iter->Seek(ToString(i));
+    ASSERT_OK(iter->status());
+    CheckCacheCounters(options, 1, 0, 1, 0);
+    CheckCompressedCacheCounters(options, 1, 0, 0, 0);
+  }
+  size_t compressed_usage = compressed_cache->GetUsage();
+  ASSERT_LT(0U, compressed_usage);
+  ASSERT_EQ(0U, cache->GetUsage());
+
+  // The next reads are served by the compressed cache, and the blocks move
+  // back down when evicted again.
+  for (size_t i = 0; i < kNumBlocks - 1; i++) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    iter->Seek(ToString(i));
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(ToString(i), iter->key().ToString());
+    ASSERT_EQ(std::string(kValueSize, 'a'), iter->value().ToString());
+    CheckCacheCounters(options, 1, 0, 1, 0);
+    CheckCompressedCacheCounters(options, 0, 1, 0, 0);
+  }
+  ASSERT_EQ(compressed_usage, compressed_cache->GetUsage());
+
+  // A block is in one of the caches only.
+  cache->SetCapacity(1 << 25);
+  ASSERT_EQ(std::string(kValueSize, 'a'), Get(ToString(0)));
+  CheckCompressedCacheCounters(options, 0, 1, 0, 0);
+  ASSERT_LT(0U, cache->GetUsage());
+  size_t usage_without_block = compressed_cache->GetUsage();
+  ASSERT_GT(compressed_usage, usage_without_block);
+
+  // Blocks dropped because the primary cache shrinks are not demoted.
+  cache->SetCapacity(0);
+  ASSERT_EQ(0U, cache->GetUsage());
+  ASSERT_EQ(usage_without_block, compressed_cache->GetUsage());
+}
+
+TEST_F(DBBlockCacheTest, NoDemotionForClosedTables) {
+  ReadOptions read_options;
+  auto table_options = GetTableOptions();
+  auto options = GetOptions(table_options);
+  options.compression = CompressionType::kNoCompression;
+  InitTable(options);
+
+  std::shared_ptr<Cache> cache = NewLRUCache(1 << 25, 0, false);
+  std::shared_ptr<Cache> compressed_cache = NewLRUCache(1 << 25, 0, false);
+  table_options.block_cache = cache;
+  table_options.block_cache_compressed = compressed_cache;
+  table_options.block_cache_compressed_compression = kSnappyCompression;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+
+  auto read_all = [&]() {
+    for (size_t i = 0; i < kNumBlocks - 1; i++) {
+      std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+      iter->Seek(ToString(i));
+      ASSERT_OK(iter->status());
+    }
+  };
+  // Blocks of an open table move down when evicted.
+  read_all();
+  ASSERT_LT(0U, cache->GetUsage());
+  ASSERT_EQ(0U, compressed_cache->GetUsage());
+  cache->EraseUnRefEntries();
+  ASSERT_LT(0U, compressed_cache->GetUsage());
+
+  // Once the table is closed they are dropped.
+  read_all();
+  ASSERT_EQ(0U, compressed_cache->GetUsage());
+  Close();
+  ASSERT_LT(0U, cache->GetUsage());
+  cache->EraseUnRefEntries();
+  ASSERT_EQ(0U, cache->GetUsage());
+  ASSERT_EQ(0U, compressed_cache->GetUsage());
+}
+
+TEST_F(DBBlockCacheTest, CompressedCacheAdmitsBlocksEvictedTwice) {
+  ReadOptions read_options;
+  auto table_options = GetTableOptions();
+  auto options = GetOptions(table_options);
+  options.compression = CompressionType::kNoCompression;
+  InitTable(options);
+
+  std::shared_ptr<Cache> cache = NewLRUCache(0, 0, false);
+  std::shared_ptr<Cache> compressed_cache = NewLRUCache(1 << 25, 0, false);
+  table_options.block_cache = cache;
+  table_options.block_cache_compressed = compressed_cache;
+  table_options.block_cache_compressed_compression = kSnappyCompression;
+  // Large enough for the keys of all blocks to be remembered
+  table_options.block_cache_compressed_admission_history = 1 << 20;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+  RecordCacheCounters(options);
+
+  // Blocks evicted for the first time are turned away.
+  for (size_t i = 0; i < kNumBlocks - 1; i++) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    iter->Seek(ToString(i));
+    ASSERT_OK(iter->status());
+    CheckCompressedCacheCounters(options, 1, 0, 0, 0);
+  }
+  ASSERT_EQ(0U, compressed_cache->GetUsage());
+
+  // They are let in when evicted again.
+  for (size_t i = 0; i < kNumBlocks - 1; i++) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    iter->Seek(ToString(i));
+    ASSERT_OK(iter->status());
+    CheckCompressedCacheCounters(options, 1, 0, 0, 0);
+  }
+  size_t compressed_usage = compressed_cache->GetUsage();
+  ASSERT_LT(0U, compressed_usage);
+
+  // From then on they move between the caches without being turned away.
+  for (int round = 0; round < 2; round++) {
+    for (size_t i = 0; i < kNumBlocks - 1; i++) {
+      std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+      iter->Seek(ToString(i));
+      ASSERT_OK(iter->status());
+      CheckCompressedCacheCounters(options, 0, 1, 0, 0);
+    }
+    ASSERT_EQ(compressed_usage, compressed_cache->GetUsage());
+  }
+}
 #endif  // SNAPPY
 
 #ifndef ROCKSDB_LITE
@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <algorithm>
 #include <cinttypes>
+#include <map>
 #include <string>
 #include "db/db_impl/db_impl.h"
 #include "db/job_context.h"
@@ -19,6 +20,9 @@
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
 #include "test_util/sync_point.h"
+#include "util/autovector.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
 #include "util/mutexlock.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -77,6 +81,21 @@ int DBImpl::IsFileDeletionsEnabled() const {
 Status DBImpl::GetLiveFiles(std::vector<std::string>& ret,
                             uint64_t* manifest_file_size,
                             bool flush_memtable) {
+  return GetLiveFilesImpl(ret, manifest_file_size, flush_memtable,
+                          false /* export_tier_filters */);
+}
+
+Status DBImpl::GetLiveFilesWithTierFilters(std::vector<std::string>& ret,
+                                           uint64_t* manifest_file_size,
+                                           bool flush_memtable) {
+  return GetLiveFilesImpl(ret, manifest_file_size, flush_memtable,
+                          immutable_db_options_.is_tiered);
+}
+
+Status DBImpl::GetLiveFilesImpl(std::vector<std::string>& ret,
+                                uint64_t* manifest_file_size,
+                                bool flush_memtable,
+                                bool export_tier_filters) {
   *manifest_file_size = 0;
 
   mutex_.Lock();
@@ -143,10 +162,112 @@ Status DBImpl::GetLiveFiles(std::vector<std::string>& ret,
   // find length of manifest file while holding the mutex lock
   *manifest_file_size = versions_->manifest_file_size();
 
+  // Must pick the versions in the same critical section as the manifest
+  // size above, so the exported filters match what the copy recovers to.
+  if (export_tier_filters) {
+    Status status = ExportTierFilters(&ret);
+    if (!status.ok()) {
+      mutex_.Unlock();
+      ROCKS_LOG_ERROR(immutable_db_options_.info_log,
+                      "Cannot export tier group filters %s\n",
+                      status.ToString().c_str());
+      return status;
+    }
+  }
+
   mutex_.Unlock();
   return Status::OK();
 }
 
+Status DBImpl::ExportTierFilters(std::vector<std::string>* live_files) {
+  mutex_.AssertHeld();
+  PersistentArena* arena =
+      versions_->GetColumnFamilySet()->GetPersistentArena();
+  if (arena == nullptr) {
+    return Status::OK();
+  }
+
+  struct GroupFilter {
+    uint32_t cf_id;
+    uint64_t block_num;
+    std::vector<uint64_t> file_numbers;
+  };
+  std::vector<GroupFilter> groups;
+  // Keep the versions alive so that their blocks cannot be reclaimed while
+  // the mutex is released below.
+  autovector<Version*> versions;
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    if (cfd->IsDropped()) {
+      continue;
+    }
+    Version* v = cfd->current();
+    v->Ref();
+    versions.push_back(v);
+    std::map<uint64_t, std::vector<uint64_t>> block_to_files;
+    const auto* vstorage = v->storage_info();
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (const auto& f : vstorage->LevelFiles(level)) {
+        if (f->pmem_block_num != 0) {
+          block_to_files[f->pmem_block_num].push_back(f->fd.GetNumber());
+        }
+      }
+    }
+    for (auto& entry : block_to_files) {
+      std::sort(entry.second.begin(), entry.second.end());
+      groups.push_back({cfd->GetID(), entry.first, std::move(entry.second)});
+    }
+  }
+  mutex_.Unlock();
+
+  // File format: level (fixed32), cf_id (fixed32), prefix id (fixed32),
+  // number of files in the group (varint32), their file numbers (varint64
+  // each), the non-zero parts of the filter (see
+  // PersistentArena::CopyFilterBlock). The name carries a checksum of the
+  // contents, so a file that already exists holds exactly the same filter and
+  // does not need to be written again.
+  Status s;
+  for (const auto& group : groups) {
+    int level;
+    uint32_t prefix_id;
+    std::string filter;
+    if (!arena->CopyFilterBlock(group.cf_id, group.block_num, &level,
+                                &prefix_id, &filter)) {
+      // Degraded group, nothing to export.
+      continue;
+    }
+    std::string contents;
+    PutFixed32(&contents, static_cast<uint32_t>(level));
+    PutFixed32(&contents, group.cf_id);
+    PutFixed32(&contents, prefix_id);
+    PutVarint32(&contents, static_cast<uint32_t>(group.file_numbers.size()));
+    for (uint64_t number : group.file_numbers) {
+      PutVarint64(&contents, number);
+    }
+    contents.append(filter);
+    uint32_t crc = crc32c::Value(contents.data(), contents.size());
+
+    std::string fname =
+        TierFilterFileName(dbname_, group.block_num, group.cf_id, crc);
+    Status exists = env_->FileExists(fname);
+    if (exists.IsNotFound()) {
+      s = WriteStringToFile(env_, contents, fname, true /* should_sync */);
+    } else {
+      s = exists;
+    }
+    if (!s.ok()) {
+      break;
+    }
+    live_files->push_back(
+        TierFilterFileName("", group.block_num, group.cf_id, crc));
+  }
+
+  mutex_.Lock();
+  for (auto v : versions) {
+    v->Unref();
+  }
+  return s;
+}
+
 Status DBImpl::GetSortedWalFiles(VectorLogPtr& files) {
   {
     // If caller disabled deletions, this function should return files that are
@@ -7,6 +7,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
+#include <algorithm>
 #include <atomic>
 
 #include "db/db_impl/db_impl.h"
@@ -441,6 +442,89 @@ TEST_F(DBFlushTest, FireOnFlushCompletedAfterCommittedResult) {
   SyncPoint::GetInstance()->DisableProcessing();
   SyncPoint::GetInstance()->ClearAllCallBacks();
 }
+
+TEST_F(DBFlushTest, SubFlush) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.max_subflushes = 4;
+  options.write_buffer_size = 64 << 20;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+
+  // The versions of a key kept for a snapshot go to the same file as the
+  // latest one
+  const int kNumKeys = 5000;
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_OK(Put(Key(i), "old"));
+  }
+  const Snapshot* snapshot = db_->GetSnapshot();
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < kNumKeys; ++i) {
+    values.push_back(RandomString(&rnd, 1000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_OK(Flush());
+
+  // About 5MB of memtable data is split into four disjoint L0 files
+  ASSERT_EQ(4, NumTableFilesAtLevel(0));
+  std::vector<LiveFileMetaData> files;
+  db_->GetLiveFilesMetaData(&files);
+  ASSERT_EQ(4U, files.size());
+  std::sort(files.begin(), files.end(),
+            [](const LiveFileMetaData& a, const LiveFileMetaData& b) {
+              return a.smallestkey < b.smallestkey;
+            });
+  for (size_t i = 1; i < files.size(); ++i) {
+    ASSERT_LT(files[i - 1].largestkey, files[i].smallestkey);
+  }
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+    ASSERT_EQ("old", Get(Key(i), snapshot));
+  }
+  db_->ReleaseSnapshot(snapshot);
+
+  Reopen(options);
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST_F(DBFlushTest, AdaptiveWriteBufferSize) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.arena_block_size = 4 << 10;
+  options.max_write_buffer_number = 8;
+  options.disable_auto_compactions = true;
+  options.level0_slowdown_writes_trigger = 1000;
+  options.level0_stop_writes_trigger = 1000;
+
+  // The memtable budget of the cold column family goes to the hot one, which
+  // flushes fewer, larger files
+  int num_files[2];
+  for (int adaptive = 0; adaptive < 2; ++adaptive) {
+    options.adaptive_write_buffer_size = adaptive != 0;
+    DestroyAndReopen(options);
+    CreateAndReopenWithCF({"cold"}, options);
+    ASSERT_OK(Put(1, "cold", "value"));
+    Random rnd(301);
+    for (int i = 0; i < 2000; ++i) {
+      ASSERT_OK(Put(0, Key(i), RandomString(&rnd, 1000)));
+    }
+    ASSERT_OK(dbfull()->TEST_WaitForFlushMemTable(handles_[0]));
+    num_files[adaptive] = NumTableFilesAtLevel(0, 0);
+    ASSERT_EQ(0, NumTableFilesAtLevel(0, 1));
+    ASSERT_EQ("value", Get(1, "cold"));
+  }
+  ASSERT_GT(num_files[0], 0);
+  ASSERT_LT(num_files[1], num_files[0] * 3 / 4);
+}
 #endif  // !ROCKSDB_LITE
 
 TEST_P(DBAtomicFlushTest, ManualAtomicFlush) {
@@ -247,6 +247,17 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname,
                                  &write_controller_, &block_cache_tracer_));
   column_family_memtables_.reset(
       new ColumnFamilyMemTablesImpl(versions_->GetColumnFamilySet()));
+  if (immutable_db_options_.wal_shards > 1) {
+    for (size_t i = 0; i < immutable_db_options_.wal_shards; i++) {
+      wal_shards_.emplace_back(new WalShard(immutable_db_options_));
+    }
+  }
+  if (immutable_db_options_.adaptive_write_buffer_size &&
+      !immutable_db_options_.atomic_flush) {
+    write_buffer_sizer_.reset(
+        new WriteBufferSizer(env_, write_buffer_manager_));
+  }
+  async_get_batcher_.reset(new AsyncGetBatcher(this, env_));
 
   DumpRocksDBBuildVersion(immutable_db_options_.info_log.get());
   DumpDBFileSummary(immutable_db_options_, dbname_);
@@ -266,7 +277,11 @@ Status DBImpl::Resume() {
   InstrumentedMutexLock db_mutex(&mutex_);
 
   if (!error_handler_.IsDBStopped() && !error_handler_.IsBGWorkStopped()) {
-    // Nothing to do
+    // Nothing to do, except for a failed pipelined WAL sync that did not
+    // stop the DB (paranoid_checks = false)
+    if (wal_sync_pipeline_ != nullptr) {
+      wal_sync_pipeline_->ClearError();
+    }
     return Status::OK();
   }
 
@@ -355,6 +370,11 @@ Status DBImpl::ResumeImpl() {
   if (s.ok()) {
     s = error_handler_.ClearBGError();
   }
+  if (s.ok() && wal_sync_pipeline_ != nullptr) {
+    // The memtables were flushed above, so the data of a failed pipelined
+    // WAL sync is safe and sync writes can be served again
+    wal_sync_pipeline_->ClearError();
+  }
   mutex_.Unlock();
 
   job_context.manifest_file_number = 1;
@@ -451,6 +471,12 @@ Status DBImpl::CloseHelper() {
   }
   mutex_.Unlock();
 
+  // Serves the queued asynchronous lookups
+  async_get_batcher_.reset();
+
+  // Serves the remaining sync requests; SyncWAL() needs mutex_
+  wal_sync_pipeline_.reset();
+
   // CancelAllBackgroundWork called with false means we just set the shutdown
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
@@ -546,6 +572,26 @@ Status DBImpl::CloseHelper() {
     }
   }
   logs_.clear();
+  for (auto& shard : wal_shards_) {
+    for (auto& log : shard->logs) {
+      uint64_t log_number = log.writer->get_log_number();
+      Status s = log.ClearWriter();
+      if (!s.ok()) {
+        ROCKS_LOG_WARN(
+            immutable_db_options_.info_log,
+            "Unable to Sync WAL file %s with error -- %s",
+            LogFileName(immutable_db_options_.wal_dir, log_number).c_str(),
+            s.ToString().c_str());
+        // Retain the first error
+        if (ret.ok()) {
+          ret = s;
+        }
+      }
+    }
+    shard->logs.clear();
+    shard->writer = nullptr;
+    shard->alive_log = nullptr;
+  }
 
   // Table cache may have table handles holding blocks from the block cache.
   // We need to release them before the block cache is destroyed. The block
@@ -1091,6 +1137,7 @@ Status DBImpl::SetDBOptions(
       WriteThread::Writer w;
       write_thread_.EnterUnbatched(&w, &mutex_);
       if (total_log_size_ > GetMaxTotalWalSize() || wal_changed) {
+        WaitForPendingWrites();
         Status purge_wal_status = SwitchWAL(&write_context);
         if (!purge_wal_status.ok()) {
           ROCKS_LOG_WARN(immutable_db_options_.info_log,
@@ -1182,6 +1229,8 @@ Status DBImpl::FlushWAL(bool sync) {
 
 Status DBImpl::SyncWAL() {
   autovector<log::Writer*, 1> logs_to_sync;
+  // The extra logs of the WAL shards, synced up to the current generation
+  autovector<LogWriterNumber*> shard_logs_to_sync;
   bool need_log_dir_sync;
   uint64_t current_log_number;
 
@@ -1192,8 +1241,20 @@ Status DBImpl::SyncWAL() {
     // This SyncWAL() call only cares about logs up to this number.
     current_log_number = logfile_number_;
 
-    while (logs_.front().number <= current_log_number &&
-           logs_.front().getting_synced) {
+    while (true) {
+      while (logs_.front().number <= current_log_number &&
+             logs_.front().getting_synced) {
+        log_sync_cv_.Wait();
+      }
+      bool shard_log_getting_synced = false;
+      for (auto& shard : wal_shards_) {
+        for (auto& log : shard->logs) {
+          shard_log_getting_synced |= log.getting_synced;
+        }
+      }
+      if (!shard_log_getting_synced) {
+        break;
+      }
       log_sync_cv_.Wait();
     }
     // First check that logs are safe to sync in background.
@@ -1207,6 +1268,17 @@ Status DBImpl::SyncWAL() {
                 : Slice());
       }
     }
+    for (auto& shard : wal_shards_) {
+      for (auto& log : shard->logs) {
+        if (!log.writer->file()->writable_file()->IsSyncThreadSafe()) {
+          return Status::NotSupported(
+              "SyncWAL() is not supported for this implementation of WAL file",
+              immutable_db_options_.allow_mmap_writes
+                  ? "try setting Options::allow_mmap_writes to false"
+                  : Slice());
+        }
+      }
+    }
     for (auto it = logs_.begin();
          it != logs_.end() && it->number <= current_log_number; ++it) {
       auto& log = *it;
@@ -1214,6 +1286,14 @@ Status DBImpl::SyncWAL() {
       log.getting_synced = true;
       logs_to_sync.push_back(log.writer);
     }
+    for (auto& shard : wal_shards_) {
+      for (auto& log : shard->logs) {
+        assert(!log.getting_synced);
+        log.getting_synced = true;
+        shard_logs_to_sync.push_back(&log);
+        logs_to_sync.push_back(log.writer);
+      }
+    }
 
     need_log_dir_sync = !log_dir_synced_;
   }
@@ -1237,13 +1317,21 @@ Status DBImpl::SyncWAL() {
     IOStatusCheck(io_s);
   }
   if (status.ok() && need_log_dir_sync) {
-    status = directories_.GetWalDir()->Fsync(IOOptions(), nullptr);
+    io_s = directories_.GetWalDir()->Fsync(IOOptions(), nullptr);
+    if (!io_s.ok()) {
+      IOStatusCheck(io_s);
+    }
+    status = io_s;
   }
   TEST_SYNC_POINT("DBWALTest::SyncWALNotWaitWrite:2");
 
   TEST_SYNC_POINT("DBImpl::SyncWAL:BeforeMarkLogsSynced:1");
   {
     InstrumentedMutexLock l(&mutex_);
+    // The extra logs of the shards stay in their logs until obsolete
+    for (LogWriterNumber* log : shard_logs_to_sync) {
+      log->getting_synced = false;
+    }
     MarkLogsSynced(current_log_number, need_log_dir_sync, status);
   }
   TEST_SYNC_POINT("DBImpl::SyncWAL:BeforeMarkLogsSynced:2");
@@ -2114,6 +2202,17 @@ void DBImpl::MultiGet(const ReadOptions& read_options,
   MultiGetWithCallback(read_options, column_family, nullptr, &sorted_keys);
 }
 
+void DBImpl::GetAsync(const ReadOptions& options,
+                      ColumnFamilyHandle* column_family, const Slice& key,
+                      GetCallback callback) {
+  if (async_get_batcher_ == nullptr) {
+    DB::GetAsync(options, column_family, key, std::move(callback));
+    return;
+  }
+  async_get_batcher_->GetAsync(options, column_family, key,
+                               std::move(callback));
+}
+
 void DBImpl::MultiGetWithCallback(
     const ReadOptions& read_options, ColumnFamilyHandle* column_family,
     ReadCallback* callback,
@@ -3149,6 +3248,10 @@ Status DBImpl::GetUpdatesSince(
     SequenceNumber seq, std::unique_ptr<TransactionLogIterator>* iter,
     const TransactionLogIterator::ReadOptions& read_options) {
   RecordTick(stats_, GET_UPDATES_SINCE_CALLS);
+  if (!wal_shards_.empty()) {
+    // The logs of a sharded WAL are not ordered by sequence number
+    return Status::NotSupported("GetUpdatesSince with wal_shards > 1");
+  }
   if (seq > versions_->LastSequence()) {
     return Status::NotFound("Requested sequence not yet written in the db");
   }
@@ -19,6 +19,7 @@
 #include <utility>
 #include <vector>
 
+#include "db/async_get_batcher.h"
 #include "db/column_family.h"
 #include "db/compaction/compaction_job.h"
 #include "db/dbformat.h"
@@ -40,6 +41,9 @@
 #include "db/trim_history_scheduler.h"
 #include "db/version_edit.h"
 #include "db/wal_manager.h"
+#include "db/wal_sync_pipeline.h"
+#include "db/write_batch_cache.h"
+#include "db/write_buffer_sizer.h"
 #include "db/write_controller.h"
 #include "db/write_thread.h"
 #include "logging/event_logger.h"
@@ -223,6 +227,10 @@ class DBImpl : public DB {
                         Status* statuses,
                         const bool sorted_input = false) override;
 
+  virtual void GetAsync(const ReadOptions& options,
+                        ColumnFamilyHandle* column_family, const Slice& key,
+                        GetCallback callback) override;
+
   virtual void MultiGetWithCallback(
       const ReadOptions& options, ColumnFamilyHandle* column_family,
       ReadCallback* callback,
@@ -370,6 +378,15 @@ class DBImpl : public DB {
   virtual Status GetLiveFiles(std::vector<std::string>&,
                               uint64_t* manifest_file_size,
                               bool flush_memtable = true) override;
+  // Same as GetLiveFiles, but in tier mode (is_tiered) also writes the group
+  // filters of the returned table files into *.tierfilter files in the DB
+  // directory and returns their names as well, so that a copy of the files
+  // can rebuild its filter pool. Only used by checkpoint and backup, which
+  // reach it through the root DB; the exported files are only kept while file
+  // deletions are disabled.
+  virtual Status GetLiveFilesWithTierFilters(std::vector<std::string>&,
+                                             uint64_t* manifest_file_size,
+                                             bool flush_memtable = true);
   virtual Status GetSortedWalFiles(VectorLogPtr& files) override;
   virtual Status GetCurrentWalFile(
       std::unique_ptr<LogFile>* current_log_file) override;
@@ -1093,6 +1110,18 @@ class DBImpl : public DB {
                             bool disable_memtable = false,
                             uint64_t* seq_used = nullptr);
 
+  // Write path for wal_shards > 1. The batch group leader of a shard
+  // allocates the sequence numbers of its group while at the front of
+  // write_thread_, then appends to the shard's log and inserts into the
+  // memtables concurrently with the other shards, and finally publishes
+  // the sequence in allocation order.
+  Status ShardedWriteImpl(const WriteOptions& options, WriteBatch* updates,
+                          uint64_t* log_used, uint64_t* seq_used);
+
+  // Waits until all the sharded write groups that were allocated sequence
+  // numbers before first_seq have published, then publishes last_seq.
+  void PublishShardedWrite(SequenceNumber first_seq, SequenceNumber last_seq);
+
   // Write only to memtables without joining any write queue
   Status UnorderedWriteMemtable(const WriteOptions& write_options,
                                 WriteBatch* my_batch, WriteCallback* callback,
@@ -1120,6 +1149,18 @@ class DBImpl : public DB {
       PreReleaseCallback* pre_release_callback, const AssignOrder assign_order,
       const PublishLastSeq publish_last_seq, const bool disable_memtable);
 
+  // Creates the extra logs of a new WAL generation, one for each shard but
+  // the first. Nothing is created if any of them fails.
+  Status CreateWALShardLogs(const autovector<uint64_t>& log_numbers,
+                            size_t preallocate_block_size,
+                            autovector<log::Writer*>* new_logs);
+
+  // Makes the shards append to the logs of a new WAL generation.
+  // REQUIRES: mutex_ and log_write_mutex_ held, the primary log of the
+  // generation is at the back of logs_ and alive_log_files_
+  void InstallWALShardLogs(const autovector<uint64_t>& log_numbers,
+                           const autovector<log::Writer*>& new_logs);
+
   // write cached_recoverable_state_ to memtable if it is not empty
   // The writer must be the leader in write_thread_ and holding mutex_
   Status WriteRecoverableState();
@@ -1234,6 +1275,27 @@ class DBImpl : public DB {
     bool getting_synced = false;
   };
 
+  // A shard of the WAL when wal_shards > 1. Shard 0 appends to the primary
+  // log of each WAL generation (logs_.back()). Every other shard owns one
+  // extra log file per generation, numbered after the generation's primary
+  // log and before the next one, so that the log number based obsoletion of
+  // the primary logs covers the extra ones as well.
+  struct WalShard {
+    explicit WalShard(const ImmutableDBOptions& db_options)
+        : write_thread(db_options) {}
+
+    // Batches the writers hashed to this shard
+    WriteThread write_thread;
+    // Extra logs of the shard that are not obsolete yet, oldest first. Empty
+    // for shard 0. Synchronized like logs_.
+    std::deque<LogWriterNumber> logs;
+    // The log the shard appends to and its entry in alive_log_files_. Changed
+    // with mutex_ held while at the front of write_thread_.
+    log::Writer* writer = nullptr;
+    uint64_t log_number = 0;
+    LogFileNumberSize* alive_log = nullptr;
+  };
+
   // PurgeFileInfo is a structure to hold information of files to be deleted in
   // purge_files_
   struct PurgeFileInfo {
@@ -1339,6 +1401,25 @@ class DBImpl : public DB {
 
   // Delete any unneeded files and stale in-memory entries.
   void DeleteObsoleteFiles();
+
+  // Shared by GetLiveFiles and GetLiveFilesWithTierFilters.
+  Status GetLiveFilesImpl(std::vector<std::string>& ret,
+                          uint64_t* manifest_file_size, bool flush_memtable,
+                          bool export_tier_filters);
+
+  // Tier mode only. Copy the group filters referenced by the current versions
+  // out of the filter pool into *.tierfilter files in the DB directory, so that
+  // checkpoint and backup carry them along with the table files. The names
+  // (relative to dbname_) are appended to live_files.
+  // REQUIRES: mutex_ held, may be released in between.
+  Status ExportTierFilters(std::vector<std::string>* live_files);
+
+  // Tier mode only. Load the *.tierfilter files found in the DB directory back
+  // into the filter pool when they match the recovered versions. Only called
+  // when the pool did not belong to any DB yet; must run before any
+  // background work is scheduled.
+  // REQUIRES: mutex_ held
+  void ImportTierFilters();
   // Delete obsolete files and log status and information of file deletion
   void DeleteObsoleteFileImpl(int job_id, const std::string& fname,
                               const std::string& path_to_sync, FileType type,
@@ -1470,7 +1551,7 @@ class DBImpl : public DB {
       mutex_.Lock();
     }
 
-    if (!immutable_db_options_.unordered_write) {
+    if (!immutable_db_options_.unordered_write && wal_shards_.empty()) {
       // Then the writes are finished before the next write group starts
       return;
     }
@@ -1497,13 +1578,22 @@ class DBImpl : public DB {
   Status PreprocessWrite(const WriteOptions& write_options, bool* need_log_sync,
                          WriteContext* write_context);
 
-  WriteBatch* MergeBatch(const WriteThread::WriteGroup& write_group,
-                         WriteBatch* tmp_batch, size_t* write_with_wal,
-                         WriteBatch** to_be_cached_state);
+  // Collects into *parts the WAL record of the write group, sequenced at
+  // `sequence`, and returns its size. The batches are not copied: a group of a
+  // single complete batch is written as that batch, otherwise the record is a
+  // header encoded into `header` (WriteBatchInternal::kHeader bytes) followed
+  // by the WAL entries of every batch.
+  uint64_t GatherWalRecord(const WriteThread::WriteGroup& write_group,
+                           SequenceNumber sequence, char* header,
+                           std::vector<Slice>* parts, size_t* write_with_wal,
+                           WriteBatch** to_be_cached_state);
 
   IOStatus WriteToWAL(const WriteBatch& merged_batch, log::Writer* log_writer,
                       uint64_t* log_used, uint64_t* log_size);
 
+  IOStatus WriteToWAL(const SliceParts& log_entry, uint64_t log_size,
+                      log::Writer* log_writer, uint64_t* log_used);
+
   IOStatus WriteToWAL(const WriteThread::WriteGroup& write_group,
                       log::Writer* log_writer, uint64_t* log_used,
                       bool need_log_sync, bool need_log_dir_sync,
@@ -1871,8 +1961,15 @@ class DBImpl : public DB {
 
   WriteBufferManager* write_buffer_manager_;
 
+  // Chooses the size of new memtables if adaptive_write_buffer_size is set
+  std::unique_ptr<WriteBufferSizer> write_buffer_sizer_;
+
   WriteThread write_thread_;
-  WriteBatch tmp_batch_;
+  // The parts of the WAL record written by WriteToWAL, kept to reuse their
+  // buffer. Only used by the write thread, like the rest of WriteToWAL.
+  std::vector<Slice> wal_record_parts_;
+  // Reusable batches of the single-key write APIs
+  WriteBatchCache write_batch_cache_;
   // The write thread when the writers have no memtable write. This will be used
   // in 2PC to batch the prepares separately from the serial commit.
   WriteThread nonmem_write_thread_;
@@ -1988,6 +2085,23 @@ class DBImpl : public DB {
   // Number of threads intending to write to memtable
   std::atomic<size_t> pending_memtable_writes_ = {};
 
+  // Syncs the WAL for sync writes when pipelined_wal_sync is effective,
+  // nullptr otherwise
+  std::unique_ptr<WalSyncPipeline> wal_sync_pipeline_;
+
+  // Serves GetAsync(); reset when the DB is closed
+  std::unique_ptr<AsyncGetBatcher> async_get_batcher_;
+
+  // The shards of the WAL, empty unless wal_shards > 1
+  std::vector<std::unique_ptr<WalShard>> wal_shards_;
+  // The last sequence allocated to a sharded write group. Only accessed at
+  // the front of write_thread_.
+  SequenceNumber wal_shard_last_allocated_seq_ = 0;
+  // Sharded write groups wait on this cv to publish their sequence in
+  // allocation order
+  std::mutex wal_shard_publish_mutex_;
+  std::condition_variable wal_shard_publish_cv_;
+
   // Each flush or compaction gets its own job id. this counter makes sure
   // they're unique
   std::atomic<int> next_job_id_;
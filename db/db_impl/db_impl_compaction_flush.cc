@@ -84,8 +84,22 @@ IOStatus DBImpl::SyncClosedLogs(JobContext* job_context) {
   mutex_.AssertHeld();
   autovector<log::Writer*, 1> logs_to_sync;
   uint64_t current_log_number = logfile_number_;
-  while (logs_.front().number < current_log_number &&
-         logs_.front().getting_synced) {
+  while (true) {
+    while (logs_.front().number < current_log_number &&
+           logs_.front().getting_synced) {
+      log_sync_cv_.Wait();
+    }
+    bool shard_log_getting_synced = false;
+    for (auto& shard : wal_shards_) {
+      for (auto& log : shard->logs) {
+        if (log.number < current_log_number && log.getting_synced) {
+          shard_log_getting_synced = true;
+        }
+      }
+    }
+    if (!shard_log_getting_synced) {
+      break;
+    }
     log_sync_cv_.Wait();
   }
   for (auto it = logs_.begin();
@@ -95,6 +109,20 @@ IOStatus DBImpl::SyncClosedLogs(JobContext* job_context) {
     log.getting_synced = true;
     logs_to_sync.push_back(log.writer);
   }
+  // The closed extra logs of the WAL shards. They stay in the logs of their
+  // shards until obsolete.
+  autovector<LogWriterNumber*> shard_logs_to_sync;
+  for (auto& shard : wal_shards_) {
+    for (auto& log : shard->logs) {
+      if (log.number >= current_log_number) {
+        break;
+      }
+      assert(!log.getting_synced);
+      log.getting_synced = true;
+      shard_logs_to_sync.push_back(&log);
+      logs_to_sync.push_back(log.writer);
+    }
+  }
 
   IOStatus io_s;
   if (!logs_to_sync.empty()) {
@@ -122,6 +150,9 @@ IOStatus DBImpl::SyncClosedLogs(JobContext* job_context) {
 
     mutex_.Lock();
 
+    for (LogWriterNumber* log : shard_logs_to_sync) {
+      log->getting_synced = false;
+    }
     // "number <= current_log_number - 1" is equivalent to
     // "number < current_log_number".
     MarkLogsSynced(current_log_number - 1, true, io_s);
@@ -228,6 +259,10 @@ Status DBImpl::FlushMemTableToOutputFile(
       std::string file_path = MakeTableFileName(
           cfd->ioptions()->cf_paths[0].path, file_meta.fd.GetNumber());
       sfm->OnAddFile(file_path);
+      for (const auto& sub_flush_meta : flush_job.GetSubFlushOutputs()) {
+        sfm->OnAddFile(MakeTableFileName(cfd->ioptions()->cf_paths[0].path,
+                                         sub_flush_meta.fd.GetNumber()));
+      }
       if (sfm->IsMaxAllowedSpaceReached()) {
         Status new_bg_error =
             Status::SpaceLimit("Max allowed space was reached");
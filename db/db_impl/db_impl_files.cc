@@ -54,6 +54,15 @@ void DBImpl::FindObsoleteFiles(JobContext* job_context, bool force,
     return;
   }
 
+  // Tier 模式下回收 flush/compaction 之后不再被引用的 group filter block
+  if (immutable_db_options_.is_tiered) {
+    uint64_t reclaimed = versions_->ReclaimPersistentFilterBlocks();
+    if (reclaimed > 0) {
+      ROCKS_LOG_DEBUG(immutable_db_options_.info_log,
+                      "Reclaimed %" PRIu64 " group filter blocks", reclaimed);
+    }
+  }
+
   bool doing_the_full_scan = false;
 
   // logic for figuring out if we're doing the full scan
@@ -227,6 +236,21 @@ void DBImpl::FindObsoleteFiles(JobContext* job_context, bool force,
     }
     // Current log cannot be obsolete.
     assert(!logs_.empty());
+    for (auto& shard : wal_shards_) {
+      while (!shard->logs.empty() &&
+             shard->logs.front().number < min_log_number) {
+        auto& log = shard->logs.front();
+        if (log.getting_synced) {
+          log_sync_cv_.Wait();
+          continue;
+        }
+        logs_to_free_.push_back(log.ReleaseWriter());
+        {
+          InstrumentedMutexLock wl(&log_write_mutex_);
+          shard->logs.pop_front();
+        }
+      }
+    }
   }
 
   // We're just cleaning up for DB::Write().
@@ -454,6 +478,11 @@ void DBImpl::PurgeObsoleteFiles(JobContext& state, bool schedule_only) {
       case kBlobFile:
         keep = true;
         break;
+      case kTierFilterFile:
+        // Only needed while a checkpoint or backup copies them, and file
+        // deletions are disabled for that whole time.
+        keep = false;
+        break;
     }
 
     if (keep) {
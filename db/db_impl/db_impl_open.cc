@@ -12,6 +12,7 @@
 
 #include "db/builder.h"
 #include "db/error_handler.h"
+#include "db/wal_compression.h"
 #include "env/composite_env_wrapper.h"
 #include "file/read_write_util.h"
 #include "file/sst_file_manager_impl.h"
@@ -21,6 +22,8 @@
 #include "rocksdb/wal_filter.h"
 #include "table/block_based/block_based_table_factory.h"
 #include "test_util/sync_point.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
 #include "util/rate_limiter.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -58,6 +61,22 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     }
   }
 
+  // Tier 模式下 group 深度的阈值需要满足 compaction <= slowdown <= stop
+  if (result.tier_max_group_depth_trigger > 0) {
+    if (result.tier_group_depth_slowdown_writes_trigger > 0 &&
+        result.tier_group_depth_slowdown_writes_trigger <
+            result.tier_max_group_depth_trigger) {
+      result.tier_group_depth_slowdown_writes_trigger =
+          result.tier_max_group_depth_trigger;
+    }
+    if (result.tier_group_depth_stop_writes_trigger > 0 &&
+        result.tier_group_depth_stop_writes_trigger <
+            result.tier_group_depth_slowdown_writes_trigger) {
+      result.tier_group_depth_stop_writes_trigger =
+          result.tier_group_depth_slowdown_writes_trigger;
+    }
+  }
+
   if (!result.write_buffer_manager) {
     result.write_buffer_manager.reset(
         new WriteBufferManager(result.db_write_buffer_size));
@@ -99,6 +118,19 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     result.recycle_log_file_num = 0;
   }
 
+  if (result.wal_shards == 0) {
+    result.wal_shards = 1;
+  }
+  if (result.wal_shards > 1) {
+    // Recycled logs are only tracked for the primary log of each generation
+    result.recycle_log_file_num = 0;
+  }
+  if (result.wal_compression != kNoCompression) {
+    // A compressed log file starts with a record in the legacy format, which
+    // can't be told apart from the leftovers of a recycled log
+    result.recycle_log_file_num = 0;
+  }
+
   if (result.wal_dir.empty()) {
     // Use dbname as default
     result.wal_dir = dbname;
@@ -239,6 +271,31 @@ Status DBImpl::ValidateOptions(const DBOptions& db_options) {
         "unordered_write is incompatible with enable_pipelined_write");
   }
 
+  if (db_options.wal_shards > 1) {
+    if (!db_options.allow_concurrent_memtable_write) {
+      return Status::InvalidArgument(
+          "wal_shards > 1 is incompatible with "
+          "!allow_concurrent_memtable_write");
+    }
+    if (db_options.enable_pipelined_write || db_options.unordered_write ||
+        db_options.two_write_queues || db_options.allow_2pc ||
+        db_options.manual_wal_flush || db_options.allow_mmap_writes) {
+      // Sync writes sync the logs of other shards while they are appended
+      // to, which mmap writes do not support
+      return Status::NotSupported(
+          "wal_shards > 1 is incompatible with enable_pipelined_write, "
+          "unordered_write, two_write_queues, allow_2pc, manual_wal_flush and "
+          "allow_mmap_writes");
+    }
+  }
+
+  if (db_options.wal_compression != kNoCompression &&
+      !WalCompressionTypeSupported(db_options.wal_compression)) {
+    return Status::NotSupported(
+        "wal_compression only supports kZSTD and kLZ4Compression, and "
+        "requires the library to be linked");
+  }
+
   if (db_options.atomic_flush && db_options.enable_pipelined_write) {
     return Status::InvalidArgument(
         "atomic_flush is incompatible with enable_pipelined_write");
@@ -709,6 +766,23 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
     }
   };
 
+  // A log being replayed, positioned at its next batch.
+  struct LogStream {
+    uint64_t log_number = 0;
+    std::string fname;
+    Status status;
+    LogReporter reporter;
+    std::unique_ptr<log::Reader> reader;
+    std::string scratch;
+    WriteBatch batch;
+    size_t record_size = 0;
+    SequenceNumber sequence = 0;
+    // The sequence number following the last replayed batch, 0 if none
+    SequenceNumber replayed_end = 0;
+    bool valid = false;
+    bool error_pending = false;
+  };
+
   mutex_.AssertHeld();
   Status status;
   std::unordered_map<int, VersionEdit> version_edits;
@@ -751,263 +825,361 @@ Status DBImpl::RecoverLogFiles(const std::vector<uint64_t>& log_numbers,
   bool flushed = false;
   uint64_t corrupted_log_number = kMaxSequenceNumber;
   uint64_t min_log_number = MinLogNumberToKeep();
-  for (auto log_number : log_numbers) {
-    if (log_number < min_log_number) {
-      ROCKS_LOG_INFO(immutable_db_options_.info_log,
-                     "Skipping log #%" PRIu64
-                     " since it is older than min log to keep #%" PRIu64,
-                     log_number, min_log_number);
-      continue;
+
+  auto logFileDropped = [this](const std::string& fname) {
+    uint64_t bytes;
+    if (env_->GetFileSize(fname, &bytes).ok()) {
+      auto info_log = immutable_db_options_.info_log.get();
+      ROCKS_LOG_WARN(info_log, "%s: dropping %d bytes", fname.c_str(),
+                     static_cast<int>(bytes));
     }
-    // The previous incarnation may not have written any MANIFEST
-    // records after allocating this log number.  So we manually
-    // update the file number allocation counter in VersionSet.
-    versions_->MarkFileNumberUsed(log_number);
-    // Open the log file
-    std::string fname = LogFileName(immutable_db_options_.wal_dir, log_number);
+  };
 
-    ROCKS_LOG_INFO(immutable_db_options_.info_log,
-                   "Recovering log #%" PRIu64 " mode %d", log_number,
-                   static_cast<int>(immutable_db_options_.wal_recovery_mode));
-    auto logFileDropped = [this, &fname]() {
-      uint64_t bytes;
-      if (env_->GetFileSize(fname, &bytes).ok()) {
-        auto info_log = immutable_db_options_.info_log.get();
-        ROCKS_LOG_WARN(info_log, "%s: dropping %d bytes", fname.c_str(),
-                       static_cast<int>(bytes));
+  // Reads the next batch of the log. valid is cleared at the end of the log,
+  // or when the log reports an error, which is then left in status.
+  auto readNextBatch = [this](LogStream* stream) {
+    Slice record;
+    stream->valid = false;
+    while (stream->status.ok() &&
+           stream->reader->ReadRecord(
+               &record, &stream->scratch,
+               immutable_db_options_.wal_recovery_mode) &&
+           stream->status.ok()) {
+      if (record.size() < WriteBatchInternal::kHeader) {
+        stream->reporter.Corruption(record.size(),
+                                    Status::Corruption("log record too small"));
+        continue;
       }
-    };
-    if (stop_replay_by_wal_filter) {
-      logFileDropped();
-      continue;
+      WriteBatchInternal::SetContents(&stream->batch, record);
+      stream->record_size = record.size();
+      stream->sequence = WriteBatchInternal::Sequence(&stream->batch);
+      stream->valid = true;
+      return;
     }
+    stream->error_pending = !stream->status.ok();
+  };
 
-    std::unique_ptr<SequentialFileReader> file_reader;
-    {
-      std::unique_ptr<FSSequentialFile> file;
-      status = fs_->NewSequentialFile(fname,
-                                      fs_->OptimizeForLogRead(file_options_),
-                                      &file, nullptr);
-      if (!status.ok()) {
-        MaybeIgnoreError(&status);
-        if (!status.ok()) {
-          return status;
-        } else {
-          // Fail with one log file, but that's ok.
-          // Try next one.
-          continue;
-        }
+  // Handles the error that stopped replaying a log. Returns a non-ok status
+  // if the recovery has to fail.
+  auto handleLogError = [&](LogStream* stream) -> Status {
+    stream->error_pending = false;
+    Status s = stream->status;
+    if (s.IsNotSupported()) {
+      // We should not treat NotSupported as corruption. It is rather a clear
+      // sign that we are processing a WAL that is produced by an incompatible
+      // version of the code.
+      return s;
+    }
+    if (immutable_db_options_.wal_recovery_mode ==
+        WALRecoveryMode::kSkipAnyCorruptedRecords) {
+      // We should ignore all errors unconditionally
+      return Status::OK();
+    } else if (immutable_db_options_.wal_recovery_mode ==
+               WALRecoveryMode::kPointInTimeRecovery) {
+      // We should ignore the error but not continue replaying
+      stop_replay_for_corruption = true;
+      corrupted_log_number = std::min(corrupted_log_number, stream->log_number);
+      if (corrupted_log_found != nullptr) {
+        *corrupted_log_found = true;
       }
-      file_reader.reset(new SequentialFileReader(
-          std::move(file), fname, immutable_db_options_.log_readahead_size));
+      ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                     "Point in time recovered to log #%" PRIu64
+                     " seq #%" PRIu64,
+                     stream->log_number, *next_sequence);
+      return Status::OK();
     }
+    assert(immutable_db_options_.wal_recovery_mode ==
+               WALRecoveryMode::kTolerateCorruptedTailRecords ||
+           immutable_db_options_.wal_recovery_mode ==
+               WALRecoveryMode::kAbsoluteConsistency);
+    return s;
+  };
 
-    // Create the log reader.
-    LogReporter reporter;
-    reporter.env = env_;
-    reporter.info_log = immutable_db_options_.info_log.get();
-    reporter.fname = fname.c_str();
-    if (!immutable_db_options_.paranoid_checks ||
-        immutable_db_options_.wal_recovery_mode ==
-            WALRecoveryMode::kSkipAnyCorruptedRecords) {
-      reporter.status = nullptr;
-    } else {
-      reporter.status = &status;
-    }
-    // We intentially make log::Reader do checksumming even if
-    // paranoid_checks==false so that corruptions cause entire commits
-    // to be skipped instead of propagating bad information (like overly
-    // large sequence numbers).
-    log::Reader reader(immutable_db_options_.info_log, std::move(file_reader),
-                       &reporter, true /*checksum*/, log_number);
+  // Replays the current batch of the log. An error of the batch is left in
+  // the status of the log; a non-ok return value fails the recovery.
+  auto replayBatch = [&](LogStream* stream) -> Status {
+    WriteBatch& batch = stream->batch;
+    const uint64_t log_number = stream->log_number;
 
-    // Determine if we should tolerate incomplete records at the tail end of the
-    // Read all the records and add to a memtable
-    std::string scratch;
-    Slice record;
-    WriteBatch batch;
+#ifndef ROCKSDB_LITE
+    if (immutable_db_options_.wal_filter != nullptr) {
+      WriteBatch new_batch;
+      bool batch_changed = false;
 
-    while (!stop_replay_by_wal_filter &&
-           reader.ReadRecord(&record, &scratch,
-                             immutable_db_options_.wal_recovery_mode) &&
-           status.ok()) {
-      if (record.size() < WriteBatchInternal::kHeader) {
-        reporter.Corruption(record.size(),
-                            Status::Corruption("log record too small"));
-        continue;
+      WalFilter::WalProcessingOption wal_processing_option =
+          immutable_db_options_.wal_filter->LogRecordFound(
+              log_number, stream->fname, batch, &new_batch, &batch_changed);
+
+      switch (wal_processing_option) {
+        case WalFilter::WalProcessingOption::kContinueProcessing:
+          // do nothing, proceeed normally
+          break;
+        case WalFilter::WalProcessingOption::kIgnoreCurrentRecord:
+          // skip current record
+          return Status::OK();
+        case WalFilter::WalProcessingOption::kStopReplay:
+          // skip current record and stop replay
+          stop_replay_by_wal_filter = true;
+          return Status::OK();
+        case WalFilter::WalProcessingOption::kCorruptedRecord: {
+          Status s =
+              Status::Corruption("Corruption reported by Wal Filter ",
+                                 immutable_db_options_.wal_filter->Name());
+          MaybeIgnoreError(&s);
+          if (!s.ok()) {
+            stream->reporter.Corruption(stream->record_size, s);
+            stream->status = s;
+            return Status::OK();
+          }
+          break;
+        }
+        default: {
+          assert(false);  // unhandled case
+          Status s = Status::NotSupported(
+              "Unknown WalProcessingOption returned"
+              " by Wal Filter ",
+              immutable_db_options_.wal_filter->Name());
+          MaybeIgnoreError(&s);
+          // Otherwise ignore the error with current record processing.
+          return s;
+        }
       }
-      WriteBatchInternal::SetContents(&batch, record);
-      SequenceNumber sequence = WriteBatchInternal::Sequence(&batch);
 
-      if (immutable_db_options_.wal_recovery_mode ==
-          WALRecoveryMode::kPointInTimeRecovery) {
-        // In point-in-time recovery mode, if sequence id of log files are
-        // consecutive, we continue recovery despite corruption. This could
-        // happen when we open and write to a corrupted DB, where sequence id
-        // will start from the last sequence id we recovered.
-        if (sequence == *next_sequence) {
-          stop_replay_for_corruption = false;
+      if (batch_changed) {
+        // Make sure that the count in the new batch is
+        // within the orignal count.
+        int new_count = WriteBatchInternal::Count(&new_batch);
+        int original_count = WriteBatchInternal::Count(&batch);
+        if (new_count > original_count) {
+          ROCKS_LOG_FATAL(
+              immutable_db_options_.info_log,
+              "Recovering log #%" PRIu64
+              " mode %d log filter %s returned "
+              "more records (%d) than original (%d) which is not allowed. "
+              "Aborting recovery.",
+              log_number,
+              static_cast<int>(immutable_db_options_.wal_recovery_mode),
+              immutable_db_options_.wal_filter->Name(), new_count,
+              original_count);
+          return Status::NotSupported(
+              "More than original # of records "
+              "returned by Wal Filter ",
+              immutable_db_options_.wal_filter->Name());
         }
-        if (stop_replay_for_corruption) {
-          logFileDropped();
-          break;
+        // Set the same sequence number in the new_batch
+        // as the original batch.
+        WriteBatchInternal::SetSequence(&new_batch,
+                                        WriteBatchInternal::Sequence(&batch));
+        batch = new_batch;
+      }
+    }
+#endif  // ROCKSDB_LITE
+
+    // If column family was not found, it might mean that the WAL write
+    // batch references to the column family that was dropped after the
+    // insert. We don't want to fail the whole write batch in that case --
+    // we just ignore the update.
+    // That's why we set ignore missing column families to true
+    bool has_valid_writes = false;
+    Status s = WriteBatchInternal::InsertInto(
+        &batch, column_family_memtables_.get(), &flush_scheduler_,
+        &trim_history_scheduler_, true, log_number, this,
+        false /* concurrent_memtable_writes */, next_sequence,
+        &has_valid_writes, seq_per_batch_, batch_per_txn_);
+    MaybeIgnoreError(&s);
+    if (!s.ok()) {
+      // We are treating this as a failure while reading since we read valid
+      // blocks that do not form coherent data
+      stream->reporter.Corruption(stream->record_size, s);
+      stream->status = s;
+      return Status::OK();
+    }
+    stream->replayed_end = *next_sequence;
+
+    if (has_valid_writes && !read_only) {
+      // we can do this because this is called before client has access to the
+      // DB and there is only a single thread operating on DB
+      ColumnFamilyData* cfd;
+
+      while ((cfd = flush_scheduler_.TakeNextColumnFamily()) != nullptr) {
+        cfd->UnrefAndTryDelete();
+        // If this asserts, it means that InsertInto failed in
+        // filtering updates to already-flushed column families
+        assert(cfd->GetLogNumber() <= log_number);
+        auto iter = version_edits.find(cfd->GetID());
+        assert(iter != version_edits.end());
+        VersionEdit* edit = &iter->second;
+        s = WriteLevel0TableForRecovery(job_id, cfd, cfd->mem(), edit);
+        if (!s.ok()) {
+          // Reflect errors immediately so that conditions like full
+          // file-systems cause the DB::Open() to fail.
+          return s;
         }
+        flushed = true;
+
+        cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
+                               *next_sequence);
       }
+    }
+    return Status::OK();
+  };
 
-#ifndef ROCKSDB_LITE
-      if (immutable_db_options_.wal_filter != nullptr) {
-        WriteBatch new_batch;
-        bool batch_changed = false;
+  // Without 2PC the batches of later logs carry larger sequence numbers,
+  // except for the logs of a sharded WAL (wal_shards > 1), which are appended
+  // concurrently and interleave their sequence numbers. So all the logs are
+  // replayed together, always taking the batch with the smallest sequence
+  // number next; for an unsharded WAL this is simply the order of the logs.
+  // With 2PC the logs are replayed one by one.
+  const bool merge_logs = !immutable_db_options_.allow_2pc;
+  size_t next_log = 0;
+  while (next_log < log_numbers.size()) {
+    std::vector<std::unique_ptr<LogStream>> streams;
+    const size_t round_end = merge_logs ? log_numbers.size() : next_log + 1;
+    for (; next_log < round_end; ++next_log) {
+      uint64_t log_number = log_numbers[next_log];
+      if (log_number < min_log_number) {
+        ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                       "Skipping log #%" PRIu64
+                       " since it is older than min log to keep #%" PRIu64,
+                       log_number, min_log_number);
+        continue;
+      }
+      // The previous incarnation may not have written any MANIFEST
+      // records after allocating this log number.  So we manually
+      // update the file number allocation counter in VersionSet.
+      versions_->MarkFileNumberUsed(log_number);
+      // Open the log file
+      std::string fname =
+          LogFileName(immutable_db_options_.wal_dir, log_number);
 
-        WalFilter::WalProcessingOption wal_processing_option =
-            immutable_db_options_.wal_filter->LogRecordFound(
-                log_number, fname, batch, &new_batch, &batch_changed);
+      ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                     "Recovering log #%" PRIu64 " mode %d", log_number,
+                     static_cast<int>(immutable_db_options_.wal_recovery_mode));
+      if (stop_replay_by_wal_filter) {
+        logFileDropped(fname);
+        continue;
+      }
 
-        switch (wal_processing_option) {
-          case WalFilter::WalProcessingOption::kContinueProcessing:
-            // do nothing, proceeed normally
-            break;
-          case WalFilter::WalProcessingOption::kIgnoreCurrentRecord:
-            // skip current record
-            continue;
-          case WalFilter::WalProcessingOption::kStopReplay:
-            // skip current record and stop replay
-            stop_replay_by_wal_filter = true;
+      std::unique_ptr<SequentialFileReader> file_reader;
+      {
+        std::unique_ptr<FSSequentialFile> file;
+        status = fs_->NewSequentialFile(fname,
+                                        fs_->OptimizeForLogRead(file_options_),
+                                        &file, nullptr);
+        if (!status.ok()) {
+          MaybeIgnoreError(&status);
+          if (!status.ok()) {
+            return status;
+          } else {
+            // Fail with one log file, but that's ok.
+            // Try next one.
             continue;
-          case WalFilter::WalProcessingOption::kCorruptedRecord: {
-            status =
-                Status::Corruption("Corruption reported by Wal Filter ",
-                                   immutable_db_options_.wal_filter->Name());
-            MaybeIgnoreError(&status);
-            if (!status.ok()) {
-              reporter.Corruption(record.size(), status);
-              continue;
-            }
-            break;
-          }
-          default: {
-            assert(false);  // unhandled case
-            status = Status::NotSupported(
-                "Unknown WalProcessingOption returned"
-                " by Wal Filter ",
-                immutable_db_options_.wal_filter->Name());
-            MaybeIgnoreError(&status);
-            if (!status.ok()) {
-              return status;
-            } else {
-              // Ignore the error with current record processing.
-              continue;
-            }
           }
         }
+        file_reader.reset(new SequentialFileReader(
+            std::move(file), fname, immutable_db_options_.log_readahead_size));
+      }
 
-        if (batch_changed) {
-          // Make sure that the count in the new batch is
-          // within the orignal count.
-          int new_count = WriteBatchInternal::Count(&new_batch);
-          int original_count = WriteBatchInternal::Count(&batch);
-          if (new_count > original_count) {
-            ROCKS_LOG_FATAL(
-                immutable_db_options_.info_log,
-                "Recovering log #%" PRIu64
-                " mode %d log filter %s returned "
-                "more records (%d) than original (%d) which is not allowed. "
-                "Aborting recovery.",
-                log_number,
-                static_cast<int>(immutable_db_options_.wal_recovery_mode),
-                immutable_db_options_.wal_filter->Name(), new_count,
-                original_count);
-            status = Status::NotSupported(
-                "More than original # of records "
-                "returned by Wal Filter ",
-                immutable_db_options_.wal_filter->Name());
-            return status;
-          }
-          // Set the same sequence number in the new_batch
-          // as the original batch.
-          WriteBatchInternal::SetSequence(&new_batch,
-                                          WriteBatchInternal::Sequence(&batch));
-          batch = new_batch;
+      streams.emplace_back(new LogStream());
+      LogStream* stream = streams.back().get();
+      stream->log_number = log_number;
+      stream->fname = fname;
+
+      // Create the log reader.
+      LogReporter& reporter = stream->reporter;
+      reporter.env = env_;
+      reporter.info_log = immutable_db_options_.info_log.get();
+      reporter.fname = stream->fname.c_str();
+      if (!immutable_db_options_.paranoid_checks ||
+          immutable_db_options_.wal_recovery_mode ==
+              WALRecoveryMode::kSkipAnyCorruptedRecords) {
+        reporter.status = nullptr;
+      } else {
+        reporter.status = &stream->status;
+      }
+      // We intentially make log::Reader do checksumming even if
+      // paranoid_checks==false so that corruptions cause entire commits
+      // to be skipped instead of propagating bad information (like overly
+      // large sequence numbers).
+      stream->reader.reset(new log::Reader(immutable_db_options_.info_log,
+                                           std::move(file_reader), &reporter,
+                                           true /*checksum*/, log_number));
+      readNextBatch(stream);
+    }
+
+    while (true) {
+      // Pick the log whose next batch has the smallest sequence number. An
+      // error of a log is handled at the position where replaying the log
+      // stopped: right after its last replayed batch, or once all the logs
+      // before it are done if none of its batches was replayed.
+      LogStream* stream = nullptr;
+      SequenceNumber stream_key = 0;
+      bool earlier_log_active = false;
+      for (auto& s : streams) {
+        SequenceNumber key;
+        if (s->valid) {
+          key = s->sequence;
+        } else if (s->error_pending &&
+                   (s->replayed_end != 0 || !earlier_log_active)) {
+          key = s->replayed_end;
+        } else {
+          earlier_log_active = earlier_log_active || s->error_pending;
+          continue;
+        }
+        earlier_log_active = true;
+        if (stream == nullptr || key < stream_key ||
+            (key == stream_key && s->error_pending && !stream->error_pending)) {
+          stream = s.get();
+          stream_key = key;
         }
       }
-#endif  // ROCKSDB_LITE
+      if (stream == nullptr) {
+        break;
+      }
 
-      // If column family was not found, it might mean that the WAL write
-      // batch references to the column family that was dropped after the
-      // insert. We don't want to fail the whole write batch in that case --
-      // we just ignore the update.
-      // That's why we set ignore missing column families to true
-      bool has_valid_writes = false;
-      status = WriteBatchInternal::InsertInto(
-          &batch, column_family_memtables_.get(), &flush_scheduler_,
-          &trim_history_scheduler_, true, log_number, this,
-          false /* concurrent_memtable_writes */, next_sequence,
-          &has_valid_writes, seq_per_batch_, batch_per_txn_);
-      MaybeIgnoreError(&status);
-      if (!status.ok()) {
-        // We are treating this as a failure while reading since we read valid
-        // blocks that do not form coherent data
-        reporter.Corruption(record.size(), status);
+      if (stream->error_pending) {
+        status = handleLogError(stream);
+        if (!status.ok()) {
+          return status;
+        }
         continue;
       }
 
-      if (has_valid_writes && !read_only) {
-        // we can do this because this is called before client has access to the
-        // DB and there is only a single thread operating on DB
-        ColumnFamilyData* cfd;
-
-        while ((cfd = flush_scheduler_.TakeNextColumnFamily()) != nullptr) {
-          cfd->UnrefAndTryDelete();
-          // If this asserts, it means that InsertInto failed in
-          // filtering updates to already-flushed column families
-          assert(cfd->GetLogNumber() <= log_number);
-          auto iter = version_edits.find(cfd->GetID());
-          assert(iter != version_edits.end());
-          VersionEdit* edit = &iter->second;
-          status = WriteLevel0TableForRecovery(job_id, cfd, cfd->mem(), edit);
-          if (!status.ok()) {
-            // Reflect errors immediately so that conditions like full
-            // file-systems cause the DB::Open() to fail.
-            return status;
-          }
-          flushed = true;
-
-          cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
-                                 *next_sequence);
+      if (immutable_db_options_.wal_recovery_mode ==
+          WALRecoveryMode::kPointInTimeRecovery) {
+        // In point-in-time recovery mode, if sequence id of log files are
+        // consecutive, we continue recovery despite corruption. This could
+        // happen when we open and write to a corrupted DB, where sequence id
+        // will start from the last sequence id we recovered.
+        if (stream->sequence == *next_sequence) {
+          stop_replay_for_corruption = false;
+        }
+        if (stop_replay_for_corruption) {
+          logFileDropped(stream->fname);
+          stream->valid = false;
+          continue;
         }
       }
-    }
 
-    if (!status.ok()) {
-      if (status.IsNotSupported()) {
-        // We should not treat NotSupported as corruption. It is rather a clear
-        // sign that we are processing a WAL that is produced by an incompatible
-        // version of the code.
+      status = replayBatch(stream);
+      if (!status.ok()) {
         return status;
       }
-      if (immutable_db_options_.wal_recovery_mode ==
-          WALRecoveryMode::kSkipAnyCorruptedRecords) {
-        // We should ignore all errors unconditionally
-        status = Status::OK();
-      } else if (immutable_db_options_.wal_recovery_mode ==
-                 WALRecoveryMode::kPointInTimeRecovery) {
-        // We should ignore the error but not continue replaying
-        status = Status::OK();
-        stop_replay_for_corruption = true;
-        corrupted_log_number = log_number;
-        if (corrupted_log_found != nullptr) {
-          *corrupted_log_found = true;
+      if (stop_replay_by_wal_filter) {
+        for (auto& s : streams) {
+          if (s.get() != stream && (s->valid || s->error_pending)) {
+            logFileDropped(s->fname);
+          }
+          s->valid = false;
+          s->error_pending = false;
         }
-        ROCKS_LOG_INFO(immutable_db_options_.info_log,
-                       "Point in time recovered to log #%" PRIu64
-                       " seq #%" PRIu64,
-                       log_number, *next_sequence);
+        break;
+      }
+      if (stream->status.ok()) {
+        readNextBatch(stream);
       } else {
-        assert(immutable_db_options_.wal_recovery_mode ==
-                   WALRecoveryMode::kTolerateCorruptedTailRecords ||
-               immutable_db_options_.wal_recovery_mode ==
-                   WALRecoveryMode::kAbsoluteConsistency);
-        return status;
+        stream->valid = false;
+        stream->error_pending = true;
       }
     }
 
@@ -1286,6 +1458,114 @@ Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
   return s;
 }
 
+void DBImpl::ImportTierFilters() {
+  mutex_.AssertHeld();
+  PersistentArena* arena =
+      versions_->GetColumnFamilySet()->GetPersistentArena();
+  if (arena == nullptr) {
+    return;
+  }
+  std::vector<std::string> filenames;
+  if (!env_->GetChildren(dbname_, &filenames).ok()) {
+    return;
+  }
+
+  struct TierGroup {
+    int level = 0;
+    std::vector<uint64_t> file_numbers;
+    bool imported = false;
+  };
+  std::map<std::pair<uint32_t, uint64_t>, TierGroup> groups;
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    const auto* vstorage = cfd->current()->storage_info();
+    for (int level = 0; level < vstorage->num_levels(); level++) {
+      for (const auto& f : vstorage->LevelFiles(level)) {
+        if (f->pmem_block_num != 0) {
+          TierGroup& group =
+              groups[std::make_pair(cfd->GetID(), f->pmem_block_num)];
+          group.level = level;
+          group.file_numbers.push_back(f->fd.GetNumber());
+        }
+      }
+    }
+  }
+  for (auto& group : groups) {
+    std::sort(group.second.file_numbers.begin(),
+              group.second.file_numbers.end());
+  }
+
+  size_t imported = 0;
+  size_t skipped = 0;
+  for (const auto& fname : filenames) {
+    uint64_t block_num;
+    uint32_t cf_id;
+    uint32_t crc;
+    if (!ParseTierFilterFileName(fname, &block_num, &cf_id, &crc)) {
+      continue;
+    }
+    std::string contents;
+    Slice input;
+    uint32_t level;
+    uint32_t file_cf_id;
+    uint32_t prefix_id;
+    uint32_t num_files;
+    std::vector<uint64_t> file_numbers;
+    bool ok = ReadFileToString(env_, dbname_ + "/" + fname, &contents).ok() &&
+              crc32c::Value(contents.data(), contents.size()) == crc;
+    if (ok) {
+      input = contents;
+      ok = GetFixed32(&input, &level) && GetFixed32(&input, &file_cf_id) &&
+           file_cf_id == cf_id && GetFixed32(&input, &prefix_id) &&
+           GetVarint32(&input, &num_files);
+    }
+    for (uint32_t i = 0; ok && i < num_files; i++) {
+      uint64_t number;
+      ok = GetVarint64(&input, &number);
+      file_numbers.push_back(number);
+    }
+    // A filter exported for an older state of the group (e.g. left behind by
+    // a crash during a checkpoint) must not overwrite the one in the pool.
+    auto group = groups.find(std::make_pair(cf_id, block_num));
+    if (ok && group != groups.end() && !group->second.imported &&
+        group->second.file_numbers == file_numbers &&
+        arena->ImportFilterBlock(cf_id, block_num, static_cast<int>(level),
+                                 prefix_id, input.data(), input.size())) {
+      group->second.imported = true;
+      imported++;
+    } else {
+      skipped++;
+    }
+  }
+  // Groups whose filter was not exported, was stale or was lost with the pool
+  // keep their block numbers in the MANIFEST. Leaving those blocks free would
+  // let a new group get the same number, after which the old files would be
+  // checked against the new group's filter. Reserve them as saturated filters
+  // so the old groups are read without filtering until they are compacted.
+  size_t reserved = 0;
+  for (const auto& group : groups) {
+    if (group.second.imported) {
+      continue;
+    }
+    if (arena->ReserveBlock(group.first.first, group.first.second,
+                            group.second.level)) {
+      reserved++;
+    } else {
+      ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                     "Failed to reserve tier group filter block %" PRIu64
+                     " of column family %" PRIu32,
+                     group.first.second, group.first.first);
+    }
+  }
+  arena->FinishImport();
+  if (imported > 0 || skipped > 0 || reserved > 0) {
+    ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                   "Imported %" ROCKSDB_PRIszt
+                   " tier group filters, skipped %" ROCKSDB_PRIszt
+                   ", reserved %" ROCKSDB_PRIszt " without filters",
+                   imported, skipped, reserved);
+  }
+}
+
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   DBOptions db_options(options);
   ColumnFamilyOptions cf_options(options);
@@ -1359,11 +1639,59 @@ Status DBImpl::CreateWAL(uint64_t log_file_num, uint64_t recycle_log_number,
                                env_, nullptr /* stats */, listeners));
     *new_log = new log::Writer(std::move(file_writer), log_file_num,
                                immutable_db_options_.recycle_log_file_num > 0,
-                               immutable_db_options_.manual_wal_flush);
+                               immutable_db_options_.manual_wal_flush,
+                               immutable_db_options_.wal_compression);
+  }
+  return s;
+}
+
+Status DBImpl::CreateWALShardLogs(const autovector<uint64_t>& log_numbers,
+                                  size_t preallocate_block_size,
+                                  autovector<log::Writer*>* new_logs) {
+  assert(log_numbers.size() + 1 == wal_shards_.size());
+  Status s;
+  for (uint64_t log_number : log_numbers) {
+    log::Writer* new_log = nullptr;
+    s = CreateWAL(log_number, 0 /*recycle_log_number*/,
+                  preallocate_block_size, &new_log);
+    if (!s.ok()) {
+      break;
+    }
+    new_logs->push_back(new_log);
+  }
+  if (!s.ok()) {
+    for (log::Writer* new_log : *new_logs) {
+      delete new_log;
+    }
+    new_logs->clear();
   }
   return s;
 }
 
+void DBImpl::InstallWALShardLogs(const autovector<uint64_t>& log_numbers,
+                                 const autovector<log::Writer*>& new_logs) {
+  mutex_.AssertHeld();
+  log_write_mutex_.AssertHeld();
+  assert(new_logs.size() + 1 == wal_shards_.size());
+  assert(logs_.back().number == logfile_number_);
+  assert(alive_log_files_.back().number == logfile_number_);
+  WalShard* primary = wal_shards_[0].get();
+  primary->writer = logs_.back().writer;
+  primary->log_number = logfile_number_;
+  primary->alive_log = &alive_log_files_.back();
+  for (size_t i = 1; i < wal_shards_.size(); i++) {
+    WalShard* shard = wal_shards_[i].get();
+    assert(log_numbers[i - 1] > logfile_number_);
+    shard->logs.emplace_back(log_numbers[i - 1], new_logs[i - 1]);
+    // References to deque elements stay valid on push_back and on
+    // pop_front of the other elements
+    alive_log_files_.push_back(LogFileNumberSize(log_numbers[i - 1]));
+    shard->writer = new_logs[i - 1];
+    shard->log_number = log_numbers[i - 1];
+    shard->alive_log = &alive_log_files_.back();
+  }
+}
+
 Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
                     const std::vector<ColumnFamilyDescriptor>& column_families,
                     std::vector<ColumnFamilyHandle*>* handles, DB** dbptr,
@@ -1422,6 +1750,20 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
 
   impl->wal_in_db_path_ = IsWalDirSameAsDBPath(&impl->immutable_db_options_);
 
+  // Column families pick up the group filter pool when Recover creates them.
+  // The DB id is not recovered yet, so the pool is matched against the
+  // IDENTITY file; a copy of the DB (checkpoint, restored backup) has none.
+  if (impl->immutable_db_options_.is_tiered) {
+    std::string pool_db_id;
+    bool new_db =
+        impl->env_->FileExists(CurrentFileName(dbname)).IsNotFound();
+    if (!new_db && !impl->GetDbIdentityFromIdentityFile(&pool_db_id).ok()) {
+      pool_db_id.clear();
+    }
+    impl->versions_->GetColumnFamilySet()->OpenPersistentArena(pool_db_id,
+                                                               new_db);
+  }
+
   impl->mutex_.Lock();
   // Handles create_if_missing, error_if_exists
   uint64_t recovered_seq(kMaxSequenceNumber);
@@ -1439,6 +1781,16 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
       assert(new_log != nullptr);
       impl->logs_.emplace_back(new_log_number, new_log);
     }
+    const ImmutableDBOptions& idb_options = impl->immutable_db_options_;
+    if (s.ok() && idb_options.pipelined_wal_sync &&
+        !idb_options.enable_pipelined_write && !impl->two_write_queues_ &&
+        !idb_options.unordered_write && !idb_options.manual_wal_flush &&
+        impl->wal_shards_.empty() &&
+        new_log->file()->writable_file()->IsSyncThreadSafe()) {
+      // The pipeline syncs the WAL while the next groups append to it
+      impl->wal_sync_pipeline_.reset(
+          new WalSyncPipeline([impl]() { return impl->SyncWAL(); }));
+    }
 
     if (s.ok()) {
       // set column family handles
@@ -1469,23 +1821,45 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
       }
     }
     if (s.ok()) {
+      PersistentArena* arena =
+          impl->versions_->GetColumnFamilySet()->GetPersistentArena();
+      if (arena != nullptr && arena->GetDbId().empty()) {
+        // The pool is new to this DB: claim it, then load the filters a
+        // checkpoint or backup brought along
+        arena->SetDbId(impl->db_id_);
+        impl->ImportTierFilters();
+      }
       SuperVersionContext sv_context(/* create_superversion */ true);
       for (auto cfd : *impl->versions_->GetColumnFamilySet()) {
         impl->InstallSuperVersionAndScheduleWork(
             cfd, &sv_context, *cfd->GetLatestMutableCFOptions());
       }
       sv_context.Clean();
-      if (impl->two_write_queues_) {
-        impl->log_write_mutex_.Lock();
-      }
-      impl->alive_log_files_.push_back(
-          DBImpl::LogFileNumberSize(impl->logfile_number_));
-      if (impl->two_write_queues_) {
-        impl->log_write_mutex_.Unlock();
+      autovector<uint64_t> shard_log_numbers;
+      autovector<log::Writer*> shard_logs;
+      if (!impl->wal_shards_.empty()) {
+        for (size_t i = 1; i < impl->wal_shards_.size(); i++) {
+          shard_log_numbers.push_back(impl->versions_->NewFileNumber());
+        }
+        s = impl->CreateWALShardLogs(shard_log_numbers, preallocate_block_size,
+                                     &shard_logs);
       }
+      if (s.ok()) {
+        if (impl->two_write_queues_ || !impl->wal_shards_.empty()) {
+          impl->log_write_mutex_.Lock();
+        }
+        impl->alive_log_files_.push_back(
+            DBImpl::LogFileNumberSize(impl->logfile_number_));
+        if (!impl->wal_shards_.empty()) {
+          impl->InstallWALShardLogs(shard_log_numbers, shard_logs);
+        }
+        if (impl->two_write_queues_ || !impl->wal_shards_.empty()) {
+          impl->log_write_mutex_.Unlock();
+        }
 
-      impl->DeleteObsoleteFiles();
-      s = impl->directories_.GetDbDir()->Fsync(IOOptions(), nullptr);
+        impl->DeleteObsoleteFiles();
+        s = impl->directories_.GetDbDir()->Fsync(IOOptions(), nullptr);
+      }
     }
     if (s.ok()) {
       // In WritePrepared there could be gap in sequence numbers. This breaks
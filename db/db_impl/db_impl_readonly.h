@@ -99,6 +99,12 @@ class DBImplReadOnly : public DBImpl {
     return DBImpl::GetLiveFiles(ret, manifest_file_size,
                                 false /* flush_memtable */);
   }
+  virtual Status GetLiveFilesWithTierFilters(
+      std::vector<std::string>& ret, uint64_t* manifest_file_size,
+      bool /*flush_memtable*/) override {
+    return DBImpl::GetLiveFilesWithTierFilters(ret, manifest_file_size,
+                                               false /* flush_memtable */);
+  }
 
   using DBImpl::Flush;
   virtual Status Flush(const FlushOptions& /*options*/,
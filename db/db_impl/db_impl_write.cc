@@ -9,6 +9,8 @@
 #include "db/db_impl/db_impl.h"
 
 #include <cinttypes>
+#include <functional>
+#include <thread>
 #include "db/error_handler.h"
 #include "db/event_helpers.h"
 #include "monitoring/perf_context_imp.h"
@@ -19,7 +21,20 @@ namespace ROCKSDB_NAMESPACE {
 // Convenience methods
 Status DBImpl::Put(const WriteOptions& o, ColumnFamilyHandle* column_family,
                    const Slice& key, const Slice& val) {
-  return DB::Put(o, column_family, key, val);
+  size_t idx;
+  WriteBatch* batch = nullptr;
+  if (o.timestamp == nullptr) {
+    batch = write_batch_cache_.Borrow(&idx);
+  }
+  if (batch == nullptr) {
+    return DB::Put(o, column_family, key, val);
+  }
+  Status s = batch->Put(column_family, key, val);
+  if (s.ok()) {
+    s = Write(o, batch);
+  }
+  write_batch_cache_.Return(idx);
+  return s;
 }
 
 Status DBImpl::Merge(const WriteOptions& o, ColumnFamilyHandle* column_family,
@@ -27,20 +42,49 @@ Status DBImpl::Merge(const WriteOptions& o, ColumnFamilyHandle* column_family,
   auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family);
   if (!cfh->cfd()->ioptions()->merge_operator) {
     return Status::NotSupported("Provide a merge_operator when opening DB");
-  } else {
+  }
+  size_t idx;
+  WriteBatch* batch = write_batch_cache_.Borrow(&idx);
+  if (batch == nullptr) {
     return DB::Merge(o, column_family, key, val);
   }
+  Status s = batch->Merge(column_family, key, val);
+  if (s.ok()) {
+    s = Write(o, batch);
+  }
+  write_batch_cache_.Return(idx);
+  return s;
 }
 
 Status DBImpl::Delete(const WriteOptions& write_options,
                       ColumnFamilyHandle* column_family, const Slice& key) {
-  return DB::Delete(write_options, column_family, key);
+  size_t idx;
+  WriteBatch* batch = write_batch_cache_.Borrow(&idx);
+  if (batch == nullptr) {
+    return DB::Delete(write_options, column_family, key);
+  }
+  Status s = batch->Delete(column_family, key);
+  if (s.ok()) {
+    s = Write(write_options, batch);
+  }
+  write_batch_cache_.Return(idx);
+  return s;
 }
 
 Status DBImpl::SingleDelete(const WriteOptions& write_options,
                             ColumnFamilyHandle* column_family,
                             const Slice& key) {
-  return DB::SingleDelete(write_options, column_family, key);
+  size_t idx;
+  WriteBatch* batch = write_batch_cache_.Borrow(&idx);
+  if (batch == nullptr) {
+    return DB::SingleDelete(write_options, column_family, key);
+  }
+  Status s = batch->SingleDelete(column_family, key);
+  if (s.ok()) {
+    s = Write(write_options, batch);
+  }
+  write_batch_cache_.Return(idx);
+  return s;
 }
 
 void DBImpl::SetRecoverableStatePreReleaseCallback(
@@ -109,6 +153,16 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
     }
   }
 
+  if (!wal_shards_.empty()) {
+    if (callback != nullptr || pre_release_callback != nullptr ||
+        log_ref != 0 || disable_memtable || seq_per_batch_) {
+      return Status::NotSupported(
+          "Write callbacks, 2PC and WAL-only writes are not supported with "
+          "wal_shards > 1");
+    }
+    return ShardedWriteImpl(write_options, my_batch, log_used, seq_used);
+  }
+
   if (two_write_queues_ && disable_memtable) {
     AssignOrder assign_order =
         seq_per_batch_ ? kDoAssignOrder : kDontAssignOrder;
@@ -195,6 +249,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
 
     status = w.FinalStatus();
   }
+  // With the sync pipeline, sync writes are synced after leaving the group
+  const bool pipelined_sync = write_options.sync && !two_write_queues_ &&
+                              wal_sync_pipeline_ != nullptr;
   if (w.state == WriteThread::STATE_COMPLETED) {
     if (log_used != nullptr) {
       *log_used = w.log_used;
@@ -203,6 +260,9 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
       *seq_used = w.sequence;
     }
     // write is complete and leader has updated sequence
+    if (pipelined_sync && w.FinalStatus().ok()) {
+      return wal_sync_pipeline_->Sync();
+    }
     return w.FinalStatus();
   }
   // else we are the leader of the write batch group
@@ -219,7 +279,7 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
 
   mutex_.Lock();
 
-  bool need_log_sync = write_options.sync;
+  bool need_log_sync = write_options.sync && !pipelined_sync;
   bool need_log_dir_sync = need_log_sync && !log_dir_synced_;
   if (!two_write_queues_ || !disable_memtable) {
     // With concurrent writes we do preprocess only in the write thread that
@@ -454,9 +514,262 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   if (status.ok()) {
     status = w.FinalStatus();
   }
+  if (pipelined_sync && status.ok()) {
+    status = wal_sync_pipeline_->Sync();
+  }
   return status;
 }
 
+Status DBImpl::ShardedWriteImpl(const WriteOptions& write_options,
+                                WriteBatch* my_batch, uint64_t* log_used,
+                                uint64_t* seq_used) {
+  PERF_TIMER_GUARD(write_pre_and_post_process_time);
+  WriteThread::Writer w(write_options, my_batch, nullptr /*callback*/,
+                        0 /*log_ref*/, false /*disable_memtable*/);
+
+  if (!write_options.disableWAL) {
+    RecordTick(stats_, WRITE_WITH_WAL);
+  }
+
+  StopWatch write_sw(env_, immutable_db_options_.statistics.get(), DB_WRITE);
+
+  // Threads running on the same core share a shard, so that the writers of
+  // a shard mostly come from one core and different cores append in parallel
+  size_t shard_index;
+  int cpuid = port::PhysicalCoreID();
+  if (cpuid >= 0) {
+    shard_index = static_cast<size_t>(cpuid) % wal_shards_.size();
+  } else {
+    shard_index = std::hash<std::thread::id>()(std::this_thread::get_id()) %
+                  wal_shards_.size();
+  }
+  TEST_SYNC_POINT_CALLBACK("DBImpl::ShardedWriteImpl:PickShard",
+                           &shard_index);
+  WalShard* shard = wal_shards_[shard_index].get();
+
+  shard->write_thread.JoinBatchGroup(&w);
+  if (w.state == WriteThread::STATE_COMPLETED) {
+    if (log_used != nullptr) {
+      *log_used = w.log_used;
+    }
+    if (seq_used != nullptr) {
+      *seq_used = w.sequence;
+    }
+    // write is complete and the shard leader has published the sequence
+    return w.FinalStatus();
+  }
+  // else we are the leader of the write batch group of the shard
+  assert(w.state == WriteThread::STATE_GROUP_LEADER);
+
+  WriteContext write_context;
+  WriteThread::WriteGroup write_group;
+  Status status;
+  IOStatus io_s;
+
+  // The sequence numbers are allocated at the front of write_thread_, which
+  // orders the groups of all the shards and excludes the operations that
+  // switch memtables and logs. The section is kept short; the log append
+  // and the memtable insert run after leaving it.
+  WriteThread::Writer sequencer;
+  mutex_.Lock();
+  write_thread_.EnterUnbatched(&sequencer, &mutex_);
+
+  // Sync writes go through SyncWAL() below, so PreprocessWrite does not need
+  // to mark logs_ as getting synced.
+  bool preprocess_log_sync = false;
+  PERF_TIMER_STOP(write_pre_and_post_process_time);
+  status = PreprocessWrite(write_options, &preprocess_log_sync, &write_context);
+  PERF_TIMER_START(write_pre_and_post_process_time);
+  const bool need_log_sync = write_options.sync && !write_options.disableWAL;
+  log::Writer* log_writer = shard->writer;
+  const uint64_t log_number = shard->log_number;
+  LogFileNumberSize* alive_log = shard->alive_log;
+  if (status.ok() && !write_options.disableWAL) {
+    log_empty_ = false;
+  }
+  mutex_.Unlock();
+
+  last_batch_group_size_ =
+      shard->write_thread.EnterAsBatchGroupLeader(&w, &write_group);
+
+  size_t total_count = 0;
+  size_t total_byte_size = 0;
+  for (auto* writer : write_group) {
+    total_count += WriteBatchInternal::Count(writer->batch);
+    total_byte_size = WriteBatchInternal::AppendedByteSize(
+        total_byte_size, WriteBatchInternal::ByteSize(writer->batch));
+  }
+
+  SequenceNumber current_sequence = 0;
+  SequenceNumber last_sequence = 0;
+  // The first memtable insert of the group that failed
+  Status memtable_status;
+  const bool allocated = status.ok();
+  if (allocated) {
+    current_sequence = std::max(wal_shard_last_allocated_seq_,
+                                versions_->LastSequence()) +
+                       1;
+    last_sequence = current_sequence + total_count - 1;
+    wal_shard_last_allocated_seq_ = last_sequence;
+    // Memtable switches wait for the allocated groups to finish
+    pending_memtable_writes_++;
+  }
+  write_thread_.ExitUnbatched(&sequencer);
+
+  if (status.ok()) {
+    // The shards update the stats concurrently
+    const bool concurrent_update = true;
+    auto stats = default_cf_internal_stats_;
+    stats->AddDBStats(InternalStats::kIntStatsNumKeysWritten, total_count,
+                      concurrent_update);
+    RecordTick(stats_, NUMBER_KEYS_WRITTEN, total_count);
+    stats->AddDBStats(InternalStats::kIntStatsBytesWritten, total_byte_size,
+                      concurrent_update);
+    RecordTick(stats_, BYTES_WRITTEN, total_byte_size);
+    stats->AddDBStats(InternalStats::kIntStatsWriteDoneBySelf, 1,
+                      concurrent_update);
+    RecordTick(stats_, WRITE_DONE_BY_SELF);
+    auto write_done_by_other = write_group.size - 1;
+    if (write_done_by_other > 0) {
+      stats->AddDBStats(InternalStats::kIntStatsWriteDoneByOther,
+                        write_done_by_other, concurrent_update);
+      RecordTick(stats_, WRITE_DONE_BY_OTHER, write_done_by_other);
+    }
+    RecordInHistogram(stats_, BYTES_PER_WRITE, total_byte_size);
+
+    if (write_options.disableWAL) {
+      has_unpersisted_data_.store(true, std::memory_order_relaxed);
+    }
+
+    PERF_TIMER_STOP(write_pre_and_post_process_time);
+
+    if (!write_options.disableWAL) {
+      PERF_TIMER_GUARD(write_wal_time);
+      char header[WriteBatchInternal::kHeader];
+      std::vector<Slice> parts;
+      size_t write_with_wal = 0;
+      WriteBatch* to_be_cached_state = nullptr;
+      uint64_t log_size = GatherWalRecord(write_group, current_sequence, header,
+                                          &parts, &write_with_wal,
+                                          &to_be_cached_state);
+      // Recoverable state is only written by the 2nd write queue
+      assert(to_be_cached_state == nullptr);
+      for (auto* writer : write_group) {
+        writer->log_used = log_number;
+      }
+
+      io_s = log_writer->AddRecord(
+          SliceParts(parts.data(), static_cast<int>(parts.size())));
+      if (log_used != nullptr) {
+        *log_used = log_number;
+      }
+      total_log_size_ += log_size;
+      // Only the leader of this shard adds to the size of its log
+      alive_log->AddSize(log_size);
+
+      if (io_s.ok()) {
+        stats->AddDBStats(InternalStats::kIntStatsWalFileBytes, log_size,
+                          concurrent_update);
+        RecordTick(stats_, WAL_FILE_BYTES, log_size);
+        stats->AddDBStats(InternalStats::kIntStatsWriteWithWal,
+                          write_with_wal, concurrent_update);
+        RecordTick(stats_, WRITE_WITH_WAL, write_with_wal);
+      }
+      status = io_s;
+    }
+
+    if (status.ok()) {
+      PERF_TIMER_GUARD(write_memtable_time);
+      // The other shards insert concurrently, so the memtables are always
+      // written in concurrent mode with a memtable view of our own. Each
+      // writer is inserted on its own, as in the parallel memtable writes of
+      // WriteImpl, so that the memtable counters and the flush state get
+      // updated (MemTableInserter::PostProcess). A failed insert only fails
+      // its own writer; the other batches are in the log already.
+      ColumnFamilyMemTablesImpl column_family_memtables(
+          versions_->GetColumnFamilySet());
+      SequenceNumber next_sequence = current_sequence;
+      for (auto* writer : write_group) {
+        writer->sequence = next_sequence;
+        next_sequence += WriteBatchInternal::Count(writer->batch);
+        if (!writer->ShouldWriteToMemtable()) {
+          continue;
+        }
+        writer->status = WriteBatchInternal::InsertInto(
+            writer, writer->sequence, &column_family_memtables,
+            &flush_scheduler_, &trim_history_scheduler_,
+            write_options.ignore_missing_column_families,
+            0 /*recovery_log_number*/, this,
+            true /*concurrent_memtable_writes*/, seq_per_batch_,
+            writer->batch_cnt, batch_per_txn_,
+            write_options.memtable_insert_hint_per_batch);
+        if (!writer->status.ok() && memtable_status.ok()) {
+          memtable_status = writer->status;
+        }
+      }
+      if (seq_used != nullptr) {
+        *seq_used = w.sequence;
+      }
+    }
+    PERF_TIMER_START(write_pre_and_post_process_time);
+  }
+
+  if (allocated) {
+    // A failed group still publishes its sequence numbers, leaving a gap,
+    // so that the groups allocated after it can make progress.
+    PublishShardedWrite(current_sequence, last_sequence);
+    size_t pending_cnt = pending_memtable_writes_.fetch_sub(1) - 1;
+    if (pending_cnt == 0) {
+      // See UnorderedWriteMemtable
+      std::lock_guard<std::mutex> lck(switch_mutex_);
+      switch_cv_.notify_all();
+    }
+  }
+
+  // The checks below lock mutex_, which a memtable switch holds while
+  // waiting for pending_memtable_writes_, so they come after the decrement.
+  if (!io_s.ok()) {
+    IOStatusCheck(io_s);
+  } else {
+    WriteStatusCheck(status);
+  }
+  MemTableInsertStatusCheck(memtable_status);
+
+  // Recovery replays the shards merged by sequence number, so a sync write
+  // has to make the writes of all the shards before it durable, not only
+  // those of its own log. Once published, every group with a smaller
+  // sequence number has appended to its log, and SyncWAL() syncs all of them.
+  if (need_log_sync && status.ok()) {
+    StopWatch sw(env_, stats_, WAL_FILE_SYNC_MICROS);
+    status = SyncWAL();
+    if (status.ok()) {
+      default_cf_internal_stats_->AddDBStats(
+          InternalStats::kIntStatsWalFileSynced, 1,
+          true /* concurrent_update */);
+    }
+  }
+
+  shard->write_thread.ExitAsBatchGroupLeader(write_group, status);
+
+  if (status.ok()) {
+    status = w.FinalStatus();
+  }
+  return status;
+}
+
+void DBImpl::PublishShardedWrite(SequenceNumber first_seq,
+                                 SequenceNumber last_seq) {
+  std::unique_lock<std::mutex> lock(wal_shard_publish_mutex_);
+  // Groups are allocated consecutive sequence numbers, so the previous group
+  // has published once LastSequence reaches first_seq - 1
+  wal_shard_publish_cv_.wait(
+      lock, [&] { return versions_->LastSequence() + 1 >= first_seq; });
+  if (versions_->LastSequence() < last_seq) {
+    versions_->SetLastSequence(last_seq);
+  }
+  wal_shard_publish_cv_.notify_all();
+}
+
 Status DBImpl::PipelinedWriteImpl(const WriteOptions& write_options,
                                   WriteBatch* my_batch, WriteCallback* callback,
                                   uint64_t* log_used, uint64_t log_ref,
@@ -947,13 +1260,14 @@ Status DBImpl::PreprocessWrite(const WriteOptions& write_options,
   return status;
 }
 
-WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
-                               WriteBatch* tmp_batch, size_t* write_with_wal,
-                               WriteBatch** to_be_cached_state) {
+uint64_t DBImpl::GatherWalRecord(const WriteThread::WriteGroup& write_group,
+                                 SequenceNumber sequence, char* header,
+                                 std::vector<Slice>* parts,
+                                 size_t* write_with_wal,
+                                 WriteBatch** to_be_cached_state) {
   assert(write_with_wal != nullptr);
-  assert(tmp_batch != nullptr);
+  assert(parts != nullptr && parts->empty());
   assert(*to_be_cached_state == nullptr);
-  WriteBatch* merged_batch = nullptr;
   *write_with_wal = 0;
   auto* leader = write_group.leader;
   assert(!leader->disable_wal);  // Same holds for all in the batch group
@@ -962,29 +1276,39 @@ WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
     // we simply write the first WriteBatch to WAL if the group only
     // contains one batch, that batch should be written to the WAL,
     // and the batch is not wanting to be truncated
-    merged_batch = leader->batch;
-    if (WriteBatchInternal::IsLatestPersistentState(merged_batch)) {
-      *to_be_cached_state = merged_batch;
+    WriteBatchInternal::SetSequence(leader->batch, sequence);
+    parts->push_back(WriteBatchInternal::Contents(leader->batch));
+    if (WriteBatchInternal::IsLatestPersistentState(leader->batch)) {
+      *to_be_cached_state = leader->batch;
     }
     *write_with_wal = 1;
-  } else {
-    // WAL needs all of the batches flattened into a single batch.
-    // We could avoid copying here with an iov-like AddRecord
-    // interface
-    merged_batch = tmp_batch;
-    for (auto writer : write_group) {
-      if (!writer->CallbackFailed()) {
-        WriteBatchInternal::Append(merged_batch, writer->batch,
-                                   /*WAL_only*/ true);
-        if (WriteBatchInternal::IsLatestPersistentState(writer->batch)) {
-          // We only need to cache the last of such write batch
-          *to_be_cached_state = writer->batch;
-        }
-        (*write_with_wal)++;
+    return parts->back().size();
+  }
+  // The WAL record is a single batch made of all the batches of the group.
+  // Rather than flattening them into a merged batch, the record is written
+  // as a new header followed by the entries of every batch in place.
+  uint64_t size = WriteBatchInternal::kHeader;
+  uint32_t count = 0;
+  parts->push_back(Slice(header, WriteBatchInternal::kHeader));
+  for (auto writer : write_group) {
+    if (!writer->CallbackFailed()) {
+      uint32_t writer_count;
+      Slice entries = WriteBatchInternal::WalEntries(writer->batch,
+                                                     &writer_count);
+      if (!entries.empty()) {
+        parts->push_back(entries);
+        size += entries.size();
+      }
+      count += writer_count;
+      if (WriteBatchInternal::IsLatestPersistentState(writer->batch)) {
+        // We only need to cache the last of such write batch
+        *to_be_cached_state = writer->batch;
       }
+      (*write_with_wal)++;
     }
   }
-  return merged_batch;
+  WriteBatchInternal::EncodeHeader(header, sequence, count);
+  return size;
 }
 
 // When two_write_queues_ is disabled, this function is called from the only
@@ -992,9 +1316,14 @@ WriteBatch* DBImpl::MergeBatch(const WriteThread::WriteGroup& write_group,
 IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
                             log::Writer* log_writer, uint64_t* log_used,
                             uint64_t* log_size) {
-  assert(log_size != nullptr);
   Slice log_entry = WriteBatchInternal::Contents(&merged_batch);
   *log_size = log_entry.size();
+  return WriteToWAL(SliceParts(&log_entry, 1), *log_size, log_writer,
+                    log_used);
+}
+
+IOStatus DBImpl::WriteToWAL(const SliceParts& log_entry, uint64_t log_size,
+                            log::Writer* log_writer, uint64_t* log_used) {
   // When two_write_queues_ WriteToWAL has to be protected from concurretn calls
   // from the two queues anyway and log_write_mutex_ is already held. Otherwise
   // if manual_wal_flush_ is enabled we need to protect log_writer->AddRecord
@@ -1014,10 +1343,10 @@ IOStatus DBImpl::WriteToWAL(const WriteBatch& merged_batch,
   if (log_used != nullptr) {
     *log_used = logfile_number_;
   }
-  total_log_size_ += log_entry.size();
+  total_log_size_ += log_size;
   // TODO(myabandeh): it might be unsafe to access alive_log_files_.back() here
   // since alive_log_files_ might be modified concurrently
-  alive_log_files_.back().AddSize(log_entry.size());
+  alive_log_files_.back().AddSize(log_size);
   log_empty_ = false;
   return io_s;
 }
@@ -1029,22 +1358,20 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
   IOStatus io_s;
   assert(!write_group.leader->disable_wal);
   // Same holds for all in the batch group
+  char header[WriteBatchInternal::kHeader];
+  std::vector<Slice>& parts = wal_record_parts_;
   size_t write_with_wal = 0;
   WriteBatch* to_be_cached_state = nullptr;
-  WriteBatch* merged_batch = MergeBatch(write_group, &tmp_batch_,
-                                        &write_with_wal, &to_be_cached_state);
-  if (merged_batch == write_group.leader->batch) {
-    write_group.leader->log_used = logfile_number_;
-  } else if (write_with_wal > 1) {
-    for (auto writer : write_group) {
+  uint64_t log_size = GatherWalRecord(write_group, sequence, header, &parts,
+                                      &write_with_wal, &to_be_cached_state);
+  for (auto writer : write_group) {
+    if (!writer->CallbackFailed()) {
       writer->log_used = logfile_number_;
     }
   }
 
-  WriteBatchInternal::SetSequence(merged_batch, sequence);
-
-  uint64_t log_size;
-  io_s = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+  io_s = WriteToWAL(SliceParts(parts.data(), static_cast<int>(parts.size())),
+                    log_size, log_writer, log_used);
   if (to_be_cached_state) {
     cached_recoverable_state_ = *to_be_cached_state;
     cached_recoverable_state_empty_ = false;
@@ -1074,9 +1401,7 @@ IOStatus DBImpl::WriteToWAL(const WriteThread::WriteGroup& write_group,
     }
   }
 
-  if (merged_batch == &tmp_batch_) {
-    tmp_batch_.Clear();
-  }
+  parts.clear();
   if (io_s.ok()) {
     auto stats = default_cf_internal_stats_;
     if (need_log_sync) {
@@ -1098,29 +1423,27 @@ IOStatus DBImpl::ConcurrentWriteToWAL(
 
   assert(!write_group.leader->disable_wal);
   // Same holds for all in the batch group
-  WriteBatch tmp_batch;
+  char header[WriteBatchInternal::kHeader];
+  std::vector<Slice> parts;
   size_t write_with_wal = 0;
   WriteBatch* to_be_cached_state = nullptr;
-  WriteBatch* merged_batch =
-      MergeBatch(write_group, &tmp_batch, &write_with_wal, &to_be_cached_state);
 
   // We need to lock log_write_mutex_ since logs_ and alive_log_files might be
   // pushed back concurrently
   log_write_mutex_.Lock();
-  if (merged_batch == write_group.leader->batch) {
-    write_group.leader->log_used = logfile_number_;
-  } else if (write_with_wal > 1) {
-    for (auto writer : write_group) {
+  for (auto writer : write_group) {
+    if (!writer->CallbackFailed()) {
       writer->log_used = logfile_number_;
     }
   }
   *last_sequence = versions_->FetchAddLastAllocatedSequence(seq_inc);
   auto sequence = *last_sequence + 1;
-  WriteBatchInternal::SetSequence(merged_batch, sequence);
+  uint64_t log_size = GatherWalRecord(write_group, sequence, header, &parts,
+                                      &write_with_wal, &to_be_cached_state);
 
   log::Writer* log_writer = logs_.back().writer;
-  uint64_t log_size;
-  io_s = WriteToWAL(*merged_batch, log_writer, log_used, &log_size);
+  io_s = WriteToWAL(SliceParts(parts.data(), static_cast<int>(parts.size())),
+                    log_size, log_writer, log_used);
   if (to_be_cached_state) {
     cached_recoverable_state_ = *to_be_cached_state;
     cached_recoverable_state_empty_ = false;
@@ -1320,8 +1643,10 @@ Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
   // suboptimal but still correct.
   ROCKS_LOG_INFO(
       immutable_db_options_.info_log,
-      "Flushing column family with oldest memtable entry. Write buffer is "
+      "Flushing column family with %s. Write buffer is "
       "using %" ROCKSDB_PRIszt " bytes out of a total of %" ROCKSDB_PRIszt ".",
+      write_buffer_sizer_ != nullptr ? "coldest memtable"
+                                     : "oldest memtable entry",
       write_buffer_manager_->memory_usage(),
       write_buffer_manager_->buffer_size());
   // no need to refcount because drop is happening in write thread, so can't
@@ -1333,17 +1658,23 @@ Status DBImpl::HandleWriteBufferFull(WriteContext* write_context) {
     ColumnFamilyData* cfd_picked = nullptr;
     SequenceNumber seq_num_for_cf_picked = kMaxSequenceNumber;
 
-    for (auto cfd : *versions_->GetColumnFamilySet()) {
-      if (cfd->IsDropped()) {
-        continue;
-      }
-      if (!cfd->mem()->IsEmpty()) {
-        // We only consider active mem table, hoping immutable memtable is
-        // already in the process of flushing.
-        uint64_t seq = cfd->mem()->GetCreationSeq();
-        if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
-          cfd_picked = cfd;
-          seq_num_for_cf_picked = seq;
+    if (write_buffer_sizer_ != nullptr) {
+      // The coldest data first
+      cfd_picked = write_buffer_sizer_->PickColumnFamilyToFlush(
+          versions_->GetColumnFamilySet());
+    } else {
+      for (auto cfd : *versions_->GetColumnFamilySet()) {
+        if (cfd->IsDropped()) {
+          continue;
+        }
+        if (!cfd->mem()->IsEmpty()) {
+          // We only consider active mem table, hoping immutable memtable is
+          // already in the process of flushing.
+          uint64_t seq = cfd->mem()->GetCreationSeq();
+          if (cfd_picked == nullptr || seq < seq_num_for_cf_picked) {
+            cfd_picked = cfd;
+            seq_num_for_cf_picked = seq;
+          }
         }
       }
     }
@@ -1662,7 +1993,20 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
   }
   uint64_t new_log_number =
       creating_new_log ? versions_->NewFileNumber() : logfile_number_;
+  // The extra logs of the WAL shards in the new generation
+  autovector<uint64_t> shard_log_numbers;
+  autovector<log::Writer*> shard_logs;
+  if (creating_new_log) {
+    for (size_t i = 1; i < wal_shards_.size(); i++) {
+      shard_log_numbers.push_back(versions_->NewFileNumber());
+    }
+  }
   const MutableCFOptions mutable_cf_options = *cfd->GetLatestMutableCFOptions();
+  MutableCFOptions new_mem_options = mutable_cf_options;
+  if (write_buffer_sizer_ != nullptr) {
+    new_mem_options.write_buffer_size = write_buffer_sizer_->OnSwitchMemtable(
+        cfd, versions_->GetColumnFamilySet());
+  }
 
   // Set memtable_info for memtable sealed callback
 #ifndef ROCKSDB_LITE
@@ -1684,16 +2028,22 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
     // of mutable_cf_options.write_buffer_size.
     s = CreateWAL(new_log_number, recycle_log_number, preallocate_block_size,
                   &new_log);
+    if (s.ok() && !shard_log_numbers.empty()) {
+      s = CreateWALShardLogs(shard_log_numbers, preallocate_block_size,
+                             &shard_logs);
+    }
   }
   if (s.ok()) {
     SequenceNumber seq = versions_->LastSequence();
-    new_mem = cfd->ConstructNewMemtable(mutable_cf_options, seq);
+    new_mem = cfd->ConstructNewMemtable(new_mem_options, seq);
     context->superversion_context.NewSuperVersion();
   }
   ROCKS_LOG_INFO(immutable_db_options_.info_log,
                  "[%s] New memtable created with log file: #%" PRIu64
-                 ". Immutable memtables: %d.\n",
-                 cfd->GetName().c_str(), new_log_number, num_imm_unflushed);
+                 ". Immutable memtables: %d. Write buffer size: "
+                 "%" ROCKSDB_PRIszt ".\n",
+                 cfd->GetName().c_str(), new_log_number, num_imm_unflushed,
+                 new_mem_options.write_buffer_size);
   mutex_.Lock();
   if (recycle_log_number != 0) {
     // Since renaming the file is done outside DB mutex, we need to ensure
@@ -1724,6 +2074,10 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
       log_dir_synced_ = false;
       logs_.emplace_back(logfile_number_, new_log);
       alive_log_files_.push_back(LogFileNumberSize(logfile_number_));
+      if (!wal_shards_.empty()) {
+        InstallWALShardLogs(shard_log_numbers, shard_logs);
+        shard_logs.clear();
+      }
     }
     log_write_mutex_.Unlock();
   }
@@ -1737,6 +2091,9 @@ Status DBImpl::SwitchMemtable(ColumnFamilyData* cfd, WriteContext* context) {
     if (new_log) {
       delete new_log;
     }
+    for (log::Writer* shard_log : shard_logs) {
+      delete shard_log;
+    }
     SuperVersion* new_superversion =
         context->superversion_context.new_superversion.release();
     if (new_superversion != nullptr) {
@@ -2178,6 +2178,60 @@ TEST_P(DBIteratorTest, ReadAhead) {
   delete iter;
 }
 
+TEST_P(DBIteratorTest, ReadAheadAsyncIO) {
+  Options options = CurrentOptions();
+  options.disable_auto_compactions = true;
+  BlockBasedTableOptions table_options;
+  table_options.block_size = 1024;
+  table_options.no_block_cache = true;
+  options.table_factory.reset(new BlockBasedTableFactory(table_options));
+  Reopen(options);
+  env_->SetBackgroundThreads(2, Env::Priority::USER);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 200; i++) {
+    values.push_back(RandomString(&rnd, 512));
+    ASSERT_OK(Put(Key(i), values.back()));
+  }
+  ASSERT_OK(Flush());
+
+  // Hold the reader back until a background read started, so that at least
+  // one window is served by it rather than read again on this thread.
+  std::atomic<int> num_async_reads{0};
+  SyncPoint::GetInstance()->LoadDependency(
+      {{"FilePrefetchBuffer::AsyncReadWork:Start",
+        "FilePrefetchBuffer::TryReadFromAsyncRead:Wait"}});
+  SyncPoint::GetInstance()->SetCallBack(
+      "FilePrefetchBuffer::TryReadFromAsyncRead:Done",
+      [&](void* /*arg*/) { num_async_reads++; });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  ReadOptions read_options;
+  read_options.readahead_size = 1024 * 10;
+  read_options.async_io = true;
+  Iterator* iter = NewIterator(read_options);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    ASSERT_EQ(values[count], iter->value().ToString());
+    count++;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(200, count);
+  for (int i = 0; i < 200; i += 7) {
+    iter->Seek(Key(i));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(values[i], iter->value().ToString());
+  }
+  delete iter;
+
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_GT(num_async_reads.load(), 0);
+  env_->SetBackgroundThreads(0, Env::Priority::USER);
+}
+
 // Insert a key, create a snapshot iterator, overwrite key lots of times,
 // seek to a smaller key. Expect DBIter to fall back to a seek instead of
 // going through all the overwrites linearly.
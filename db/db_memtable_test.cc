@@ -3,6 +3,7 @@
 //  COPYING file in the root directory) and Apache 2.0 License
 //  (found in the LICENSE.Apache file in the root directory).
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -331,6 +332,283 @@ TEST_F(DBMemTableTest, ColumnFamilyId) {
   }
 }
 
+#ifndef ROCKSDB_LITE
+namespace {
+// Looks key up in mem as of seq. Returns the value, "DELETED" for a deletion
+// or "NOT_FOUND" when mem has no entry for key
+std::string MemTableGet(MemTable* mem, const std::string& key,
+                        SequenceNumber seq = kMaxSequenceNumber) {
+  std::string value;
+  Status s;
+  MergeContext merge_context;
+  SequenceNumber max_covering_tombstone_seq = 0;
+  if (!mem->Get(LookupKey(key, seq), &value, /*timestamp=*/nullptr, &s,
+                &merge_context, &max_covering_tombstone_seq, ReadOptions())) {
+    return "NOT_FOUND";
+  }
+  return s.IsNotFound() ? "DELETED" : value;
+}
+}  // namespace
+
+TEST_F(DBMemTableTest, HashIndexedSkipListConcurrentWrite) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(NewHashIndexedSkipListRepFactory(16));
+  DestroyAndReopen(options);
+
+  const int kNumThreads = 4;
+  const int kNumKeys = 1000;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = t; i < kNumKeys; i += kNumThreads) {
+        ASSERT_OK(Put(Key(i), "v1_" + Key(i)));
+        ASSERT_OK(Put(Key(i), "v2_" + Key(i)));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // Point lookups find the newest version through the hash index
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ("v2_" + Key(i), Get(Key(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get("missing"));
+
+  // Iteration goes through the skip list in key order
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    ASSERT_EQ("v2_" + Key(count), iter->value().ToString());
+    ++count;
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(kNumKeys, count);
+  iter.reset();
+
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2_" + Key(0), Get(Key(0)));
+}
+
+TEST_F(DBMemTableTest, HashIndexedSkipListRep) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  WriteBufferManager wb(0);
+  // A single bucket puts every user key in the same list
+  for (size_t bucket_count : {1, 7, 1000}) {
+    Options options;
+    options.memtable_factory.reset(
+        NewHashIndexedSkipListRepFactory(bucket_count));
+    ImmutableCFOptions ioptions(options);
+    std::unique_ptr<MemTable> mem(
+        new MemTable(cmp, ioptions, MutableCFOptions(options), &wb,
+                     kMaxSequenceNumber, 0 /* column_family_id */));
+
+    const int kNumKeys = 200;
+    SequenceNumber seq = 1;
+    int num_entries = 0;
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_TRUE(mem->Add(seq++, kTypeValue, Key(i), "v1_" + Key(i)));
+      num_entries++;
+    }
+    const SequenceNumber v1_seq = seq - 1;
+    for (int i = 0; i < kNumKeys; i += 2) {
+      ASSERT_TRUE(mem->Add(seq++, kTypeValue, Key(i), "v2_" + Key(i)));
+      num_entries++;
+    }
+    for (int i = 0; i < kNumKeys; i += 5) {
+      ASSERT_TRUE(mem->Add(seq++, kTypeDeletion, Key(i), ""));
+      num_entries++;
+    }
+    // Duplicates are found through the skip list
+    ASSERT_FALSE(mem->Add(v1_seq, kTypeValue, Key(kNumKeys - 1), "dup"));
+    ASSERT_FALSE(mem->Add(seq - 1, kTypeValue, Key(kNumKeys - 5), "dup"));
+
+    for (int i = 0; i < kNumKeys; i++) {
+      std::string expected = (i % 2 == 0 ? "v2_" : "v1_") + Key(i);
+      if (i % 5 == 0) {
+        expected = "DELETED";
+      }
+      ASSERT_EQ(expected, MemTableGet(mem.get(), Key(i)));
+      // Older versions follow the newest one in the bucket
+      ASSERT_EQ("v1_" + Key(i), MemTableGet(mem.get(), Key(i), v1_seq));
+      // Keys sharing the bucket stop the lookup
+      ASSERT_EQ("NOT_FOUND", MemTableGet(mem.get(), Key(i) + "x"));
+    }
+    ASSERT_EQ("NOT_FOUND", MemTableGet(mem.get(), Key(0), 0));
+
+    Arena arena;
+    ScopedArenaIterator iter(mem->NewIterator(ReadOptions(), &arena));
+    int count = 0;
+    std::string prev;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+      if (count > 0) {
+        ASSERT_LT(cmp.Compare(prev, iter->key()), 0);
+      }
+      prev = iter->key().ToString();
+    }
+    ASSERT_EQ(num_entries, count);
+  }
+}
+
+TEST_F(DBMemTableTest, HashIndexedSkipListRepConcurrentAdd) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  WriteBufferManager wb(0);
+  Options options;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(NewHashIndexedSkipListRepFactory(16));
+  ImmutableCFOptions ioptions(options);
+  std::unique_ptr<MemTable> mem(
+      new MemTable(cmp, ioptions, MutableCFOptions(options), &wb,
+                   kMaxSequenceNumber, 0 /* column_family_id */));
+
+  // Every thread writes three versions of the same keys, in the order of
+  // their sequence numbers, and retries one duplicate
+  const int kNumThreads = 4;
+  const int kNumKeys = 500;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      MemTablePostProcessInfo post_process_info;
+      for (int v = 0; v < 3; v++) {
+        SequenceNumber seq = 1 + v * kNumThreads + t;
+        for (int i = 0; i < kNumKeys; i++) {
+          ASSERT_TRUE(mem->Add(seq, kTypeValue, Key(i), ToString(seq), true,
+                               &post_process_info));
+        }
+        ASSERT_FALSE(mem->Add(seq, kTypeValue, Key(0), "dup", true,
+                              &post_process_info));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(ToString(3 * kNumThreads), MemTableGet(mem.get(), Key(i)));
+    for (SequenceNumber seq = 1; seq <= 3 * kNumThreads; seq++) {
+      ASSERT_EQ(ToString(seq), MemTableGet(mem.get(), Key(i), seq));
+    }
+  }
+}
+
+TEST_F(DBMemTableTest, AdaptiveRadixTree) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(NewAdaptiveRadixTreeRepFactory());
+  DestroyAndReopen(options);
+
+  // Keys with long common prefixes, some being prefixes of others
+  std::vector<std::string> keys;
+  for (int i = 0; i < 300; ++i) {
+    std::string key = "tenant" + ToString(i % 3) + "/table/" + ToString(i);
+    keys.push_back(key);
+    keys.push_back(key + "/a");
+  }
+  keys.push_back("");
+  keys.push_back("tenant");
+
+  const int kNumThreads = 4;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < keys.size(); i += kNumThreads) {
+        ASSERT_OK(Put(keys[i], "v1_" + keys[i]));
+        ASSERT_OK(Put(keys[i], "v2_" + keys[i]));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_OK(Delete("tenant"));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::find(keys.begin(), keys.end(), "tenant"));
+
+  for (const auto& key : keys) {
+    ASSERT_EQ("v2_" + key, Get(key));
+  }
+  ASSERT_EQ("NOT_FOUND", Get("tenant"));
+  ASSERT_EQ("NOT_FOUND", Get("tenant0/table"));
+
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  size_t i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+    ASSERT_LT(i, keys.size());
+    ASSERT_EQ(keys[i], iter->key().ToString());
+  }
+  ASSERT_EQ(keys.size(), i);
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    ASSERT_EQ(keys[--i], iter->key().ToString());
+  }
+  ASSERT_EQ(0U, i);
+
+  iter->Seek("tenant1/table/");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(*std::lower_bound(keys.begin(), keys.end(), "tenant1/table/"),
+            iter->key().ToString());
+  iter->SeekForPrev("tenant1/table/");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(*(std::lower_bound(keys.begin(), keys.end(), "tenant1/table/") - 1),
+            iter->key().ToString());
+  ASSERT_OK(iter->status());
+  iter.reset();
+
+  ASSERT_OK(Flush());
+  ASSERT_EQ("v2_" + keys.back(), Get(keys.back()));
+}
+
+TEST_F(DBMemTableTest, BulkLoad) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(NewBulkLoadRepFactory(2));
+  DestroyAndReopen(options);
+
+  const int kNumThreads = 4;
+  const int kNumKeys = 2000;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = t; i < kNumKeys; i += kNumThreads) {
+        ASSERT_OK(Put(Key(i), "v1"));
+        ASSERT_OK(Put(Key(i), "v2"));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_OK(Delete(Key(7)));
+
+  // Reads against the unsorted mutable memtable
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(i == 7 ? "NOT_FOUND" : "v2", Get(Key(i)));
+  }
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  int count = 0;
+  std::string prev;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++count) {
+    ASSERT_LT(prev, iter->key().ToString());
+    prev = iter->key().ToString();
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(kNumKeys - 1, count);
+  iter.reset();
+
+  // The immutable memtable is sorted in parallel before being flushed
+  ASSERT_OK(Flush());
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(i == 7 ? "NOT_FOUND" : "v2", Get(Key(i)));
+  }
+}
+#endif  // ROCKSDB_LITE
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
@@ -0,0 +1,748 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db/db_test_util.h"
+#include "file/filename.h"
+#include "port/stack_trace.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/perf_context.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/utilities/backupable_db.h"
+#include "rocksdb/utilities/checkpoint.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+#ifndef ROCKSDB_LITE
+class DBTierTest : public DBTestBase {
+ public:
+  DBTierTest()
+      : DBTestBase("/db_tier_test"), pmem_path_(dbname_ + "_pmem") {
+    EXPECT_OK(env_->CreateDirIfMissing(pmem_path_));
+    DeletePool();
+  }
+
+  ~DBTierTest() override {
+    Close();
+    DeletePool();
+    env_->DeleteDir(pmem_path_);
+  }
+
+  void DeletePool() {
+    const std::string pool = pmem_path_ + "/cuckoo_filters.pool";
+    env_->DeleteFile(pool);
+    for (int segment = 1; segment < 4; segment++) {
+      env_->DeleteFile(pool + "." + ToString(segment));
+    }
+  }
+
+  // Every flush is compacted into L1, where it joins the vertical group it
+  // overlaps instead of being merged with it
+  Options TierOptions() {
+    Options options = CurrentOptions();
+    options.compaction_style = kCompactionStyleTier;
+    options.is_tiered = true;
+    options.persistent_file_path_ = pmem_path_;
+    options.persistent_file_size_ = 4 << 20;
+    options.persistent_file_max_size_ = 16 << 20;
+    options.persistent_block_size_ = 64 << 10;
+    options.level0_file_num_compaction_trigger = 1;
+    options.max_bytes_for_level_base = 64 << 20;
+    options.tier_max_group_depth_trigger = 100;
+    options.tier_avg_group_depth_trigger = 100;
+    options.max_open_files = -1;
+    return options;
+  }
+
+  static std::string TierKey(const std::string& prefix, int i) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%03d", i);
+    return prefix + buf;
+  }
+
+  // Writes the keys as one L1 file and records them in model_
+  void WriteFile(const std::string& prefix, int first, int last, int step,
+                 const std::string& value) {
+    for (int i = first; i <= last; i += step) {
+      std::string key = TierKey(prefix, i);
+      ASSERT_OK(Put(key, value + key));
+      model_[key] = value + key;
+      targets_.push_back(key);
+    }
+    ASSERT_OK(Flush());
+    ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  }
+
+  void DeleteKeys(const std::vector<std::string>& keys) {
+    for (const auto& key : keys) {
+      ASSERT_OK(Delete(key));
+      model_.erase(key);
+    }
+    ASSERT_OK(Flush());
+    ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  }
+
+  bool LevelHasOverlappingFiles(int level) {
+    ColumnFamilyMetaData cf_meta;
+    db_->GetColumnFamilyMetaData(&cf_meta);
+    const auto& files = cf_meta.levels[level].files;
+    for (size_t i = 0; i < files.size(); i++) {
+      for (size_t j = i + 1; j < files.size(); j++) {
+        if (files[i].smallestkey <= files[j].largestkey &&
+            files[j].smallestkey <= files[i].largestkey) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Checks scans in both directions, and Seek() and SeekForPrev() to every
+  // key ever written and to the gaps after them, against model_
+  void VerifyIterator(const ReadOptions& read_options) {
+    std::map<std::string, std::string> expected;
+    for (const auto& kv : model_) {
+      if ((read_options.iterate_lower_bound != nullptr &&
+           Slice(kv.first).compare(*read_options.iterate_lower_bound) < 0) ||
+          (read_options.iterate_upper_bound != nullptr &&
+           Slice(kv.first).compare(*read_options.iterate_upper_bound) >= 0)) {
+        continue;
+      }
+      expected.insert(kv);
+    }
+
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    auto it = expected.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++it) {
+      ASSERT_TRUE(it != expected.end());
+      ASSERT_EQ(it->first, iter->key().ToString());
+      ASSERT_EQ(it->second, iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(it == expected.end());
+
+    auto rit = expected.rbegin();
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev(), ++rit) {
+      ASSERT_TRUE(rit != expected.rend());
+      ASSERT_EQ(rit->first, iter->key().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_TRUE(rit == expected.rend());
+
+    for (const auto& key : targets_) {
+      for (const std::string& target : {key, key + "5"}) {
+        iter->Seek(target);
+        it = expected.lower_bound(target);
+        if (it == expected.end()) {
+          ASSERT_FALSE(iter->Valid()) << target;
+        } else {
+          ASSERT_TRUE(iter->Valid()) << target;
+          ASSERT_EQ(it->first, iter->key().ToString());
+        }
+        ASSERT_OK(iter->status());
+
+        iter->SeekForPrev(target);
+        it = expected.upper_bound(target);
+        if (it == expected.begin()) {
+          ASSERT_FALSE(iter->Valid()) << target;
+        } else {
+          --it;
+          ASSERT_TRUE(iter->Valid()) << target;
+          ASSERT_EQ(it->first, iter->key().ToString());
+        }
+        ASSERT_OK(iter->status());
+      }
+    }
+  }
+
+  // Builds three vertical groups in L1; the first and the last hold
+  // overlapping files
+  void WriteOverlappingGroups() {
+    WriteFile("b", 0, 40, 2, "v1");
+    WriteFile("b", 10, 60, 3, "v2");
+    WriteFile("b", 20, 30, 1, "v3");
+    DeleteKeys({TierKey("b", 25), TierKey("b", 40), TierKey("b", 60)});
+    WriteFile("d", 0, 20, 1, "v1");
+    WriteFile("f", 0, 30, 5, "v1");
+    WriteFile("f", 5, 35, 5, "v2");
+  }
+
+  // Writes a group of new keys, which takes the first free block of the
+  // pool, then reads back everything written before
+  void VerifyAfterNewGroup(const std::string& prefix) {
+    WriteFile(prefix, 0, 30, 1, "v1");
+    for (const auto& key : targets_) {
+      auto it = model_.find(key);
+      ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second, Get(key));
+    }
+    VerifyIterator(ReadOptions());
+  }
+
+  const std::string pmem_path_;
+  std::map<std::string, std::string> model_;
+  std::vector<std::string> targets_;
+};
+
+TEST_F(DBTierTest, IterateOverlappingGroups) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_TRUE(LevelHasOverlappingFiles(1));
+
+  VerifyIterator(ReadOptions());
+
+  // The groups are rebuilt from the MANIFEST
+  Reopen(options);
+  ASSERT_TRUE(LevelHasOverlappingFiles(1));
+  VerifyIterator(ReadOptions());
+}
+
+TEST_F(DBTierTest, IterateWithBounds) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+  ASSERT_TRUE(LevelHasOverlappingFiles(1));
+
+  struct Bounds {
+    const char* lower;
+    const char* upper;
+  };
+  // Bounds inside a group, on group boundaries, between groups and past
+  // every group
+  const std::vector<Bounds> all_bounds = {
+      {"b015", "b045"}, {"b030", "f010"}, {"c", nullptr},   {nullptr, "d005"},
+      {"c", "c5"},      {"d000", "d020"}, {"e", "g"},       {"a", "b"},
+      {"g", nullptr},   {nullptr, "a"},   {"f012", "f013"},
+  };
+  for (const auto& bounds : all_bounds) {
+    Slice lower(bounds.lower != nullptr ? bounds.lower : "");
+    Slice upper(bounds.upper != nullptr ? bounds.upper : "");
+    ReadOptions read_options;
+    read_options.iterate_lower_bound =
+        bounds.lower != nullptr ? &lower : nullptr;
+    read_options.iterate_upper_bound =
+        bounds.upper != nullptr ? &upper : nullptr;
+    VerifyIterator(read_options);
+  }
+}
+
+TEST_F(DBTierTest, IterateWithMemtableAndL0) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  // Newer versions in L0 and the memtable hide the ones in the groups
+  options.level0_file_num_compaction_trigger = 10;
+  Reopen(options);
+  for (int i = 0; i < 60; i += 7) {
+    std::string key = TierKey("b", i);
+    ASSERT_OK(Put(key, "l0" + key));
+    model_[key] = "l0" + key;
+    targets_.push_back(key);
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ(1, NumTableFilesAtLevel(0));
+  for (int i = 0; i < 35; i += 4) {
+    std::string key = TierKey("f", i);
+    ASSERT_OK(Put(key, "mem" + key));
+    model_[key] = "mem" + key;
+    targets_.push_back(key);
+  }
+  ASSERT_OK(Delete(TierKey("d", 7)));
+  model_.erase(TierKey("d", 7));
+
+  VerifyIterator(ReadOptions());
+}
+
+TEST_F(DBTierTest, IngestionOverlapCheck) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  // The key was deleted in the first group. The overlap check has to see
+  // the tombstone through the group iterator, or the file would be placed
+  // below L1 and the tombstone would hide it
+  std::string sst = dbname_ + "_ingest.sst";
+  SstFileWriter writer(EnvOptions(), options);
+  ASSERT_OK(writer.Open(sst));
+  ASSERT_OK(writer.Put(TierKey("b", 25), "ingested"));
+  ASSERT_OK(writer.Finish());
+  ASSERT_OK(db_->IngestExternalFile({sst}, IngestExternalFileOptions()));
+  model_[TierKey("b", 25)] = "ingested";
+
+  ASSERT_EQ("ingested", Get(TierKey("b", 25)));
+  VerifyIterator(ReadOptions());
+}
+
+TEST_F(DBTierTest, IngestedFilesGetGroupFilters) {
+  Options options = TierOptions();
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  auto write_sst = [&](const std::string& name, const std::string& prefix,
+                       int first, int last, int step,
+                       const std::string& value) {
+    std::string sst = dbname_ + "_" + name + ".sst";
+    SstFileWriter writer(EnvOptions(), options);
+    EXPECT_OK(writer.Open(sst));
+    for (int i = first; i <= last; i += step) {
+      std::string key = TierKey(prefix, i);
+      EXPECT_OK(writer.Put(key, value + key));
+      model_[key] = value + key;
+      targets_.push_back(key);
+    }
+    EXPECT_OK(writer.Finish());
+    return sst;
+  };
+  // Block numbers of the group filters of the files with keys of the prefix
+  auto filter_blocks = [&](const std::string& prefix) {
+    std::vector<std::vector<FileMetaData>> levels;
+    dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &levels);
+    std::vector<uint64_t> blocks;
+    for (const auto& files : levels) {
+      for (const auto& f : files) {
+        if (f.smallest.user_key().starts_with(prefix)) {
+          blocks.push_back(f.pmem_block_num);
+        }
+      }
+    }
+    return blocks;
+  };
+
+  // Files that overlap neither each other nor the DB get a filter each,
+  // built on the LOW pool
+  env_->SetBackgroundThreads(2, Env::Priority::LOW);
+  ASSERT_OK(db_->IngestExternalFile({write_sst("h", "h", 0, 30, 2, "v1"),
+                                     write_sst("k", "k", 0, 30, 2, "v1")},
+                                    IngestExternalFileOptions()));
+  std::vector<uint64_t> h_blocks = filter_blocks("h");
+  std::vector<uint64_t> k_blocks = filter_blocks("k");
+  ASSERT_EQ(1U, h_blocks.size());
+  ASSERT_EQ(1U, k_blocks.size());
+  ASSERT_NE(0U, h_blocks[0]);
+  ASSERT_NE(0U, k_blocks[0]);
+  ASSERT_NE(h_blocks[0], k_blocks[0]);
+
+  // Files that overlap each other go to L0 without filters
+  options.disable_auto_compactions = true;
+  Reopen(options);
+  ASSERT_OK(db_->IngestExternalFile({write_sst("j1", "j", 0, 30, 2, "v1"),
+                                     write_sst("j2", "j", 10, 40, 3, "v2")},
+                                    IngestExternalFileOptions()));
+  ASSERT_EQ(2, NumTableFilesAtLevel(0));
+  for (uint64_t block_num : filter_blocks("j")) {
+    ASSERT_EQ(0U, block_num);
+  }
+
+  auto verify = [&]() {
+    for (const auto& key : targets_) {
+      auto it = model_.find(key);
+      ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second, Get(key));
+    }
+    VerifyIterator(ReadOptions());
+  };
+  verify();
+  // Keys inside the ingested files that were never written are ruled out
+  // by their filters
+  options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL);
+  for (int i = 1; i < 30; i += 2) {
+    ASSERT_EQ("NOT_FOUND", Get(TierKey("h", i)));
+    ASSERT_EQ("NOT_FOUND", Get(TierKey("k", i)));
+  }
+  ASSERT_GT(
+      options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL),
+      0U);
+
+  // Once compacted out of L0 the overlapping files form a group with a filter
+  options.disable_auto_compactions = false;
+  Reopen(options);
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  for (uint64_t block_num : filter_blocks("j")) {
+    ASSERT_NE(0U, block_num);
+  }
+  verify();
+}
+
+TEST_F(DBTierTest, GetThroughGroupFilters) {
+  Options options = TierOptions();
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  // Groups two files deep are compacted into L2, then a new file in L1
+  // covers keys of a group in L2, so a Get probes the filters of both levels
+  options.tier_max_group_depth_trigger = 2;
+  Reopen(options);
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  WriteFile("b", 5, 55, 10, "v4");
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_GT(NumTableFilesAtLevel(1), 0);
+  ASSERT_GT(NumTableFilesAtLevel(2), 0);
+
+  for (const auto& key : targets_) {
+    auto it = model_.find(key);
+    ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second, Get(key));
+  }
+
+  // Keys inside the groups that were never written are ruled out by the
+  // group filters
+  options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL);
+  for (int i = 0; i < 60; i++) {
+    for (const char* prefix : {"b", "d", "f"}) {
+      ASSERT_EQ("NOT_FOUND", Get(TierKey(prefix, i) + "x"));
+    }
+  }
+  ASSERT_GT(
+      options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL),
+      0U);
+}
+
+TEST_F(DBTierTest, GetGroupBoundariesAndL0) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  // The first and the last key of every file, which covers the first file
+  // of each group and the files of the last group
+  std::vector<std::vector<FileMetaData>> levels;
+  dbfull()->TEST_GetFilesMetaData(db_->DefaultColumnFamily(), &levels);
+  ASSERT_GT(levels[1].size(), 3U);
+  for (const auto& f : levels[1]) {
+    for (const Slice& key : {f.smallest.user_key(), f.largest.user_key()}) {
+      auto it = model_.find(key.ToString());
+      ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second,
+                Get(key.ToString()));
+    }
+  }
+
+  // Overlapping L0 files hold newer versions of keys in the groups; the
+  // newest file wins
+  options.level0_file_num_compaction_trigger = 10;
+  Reopen(options);
+  auto write_l0 = [&](int first, int last, int step,
+                      const std::string& value) {
+    for (int i = first; i <= last; i += step) {
+      std::string key = TierKey("b", i);
+      ASSERT_OK(Put(key, value + key));
+      model_[key] = value + key;
+      targets_.push_back(key);
+    }
+    ASSERT_OK(Flush());
+  };
+  write_l0(0, 58, 2, "l0a");
+  write_l0(1, 59, 4, "l0b");
+  write_l0(0, 58, 6, "l0c");
+  ASSERT_EQ(3, NumTableFilesAtLevel(0));
+
+  std::vector<std::string> keys;
+  for (const auto& key : targets_) {
+    keys.push_back(key);
+    keys.push_back(key + "x");
+  }
+  std::vector<std::string> values = MultiGet(keys);
+  ASSERT_EQ(keys.size(), values.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto it = model_.find(keys[i]);
+    std::string expected = it == model_.end() ? "NOT_FOUND" : it->second;
+    ASSERT_EQ(expected, Get(keys[i])) << keys[i];
+    ASSERT_EQ(expected, values[i]) << keys[i];
+  }
+}
+
+TEST_F(DBTierTest, GetOutsideTierMode) {
+  Options options = CurrentOptions();
+  options.statistics = CreateDBStatistics();
+  options.disable_auto_compactions = true;
+  options.target_file_size_base = 4 << 10;
+  DestroyAndReopen(options);
+
+  // Two overlapping L0 files, read newest first
+  Random rnd(301);
+  for (const char* value : {"v1", "v2"}) {
+    for (int i = 0; i < 200; i++) {
+      std::string key = TierKey("k", i);
+      model_[key] = value + RandomString(&rnd, 100);
+      ASSERT_OK(Put(key, model_[key]));
+    }
+    ASSERT_OK(Flush());
+  }
+  ASSERT_EQ(2, NumTableFilesAtLevel(0));
+  options.statistics->getAndResetTickerCount(GET_HIT_L0);
+  for (const auto& kv : model_) {
+    ASSERT_EQ("v2", Get(kv.first).substr(0, 2));
+  }
+  ASSERT_EQ(model_.size(),
+            options.statistics->getAndResetTickerCount(GET_HIT_L0));
+
+  // Disjoint L1 files are found by binary search, without group filters
+  MoveFilesToLevel(1);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_GT(NumTableFilesAtLevel(1), 2);
+  ASSERT_FALSE(LevelHasOverlappingFiles(1));
+  for (const auto& kv : model_) {
+    ASSERT_EQ(kv.second, Get(kv.first));
+    ASSERT_EQ("NOT_FOUND", Get(kv.first + "x"));
+  }
+  ASSERT_EQ(model_.size(),
+            options.statistics->getAndResetTickerCount(GET_HIT_L1));
+  ASSERT_EQ(0U, options.statistics->getTickerCount(GET_HIT_L0));
+  ASSERT_EQ(0U, options.statistics->getTickerCount(TIER_GROUP_FILTER_PROBED));
+}
+
+TEST_F(DBTierTest, PrefixSeekSkipsGroups) {
+  Options options = TierOptions();
+  options.prefix_extractor.reset(NewFixedPrefixTransform(2));
+  options.tier_prefix_filter = true;
+  // Every data block read is counted
+  BlockBasedTableOptions table_options;
+  table_options.no_block_cache = true;
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  // Two groups, and each has a prefix missing inside its key range
+  auto write_prefixes = [&](const std::vector<std::string>& prefixes,
+                            int first, int last) {
+    for (const auto& prefix : prefixes) {
+      for (int i = first; i <= last; i++) {
+        std::string key = TierKey(prefix, i);
+        ASSERT_OK(Put(key, "v" + key));
+        model_[key] = "v" + key;
+        targets_.push_back(key);
+      }
+    }
+    ASSERT_OK(Flush());
+    ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  };
+  write_prefixes({"aa", "ac"}, 0, 9);
+  write_prefixes({"aa"}, 5, 15);
+  write_prefixes({"ae", "ag"}, 0, 9);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_TRUE(LevelHasOverlappingFiles(1));
+
+  ReadOptions read_options;
+  read_options.prefix_same_as_start = true;
+  auto count_prefix = [&](const std::string& prefix) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options));
+    int count = 0;
+    for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+      EXPECT_TRUE(iter->key().starts_with(prefix));
+      count++;
+    }
+    EXPECT_OK(iter->status());
+    return count;
+  };
+
+  SetPerfLevel(kEnableCount);
+  // Groups without the prefix are ruled out by their filters or key ranges,
+  // so no file is read
+  for (const char* prefix : {"ab", "af", "ad", "ah"}) {
+    get_perf_context()->Reset();
+    ASSERT_EQ(0, count_prefix(prefix)) << prefix;
+    ASSERT_EQ(0U, get_perf_context()->block_read_count) << prefix;
+  }
+  ASSERT_EQ(16, count_prefix("aa"));
+  ASSERT_EQ(10, count_prefix("ac"));
+  ASSERT_EQ(10, count_prefix("ag"));
+
+  // Fingerprints of another prefix_extractor are not used
+  options.prefix_extractor.reset(NewFixedPrefixTransform(3));
+  Reopen(options);
+  get_perf_context()->Reset();
+  ASSERT_EQ(0, count_prefix("ab0"));
+  ASSERT_GT(get_perf_context()->block_read_count, 0U);
+  ASSERT_EQ(10, count_prefix("ac0"));
+  SetPerfLevel(kDisable);
+
+  read_options = ReadOptions();
+  read_options.total_order_seek = true;
+  VerifyIterator(read_options);
+}
+
+TEST_F(DBTierTest, ReadsWithDegradedPool) {
+  Options options = TierOptions();
+  options.statistics = CreateDBStatistics();
+  // The pool has room for a single group filter and cannot grow
+  options.persistent_file_size_ = 2 * options.persistent_block_size_;
+  options.persistent_file_max_size_ = options.persistent_file_size_;
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+  ASSERT_GT(options.statistics->getTickerCount(TIER_GROUP_FILTER_DEGRADED),
+            0U);
+
+  // Groups without a filter are read by key range only
+  auto verify = [&]() {
+    for (const auto& key : targets_) {
+      auto it = model_.find(key);
+      ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second, Get(key));
+      ASSERT_EQ("NOT_FOUND", Get(key + "x"));
+    }
+    VerifyIterator(ReadOptions());
+  };
+  verify();
+
+  // Compactions out of degraded groups, and into them
+  options.tier_max_group_depth_trigger = 2;
+  Reopen(options);
+  ASSERT_OK(dbfull()->TEST_WaitForCompact());
+  WriteFile("b", 5, 55, 10, "v4");
+  WriteFile("d", 0, 20, 2, "v2");
+  ASSERT_GT(NumTableFilesAtLevel(2), 0);
+  verify();
+
+  Reopen(options);
+  verify();
+}
+
+TEST_F(DBTierTest, ReopenWithLostPool) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  // The groups in the MANIFEST keep their block numbers, which are free in
+  // the new pool
+  Close();
+  DeletePool();
+  Reopen(options);
+  VerifyAfterNewGroup("h");
+  // The reserved blocks are still taken after the pool was claimed
+  Reopen(options);
+  VerifyAfterNewGroup("j");
+}
+
+TEST_F(DBTierTest, CopyThroughCheckpointAndBackup) {
+  Options options = TierOptions();
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  const std::string checkpoint_dir = dbname_ + "_checkpoint";
+  const std::string backup_dir = dbname_ + "_backup";
+  const std::string restore_dir = dbname_ + "_restore";
+  ASSERT_OK(DestroyDB(checkpoint_dir, options));
+  ASSERT_OK(DestroyDB(restore_dir, options));
+  Checkpoint* checkpoint;
+  ASSERT_OK(Checkpoint::Create(db_, &checkpoint));
+  ASSERT_OK(checkpoint->CreateCheckpoint(checkpoint_dir));
+  delete checkpoint;
+  BackupEngine* backup_engine;
+  BackupableDBOptions backup_options(backup_dir);
+  backup_options.destroy_old_data = true;
+  ASSERT_OK(BackupEngine::Open(env_, backup_options, &backup_engine));
+  ASSERT_OK(backup_engine->CreateNewBackup(db_));
+  Close();
+  ASSERT_OK(backup_engine->RestoreDBFromLatestBackup(restore_dir, restore_dir));
+  ASSERT_OK(backup_engine->PurgeOldBackups(0));
+  delete backup_engine;
+
+  // Both copies come with the filters of their groups, which hold only the
+  // used part of the pool blocks. Each is opened with a new pool, rebuilt
+  // from those filters
+  auto verify = [&]() {
+    options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL);
+    for (const auto& key : targets_) {
+      auto it = model_.find(key);
+      ASSERT_EQ(it == model_.end() ? "NOT_FOUND" : it->second, Get(key));
+      ASSERT_EQ("NOT_FOUND", Get(key + "x"));
+    }
+    ASSERT_GT(
+        options.statistics->getAndResetTickerCount(TIER_GROUP_FILTER_USEFUL),
+        0U);
+    VerifyIterator(ReadOptions());
+  };
+  const auto model = model_;
+  const auto targets = targets_;
+  for (const auto& dir : {checkpoint_dir, restore_dir}) {
+    std::vector<std::string> children;
+    ASSERT_OK(env_->GetChildren(dir, &children));
+    int exported = 0;
+    for (const auto& fname : children) {
+      uint64_t block_num;
+      uint32_t cf_id;
+      uint32_t crc;
+      if (ParseTierFilterFileName(fname, &block_num, &cf_id, &crc)) {
+        uint64_t size;
+        ASSERT_OK(env_->GetFileSize(dir + "/" + fname, &size));
+        ASSERT_LT(size, options.persistent_block_size_ / 4);
+        exported++;
+      }
+    }
+    ASSERT_GT(exported, 0) << dir;
+
+    DeletePool();
+    ASSERT_OK(DB::Open(options, dir, &db_));
+    verify();
+    Close();
+    ASSERT_OK(DB::Open(options, dir, &db_));
+    verify();
+    VerifyAfterNewGroup("h");
+    Close();
+    ASSERT_OK(DestroyDB(dir, options));
+    model_ = model;
+    targets_ = targets;
+  }
+  // Only the empty directories of the purged backups are left
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(backup_dir, &children));
+  for (const auto& child : children) {
+    if (child != "." && child != "..") {
+      ASSERT_OK(test::DestroyDir(env_, backup_dir + "/" + child));
+    }
+  }
+  ASSERT_OK(env_->DeleteDir(backup_dir));
+}
+
+TEST_F(DBTierTest, OpenCheckpointWithMissingFilter) {
+  Options options = TierOptions();
+  DestroyAndReopen(options);
+  WriteOverlappingGroups();
+
+  const std::string checkpoint_dir = dbname_ + "_checkpoint";
+  ASSERT_OK(DestroyDB(checkpoint_dir, options));
+  Checkpoint* checkpoint;
+  ASSERT_OK(Checkpoint::Create(db_, &checkpoint));
+  ASSERT_OK(checkpoint->CreateCheckpoint(checkpoint_dir));
+  delete checkpoint;
+  Close();
+
+  // Drop the export of the group with the lowest block, the first one a new
+  // group would get
+  std::vector<std::string> children;
+  ASSERT_OK(env_->GetChildren(checkpoint_dir, &children));
+  std::string lowest;
+  uint64_t lowest_block = port::kMaxUint64;
+  for (const auto& fname : children) {
+    uint64_t block_num;
+    uint32_t cf_id;
+    uint32_t crc;
+    if (ParseTierFilterFileName(fname, &block_num, &cf_id, &crc) &&
+        block_num < lowest_block) {
+      lowest = fname;
+      lowest_block = block_num;
+    }
+  }
+  ASSERT_FALSE(lowest.empty());
+  ASSERT_OK(env_->DeleteFile(checkpoint_dir + "/" + lowest));
+
+  DeletePool();
+  ASSERT_OK(DB::Open(options, checkpoint_dir, &db_));
+  VerifyAfterNewGroup("h");
+  Close();
+  ASSERT_OK(DestroyDB(checkpoint_dir, options));
+}
+#endif  // ROCKSDB_LITE
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
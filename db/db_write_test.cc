@@ -320,6 +320,376 @@ INSTANTIATE_TEST_CASE_P(DBWriteTestInstance, DBWriteTest,
                                         DBTestBase::kConcurrentWALWrites,
                                         DBTestBase::kPipelinedWrite));
 
+// Sync writes with pipelined_wal_sync.
+class DBPipelinedWalSyncTest : public DBTestBase {
+ public:
+  DBPipelinedWalSyncTest() : DBTestBase("/db_pipelined_wal_sync_test") {}
+
+  Options GetPipelinedOptions(Env* env) {
+    Options options = CurrentOptions();
+    options.pipelined_wal_sync = true;
+    options.env = env;
+    return options;
+  }
+
+  // Fails the next WAL sync, after the data was appended. The caller
+  // reactivates the file system.
+  void FailNextWalSync(FaultInjectionTestEnv* fault_env) {
+    fail_sync_ = true;
+    SyncPoint::GetInstance()->SetCallBack(
+        "DBWALTest::SyncWALNotWaitWrite:1", [this, fault_env](void*) {
+          if (fail_sync_.exchange(false)) {
+            fault_env->SetFilesystemActive(false);
+          }
+        });
+    SyncPoint::GetInstance()->EnableProcessing();
+  }
+
+ private:
+  std::atomic<bool> fail_sync_{false};
+};
+
+TEST_F(DBPipelinedWalSyncTest, SyncWritesSurviveCrash) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = GetPipelinedOptions(fault_env.get());
+  DestroyAndReopen(options);
+
+  const int kThreads = 4;
+  const int kKeysPerThread = 50;
+  WriteOptions sync_write;
+  sync_write.sync = true;
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kKeysPerThread; i++) {
+        ASSERT_OK(db_->Put(sync_write, "key" + ToString(t) + "_" + ToString(i),
+                           "v" + ToString(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Everything acknowledged to a sync write is on disk
+  fault_env->SetFilesystemActive(false);
+  Close();
+  fault_env->DropUnsyncedFileData();
+  fault_env->ResetState();
+
+  Reopen(options);
+  for (int t = 0; t < kThreads; t++) {
+    for (int i = 0; i < kKeysPerThread; i++) {
+      ASSERT_EQ("v" + ToString(i),
+                Get("key" + ToString(t) + "_" + ToString(i)));
+    }
+  }
+  Close();
+}
+
+// The sync failure is injected from a sync point
+#ifndef NDEBUG
+TEST_F(DBPipelinedWalSyncTest, SyncFailureStopsWrites) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = GetPipelinedOptions(fault_env.get());
+  options.paranoid_checks = true;
+  DestroyAndReopen(options);
+
+  WriteOptions sync_write;
+  sync_write.sync = true;
+  ASSERT_OK(db_->Put(sync_write, "key0", "v0"));
+
+  FailNextWalSync(fault_env.get());
+  ASSERT_TRUE(db_->Put(sync_write, "key1", "v1").IsIOError());
+  fault_env->SetFilesystemActive(true);
+
+  // As with an inline sync, the error goes to the background error handler,
+  // which stops all writes
+  ASSERT_NOK(db_->Put(sync_write, "key2", "v2"));
+  ASSERT_NOK(db_->Put(WriteOptions(), "key2", "v2"));
+  SyncPoint::GetInstance()->DisableProcessing();
+
+  Reopen(options);
+  ASSERT_EQ("v0", Get("key0"));
+  ASSERT_OK(db_->Put(sync_write, "key2", "v2"));
+  ASSERT_EQ("v2", Get("key2"));
+  Close();
+}
+
+TEST_F(DBPipelinedWalSyncTest, SyncFailureClearedByResume) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = GetPipelinedOptions(fault_env.get());
+  // The DB keeps accepting writes after the failure
+  options.paranoid_checks = false;
+  DestroyAndReopen(options);
+
+  WriteOptions sync_write;
+  sync_write.sync = true;
+  FailNextWalSync(fault_env.get());
+  ASSERT_TRUE(db_->Put(sync_write, "key0", "v0").IsIOError());
+  fault_env->SetFilesystemActive(true);
+  SyncPoint::GetInstance()->DisableProcessing();
+
+  // A later sync cannot vouch for the data of the failed one
+  ASSERT_OK(db_->Put(WriteOptions(), "key1", "v1"));
+  ASSERT_TRUE(db_->Put(sync_write, "key1", "v1").IsIOError());
+
+  ASSERT_OK(db_->Resume());
+  ASSERT_OK(db_->Put(sync_write, "key2", "v2"));
+  ASSERT_EQ("v2", Get("key2"));
+  Close();
+}
+#endif  // !NDEBUG
+
+// Writes and recovery of a sharded WAL (wal_shards > 1).
+class DBShardedWalTest : public DBTestBase {
+ public:
+  static const size_t kShards = 4;
+
+  DBShardedWalTest() : DBTestBase("/db_sharded_wal_test") {}
+
+  Options GetShardedOptions() {
+    Options options = CurrentOptions();
+    options.wal_shards = kShards;
+    return options;
+  }
+
+  // Sends the writes to the shards in turn, so that the sequence numbers of
+  // consecutive writes interleave across the logs.
+  void RoundRobinShards() {
+    SyncPoint::GetInstance()->SetCallBack(
+        "DBImpl::ShardedWriteImpl:PickShard", [this](void* arg) {
+          size_t* shard_index = reinterpret_cast<size_t*>(arg);
+          *shard_index = next_shard_.fetch_add(1) % kShards;
+        });
+    SyncPoint::GetInstance()->EnableProcessing();
+  }
+
+ private:
+  std::atomic<size_t> next_shard_{0};
+};
+
+TEST_F(DBShardedWalTest, RecoverInterleavedShards) {
+  Options options = GetShardedOptions();
+  // Keep the logs around across reopens
+  options.avoid_flush_during_recovery = true;
+  DestroyAndReopen(options);
+  RoundRobinShards();
+
+  // Every key is overwritten from all the shards, so recovery has to replay
+  // the logs in sequence number order to end up with the last values.
+  for (int i = 0; i < 200; i++) {
+    ASSERT_OK(Put("key" + ToString(i % 10), "v" + ToString(i)));
+  }
+  ASSERT_OK(Delete("key3"));
+  const SequenceNumber last_seq = dbfull()->GetLatestSequenceNumber();
+  ASSERT_EQ(201, last_seq);
+
+  auto verify = [&]() {
+    for (int k = 0; k < 10; k++) {
+      if (k == 3) {
+        ASSERT_EQ("NOT_FOUND", Get("key3"));
+      } else {
+        ASSERT_EQ("v" + ToString(190 + k), Get("key" + ToString(k)));
+      }
+    }
+    ASSERT_EQ(last_seq, dbfull()->GetLatestSequenceNumber());
+  };
+
+  Reopen(options);
+  verify();
+
+  // The logs of a sharded WAL are replayed the same way without sharding
+  options.wal_shards = 1;
+  Reopen(options);
+  verify();
+}
+
+TEST_F(DBShardedWalTest, RecoverAfterFlush) {
+  Options options = GetShardedOptions();
+  DestroyAndReopen(options);
+  RoundRobinShards();
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(Put("key" + ToString(i), "old"));
+  }
+  ASSERT_OK(Flush());
+  ASSERT_EQ(1, NumTableFilesAtLevel(0));
+  // Only the writes after the flush are replayed from the logs
+  for (int i = 0; i < 50; i++) {
+    ASSERT_OK(Put("key" + ToString(i), "new"));
+  }
+
+  Reopen(options);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i < 50 ? "new" : "old", Get("key" + ToString(i)));
+  }
+}
+
+TEST_F(DBShardedWalTest, WritesFillAndFlushMemtables) {
+  Options options = GetShardedOptions();
+  options.write_buffer_size = 64 << 10;
+  options.max_write_buffer_number = 4;
+  options.disable_auto_compactions = true;
+  DestroyAndReopen(options);
+  RoundRobinShards();
+
+  // The shards insert into the memtable concurrently; the memtable still has
+  // to account for the entries and ask for a flush once full.
+  const int kThreads = 4;
+  const int kKeysPerThread = 200;
+  const std::string value(1024, 'v');
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kKeysPerThread; i++) {
+        ASSERT_OK(Put("key" + ToString(t) + "_" + ToString(i), value));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_OK(dbfull()->TEST_WaitForFlushMemTable());
+  ASSERT_GT(NumTableFilesAtLevel(0), 0);
+
+  uint64_t active_entries = 0;
+  ASSERT_TRUE(dbfull()->GetIntProperty(
+      "rocksdb.num-entries-active-mem-table", &active_entries));
+  ASSERT_LT(active_entries,
+            static_cast<uint64_t>(kThreads * kKeysPerThread));
+
+  Reopen(options);
+  for (int t = 0; t < kThreads; t++) {
+    for (int i = 0; i < kKeysPerThread; i++) {
+      ASSERT_EQ(value, Get("key" + ToString(t) + "_" + ToString(i)));
+    }
+  }
+}
+
+TEST_F(DBShardedWalTest, SyncWritesSurviveCrash) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = GetShardedOptions();
+  options.env = fault_env.get();
+  DestroyAndReopen(options);
+  RoundRobinShards();
+
+  // Every write is a sync write, so nothing is lost whichever shard it went to
+  WriteOptions sync_write;
+  sync_write.sync = true;
+  for (int i = 0; i < 40; i++) {
+    ASSERT_OK(db_->Put(sync_write, "key" + ToString(i), "v" + ToString(i)));
+  }
+
+  fault_env->SetFilesystemActive(false);
+  Close();
+  fault_env->DropUnsyncedFileData();
+  fault_env->ResetState();
+
+  Reopen(options);
+  for (int i = 0; i < 40; i++) {
+    ASSERT_EQ("v" + ToString(i), Get("key" + ToString(i)));
+  }
+  Close();
+}
+
+TEST_F(DBShardedWalTest, SyncWriteSyncsOtherShards) {
+  std::unique_ptr<FaultInjectionTestEnv> fault_env(
+      new FaultInjectionTestEnv(env_));
+  Options options = GetShardedOptions();
+  options.env = fault_env.get();
+  options.wal_recovery_mode = WALRecoveryMode::kPointInTimeRecovery;
+  DestroyAndReopen(options);
+  RoundRobinShards();
+
+  // The unsynced writes land in all the shards; the sync write after them
+  // lands in one shard only but has to make all of them durable
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(Put("key" + ToString(i), "v" + ToString(i)));
+  }
+  WriteOptions sync_write;
+  sync_write.sync = true;
+  ASSERT_OK(db_->Put(sync_write, "synced", "v"));
+  const SequenceNumber synced_seq = dbfull()->GetLatestSequenceNumber();
+  // Lost in the crash
+  for (int i = 10; i < 15; i++) {
+    ASSERT_OK(Put("key" + ToString(i), "v" + ToString(i)));
+  }
+
+  fault_env->SetFilesystemActive(false);
+  Close();
+  fault_env->DropUnsyncedFileData();
+  fault_env->ResetState();
+
+  Reopen(options);
+  ASSERT_EQ("v", Get("synced"));
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ("v" + ToString(i), Get("key" + ToString(i)));
+  }
+  for (int i = 10; i < 15; i++) {
+    ASSERT_EQ("NOT_FOUND", Get("key" + ToString(i)));
+  }
+  ASSERT_EQ(synced_seq, dbfull()->GetLatestSequenceNumber());
+  Close();
+}
+
+TEST_F(DBShardedWalTest, MemtableInsertErrorFailsOnlyItsWriter) {
+  constexpr int kNumThreads = 4;
+  Options options = GetShardedOptions();
+  CreateAndReopenWithCF({"pikachu"}, options);
+  ASSERT_OK(db_->DropColumnFamily(handles_[1]));
+
+  // All the writers go to one shard, and the leader waits until the others
+  // have joined its group
+  std::atomic<int> ready_count{0};
+  std::atomic<int> leader_count{0};
+  SyncPoint::GetInstance()->SetCallBack(
+      "DBImpl::ShardedWriteImpl:PickShard",
+      [](void* arg) { *reinterpret_cast<size_t*>(arg) = 0; });
+  SyncPoint::GetInstance()->SetCallBack(
+      "WriteThread::JoinBatchGroup:Wait", [&](void* arg) {
+        ready_count++;
+        auto* w = reinterpret_cast<WriteThread::Writer*>(arg);
+        if (w->state == WriteThread::STATE_GROUP_LEADER) {
+          leader_count++;
+          while (ready_count < kNumThreads) {
+            // busy waiting
+          }
+        }
+      });
+  SyncPoint::GetInstance()->EnableProcessing();
+
+  // The write to the dropped column family fails, whether it leads the group
+  // or not; the other writes of the group succeed
+  std::vector<port::Thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(port::Thread(
+        [&](int index) {
+          if (index == 0) {
+            ASSERT_TRUE(db_->Put(WriteOptions(), handles_[1], "key", "value")
+                            .IsInvalidArgument());
+          } else {
+            ASSERT_OK(Put("key" + ToString(index), "value"));
+          }
+        },
+        i));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  SyncPoint::GetInstance()->DisableProcessing();
+  SyncPoint::GetInstance()->ClearAllCallBacks();
+  ASSERT_EQ(1, leader_count);
+  for (int i = 1; i < kNumThreads; i++) {
+    ASSERT_EQ("value", Get("key" + ToString(i)));
+  }
+  Close();
+}
+
 }  // namespace ROCKSDB_NAMESPACE
 
 int main(int argc, char** argv) {
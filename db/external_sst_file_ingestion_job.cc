@@ -17,11 +17,13 @@
 #include "db/version_edit.h"
 #include "file/file_util.h"
 #include "file/random_access_file_reader.h"
+#include "monitoring/statistics.h"
 #include "table/merging_iterator.h"
 #include "table/scoped_arena_iterator.h"
 #include "table/sst_file_writer_collectors.h"
 #include "table/table_builder.h"
 #include "test_util/sync_point.h"
+#include "util/run_in_parallel.h"
 #include "util/stop_watch.h"
 
 namespace ROCKSDB_NAMESPACE {
@@ -160,6 +162,13 @@ Status ExternalSstFileIngestionJob::Prepare(
   }
   TEST_SYNC_POINT("ExternalSstFileIngestionJob::AfterSyncDir");
 
+  // Overlapping files all go to L0, which carries no group filters.
+  if (status.ok() &&
+      cfd_->ioptions()->compaction_style == kCompactionStyleTier &&
+      cfd_->GetPersistentArena() != nullptr && !files_overlap_) {
+    status = BuildGroupFilters(sv);
+  }
+
   // TODO: The following is duplicated with Cleanup().
   if (!status.ok()) {
     // We failed, remove all files that we copied into the db
@@ -244,6 +253,10 @@ Status ExternalSstFileIngestionJob::Run() {
     if (!status.ok()) {
       return status;
     }
+    if (f.group_filter_block_num != 0) {
+      cfd_->GetPersistentArena()->SetBlockLevel(f.group_filter_block_num,
+                                                f.picked_level);
+    }
 
     // We use the import time as the ancester time. This is the time the data
     // is written to the database.
@@ -259,7 +272,8 @@ Status ExternalSstFileIngestionJob::Run() {
         f.picked_level, f.fd.GetNumber(), f.fd.GetPathId(), f.fd.GetFileSize(),
         f.smallest_internal_key, f.largest_internal_key, f.assigned_seqno,
         f.assigned_seqno, false, kInvalidBlobFileNumber, oldest_ancester_time,
-        current_time, kUnknownFileChecksum, kUnknownFileChecksumFuncName);
+        current_time, kUnknownFileChecksum, kUnknownFileChecksumFuncName,
+        f.group_filter_block_num);
   }
   return status;
 }
@@ -324,6 +338,14 @@ void ExternalSstFileIngestionJob::UpdateStats() {
 }
 
 void ExternalSstFileIngestionJob::Cleanup(const Status& status) {
+  // The new filters are referenced by the installed version now, or by
+  // nothing if the ingestion failed; either way the filter pool decides when
+  // to reclaim them.
+  for (uint64_t block_num : new_group_filter_blocks_) {
+    cfd_->GetPersistentArena()->CommitBlock(block_num);
+  }
+  new_group_filter_blocks_.clear();
+
   if (!status.ok()) {
     // We failed to add the files to the database
     // remove all the files we copied
@@ -369,22 +391,8 @@ Status ExternalSstFileIngestionJob::GetIngestedFileInfo(
 
   // Create TableReader for external file
   std::unique_ptr<TableReader> table_reader;
-  std::unique_ptr<FSRandomAccessFile> sst_file;
-  std::unique_ptr<RandomAccessFileReader> sst_file_reader;
-
-  status = fs_->NewRandomAccessFile(external_file, env_options_,
-                                    &sst_file, nullptr);
-  if (!status.ok()) {
-    return status;
-  }
-  sst_file_reader.reset(new RandomAccessFileReader(std::move(sst_file),
-                                                   external_file));
-
-  status = cfd_->ioptions()->table_factory->NewTableReader(
-      TableReaderOptions(*cfd_->ioptions(),
-                         sv->mutable_cf_options.prefix_extractor.get(),
-                         env_options_, cfd_->internal_comparator()),
-      std::move(sst_file_reader), file_to_ingest->file_size, &table_reader);
+  status = NewTableReaderForFile(external_file, file_to_ingest->file_size, sv,
+                                 &table_reader);
   if (!status.ok()) {
     return status;
   }
@@ -523,6 +531,136 @@ Status ExternalSstFileIngestionJob::GetIngestedFileInfo(
   return status;
 }
 
+Status ExternalSstFileIngestionJob::NewTableReaderForFile(
+    const std::string& file_path, uint64_t file_size, SuperVersion* sv,
+    std::unique_ptr<TableReader>* table_reader) {
+  std::unique_ptr<FSRandomAccessFile> sst_file;
+  std::unique_ptr<RandomAccessFileReader> sst_file_reader;
+
+  Status status =
+      fs_->NewRandomAccessFile(file_path, env_options_, &sst_file, nullptr);
+  if (!status.ok()) {
+    return status;
+  }
+  sst_file_reader.reset(
+      new RandomAccessFileReader(std::move(sst_file), file_path));
+
+  return cfd_->ioptions()->table_factory->NewTableReader(
+      TableReaderOptions(*cfd_->ioptions(),
+                         sv->mutable_cf_options.prefix_extractor.get(),
+                         env_options_, cfd_->internal_comparator()),
+      std::move(sst_file_reader), file_size, table_reader);
+}
+
+Status ExternalSstFileIngestionJob::BuildGroupFilters(SuperVersion* sv) {
+  // Leave half of the filter free: later compactions into the file's group
+  // keep inserting into the same filter.
+  uint64_t max_keys_per_filter =
+      CuckooFilter::MaxKeyNum(cfd_->GetPersistentArena()->GetBlockSize()) / 2;
+  if (cfd_->ioptions()->tier_prefix_filter &&
+      sv->mutable_cf_options.prefix_extractor != nullptr) {
+    // In the worst case every key has its own prefix, which takes a second
+    // slot in the filter.
+    max_keys_per_filter /= 2;
+  }
+
+  // Range tombstones are not inserted into group filters, so a file holding
+  // any must never be skipped by one. A file with more keys than a filter
+  // can hold with that headroom is left without a filter as well.
+  //
+  // Each file gets a filter of its own: the files do not overlap, so each
+  // one becomes a group of its own at whatever level Run() picks for it,
+  // and files sharing a filter could end up in different levels.
+  std::vector<std::vector<IngestedFileInfo*>> groups;
+  for (IngestedFileInfo& f : files_to_ingest_) {
+    if (f.num_range_deletions == 0 && f.num_entries <= max_keys_per_filter) {
+      groups.emplace_back(1, &f);
+    }
+  }
+  if (groups.empty()) {
+    return Status::OK();
+  }
+
+  // The filters are built on the calling thread and the threads of the low
+  // priority pool, which reads the files of the other background jobs too.
+  std::vector<Status> statuses(groups.size());
+  std::vector<uint64_t> block_nums(groups.size(), 0);
+  RunInParallel(env_, Env::Priority::LOW, groups.size(), [&](size_t i) {
+    statuses[i] = BuildGroupFilter(groups[i], sv, &block_nums[i]);
+  });
+
+  Status status;
+  for (size_t i = 0; i < groups.size(); i++) {
+    if (block_nums[i] != 0) {
+      new_group_filter_blocks_.push_back(block_nums[i]);
+    }
+    if (status.ok() && !statuses[i].ok()) {
+      status = statuses[i];
+    }
+  }
+  return status;
+}
+
+Status ExternalSstFileIngestionJob::BuildGroupFilter(
+    const std::vector<IngestedFileInfo*>& files, SuperVersion* sv,
+    uint64_t* block_num) {
+  // The level is not known until Run(); the block is moved to the picked
+  // level there.
+  std::unique_ptr<CuckooFilter> filter(
+      new CuckooFilter(cfd_->GetPersistentArena(), cfd_->GetID(),
+                       0 /* level */, *block_num));
+  if (!filter->IsValid()) {
+    RecordTick(db_options_.statistics.get(), TIER_GROUP_FILTER_DEGRADED);
+    return Status::OK();
+  }
+
+  const SliceTransform* prefix_extractor = nullptr;
+  if (cfd_->ioptions()->tier_prefix_filter) {
+    uint32_t prefix_id =
+        TierPrefixFilterId(sv->mutable_cf_options.prefix_extractor.get());
+    if (prefix_id != 0) {
+      cfd_->GetPersistentArena()->SetPrefixId(*block_num, prefix_id);
+      prefix_extractor = sv->mutable_cf_options.prefix_extractor.get();
+    }
+  }
+
+  ReadOptions ro;
+  ro.fill_cache = false;
+  for (IngestedFileInfo* f : files) {
+    std::unique_ptr<TableReader> table_reader;
+    Status status = NewTableReaderForFile(
+        f->internal_file_path, f->fd.GetFileSize(), sv, &table_reader);
+    if (!status.ok()) {
+      return status;
+    }
+    std::unique_ptr<InternalIterator> iter(table_reader->NewIterator(
+        ro, sv->mutable_cf_options.prefix_extractor.get(), /*arena=*/nullptr,
+        /*skip_filters=*/false, TableReaderCaller::kExternalSSTIngestion));
+    std::string last_prefix;
+    bool has_last_prefix = false;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      Slice user_key = ExtractUserKey(iter->key());
+      filter->CuckooPutKey(user_key.data(), user_key.size());
+      if (prefix_extractor != nullptr && prefix_extractor->InDomain(user_key)) {
+        Slice prefix = prefix_extractor->Transform(user_key);
+        if (!has_last_prefix || prefix != Slice(last_prefix)) {
+          filter->CuckooPutPrefix(prefix.data(), prefix.size());
+          last_prefix.assign(prefix.data(), prefix.size());
+          has_last_prefix = true;
+        }
+      }
+    }
+    if (!iter->status().ok()) {
+      return iter->status();
+    }
+  }
+
+  for (IngestedFileInfo* f : files) {
+    f->group_filter_block_num = *block_num;
+  }
+  return Status::OK();
+}
+
 Status ExternalSstFileIngestionJob::AssignLevelAndSeqnoForIngestedFile(
     SuperVersion* sv, bool force_global_seqno, CompactionStyle compaction_style,
     SequenceNumber last_seqno, IngestedFileInfo* file_to_ingest,
@@ -56,6 +56,9 @@ struct IngestedFileInfo {
   SequenceNumber assigned_seqno = 0;
   // Level inside the DB we picked for the external file.
   int picked_level = 0;
+  // Tier mode: block of the group cuckoo filter built for this file, 0 if the
+  // file is ingested without one.
+  uint64_t group_filter_block_num = 0;
   // Whether to copy or link the external sst file. copy_file will be set to
   // false if ingestion_options.move_files is true and underlying FS
   // supports link operation. Need to provide a default value to make the
@@ -129,6 +132,21 @@ class ExternalSstFileIngestionJob {
                              IngestedFileInfo* file_to_ingest,
                              SuperVersion* sv);
 
+  Status NewTableReaderForFile(const std::string& file_path,
+                               uint64_t file_size, SuperVersion* sv,
+                               std::unique_ptr<TableReader>* table_reader);
+
+  // Tier mode: build the group cuckoo filters of the files copied into the
+  // DB, one per file, each filled to at most half of its capacity. The
+  // filters are built in parallel, before the version edit is installed.
+  Status BuildGroupFilters(SuperVersion* sv);
+
+  // Insert every user key of `files` into a newly allocated filter and
+  // record its block in the files. Leaves the files without a filter if the
+  // filter pool refuses the allocation.
+  Status BuildGroupFilter(const std::vector<IngestedFileInfo*>& files,
+                          SuperVersion* sv, uint64_t* block_num);
+
   // Assign `file_to_ingest` the appropriate sequence number and  the lowest
   // possible level that it can be ingested to according to compaction_style.
   // REQUIRES: Mutex held
@@ -175,6 +193,9 @@ class ExternalSstFileIngestionJob {
   // Set in ExternalSstFileIngestionJob::Prepare(), if true all files are
   // ingested in L0
   bool files_overlap_{false};
+  // Filter blocks allocated by BuildGroupFilters(), handed back to the filter
+  // pool in Cleanup()
+  std::vector<uint64_t> new_group_filter_blocks_;
 };
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -170,6 +170,24 @@ TEST_F(FileNameTest, Construction) {
   ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
   ASSERT_EQ(100U, number);
   ASSERT_EQ(kMetaDatabase, type);
+
+  fname = TierFilterFileName("tf", 7, 3, 0xdeadbeefU);
+  ASSERT_EQ("tf/", std::string(fname.data(), 3));
+  ASSERT_TRUE(ParseFileName(fname.c_str() + 3, &number, &type));
+  ASSERT_EQ(7U, number);
+  ASSERT_EQ(kTierFilterFile, type);
+  uint64_t block_num;
+  uint32_t cf_id;
+  uint32_t crc;
+  ASSERT_TRUE(
+      ParseTierFilterFileName(fname.c_str() + 3, &block_num, &cf_id, &crc));
+  ASSERT_EQ(7U, block_num);
+  ASSERT_EQ(3U, cf_id);
+  ASSERT_EQ(0xdeadbeefU, crc);
+  ASSERT_FALSE(ParseTierFilterFileName("000007.3.deadbee.tierfilter",
+                                       &block_num, &cf_id, &crc));
+  ASSERT_FALSE(ParseTierFilterFileName("000007.3.deadbeef.sst", &block_num,
+                                       &cf_id, &crc));
 }
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -51,6 +51,114 @@
 
 namespace ROCKSDB_NAMESPACE {
 
+namespace {
+
+// A flush is only split into ranges of at least this much memtable data
+const uint64_t kMinSubFlushDataSize = 1 << 20;
+// Number of keys sampled from the memtables per sub-flush to pick boundaries
+const size_t kSamplesPerSubFlush = 32;
+
+// Restricts an iterator over internal keys to the user keys in
+// [*start, *end), where a null bound means unbounded.
+class KeyRangeIterator : public InternalIterator {
+ public:
+  KeyRangeIterator(InternalIterator* iter, const std::string* start,
+                   const std::string* end, const Comparator* ucmp)
+      : iter_(iter), start_(start), end_(end), ucmp_(ucmp), valid_(false) {}
+
+  bool Valid() const override { return valid_; }
+
+  void SeekToFirst() override {
+    if (start_ == nullptr) {
+      iter_->SeekToFirst();
+    } else {
+      iter_->Seek(InternalKey(*start_, kMaxSequenceNumber, kValueTypeForSeek)
+                      .Encode());
+    }
+    UpdateValid();
+  }
+
+  void SeekToLast() override {
+    if (end_ == nullptr) {
+      iter_->SeekToLast();
+    } else {
+      iter_->SeekForPrev(
+          InternalKey(*end_, kMaxSequenceNumber, kValueTypeForSeek).Encode());
+    }
+    UpdateValid();
+  }
+
+  void Seek(const Slice& target) override {
+    if (start_ != nullptr &&
+        ucmp_->Compare(ExtractUserKey(target), *start_) < 0) {
+      SeekToFirst();
+      return;
+    }
+    iter_->Seek(target);
+    UpdateValid();
+  }
+
+  void SeekForPrev(const Slice& target) override {
+    if (end_ != nullptr && ucmp_->Compare(ExtractUserKey(target), *end_) >= 0) {
+      SeekToLast();
+      return;
+    }
+    iter_->SeekForPrev(target);
+    UpdateValid();
+  }
+
+  void Next() override {
+    iter_->Next();
+    UpdateValid();
+  }
+
+  void Prev() override {
+    iter_->Prev();
+    UpdateValid();
+  }
+
+  Slice key() const override { return iter_->key(); }
+  Slice value() const override { return iter_->value(); }
+  Status status() const override { return iter_->status(); }
+
+  void SetPinnedItersMgr(PinnedIteratorsManager* pinned_iters_mgr) override {
+    iter_->SetPinnedItersMgr(pinned_iters_mgr);
+  }
+  bool IsKeyPinned() const override { return iter_->IsKeyPinned(); }
+  bool IsValuePinned() const override { return iter_->IsValuePinned(); }
+
+ private:
+  void UpdateValid() {
+    valid_ = iter_->Valid();
+    if (valid_) {
+      Slice user_key = ExtractUserKey(iter_->key());
+      valid_ = (start_ == nullptr || ucmp_->Compare(user_key, *start_) >= 0) &&
+               (end_ == nullptr || ucmp_->Compare(user_key, *end_) < 0);
+    }
+  }
+
+  InternalIterator* iter_;
+  const std::string* start_;
+  const std::string* end_;
+  const Comparator* ucmp_;
+  bool valid_;
+};
+
+}  // namespace
+
+// Output of one key range of a split flush
+struct FlushJob::SubFlushState {
+  // User keys in [*start, *end) are written; null means unbounded
+  const std::string* start = nullptr;
+  const std::string* end = nullptr;
+  FileMetaData meta;
+  TableProperties table_properties;
+  Status status;
+  IOStatus io_status;
+  // Bytes written by the thread running this sub-flush
+  uint64_t bytes_written = 0;
+};
+
 const char* GetFlushReasonString (FlushReason flush_reason) {
   switch (flush_reason) {
     case FlushReason::kOthers:
@@ -380,20 +488,34 @@ Status FlushJob::WriteLevel0Table() {
                                    ? current_time
                                    : meta_.oldest_ancester_time;
 
+      // Range tombstones would widen every output to the range they cover, so
+      // flushes containing them are not split.
+      std::vector<std::string> boundaries;
+      if (range_del_iters.empty()) {
+        GenSubFlushBoundaries(total_num_entries, total_data_size, &boundaries);
+      }
+
       IOStatus io_s;
-      s = BuildTable(
-          dbname_, db_options_.env, db_options_.fs.get(), *cfd_->ioptions(),
-          mutable_cf_options_, file_options_, cfd_->table_cache(), iter.get(),
-          std::move(range_del_iters), &meta_, cfd_->internal_comparator(),
-          cfd_->int_tbl_prop_collector_factories(), cfd_->GetID(),
-          cfd_->GetName(), existing_snapshots_,
-          earliest_write_conflict_snapshot_, snapshot_checker_,
-          output_compression_, mutable_cf_options_.sample_for_compression,
-          mutable_cf_options_.compression_opts,
-          mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
-          TableFileCreationReason::kFlush, &io_s, event_logger_,
-          job_context_->job_id, Env::IO_HIGH, &table_properties_, 0 /* level */,
-          creation_time, oldest_key_time, write_hint, current_time);
+      if (boundaries.empty()) {
+        s = BuildTable(
+            dbname_, db_options_.env, db_options_.fs.get(), *cfd_->ioptions(),
+            mutable_cf_options_, file_options_, cfd_->table_cache(),
+            iter.get(), std::move(range_del_iters), &meta_,
+            cfd_->internal_comparator(),
+            cfd_->int_tbl_prop_collector_factories(), cfd_->GetID(),
+            cfd_->GetName(), existing_snapshots_,
+            earliest_write_conflict_snapshot_, snapshot_checker_,
+            output_compression_, mutable_cf_options_.sample_for_compression,
+            mutable_cf_options_.compression_opts,
+            mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
+            TableFileCreationReason::kFlush, &io_s, event_logger_,
+            job_context_->job_id, Env::IO_HIGH, &table_properties_,
+            0 /* level */, creation_time, oldest_key_time, write_hint,
+            current_time);
+      } else {
+        s = RunSubFlushes(boundaries, creation_time, oldest_key_time,
+                          write_hint, current_time, &io_s);
+      }
       if (!io_s.ok()) {
         io_status_ = io_s;
       }
@@ -431,6 +553,18 @@ Status FlushJob::WriteLevel0Table() {
                    meta_.oldest_ancester_time, meta_.file_creation_time,
                    meta_.file_checksum, meta_.file_checksum_func_name);
   }
+  uint64_t bytes_written = meta_.fd.GetFileSize();
+  if (s.ok()) {
+    for (const FileMetaData& meta : sub_flush_outputs_) {
+      edit_->AddFile(0 /* level */, meta.fd.GetNumber(), meta.fd.GetPathId(),
+                     meta.fd.GetFileSize(), meta.smallest, meta.largest,
+                     meta.fd.smallest_seqno, meta.fd.largest_seqno,
+                     meta.marked_for_compaction, meta.oldest_blob_file_number,
+                     meta.oldest_ancester_time, meta.file_creation_time,
+                     meta.file_checksum, meta.file_checksum_func_name);
+      bytes_written += meta.fd.GetFileSize();
+    }
+  }
 #ifndef ROCKSDB_LITE
   // Piggyback FlushJobInfo on the first first flushed memtable.
   mems_[0]->SetFlushJobInfo(GetFlushJobInfo());
@@ -440,15 +574,168 @@ Status FlushJob::WriteLevel0Table() {
   InternalStats::CompactionStats stats(CompactionReason::kFlush, 1);
   stats.micros = db_options_.env->NowMicros() - start_micros;
   stats.cpu_micros = db_options_.env->NowCPUNanos() / 1000 - start_cpu_micros;
-  stats.bytes_written = meta_.fd.GetFileSize();
+  stats.bytes_written = bytes_written;
   RecordTimeToHistogram(stats_, FLUSH_TIME, stats.micros);
   cfd_->internal_stats()->AddCompactionStats(0 /* level */, thread_pri_, stats);
   cfd_->internal_stats()->AddCFStats(InternalStats::BYTES_FLUSHED,
-                                     meta_.fd.GetFileSize());
+                                     bytes_written);
   RecordFlushIOStats();
   return s;
 }
 
+void FlushJob::GenSubFlushBoundaries(uint64_t total_num_entries,
+                                     uint64_t total_data_size,
+                                     std::vector<std::string>* boundaries) {
+  const Comparator* ucmp = cfd_->user_comparator();
+  // The files of an atomic flush are installed by the caller, one per
+  // column family.
+  if (db_options_.max_subflushes <= 1 || !write_manifest_ ||
+      cfd_->ioptions()->compaction_style != kCompactionStyleLevel ||
+      ucmp->timestamp_size() > 0 || total_num_entries == 0) {
+    return;
+  }
+  const uint64_t num_subflushes = std::min<uint64_t>(
+      db_options_.max_subflushes, total_data_size / kMinSubFlushDataSize);
+  if (num_subflushes <= 1) {
+    return;
+  }
+
+  // Sample each memtable in proportion to its number of entries
+  std::vector<std::string> samples;
+  const uint64_t num_samples = num_subflushes * kSamplesPerSubFlush;
+  for (MemTable* m : mems_) {
+    m->SampleUserKeys(static_cast<size_t>(std::max<uint64_t>(
+                          num_samples * m->num_entries() / total_num_entries,
+                          1)),
+                      &samples);
+  }
+  std::sort(samples.begin(), samples.end(),
+            [ucmp](const std::string& a, const std::string& b) {
+              return ucmp->Compare(a, b) < 0;
+            });
+  samples.erase(std::unique(samples.begin(), samples.end(),
+                            [ucmp](const std::string& a, const std::string& b) {
+                              return ucmp->Compare(a, b) == 0;
+                            }),
+                samples.end());
+  if (samples.size() < 2) {
+    return;
+  }
+  // All versions of a user key go to the same range. The first boundary is
+  // above the smallest sample so that no range is known to be empty.
+  for (uint64_t i = 1; i < num_subflushes; i++) {
+    const std::string& key = samples[std::max<size_t>(
+        static_cast<size_t>(i * samples.size() / num_subflushes), 1)];
+    if (boundaries->empty() || ucmp->Compare(boundaries->back(), key) < 0) {
+      boundaries->push_back(key);
+    }
+  }
+}
+
+Status FlushJob::RunSubFlushes(const std::vector<std::string>& boundaries,
+                               uint64_t creation_time,
+                               uint64_t oldest_key_time,
+                               Env::WriteLifeTimeHint write_hint,
+                               uint64_t current_time, IOStatus* io_s) {
+  std::vector<SubFlushState> states(boundaries.size() + 1);
+  for (size_t i = 0; i < states.size(); i++) {
+    SubFlushState& state = states[i];
+    state.start = i == 0 ? nullptr : &boundaries[i - 1];
+    state.end = i == boundaries.size() ? nullptr : &boundaries[i];
+    // The first range keeps the file number picked by PickMemTable(), which
+    // identifies the flush in the memtable list.
+    state.meta.fd = i == 0 ? meta_.fd
+                           : FileDescriptor(versions_->NewFileNumber(), 0, 0);
+    state.meta.oldest_ancester_time = meta_.oldest_ancester_time;
+    state.meta.file_creation_time = meta_.file_creation_time;
+  }
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "[%s] [JOB %d] Level-0 flush split into %" ROCKSDB_PRIszt
+                 " sub-flushes",
+                 cfd_->GetName().c_str(), job_context_->job_id, states.size());
+
+  // Launch a thread for each of sub-flushes 1...n-1 and run the first one in
+  // the current thread
+  std::vector<port::Thread> thread_pool;
+  thread_pool.reserve(states.size() - 1);
+  for (size_t i = 1; i < states.size(); i++) {
+    thread_pool.emplace_back(&FlushJob::ProcessSubFlush, this, &states[i],
+                             creation_time, oldest_key_time, write_hint,
+                             current_time);
+  }
+  ProcessSubFlush(&states[0], creation_time, oldest_key_time, write_hint,
+                  current_time);
+  for (auto& thread : thread_pool) {
+    thread.join();
+  }
+
+  Status s;
+  for (size_t i = 0; i < states.size(); i++) {
+    SubFlushState& state = states[i];
+    if (s.ok()) {
+      s = state.status;
+    }
+    if (io_s->ok()) {
+      *io_s = state.io_status;
+    }
+    if (i == 0) {
+      continue;
+    }
+    // The first sub-flush is accounted by RecordFlushIOStats()
+    RecordTick(stats_, FLUSH_WRITE_BYTES, state.bytes_written);
+    ThreadStatusUtil::IncreaseThreadOperationProperty(
+        ThreadStatus::FLUSH_BYTES_WRITTEN, state.bytes_written);
+    if (state.meta.fd.GetFileSize() > 0) {
+      sub_flush_outputs_.push_back(state.meta);
+    }
+  }
+  meta_ = states[0].meta;
+  table_properties_ = states[0].table_properties;
+  return s;
+}
+
+void FlushJob::ProcessSubFlush(SubFlushState* state, uint64_t creation_time,
+                               uint64_t oldest_key_time,
+                               Env::WriteLifeTimeHint write_hint,
+                               uint64_t current_time) {
+  const uint64_t prev_bytes_written = IOSTATS(bytes_written);
+  ReadOptions ro;
+  ro.total_order_seek = true;
+  Arena arena;
+  std::vector<InternalIterator*> memtables;
+  for (MemTable* m : mems_) {
+    memtables.push_back(m->NewIterator(ro, &arena));
+  }
+  ScopedArenaIterator iter(
+      NewMergingIterator(&cfd_->internal_comparator(), &memtables[0],
+                         static_cast<int>(memtables.size()), &arena));
+  KeyRangeIterator range_iter(iter.get(), state->start, state->end,
+                              cfd_->user_comparator());
+
+  state->status = BuildTable(
+      dbname_, db_options_.env, db_options_.fs.get(), *cfd_->ioptions(),
+      mutable_cf_options_, file_options_, cfd_->table_cache(), &range_iter,
+      std::vector<std::unique_ptr<FragmentedRangeTombstoneIterator>>(),
+      &state->meta, cfd_->internal_comparator(),
+      cfd_->int_tbl_prop_collector_factories(), cfd_->GetID(), cfd_->GetName(),
+      existing_snapshots_, earliest_write_conflict_snapshot_,
+      snapshot_checker_, output_compression_,
+      mutable_cf_options_.sample_for_compression,
+      mutable_cf_options_.compression_opts,
+      mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
+      TableFileCreationReason::kFlush, &state->io_status, event_logger_,
+      job_context_->job_id, Env::IO_HIGH, &state->table_properties,
+      0 /* level */, creation_time, oldest_key_time, write_hint,
+      current_time);
+  state->bytes_written = IOSTATS(bytes_written) - prev_bytes_written;
+  ROCKS_LOG_INFO(db_options_.info_log,
+                 "[%s] [JOB %d] Level-0 sub-flush table #%" PRIu64 ": %" PRIu64
+                 " bytes %s",
+                 cfd_->GetName().c_str(), job_context_->job_id,
+                 state->meta.fd.GetNumber(), state->meta.fd.GetFileSize(),
+                 state->status.ToString().c_str());
+}
+
 #ifndef ROCKSDB_LITE
 std::unique_ptr<FlushJobInfo> FlushJob::GetFlushJobInfo() const {
   db_mutex_->AssertHeld();
@@ -93,11 +93,33 @@ class FlushJob {
   // Return the IO status
   IOStatus io_status() const { return io_status_; }
 
+  // Files written by the sub-flushes other than the first one, whose file is
+  // returned through Run()'s file_meta. See DBOptions::max_subflushes.
+  const std::vector<FileMetaData>& GetSubFlushOutputs() const {
+    return sub_flush_outputs_;
+  }
+
  private:
+  struct SubFlushState;
+
   void ReportStartedFlush();
   void ReportFlushInputSize(const autovector<MemTable*>& mems);
   void RecordFlushIOStats();
   Status WriteLevel0Table();
+  // Picks the user keys splitting the flush into key ranges that are written
+  // to separate files by separate threads. Leaves boundaries empty if the
+  // flush is not to be split.
+  void GenSubFlushBoundaries(uint64_t total_num_entries,
+                             uint64_t total_data_size,
+                             std::vector<std::string>* boundaries);
+  Status RunSubFlushes(const std::vector<std::string>& boundaries,
+                       uint64_t creation_time, uint64_t oldest_key_time,
+                       Env::WriteLifeTimeHint write_hint,
+                       uint64_t current_time, IOStatus* io_s);
+  void ProcessSubFlush(SubFlushState* state, uint64_t creation_time,
+                       uint64_t oldest_key_time,
+                       Env::WriteLifeTimeHint write_hint,
+                       uint64_t current_time);
 #ifndef ROCKSDB_LITE
   std::unique_ptr<FlushJobInfo> GetFlushJobInfo() const;
 #endif  // !ROCKSDB_LITE
@@ -158,6 +180,8 @@ class FlushJob {
   bool pick_memtable_called;
   Env::Priority thread_pri_;
   IOStatus io_status_;
+  // Non-empty files written by the sub-flushes after the first one
+  std::vector<FileMetaData> sub_flush_outputs_;
 };
 
 }  // namespace ROCKSDB_NAMESPACE
@@ -1198,15 +1198,21 @@ void InternalStats::DumpCFMapStatsIOStalls(
       std::to_string(cf_stats_count_[MEMTABLE_LIMIT_STOPS]);
   (*cf_stats)["io_stalls.memtable_slowdown"] =
       std::to_string(cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS]);
+  (*cf_stats)["io_stalls.tier_group_depth_slowdown"] =
+      std::to_string(cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS]);
+  (*cf_stats)["io_stalls.tier_group_depth_stop"] =
+      std::to_string(cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_STOPS]);
 
   uint64_t total_stop = cf_stats_count_[L0_FILE_COUNT_LIMIT_STOPS] +
                         cf_stats_count_[PENDING_COMPACTION_BYTES_LIMIT_STOPS] +
-                        cf_stats_count_[MEMTABLE_LIMIT_STOPS];
+                        cf_stats_count_[MEMTABLE_LIMIT_STOPS] +
+                        cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_STOPS];
 
   uint64_t total_slowdown =
       cf_stats_count_[L0_FILE_COUNT_LIMIT_SLOWDOWNS] +
       cf_stats_count_[PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS] +
-      cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS];
+      cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS] +
+      cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS];
 
   (*cf_stats)["io_stalls.total_stop"] = std::to_string(total_stop);
   (*cf_stats)["io_stalls.total_slowdown"] = std::to_string(total_slowdown);
@@ -1251,7 +1257,9 @@ void InternalStats::DumpCFStatsNoFileHistogram(std::string* value) {
       cf_stats_count_[PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS] +
       cf_stats_count_[PENDING_COMPACTION_BYTES_LIMIT_STOPS] +
       cf_stats_count_[MEMTABLE_LIMIT_STOPS] +
-      cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS];
+      cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS] +
+      cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS] +
+      cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_STOPS];
   // Interval summary
   uint64_t interval_flush_ingest =
       flush_ingest - cf_stats_snapshot_.ingest_bytes_flush;
@@ -1373,6 +1381,10 @@ void InternalStats::DumpCFStatsNoFileHistogram(std::string* value) {
            " memtable_compaction, "
            "%" PRIu64
            " memtable_slowdown, "
+           "%" PRIu64
+           " tier_group_depth_slowdown, "
+           "%" PRIu64
+           " tier_group_depth_stop, "
            "interval %" PRIu64 " total count\n",
            cf_stats_count_[L0_FILE_COUNT_LIMIT_SLOWDOWNS],
            cf_stats_count_[LOCKED_L0_FILE_COUNT_LIMIT_SLOWDOWNS],
@@ -1382,6 +1394,8 @@ void InternalStats::DumpCFStatsNoFileHistogram(std::string* value) {
            cf_stats_count_[PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS],
            cf_stats_count_[MEMTABLE_LIMIT_STOPS],
            cf_stats_count_[MEMTABLE_LIMIT_SLOWDOWNS],
+           cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS],
+           cf_stats_count_[TIER_GROUP_DEPTH_LIMIT_STOPS],
            total_stall_count - cf_stats_snapshot_.stall_count);
   value->append(buf);
 
@@ -99,6 +99,8 @@ class InternalStats {
     LOCKED_L0_FILE_COUNT_LIMIT_STOPS,
     PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS,
     PENDING_COMPACTION_BYTES_LIMIT_STOPS,
+    TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS,
+    TIER_GROUP_DEPTH_LIMIT_STOPS,
     WRITE_STALLS_ENUM_MAX,
     BYTES_FLUSHED,
     BYTES_INGESTED_ADD_FILE,
@@ -607,6 +609,8 @@ class InternalStats {
     LOCKED_L0_FILE_COUNT_LIMIT_STOPS,
     PENDING_COMPACTION_BYTES_LIMIT_SLOWDOWNS,
     PENDING_COMPACTION_BYTES_LIMIT_STOPS,
+    TIER_GROUP_DEPTH_LIMIT_SLOWDOWNS,
+    TIER_GROUP_DEPTH_LIMIT_STOPS,
     WRITE_STALLS_ENUM_MAX,
     BYTES_FLUSHED,
     BYTES_INGESTED_ADD_FILE,
@@ -38,7 +38,8 @@ Reader::Reader(std::shared_ptr<Logger> info_log,
       last_record_offset_(0),
       end_of_buffer_offset_(0),
       log_number_(log_num),
-      recycled_(false) {}
+      recycled_(false),
+      compression_type_(kNoCompression) {}
 
 Reader::~Reader() {
   delete[] backing_store_;
@@ -78,6 +79,9 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         prospective_record_offset = physical_record_offset;
         scratch->clear();
         *record = fragment;
+        if (!MaybeUncompressRecord(record)) {
+          break;
+        }
         last_record_offset_ = prospective_record_offset;
         return true;
 
@@ -113,11 +117,25 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
         } else {
           scratch->append(fragment.data(), fragment.size());
           *record = Slice(*scratch);
+          if (!MaybeUncompressRecord(record)) {
+            in_fragmented_record = false;
+            scratch->clear();
+            break;
+          }
           last_record_offset_ = prospective_record_offset;
           return true;
         }
         break;
 
+      case kSetCompressionType:
+        if (in_fragmented_record) {
+          ReportCorruption(scratch->size(), "partial record without end(3)");
+          in_fragmented_record = false;
+          scratch->clear();
+        }
+        InitCompression(fragment);
+        break;
+
       case kBadHeader:
         if (wal_recovery_mode == WALRecoveryMode::kAbsoluteConsistency) {
           // in clean shutdown we don't expect any error in the log files
@@ -266,11 +284,49 @@ void Reader::UnmarkEOFInternal() {
   }
 }
 
+void Reader::InitCompression(const Slice& payload) {
+  if (compression_type_ != kNoCompression) {
+    ReportCorruption(payload.size(), "duplicate compression type record");
+    return;
+  }
+  if (payload.size() != 1) {
+    ReportCorruption(payload.size(), "bad compression type record");
+    return;
+  }
+  compression_type_ = static_cast<CompressionType>(payload[0]);
+  uncompressor_ = WalUncompressor::Create(compression_type_);
+  if (uncompressor_ == nullptr) {
+    ReportDrop(0, Status::NotSupported(
+                      "WAL compression type not supported in this build"));
+  }
+}
+
+bool Reader::MaybeUncompressRecord(Slice* record) {
+  if (compression_type_ == kNoCompression) {
+    return true;
+  }
+  Slice input = *record;
+  uint64_t uncompressed_size = 0;
+  if (uncompressor_ == nullptr || !GetVarint64(&input, &uncompressed_size) ||
+      !uncompressor_->Uncompress(input, static_cast<size_t>(uncompressed_size),
+                                 &uncompressed_buffer_)) {
+    ReportCorruption(record->size(), "failed to uncompress record");
+    record->clear();
+    return false;
+  }
+  *record = Slice(uncompressed_buffer_);
+  return true;
+}
+
 void Reader::ReportCorruption(size_t bytes, const char* reason) {
   ReportDrop(bytes, Status::Corruption(reason));
 }
 
 void Reader::ReportDrop(size_t bytes, const Status& reason) {
+  // The stream can't be uncompressed past the lost data. The uncompressor
+  // does not always notice that, so all the later records of the file are
+  // dropped as well.
+  uncompressor_.reset();
   if (reporter_ != nullptr) {
     reporter_->Corruption(bytes, reason);
   }
@@ -417,9 +473,12 @@ bool FragmentBufferedReader::ReadRecord(Slice* record, std::string* scratch,
         }
         fragments_.clear();
         *record = fragment;
+        in_fragmented_record_ = false;
+        if (!MaybeUncompressRecord(record)) {
+          break;
+        }
         prospective_record_offset = physical_record_offset;
         last_record_offset_ = prospective_record_offset;
-        in_fragmented_record_ = false;
         return true;
 
       case kFirstType:
@@ -452,12 +511,25 @@ bool FragmentBufferedReader::ReadRecord(Slice* record, std::string* scratch,
           scratch->assign(fragments_.data(), fragments_.size());
           fragments_.clear();
           *record = Slice(*scratch);
-          last_record_offset_ = prospective_record_offset;
           in_fragmented_record_ = false;
+          if (!MaybeUncompressRecord(record)) {
+            scratch->clear();
+            break;
+          }
+          last_record_offset_ = prospective_record_offset;
           return true;
         }
         break;
 
+      case kSetCompressionType:
+        if (in_fragmented_record_) {
+          ReportCorruption(fragments_.size(), "partial record without end(3)");
+          in_fragmented_record_ = false;
+          fragments_.clear();
+        }
+        InitCompression(fragment);
+        break;
+
       case kBadHeader:
       case kBadRecord:
       case kEof:
@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include "db/log_format.h"
+#include "db/wal_compression.h"
 #include "file/sequence_file_reader.h"
 #include "rocksdb/options.h"
 #include "rocksdb/slice.h"
@@ -124,6 +125,12 @@ class Reader {
   // Whether this is a recycled log file
   bool recycled_;
 
+  // Set by the kSetCompressionType record of a compressed log file. Records
+  // are uncompressed into uncompressed_buffer_.
+  CompressionType compression_type_;
+  std::unique_ptr<WalUncompressor> uncompressor_;
+  std::string uncompressed_buffer_;
+
   // Extend record types with the following special values
   enum {
     kEof = kMaxRecordType + 1,
@@ -150,6 +157,13 @@ class Reader {
 
   void UnmarkEOFInternal();
 
+  // Handles the payload of a kSetCompressionType record
+  void InitCompression(const Slice& payload);
+
+  // Replaces *record by its uncompressed contents if the log file is
+  // compressed. Reports a corruption and returns false if that fails.
+  bool MaybeUncompressRecord(Slice* record);
+
   // Reports dropped bytes to the reporter.
   // buffer_ must be updated to remove the dropped bytes prior to invocation.
   void ReportCorruption(size_t bytes, const char* reason);
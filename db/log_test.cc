@@ -9,6 +9,7 @@
 
 #include "db/log_reader.h"
 #include "db/log_writer.h"
+#include "db/wal_compression.h"
 #include "env/composite_env_wrapper.h"
 #include "file/sequence_file_reader.h"
 #include "file/writable_file_writer.h"
@@ -194,6 +195,10 @@ class LogTest : public ::testing::TestWithParam<std::tuple<int, bool>> {
     writer_.AddRecord(Slice(msg));
   }
 
+  void Write(const std::vector<Slice>& parts) {
+    writer_.AddRecord(SliceParts(parts.data(), static_cast<int>(parts.size())));
+  }
+
   size_t WrittenBytes() const {
     return dest_contents().size();
   }
@@ -297,6 +302,38 @@ TEST_P(LogTest, ManyBlocks) {
   ASSERT_EQ("EOF", Read());
 }
 
+TEST_P(LogTest, WriteParts) {
+  // Records gathered from several parts, some of them empty and some larger
+  // than a block, read back as their concatenation
+  Random rnd(301);
+  std::vector<std::string> records;
+  for (int i = 0; i < 200; i++) {
+    std::vector<std::string> pieces;
+    std::vector<Slice> parts;
+    const int num_parts = 1 + static_cast<int>(rnd.Uniform(5));
+    for (int j = 0; j < num_parts; j++) {
+      if (rnd.OneIn(4)) {
+        pieces.push_back("");
+      } else if (rnd.OneIn(20)) {
+        pieces.push_back(BigString(NumberString(i), kBlockSize + j));
+      } else {
+        pieces.push_back(RandomSkewedString(i * 10 + j, &rnd));
+      }
+    }
+    std::string record;
+    for (const auto& piece : pieces) {
+      parts.emplace_back(piece);
+      record += piece;
+    }
+    Write(parts);
+    records.push_back(record);
+  }
+  for (const auto& record : records) {
+    ASSERT_EQ(record, Read());
+  }
+  ASSERT_EQ("EOF", Read());
+}
+
 TEST_P(LogTest, Fragmentation) {
   Write("small");
   Write(BigString("medium", 50000));
@@ -919,6 +956,153 @@ TEST_P(RetriableLogTest, NonBlockingReadFullRecord) {
 
 INSTANTIATE_TEST_CASE_P(bool, RetriableLogTest, ::testing::Values(0, 2));
 
+// Param type is tuple<CompressionType, bool>
+// get<0>(tuple): compression type of the log
+// get<1>(tuple): true if reading with FragmentBufferedReader
+class CompressionLogTest
+    : public ::testing::TestWithParam<std::tuple<CompressionType, bool>> {
+ private:
+  class StringSource : public SequentialFile {
+   public:
+    explicit StringSource(const std::string& contents) : contents_(contents) {}
+
+    Status Read(size_t n, Slice* result, char* scratch) override {
+      n = std::min(n, contents_.size());
+      memcpy(scratch, contents_.data(), n);
+      *result = Slice(scratch, n);
+      contents_.remove_prefix(n);
+      return Status::OK();
+    }
+
+    Status Skip(uint64_t n) override {
+      contents_.remove_prefix(
+          std::min(static_cast<size_t>(n), contents_.size()));
+      return Status::OK();
+    }
+
+   private:
+    Slice contents_;
+  };
+
+  class ReportCollector : public Reader::Reporter {
+   public:
+    size_t dropped_bytes_ = 0;
+    void Corruption(size_t bytes, const Status& /*status*/) override {
+      dropped_bytes_ += bytes;
+    }
+  };
+
+  std::unique_ptr<Writer> writer_;
+  std::string contents_;
+  ReportCollector report_;
+
+ public:
+  bool Supported() const {
+    return WalCompressionTypeSupported(std::get<0>(GetParam()));
+  }
+
+  Writer* NewWriter() {
+    std::unique_ptr<WritableFileWriter> dest(test::GetWritableFileWriter(
+        new test::StringSink(), "" /* don't care */));
+    writer_.reset(new Writer(std::move(dest), 123, false /* recycle */,
+                             false /* manual_flush */,
+                             std::get<0>(GetParam())));
+    return writer_.get();
+  }
+
+  // The file written so far
+  std::string& contents() {
+    return test::GetStringSinkFromLegacyWriter(writer_->file())->contents_;
+  }
+
+  // Reads a copy of the file written so far
+  std::unique_ptr<Reader> NewReader() {
+    contents_ = contents();
+    std::unique_ptr<SequentialFileReader> source(test::GetSequentialFileReader(
+        new StringSource(contents_), "" /* file name */));
+    if (std::get<1>(GetParam())) {
+      return std::unique_ptr<Reader>(new FragmentBufferedReader(
+          nullptr, std::move(source), &report_, true /* checksum */,
+          123 /* log_number */));
+    }
+    return std::unique_ptr<Reader>(new Reader(nullptr, std::move(source),
+                                              &report_, true /* checksum */,
+                                              123 /* log_number */));
+  }
+
+  size_t DroppedBytes() const { return report_.dropped_bytes_; }
+};
+
+TEST_P(CompressionLogTest, ReadWrite) {
+  if (!Supported()) {
+    return;
+  }
+  std::vector<std::string> records;
+  Random rnd(301);
+  size_t total = 0;
+  for (int i = 0; i < 2000; i++) {
+    if (i % 500 == 0) {
+      // Spans several blocks
+      records.push_back(BigString(NumberString(i), 3 * kBlockSize));
+    } else {
+      records.push_back(RandomSkewedString(i, &rnd));
+    }
+    total += records.back().size();
+  }
+  records.push_back("");
+
+  Writer* writer = NewWriter();
+  for (const auto& record : records) {
+    ASSERT_OK(writer->AddRecord(Slice(record)));
+  }
+  ASSERT_LT(contents().size(), total);
+
+  std::unique_ptr<Reader> reader = NewReader();
+  std::string scratch;
+  Slice record;
+  for (const auto& expected : records) {
+    ASSERT_TRUE(reader->ReadRecord(&record, &scratch));
+    ASSERT_EQ(expected, record.ToString());
+  }
+  ASSERT_FALSE(reader->ReadRecord(&record, &scratch));
+  ASSERT_EQ(0U, DroppedBytes());
+}
+
+TEST_P(CompressionLogTest, CorruptionStopsStream) {
+  if (!Supported()) {
+    return;
+  }
+  Writer* writer = NewWriter();
+  ASSERT_OK(writer->AddRecord(Slice("foo")));
+  const size_t second_start = contents().size();
+  ASSERT_OK(writer->AddRecord(Slice(BigString("bar-", 400))));
+  // Reading resumes in the next block after a checksum mismatch
+  Random rnd(301);
+  while (contents().size() < kBlockSize) {
+    std::string filler;
+    test::RandomString(&rnd, 100, &filler);
+    ASSERT_OK(writer->AddRecord(Slice(filler)));
+  }
+  ASSERT_OK(writer->AddRecord(Slice(BigString("bar-", 401))));
+  ASSERT_OK(writer->AddRecord(Slice("foobar")));
+
+  // Corrupt the payload of the second record. The records after it refer to
+  // the stream before them and are dropped too.
+  contents()[second_start + kHeaderSize + 1] ^= 0x55;
+  std::unique_ptr<Reader> reader = NewReader();
+  std::string scratch;
+  Slice record;
+  ASSERT_TRUE(reader->ReadRecord(&record, &scratch));
+  ASSERT_EQ("foo", record.ToString());
+  ASSERT_FALSE(reader->ReadRecord(&record, &scratch));
+  ASSERT_GT(DroppedBytes(), 0U);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    Compression, CompressionLogTest,
+    ::testing::Combine(::testing::Values(kZSTD, kLZ4Compression),
+                       ::testing::Bool()));
+
 }  // namespace log
 }  // namespace ROCKSDB_NAMESPACE
 
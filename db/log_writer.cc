@@ -10,6 +10,8 @@
 #include "db/log_writer.h"
 
 #include <stdint.h>
+#include <algorithm>
+
 #include "file/writable_file_writer.h"
 #include "rocksdb/env.h"
 #include "util/coding.h"
@@ -19,16 +21,26 @@ namespace ROCKSDB_NAMESPACE {
 namespace log {
 
 Writer::Writer(std::unique_ptr<WritableFileWriter>&& dest, uint64_t log_number,
-               bool recycle_log_files, bool manual_flush)
+               bool recycle_log_files, bool manual_flush,
+               CompressionType compression_type)
     : dest_(std::move(dest)),
       block_offset_(0),
       log_number_(log_number),
       recycle_log_files_(recycle_log_files),
-      manual_flush_(manual_flush) {
+      manual_flush_(manual_flush),
+      compression_type_(kNoCompression),
+      compression_type_recorded_(false) {
   for (int i = 0; i <= kMaxRecordType; i++) {
     char t = static_cast<char>(i);
     type_crc_[i] = crc32c::Value(&t, 1);
   }
+  // The kSetCompressionType record has no recyclable format
+  if (compression_type != kNoCompression && !recycle_log_files_) {
+    compressor_ = WalCompressor::Create(compression_type);
+    if (compressor_ != nullptr) {
+      compression_type_ = compression_type;
+    }
+  }
 }
 
 Writer::~Writer() {
@@ -49,18 +61,52 @@ IOStatus Writer::Close() {
 }
 
 IOStatus Writer::AddRecord(const Slice& slice) {
-  const char* ptr = slice.data();
-  size_t left = slice.size();
+  return AddRecord(SliceParts(&slice, 1));
+}
+
+IOStatus Writer::AddRecord(const SliceParts& parts) {
+  SliceParts record = parts;
+  size_t left = 0;
+  for (int i = 0; i < parts.num_parts; i++) {
+    left += parts.parts[i].size();
+  }
 
   // Header size varies depending on whether we are recycling or not.
   const int header_size =
       recycle_log_files_ ? kRecyclableHeaderSize : kHeaderSize;
 
+  IOStatus s;
+  Slice compressed;
+  if (compressor_ != nullptr) {
+    if (!compression_type_recorded_) {
+      s = AddCompressionTypeRecord();
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    Slice input;
+    if (parts.num_parts == 1) {
+      input = parts.parts[0];
+    } else {
+      gathered_buffer_.clear();
+      input = Slice(parts, &gathered_buffer_);
+    }
+    compressed_buffer_.clear();
+    PutVarint64(&compressed_buffer_, input.size());
+    if (!compressor_->Compress(input, &compressed_buffer_)) {
+      return IOStatus::IOError("Failed to compress WAL record");
+    }
+    compressed = Slice(compressed_buffer_);
+    record = SliceParts(&compressed, 1);
+    left = compressed.size();
+  }
+
   // Fragment the record if necessary and emit it.  Note that if slice
   // is empty, we still want to iterate once to emit a single
   // zero-length record
-  IOStatus s;
   bool begin = true;
+  int part_index = 0;
+  size_t part_offset = 0;
   do {
     const int64_t leftover = kBlockSize - block_offset_;
     assert(leftover >= 0);
@@ -97,8 +143,8 @@ IOStatus Writer::AddRecord(const Slice& slice) {
       type = recycle_log_files_ ? kRecyclableMiddleType : kMiddleType;
     }
 
-    s = EmitPhysicalRecord(type, ptr, fragment_length);
-    ptr += fragment_length;
+    s = EmitPhysicalRecord(type, record, &part_index, &part_offset,
+                           fragment_length);
     left -= fragment_length;
     begin = false;
   } while (s.ok() && left > 0);
@@ -114,7 +160,28 @@ IOStatus Writer::AddRecord(const Slice& slice) {
 
 bool Writer::TEST_BufferIsEmpty() { return dest_->TEST_BufferIsEmpty(); }
 
+IOStatus Writer::AddCompressionTypeRecord() {
+  // Always the first record of the file, so it fits into the first block
+  assert(block_offset_ == 0);
+  const char type = static_cast<char>(compression_type_);
+  IOStatus s = EmitPhysicalRecord(kSetCompressionType, &type, 1);
+  if (s.ok()) {
+    compression_type_recorded_ = true;
+  }
+  return s;
+}
+
 IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
+  Slice payload(ptr, n);
+  int part_index = 0;
+  size_t part_offset = 0;
+  return EmitPhysicalRecord(t, SliceParts(&payload, 1), &part_index,
+                            &part_offset, n);
+}
+
+IOStatus Writer::EmitPhysicalRecord(RecordType t, const SliceParts& parts,
+                                    int* part_index, size_t* part_offset,
+                                    size_t n) {
   assert(n <= 0xffff);  // Must fit in two bytes
 
   size_t header_size;
@@ -126,7 +193,7 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
   buf[6] = static_cast<char>(t);
 
   uint32_t crc = type_crc_[t];
-  if (t < kRecyclableFullType) {
+  if (t < kRecyclableFullType || t == kSetCompressionType) {
     // Legacy record format
     assert(block_offset_ + kHeaderSize + n <= kBlockSize);
     header_size = kHeaderSize;
@@ -144,15 +211,37 @@ IOStatus Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
     crc = crc32c::Extend(crc, buf + 7, 4);
   }
 
-  // Compute the crc of the record type and the payload.
-  crc = crc32c::Extend(crc, ptr, n);
+  // Compute the crc of the record type and the payload, which may span
+  // several parts.
+  int index = *part_index;
+  size_t offset = *part_offset;
+  for (size_t left = n; left > 0;) {
+    assert(index < parts.num_parts);
+    const Slice& part = parts.parts[index];
+    const size_t len = std::min(part.size() - offset, left);
+    crc = crc32c::Extend(crc, part.data() + offset, len);
+    left -= len;
+    offset += len;
+    if (offset == part.size()) {
+      index++;
+      offset = 0;
+    }
+  }
   crc = crc32c::Mask(crc);  // Adjust for storage
   EncodeFixed32(buf, crc);
 
   // Write the header and the payload
   IOStatus s = dest_->Append(Slice(buf, header_size));
-  if (s.ok()) {
-    s = dest_->Append(Slice(ptr, n));
+  for (size_t left = n; s.ok() && left > 0;) {
+    const Slice& part = parts.parts[*part_index];
+    const size_t len = std::min(part.size() - *part_offset, left);
+    s = dest_->Append(Slice(part.data() + *part_offset, len));
+    left -= len;
+    *part_offset += len;
+    if (*part_offset == part.size()) {
+      (*part_index)++;
+      *part_offset = 0;
+    }
   }
   block_offset_ += header_size + n;
   return s;
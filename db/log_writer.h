@@ -11,8 +11,10 @@
 #include <stdint.h>
 
 #include <memory>
+#include <string>
 
 #include "db/log_format.h"
+#include "db/wal_compression.h"
 #include "rocksdb/io_status.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/status.h"
@@ -65,6 +67,16 @@ namespace log {
  * Same as above, with the addition of
  * Log number = 32bit log file number, so that we can distinguish between
  * records written by the most recent log writer vs a previous one.
+ *
+ * Compressed log files start with a kSetCompressionType record in the legacy
+ * format. The payload of every logical record after it is
+ *
+ * +------------------------------+--- ... ---+
+ * | Uncompressed size (varint64) | Data      |
+ * +------------------------------+--- ... ---+
+ *
+ * where Data is the next piece of a single compression stream spanning the
+ * whole file (see WalCompressor), fragmented into physical records as usual.
  */
 class Writer {
  public:
@@ -73,7 +85,8 @@ class Writer {
   // "*dest" must remain live while this Writer is in use.
   explicit Writer(std::unique_ptr<WritableFileWriter>&& dest,
                   uint64_t log_number, bool recycle_log_files,
-                  bool manual_flush = false);
+                  bool manual_flush = false,
+                  CompressionType compression_type = kNoCompression);
   // No copying allowed
   Writer(const Writer&) = delete;
   void operator=(const Writer&) = delete;
@@ -82,6 +95,10 @@ class Writer {
 
   IOStatus AddRecord(const Slice& slice);
 
+  // Same as AddRecord(Slice) for the concatenation of the parts, which are
+  // written without being concatenated first.
+  IOStatus AddRecord(const SliceParts& parts);
+
   WritableFileWriter* file() { return dest_.get(); }
   const WritableFileWriter* file() const { return dest_.get(); }
 
@@ -106,9 +123,25 @@ class Writer {
 
   IOStatus EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
 
+  // Emits the next `length` bytes of the parts, starting at part *part_index
+  // and offset *part_offset in it, and advances the position past them.
+  IOStatus EmitPhysicalRecord(RecordType type, const SliceParts& parts,
+                              int* part_index, size_t* part_offset,
+                              size_t length);
+
+  IOStatus AddCompressionTypeRecord();
+
   // If true, it does not flush after each write. Instead it relies on the upper
   // layer to manually does the flush by calling ::WriteBuffer()
   bool manual_flush_;
+
+  // Set if the records are compressed. The kSetCompressionType record is
+  // written in front of the first record.
+  CompressionType compression_type_;
+  std::unique_ptr<WalCompressor> compressor_;
+  bool compression_type_recorded_;
+  std::string compressed_buffer_;
+  std::string gathered_buffer_;
 };
 
 }  // namespace log
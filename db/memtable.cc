@@ -468,6 +468,17 @@ MemTable::MemTableStats MemTable::ApproximateStats(const Slice& start_ikey,
   return {entry_count * (data_size / n), entry_count};
 }
 
+void MemTable::SampleUserKeys(size_t num_samples,
+                              std::vector<std::string>* user_keys) {
+  std::vector<const char*> entries;
+  table_->SampleEntries(num_entries_.load(std::memory_order_relaxed),
+                        num_samples, &entries);
+  for (const char* entry : entries) {
+    user_keys->push_back(
+        ExtractUserKey(GetLengthPrefixedSlice(entry)).ToString());
+  }
+}
+
 bool MemTable::Add(SequenceNumber s, ValueType type,
                    const Slice& key, /* user key */
                    const Slice& value, bool allow_concurrent,
@@ -1117,6 +1128,21 @@ void MemTableRep::Get(const LookupKey& k, void* callback_args,
   }
 }
 
+void MemTableRep::SampleEntries(uint64_t num_entries, size_t num_samples,
+                                std::vector<const char*>* entries) {
+  if (num_samples == 0) {
+    return;
+  }
+  const uint64_t step = std::max<uint64_t>(num_entries / num_samples, 1);
+  std::unique_ptr<Iterator> iter(GetIterator());
+  uint64_t i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), ++i) {
+    if (i % step == 0) {
+      entries->push_back(iter->key());
+    }
+  }
+}
+
 void MemTable::RefLogContainingPrepSection(uint64_t log) {
   assert(log > 0);
   auto cur = min_prep_log_referenced_.load();
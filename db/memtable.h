@@ -88,6 +88,9 @@ class MemTable {
                            const char* prefix_len_key2) const override;
     virtual int operator()(const char* prefix_len_key,
                            const DecodedType& key) const override;
+    virtual const Comparator* user_comparator() const override {
+      return comparator.user_comparator();
+    }
   };
 
   // MemTables are reference counted.  The initial reference count
@@ -405,6 +408,11 @@ class MemTable {
   MemTableStats ApproximateStats(const Slice& start_ikey,
                                  const Slice& end_ikey);
 
+  // Appends to *user_keys about num_samples user keys sampled uniformly from
+  // the point entries of the memtable, in no particular order.
+  // REQUIRES: the memtable is immutable.
+  void SampleUserKeys(size_t num_samples, std::vector<std::string>* user_keys);
+
   // Get the lock associated for the key
   port::RWMutex* GetLock(const Slice& key);
 
@@ -576,6 +576,37 @@ Status TableCache::MultiGet(const ReadOptions& options,
   return s;
 }
 
+Status TableCache::PrefetchForMultiGet(
+    const ReadOptions& options,
+    const InternalKeyComparator& internal_comparator,
+    const FileMetaData& file_meta, const MultiGetContext::Range* mget_range,
+    const SliceTransform* prefix_extractor, HistogramImpl* file_read_hist,
+    bool skip_filters, int level) {
+  auto& fd = file_meta.fd;
+  Status s;
+  TableReader* t = fd.table_reader;
+  Cache::Handle* handle = nullptr;
+  if (t == nullptr) {
+    s = FindTable(file_options_, internal_comparator, fd, &handle,
+                  prefix_extractor,
+                  options.read_tier == kBlockCacheTier /* no_io */,
+                  true /* record_read_stats */, file_read_hist, skip_filters,
+                  level);
+    if (s.ok()) {
+      t = GetTableReaderFromHandle(handle);
+      assert(t);
+    }
+  }
+  if (s.ok()) {
+    s = t->PrefetchForMultiGet(options, mget_range, prefix_extractor,
+                               skip_filters);
+  }
+  if (handle != nullptr) {
+    ReleaseHandle(handle);
+  }
+  return s;
+}
+
 Status TableCache::GetTableProperties(
     const FileOptions& file_options,
     const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
@@ -118,6 +118,17 @@ class TableCache {
                   HistogramImpl* file_read_hist = nullptr,
                   bool skip_filters = false, int level = -1);
 
+  // Reads the data blocks of the specified file that the keys of mget_range
+  // may live in into the block cache, see TableReader::PrefetchForMultiGet().
+  // The keys do not need a GetContext.
+  Status PrefetchForMultiGet(const ReadOptions& options,
+                             const InternalKeyComparator& internal_comparator,
+                             const FileMetaData& file_meta,
+                             const MultiGetContext::Range* mget_range,
+                             const SliceTransform* prefix_extractor = nullptr,
+                             HistogramImpl* file_read_hist = nullptr,
+                             bool skip_filters = false, int level = -1);
+
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
 
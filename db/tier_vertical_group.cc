@@ -0,0 +1,114 @@
+#include "db/tier_vertical_group.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "rocksdb/slice_transform.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// 计算一个 group 的深度
+// 将每个文件看作闭区间 [smallest, largest], 求被最多区间覆盖的点
+int ComputeGroupDepth(const Comparator* ucmp,
+                      const std::vector<FileMetaData*>& files) {
+  if (files.size() <= 1) {
+    return static_cast<int>(files.size());
+  }
+  // files 已经按照 smallest 排序, 只需要对 largest 排序
+  std::vector<Slice> ends;
+  ends.reserve(files.size());
+  for (auto* f : files) {
+    ends.push_back(f->largest.user_key());
+  }
+  std::sort(ends.begin(), ends.end(), [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->CompareWithoutTimestamp(a, b) < 0;
+  });
+
+  int depth = 0;
+  int max_depth = 0;
+  size_t end_idx = 0;
+  for (auto* f : files) {
+    Slice start = f->smallest.user_key();
+    // 闭区间: 结束于 start 之前的文件不再覆盖 start
+    while (end_idx < ends.size() &&
+           ucmp->CompareWithoutTimestamp(ends[end_idx], start) < 0) {
+      end_idx++;
+      depth--;
+    }
+    depth++;
+    max_depth = std::max(max_depth, depth);
+  }
+  return max_depth;
+}
+}  // namespace
+
+void BuildTierVerticalGroups(const InternalKeyComparator& icmp,
+                             const std::vector<FileMetaData*>& files,
+                             bool skip_being_compacted,
+                             std::vector<TierVerticalGroup>* groups) {
+  groups->clear();
+
+  std::vector<FileMetaData*> level_files;
+  level_files.reserve(files.size());
+  for (auto* f : files) {
+    if (skip_being_compacted && f->being_compacted) {
+      continue;
+    }
+    level_files.push_back(f);
+  }
+  if (level_files.empty()) {
+    return;
+  }
+
+  // 对元数据按照 smallest InternalKey 从小到大进行排序
+  std::sort(level_files.begin(), level_files.end(),
+            [&icmp](FileMetaData* ptr1, FileMetaData* ptr2) {
+              int cmp_res = icmp.Compare(ptr1->smallest, ptr2->smallest);
+              if (!cmp_res) {
+                return icmp.Compare(ptr1->largest, ptr2->largest) > 0;
+              }
+              return cmp_res < 0;
+            });
+
+  const Comparator* ucmp = icmp.user_comparator();
+  TierVerticalGroup vgroup;
+  for (auto* f : level_files) {
+    // 判断此文件是否落在当前 group 范围内, 注意需要比较的是 UserKey
+    if (!vgroup.files.empty() &&
+        ucmp->CompareWithoutTimestamp(vgroup.largest.user_key(),
+                                      f->smallest.user_key()) >= 0) {
+      vgroup.files.push_back(f);
+      vgroup.total_file_size += f->compensated_file_size;
+      if (icmp.Compare(vgroup.largest, f->largest) < 0) {
+        // 扩展 largest 边界
+        vgroup.largest = f->largest;
+      }
+      continue;
+    }
+    if (!vgroup.files.empty()) {
+      vgroup.depth = ComputeGroupDepth(ucmp, vgroup.files);
+      groups->push_back(std::move(vgroup));
+      vgroup = TierVerticalGroup();
+    }
+    vgroup.files.push_back(f);
+    vgroup.smallest = f->smallest;
+    vgroup.largest = f->largest;
+    vgroup.total_file_size = f->compensated_file_size;
+  }
+  vgroup.depth = ComputeGroupDepth(ucmp, vgroup.files);
+  groups->push_back(std::move(vgroup));
+}
+
+uint32_t TierPrefixFilterId(const SliceTransform* prefix_extractor) {
+  if (prefix_extractor == nullptr) {
+    return 0;
+  }
+  const char* name = prefix_extractor->Name();
+  uint32_t id = Hash(name, strlen(name), 0x7469657aU);
+  return id == 0 ? 1 : id;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/version_edit.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Tier 模式下, 同一层中 key range 相互重叠的文件组成一个 vertical group
+// 同一个 group 中的文件共享一个 group cuckoo filter
+struct TierVerticalGroup {
+  std::vector<FileMetaData*> files;  // group 中的文件, 按 smallest 从小到大排序
+  InternalKey smallest;              // 整个 group 中的文件的最小 InternalKey
+  InternalKey largest;               // 整个 group 中的文件的最大 InternalKey
+  uint64_t total_file_size = 0;      // 整个 group 中的文件的 compensated_file_size 之和
+  // group 的深度: 同一个 user key 最多会被 group 中的多少个文件覆盖
+  // 也就是一次点查在这个 group 中最多需要读多少个文件
+  int depth = 0;
+};
+
+// 将 files 划分为 vertical group, 结果按照 key range 从小到大排列
+// files 不需要预先排序; skip_being_compacted 为 true 时忽略正在 compaction 的文件
+extern void BuildTierVerticalGroups(const InternalKeyComparator& icmp,
+                                    const std::vector<FileMetaData*>& files,
+                                    bool skip_being_compacted,
+                                    std::vector<TierVerticalGroup>* groups);
+
+// group filter 中 prefix 指纹对应的 prefix_extractor 的标识, 保存在 filter
+// block 头中. prefix_extractor 改变后, 旧的 filter 中的 prefix 指纹不再可用
+// prefix_extractor 为空时返回 0, 否则返回一个非 0 值
+extern uint32_t TierPrefixFilterId(const SliceTransform* prefix_extractor);
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,287 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/tier_vertical_group.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/version_set.h"
+#include "options/cf_options.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/options.h"
+#include "rocksdb/slice_transform.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+FileMetaData* NewFile(uint64_t file_number, const char* smallest,
+                      const char* largest, uint64_t file_size) {
+  FileMetaData* f = new FileMetaData(
+      file_number, 0, file_size, InternalKey(smallest, 100, kTypeValue),
+      InternalKey(largest, 100, kTypeValue), /* smallest_seq */ 0,
+      /* largest_seq */ 0, /* marked_for_compact */ false,
+      kInvalidBlobFileNumber, kUnknownOldestAncesterTime,
+      kUnknownFileCreationTime, kUnknownFileChecksum,
+      kUnknownFileChecksumFuncName);
+  f->compensated_file_size = file_size;
+  return f;
+}
+
+}  // namespace
+
+class TierVerticalGroupTest : public testing::Test {
+ public:
+  TierVerticalGroupTest() : icmp_(BytewiseComparator()) {}
+
+  FileMetaData* Add(const char* smallest, const char* largest,
+                    uint64_t file_size = 1) {
+    files_.emplace_back(
+        NewFile(files_.size() + 1, smallest, largest, file_size));
+    return files_.back().get();
+  }
+
+  std::vector<TierVerticalGroup> Build(bool skip_being_compacted = true) {
+    std::vector<FileMetaData*> files;
+    for (auto& f : files_) {
+      files.push_back(f.get());
+    }
+    std::vector<TierVerticalGroup> groups;
+    BuildTierVerticalGroups(icmp_, files, skip_being_compacted, &groups);
+    return groups;
+  }
+
+  // The file numbers of the group in the order of the group
+  static std::vector<uint64_t> FileNumbers(const TierVerticalGroup& group) {
+    std::vector<uint64_t> numbers;
+    for (auto* f : group.files) {
+      numbers.push_back(f->fd.GetNumber());
+    }
+    return numbers;
+  }
+
+  InternalKeyComparator icmp_;
+  std::vector<std::unique_ptr<FileMetaData>> files_;
+};
+
+TEST_F(TierVerticalGroupTest, Empty) {
+  ASSERT_TRUE(Build().empty());
+  Add("a", "b")->being_compacted = true;
+  ASSERT_TRUE(Build().empty());
+  ASSERT_EQ(1U, Build(false /* skip_being_compacted */).size());
+}
+
+TEST_F(TierVerticalGroupTest, GroupOverlappingFiles) {
+  // Not sorted by key range
+  Add("h", "i", 10);
+  Add("f", "g", 20);
+  Add("b", "d", 30);
+  Add("a", "c", 40);
+  // Closed ranges: sharing "f" is an overlap
+  Add("e", "f", 50);
+
+  std::vector<TierVerticalGroup> groups = Build();
+  ASSERT_EQ(3U, groups.size());
+
+  ASSERT_EQ(std::vector<uint64_t>({4, 3}), FileNumbers(groups[0]));
+  ASSERT_EQ("a", groups[0].smallest.user_key().ToString());
+  ASSERT_EQ("d", groups[0].largest.user_key().ToString());
+  ASSERT_EQ(70U, groups[0].total_file_size);
+  ASSERT_EQ(2, groups[0].depth);
+
+  ASSERT_EQ(std::vector<uint64_t>({5, 2}), FileNumbers(groups[1]));
+  ASSERT_EQ("e", groups[1].smallest.user_key().ToString());
+  ASSERT_EQ("g", groups[1].largest.user_key().ToString());
+  ASSERT_EQ(70U, groups[1].total_file_size);
+  ASSERT_EQ(2, groups[1].depth);
+
+  ASSERT_EQ(std::vector<uint64_t>({1}), FileNumbers(groups[2]));
+  ASSERT_EQ(10U, groups[2].total_file_size);
+  ASSERT_EQ(1, groups[2].depth);
+}
+
+TEST_F(TierVerticalGroupTest, NestedDepth) {
+  // Every file is inside the one before it
+  Add("a", "z");
+  Add("b", "y");
+  Add("c", "x");
+  // Inside the first two files only
+  Add("p", "q");
+  std::vector<TierVerticalGroup> groups = Build();
+  ASSERT_EQ(1U, groups.size());
+  ASSERT_EQ(4U, groups[0].files.size());
+  ASSERT_EQ("a", groups[0].smallest.user_key().ToString());
+  ASSERT_EQ("z", groups[0].largest.user_key().ToString());
+  ASSERT_EQ(4, groups[0].depth);
+}
+
+TEST_F(TierVerticalGroupTest, ChainedDepth) {
+  // Each file overlaps only its neighbours, so no key is in more than two
+  // files even though the group spans all of them
+  Add("a", "c");
+  Add("b", "e");
+  Add("d", "g");
+  Add("f", "i");
+  std::vector<TierVerticalGroup> groups = Build();
+  ASSERT_EQ(1U, groups.size());
+  ASSERT_EQ(4U, groups[0].files.size());
+  ASSERT_EQ(2, groups[0].depth);
+}
+
+TEST_F(TierVerticalGroupTest, SameRange) {
+  Add("a", "c");
+  Add("a", "c");
+  Add("c", "c");
+  std::vector<TierVerticalGroup> groups = Build();
+  ASSERT_EQ(1U, groups.size());
+  ASSERT_EQ(3, groups[0].depth);
+}
+
+TEST_F(TierVerticalGroupTest, SkipBeingCompacted) {
+  Add("a", "c");
+  Add("b", "e")->being_compacted = true;
+  Add("d", "g");
+
+  // Without the file being compacted nothing bridges the other two
+  std::vector<TierVerticalGroup> groups = Build();
+  ASSERT_EQ(2U, groups.size());
+  ASSERT_EQ(std::vector<uint64_t>({1}), FileNumbers(groups[0]));
+  ASSERT_EQ(1, groups[0].depth);
+  ASSERT_EQ(std::vector<uint64_t>({3}), FileNumbers(groups[1]));
+  ASSERT_EQ(1, groups[1].depth);
+
+  groups = Build(false /* skip_being_compacted */);
+  ASSERT_EQ(1U, groups.size());
+  ASSERT_EQ(std::vector<uint64_t>({1, 2, 3}), FileNumbers(groups[0]));
+  ASSERT_EQ(2, groups[0].depth);
+}
+
+TEST_F(TierVerticalGroupTest, PrefixFilterId) {
+  ASSERT_EQ(0U, TierPrefixFilterId(nullptr));
+  std::unique_ptr<const SliceTransform> prefix4(NewFixedPrefixTransform(4));
+  std::unique_ptr<const SliceTransform> prefix4_again(
+      NewFixedPrefixTransform(4));
+  std::unique_ptr<const SliceTransform> prefix8(NewFixedPrefixTransform(8));
+  ASSERT_NE(0U, TierPrefixFilterId(prefix4.get()));
+  ASSERT_NE(0U, TierPrefixFilterId(prefix8.get()));
+  ASSERT_EQ(TierPrefixFilterId(prefix4.get()),
+            TierPrefixFilterId(prefix4_again.get()));
+  ASSERT_NE(TierPrefixFilterId(prefix4.get()),
+            TierPrefixFilterId(prefix8.get()));
+}
+
+class TierCompactionScoreTest : public testing::Test {
+ public:
+  TierCompactionScoreTest()
+      : icmp_(BytewiseComparator()),
+        options_(NewOptions()),
+        ioptions_(options_),
+        mutable_cf_options_(options_),
+        vstorage_(&icmp_, BytewiseComparator(), options_.num_levels,
+                  kCompactionStyleTier, /*src_vstorage=*/nullptr,
+                  /*_force_consistency_checks=*/false) {}
+
+  ~TierCompactionScoreTest() override {
+    for (int i = 0; i < vstorage_.num_levels(); ++i) {
+      for (auto* f : vstorage_.LevelFiles(i)) {
+        if (--f->refs == 0) {
+          delete f;
+        }
+      }
+    }
+  }
+
+  static Options NewOptions() {
+    Options options;
+    options.compaction_style = kCompactionStyleTier;
+    options.num_levels = 4;
+    // Large enough for the size of a level not to matter
+    options.max_bytes_for_level_base = 1 << 30;
+    return options;
+  }
+
+  void Add(int level, uint64_t file_number, const char* smallest,
+           const char* largest) {
+    vstorage_.AddFile(level, NewFile(file_number, smallest, largest, 1));
+  }
+
+  double Score(int level) {
+    vstorage_.CalculateBaseBytes(ioptions_, mutable_cf_options_);
+    vstorage_.ComputeCompactionScore(ioptions_, mutable_cf_options_);
+    for (int i = 0; i < vstorage_.MaxInputLevel() + 1; i++) {
+      if (vstorage_.CompactionScoreLevel(i) == level) {
+        return vstorage_.CompactionScore(i);
+      }
+    }
+    ADD_FAILURE() << "No score for level " << level;
+    return 0;
+  }
+
+  InternalKeyComparator icmp_;
+  Options options_;
+  ImmutableCFOptions ioptions_;
+  MutableCFOptions mutable_cf_options_;
+  VersionStorageInfo vstorage_;
+};
+
+TEST_F(TierCompactionScoreTest, MaxGroupDepth) {
+  ioptions_.tier_max_group_depth_trigger = 2;
+  ioptions_.tier_avg_group_depth_trigger = 0;
+  // One group of depth 3 and one of depth 1
+  Add(1, 1, "a", "z");
+  Add(1, 2, "b", "y");
+  Add(1, 3, "c", "x");
+  Add(1, 4, "zz", "zzz");
+  ASSERT_DOUBLE_EQ(1.5, Score(1));
+  ASSERT_EQ(3, vstorage_.tier_max_group_depth());
+}
+
+TEST_F(TierCompactionScoreTest, AvgGroupDepth) {
+  ioptions_.tier_max_group_depth_trigger = 8;
+  ioptions_.tier_avg_group_depth_trigger = 1;
+  // Groups of depth 3 and 1
+  Add(2, 1, "a", "z");
+  Add(2, 2, "b", "y");
+  Add(2, 3, "c", "x");
+  Add(2, 4, "zz", "zzz");
+  ASSERT_DOUBLE_EQ(2.0, Score(2));
+  ASSERT_EQ(3, vstorage_.tier_max_group_depth());
+}
+
+TEST_F(TierCompactionScoreTest, DeepestLevel) {
+  ioptions_.tier_max_group_depth_trigger = 4;
+  ioptions_.tier_avg_group_depth_trigger = 0;
+  Add(1, 1, "a", "c");
+  Add(1, 2, "b", "d");
+  Add(2, 3, "a", "z");
+  Add(2, 4, "b", "y");
+  Add(2, 5, "c", "x");
+  ASSERT_DOUBLE_EQ(0.5, Score(1));
+  ASSERT_DOUBLE_EQ(0.75, Score(2));
+  // The write stall follows the deepest group of any level
+  ASSERT_EQ(3, vstorage_.tier_max_group_depth());
+}
+
+TEST_F(TierCompactionScoreTest, FilesBeingCompacted) {
+  ioptions_.tier_max_group_depth_trigger = 2;
+  ioptions_.tier_avg_group_depth_trigger = 0;
+  Add(1, 1, "a", "c");
+  Add(1, 2, "b", "d");
+  vstorage_.LevelFiles(1)[1]->being_compacted = true;
+  // The score only counts the files that can still be picked, while the
+  // write stall follows the depth reads see until the compaction finishes
+  ASSERT_DOUBLE_EQ(0.5, Score(1));
+  ASSERT_EQ(2, vstorage_.tier_max_group_depth());
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
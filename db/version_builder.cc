@@ -261,7 +261,14 @@ class VersionBuilder::Rep {
                   NumberToString(external_file_seqno) + " with fileNumber " +
                   NumberToString(f1->fd.GetNumber()));
             }
-          } else if (f1->fd.smallest_seqno <= f2->fd.smallest_seqno) {
+          } else if (f1->fd.smallest_seqno <= f2->fd.smallest_seqno &&
+                     vstorage->InternalComparator()->Compare(
+                         f1->smallest, f2->largest) <= 0 &&
+                     vstorage->InternalComparator()->Compare(
+                         f2->smallest, f1->largest) <= 0) {
+            // The files of one sub-flushed memtable (see
+            // DBOptions::max_subflushes) have interleaved sequence numbers,
+            // but their key ranges are disjoint.
             fprintf(stderr,
                     "L0 files seqno %" PRIu64 " %" PRIu64 " vs. %" PRIu64
                     " %" PRIu64 "\n",
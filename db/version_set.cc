@@ -28,6 +28,7 @@
 #include "db/merge_helper.h"
 #include "db/pinned_iterators_manager.h"
 #include "db/table_cache.h"
+#include "db/tier_vertical_group.h"
 #include "db/version_builder.h"
 #include "db/version_edit_handler.h"
 #include "file/filename.h"
@@ -350,17 +351,25 @@ class FilePicker {
 };
 
 // Tier 模式下的 FilePicker
+// 非 Tier 模式下(没有 group filter)直接退化为普通的 FilePicker
 class TierFilePicker {
 public:
   TierFilePicker(ColumnFamilyData* cfd, std::vector<FileMetaData*>* files, const Slice& user_key,
              const Slice& ikey, autovector<LevelFilesBrief>* file_levels,
              unsigned int num_levels, FileIndexer* file_indexer,
              const Comparator* user_comparator,
-             const InternalKeyComparator* internal_comparator)
+             const InternalKeyComparator* internal_comparator,
+             Statistics* statistics,
+             const std::vector<std::vector<TierVerticalGroup>>* tier_groups)
     : cfd_(cfd), files_(files), user_key_(user_key),
       ikey_(ikey), level_files_brief_(file_levels),
       num_levels_(num_levels), user_comparator_(user_comparator),
-      internal_comparator_(internal_comparator) {
+      internal_comparator_(internal_comparator),
+      statistics_(statistics),
+      is_tiered_(cfd->ioptions()->compaction_style == kCompactionStyleTier),
+      // level 0 的 table reader 的 Prepare 也由 level_picker_ 完成
+      level_picker_(files, user_key, ikey, file_levels, num_levels,
+                    file_indexer, user_comparator, internal_comparator) {
       curr_level_ = 0;
       curr_index_in_curr_level_ = 0;
       valid_group_file_index_ = -1;     // 初始化为无效
@@ -368,19 +377,30 @@ public:
       hit_file_level_ = static_cast<unsigned int>(-1);
       is_hit_file_last_in_level_ = false;
 
-      for (unsigned int i = 0; i < (*level_files_brief_)[0].num_files; ++i) {
-        auto* r = (*level_files_brief_)[0].files[i].fd.table_reader;
-        if (r) {
-          r->Prepare(ikey);
-        }
+      // 没有开启 is_tiered 时没有 filter pool, 所有文件都按 key range 判断
+      arena_ = cfd_->GetPersistentArena();
+      if (is_tiered_ && arena_ != nullptr) {
+        key_tags_ = CuckooFilter::ComputeKeyTags(
+            arena_->GetBlockSize(), user_key_.data(), user_key_.size());
+        PrefetchGroupFilters(arena_, tier_groups);
       }
   }
 
-  unsigned int GetHitFileLevel() { return hit_file_level_; }
-  int GetCurrentLevel() const { return curr_level_; }
-  bool IsHitFileLastInLevel() { return is_hit_file_last_in_level_; }
+  unsigned int GetHitFileLevel() {
+    return is_tiered_ ? hit_file_level_ : level_picker_.GetHitFileLevel();
+  }
+  int GetCurrentLevel() const {
+    return is_tiered_ ? curr_level_ : level_picker_.GetCurrentLevel();
+  }
+  bool IsHitFileLastInLevel() {
+    return is_tiered_ ? is_hit_file_last_in_level_
+                      : level_picker_.IsHitFileLastInLevel();
+  }
   
   FdWithKeyRange* GetNextFile() {
+    if (!is_tiered_) {
+      return level_picker_.GetNextFile();
+    }
     if (curr_level_ >= num_levels_) {
       return nullptr;
     }
@@ -405,16 +425,20 @@ public:
 #endif
 
         unsigned int idx = curr_level_in_range_group_.file_indexs_[valid_group_file_index_];
-        if (cur->file_metadata->pmem_block_num != 0) {
-          CuckooFilter* cuckoo = new CuckooFilter(cfd_->GetPersistentArena(),
-            cur->file_metadata->pmem_block_num);
-
-          if (!cuckoo->CuckooKeyExists(user_key_.data(), user_key_.size())) {
+        // 第 0 层的文件以及 filter pool 降级时生成的 group 没有 filter
+        if (arena_ != nullptr &&
+            arena_->IsFilterBlock(cfd_->GetID(),
+                                  cur->file_metadata->pmem_block_num)) {
+          RecordTick(statistics_, TIER_GROUP_FILTER_PROBED);
+          if (!CuckooFilter::KeyExists(arena_,
+                                       cur->file_metadata->pmem_block_num,
+                                       key_tags_)) {
 
 #ifndef TIERED_DEBUG
         fprintf(stdout, "[VersionSet::FilePicker]----------------Not Exists: Skip File---------------------\n\n");
 #endif
 
+            RecordTick(statistics_, TIER_GROUP_FILTER_USEFUL);
             valid_group_file_index_++;
             continue;
           }
@@ -434,14 +458,9 @@ public:
               hit_file_level_ = curr_level_;
               valid_group_file_index_++;
               is_hit_file_last_in_level_ = idx == curr_file_level_->num_files - 1;
-              delete cuckoo;
               return cur;
           }
-
-          delete cuckoo;
         } else {
-          // 判断是不是第 0 层的
-          assert(curr_level_ == 0);
           if (user_comparator_->CompareWithoutTimestamp(
               cur_smallest_key,
               user_key_) <= 0 &&
@@ -495,6 +514,12 @@ private:
   unsigned int num_levels_;
   const Comparator* user_comparator_;
   const InternalKeyComparator* internal_comparator_;
+  Statistics* statistics_;
+
+  bool is_tiered_;
+  FilePicker level_picker_;
+  PersistentArena* arena_;
+  CuckooFilter::KeyTags key_tags_;
 
   unsigned int hit_file_level_;
   bool is_hit_file_last_in_level_;
@@ -514,6 +539,60 @@ private:
   LevelFilesBrief* curr_file_level_;
   int valid_group_file_index_;
 
+  // 在开始逐层查找之前, 找出每一层中覆盖 user_key_ 的 group, 对它们的
+  // filter 中 key 所在的 bucket 发出预取. 各层 filter 的 cache miss (PMem
+  // 上约 300ns) 相互重叠, 并且与第一次 SST 读取重叠, 不再串行地出现在
+  // 每一层的查找路径上
+  void PrefetchGroupFilters(
+      PersistentArena* arena,
+      const std::vector<std::vector<TierVerticalGroup>>* tier_groups) {
+    if (tier_groups == nullptr) {
+      return;
+    }
+    for (size_t level = 1; level < tier_groups->size(); level++) {
+      const auto& groups = (*tier_groups)[level];
+      // 第一个 largest >= user_key_ 的 group
+      auto it = std::lower_bound(
+          groups.begin(), groups.end(), user_key_,
+          [this](const TierVerticalGroup& group, const Slice& key) {
+            return user_comparator_->CompareWithoutTimestamp(
+                       group.largest.user_key(), key) < 0;
+          });
+      if (it == groups.end() ||
+          user_comparator_->CompareWithoutTimestamp(it->smallest.user_key(),
+                                                    user_key_) > 0) {
+        continue;
+      }
+      uint64_t last_block = 0;
+      for (const auto* f : it->files) {
+        if (f->pmem_block_num != 0 && f->pmem_block_num != last_block) {
+          CuckooFilter::PrefetchKey(arena, f->pmem_block_num, key_tags_);
+          last_block = f->pmem_block_num;
+        }
+      }
+    }
+  }
+
+  // group 中的文件按 smallest key 排列, 但相互重叠, 同一个 key 的新版本
+  // 在 largest_seqno 更大的文件中. 与第 0 层一样从新到旧查找
+  void SortCurGroupNewestFirst() {
+    std::vector<std::pair<FdWithKeyRange*, unsigned int>> files;
+    for (size_t i = 0; i < curr_level_in_range_group_.group_files_.size(); i++) {
+      files.emplace_back(curr_level_in_range_group_.group_files_[i],
+                         curr_level_in_range_group_.file_indexs_[i]);
+    }
+    std::stable_sort(files.begin(), files.end(),
+                     [](const std::pair<FdWithKeyRange*, unsigned int>& a,
+                        const std::pair<FdWithKeyRange*, unsigned int>& b) {
+                       return a.first->fd.largest_seqno >
+                              b.first->fd.largest_seqno;
+                     });
+    for (size_t i = 0; i < files.size(); i++) {
+      curr_level_in_range_group_.group_files_[i] = files[i].first;
+      curr_level_in_range_group_.file_indexs_[i] = files[i].second;
+    }
+  }
+
   void PrepareCurLevelGroupInfo() {
     curr_level_in_range_group_.group_files_.clear();
     curr_level_in_range_group_.file_indexs_.clear();
@@ -533,6 +612,16 @@ private:
     //                     return cmp_res < 0;
     //             });
 
+    if (curr_level_ == 0) {
+      // 第 0 层的文件按从新到旧排列, 不按 key 排序, 不能划分 group,
+      // 逐个按 key range 判断
+      for (unsigned int i = 0; i < curr_file_level_->num_files; i++) {
+        curr_level_in_range_group_.group_files_.push_back(&(curr_file_level_->files[i]));
+        curr_level_in_range_group_.file_indexs_.push_back(i);
+      }
+      return;
+    }
+
     if (curr_file_level_->num_files != 0) {
       curr_level_in_range_group_.group_files_.push_back(&(curr_file_level_->files[0]));
       curr_level_in_range_group_.file_indexs_.push_back(0);
@@ -558,14 +647,27 @@ private:
               user_comparator_->CompareWithoutTimestamp(
               ExtractUserKey(curr_level_in_range_group_.largest),
               user_key_) >= 0) {
+            SortCurGroupNewestFirst();
             return;
           }
           curr_level_in_range_group_.group_files_.clear();
           curr_level_in_range_group_.file_indexs_.clear();
+          curr_level_in_range_group_.group_files_.push_back(&(curr_file_level_->files[i]));
+          curr_level_in_range_group_.file_indexs_.push_back(i);
           curr_level_in_range_group_.smallest = curr_file_level_->files[i].smallest_key;
           curr_level_in_range_group_.largest = curr_file_level_->files[i].largest_key;
         }
       }
+      // 最后一个 group 同样需要判断
+      if (user_comparator_->CompareWithoutTimestamp(
+          ExtractUserKey(curr_level_in_range_group_.smallest),
+          user_key_) <= 0 &&
+          user_comparator_->CompareWithoutTimestamp(
+          ExtractUserKey(curr_level_in_range_group_.largest),
+          user_key_) >= 0) {
+        SortCurGroupNewestFirst();
+        return;
+      }
       curr_level_in_range_group_.group_files_.clear();
       curr_level_in_range_group_.file_indexs_.clear();
       return;
@@ -956,6 +1058,167 @@ class FilePickerMultiGet {
     return false;
   }
 };
+
+// Reads the data blocks of every file a MultiGet batch may have to visit on
+// the USER thread pool, so that the reads of different files and levels are
+// in flight together while Version::MultiGet() resolves the keys level by
+// level. Before looking up a file, MultiGet() calls WaitForFile(): if the
+// prefetch of that file is running it waits for it, and if no thread picked
+// it up yet it is dropped and the lookup reads the blocks itself.
+class MultiGetFilePrefetcher {
+ public:
+  MultiGetFilePrefetcher(Env* env, TableCache* table_cache,
+                         const ReadOptions& read_options,
+                         const InternalKeyComparator* internal_comparator,
+                         const SliceTransform* prefix_extractor)
+      : env_(env), state_(std::make_shared<State>()) {
+    state_->table_cache = table_cache;
+    state_->read_options = read_options;
+    state_->internal_comparator = internal_comparator;
+    state_->prefix_extractor = prefix_extractor;
+  }
+
+  // Drops the prefetches that did not start and waits for the running ones,
+  // which use the keys and files of the batch.
+  ~MultiGetFilePrefetcher() {
+    MutexLock l(&state_->mu);
+    for (auto& file : state_->files) {
+      if (file->state == kPending) {
+        file->state = kDone;
+      }
+    }
+    while (state_->running > 0) {
+      state_->cv.Wait();
+    }
+  }
+
+  void AddFile(FdWithKeyRange* f, const MultiGetRange& file_range,
+               HistogramImpl* file_read_hist, bool skip_filters, int level) {
+    std::unique_ptr<File> file(new File());
+    file->fd = f;
+    file->file_read_hist = file_read_hist;
+    file->skip_filters = skip_filters;
+    file->level = level;
+    for (auto iter = file_range.begin(); iter != file_range.end(); ++iter) {
+      // All the keys of a batch are read at the same sequence number.
+      state_->snapshot = GetInternalKeySeqno(iter->ikey);
+      file->statuses.emplace_back();
+      file->keys.emplace_back(nullptr, *iter->key, nullptr, nullptr,
+                              &file->statuses.back());
+    }
+    state_->files.push_back(std::move(file));
+  }
+
+  size_t NumFiles() const { return state_->files.size(); }
+
+  // Hands the files to at most `max_threads` threads of the USER pool.
+  void Start(int max_threads) {
+    size_t num_threads =
+        std::min(state_->files.size(), static_cast<size_t>(max_threads));
+    for (size_t i = 0; i < num_threads; i++) {
+      env_->Schedule(&MultiGetFilePrefetcher::BGWork,
+                     new std::shared_ptr<State>(state_), Env::Priority::USER);
+    }
+  }
+
+  void WaitForFile(const FdWithKeyRange* f) {
+    TEST_SYNC_POINT("MultiGetFilePrefetcher::WaitForFile");
+    MutexLock l(&state_->mu);
+    // Files are looked up in the order they were added, possibly skipping
+    // some.
+    while (next_lookup_ < state_->files.size() &&
+           state_->files[next_lookup_]->fd != f) {
+      next_lookup_++;
+    }
+    if (next_lookup_ == state_->files.size()) {
+      return;
+    }
+    File* file = state_->files[next_lookup_++].get();
+    if (file->state == kPending) {
+      file->state = kDone;
+    }
+    while (file->state != kDone) {
+      state_->cv.Wait();
+    }
+  }
+
+ private:
+  enum FileState { kPending, kRunning, kDone };
+
+  struct File {
+    FdWithKeyRange* fd;
+    HistogramImpl* file_read_hist;
+    bool skip_filters;
+    int level;
+    // Copies of the batch's keys that may be in the file. They have no
+    // GetContext and statuses of their own, so the prefetch never touches
+    // state the lookups use.
+    autovector<KeyContext, MultiGetContext::MAX_BATCH_SIZE> keys;
+    autovector<Status, MultiGetContext::MAX_BATCH_SIZE> statuses;
+    FileState state = kPending;
+  };
+
+  // Shared with the pool threads, which may only get to run after the
+  // MultiGet is over and must then find nothing left to do.
+  struct State {
+    State() : cv(&mu) {}
+
+    TableCache* table_cache;
+    ReadOptions read_options;
+    const InternalKeyComparator* internal_comparator;
+    const SliceTransform* prefix_extractor;
+    SequenceNumber snapshot = 0;
+    std::vector<std::unique_ptr<File>> files;
+
+    port::Mutex mu;
+    port::CondVar cv;
+    // Next file a pool thread considers, and the number of prefetches in
+    // progress. Guarded by mu, as is File::state.
+    size_t next_file = 0;
+    int running = 0;
+  };
+
+  static void BGWork(void* arg) {
+    std::unique_ptr<std::shared_ptr<State>> state_ptr(
+        static_cast<std::shared_ptr<State>*>(arg));
+    State* state = state_ptr->get();
+    MutexLock l(&state->mu);
+    while (state->next_file < state->files.size()) {
+      File* file = state->files[state->next_file++].get();
+      if (file->state != kPending) {
+        continue;
+      }
+      file->state = kRunning;
+      state->running++;
+      state->mu.Unlock();
+      Prefetch(state, file);
+      state->mu.Lock();
+      file->state = kDone;
+      state->running--;
+      state->cv.SignalAll();
+    }
+  }
+
+  static void Prefetch(State* state, File* file) {
+    autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE> sorted_keys;
+    for (auto& key : file->keys) {
+      sorted_keys.push_back(&key);
+    }
+    MultiGetContext ctx(&sorted_keys, 0, sorted_keys.size(), state->snapshot);
+    MultiGetRange range = ctx.GetMultiGetRange();
+    TEST_SYNC_POINT("MultiGetFilePrefetcher::Prefetch");
+    // Errors surface again when the file is looked up.
+    state->table_cache->PrefetchForMultiGet(
+        state->read_options, *state->internal_comparator,
+        *file->fd->file_metadata, &range, state->prefix_extractor,
+        file->file_read_hist, file->skip_filters, file->level);
+  }
+
+  Env* env_;
+  std::shared_ptr<State> state_;
+  // Position of the last file MultiGet() looked up.
+  size_t next_lookup_ = 0;
+};
 }  // anonymous namespace
 
 VersionStorageInfo::~VersionStorageInfo() { delete[] files_; }
@@ -1427,6 +1690,429 @@ void LevelIterator::InitFileIterator(size_t new_file_index) {
     }
   }
 }
+
+// Tier 模式下 L1+ 的迭代器
+// 同一层中的文件按 vertical group 组织, group 之间 key range 不重叠,
+// group 内部的文件相互重叠. 迭代器按 group 依次前进, 只为游标所在的 group
+// 打开文件并做多路归并, 整个 group 超出 iterate_upper_bound /
+// iterate_lower_bound 时直接跳过.
+// prefix seek 时, group filter 中带有同一个 prefix_extractor 的 prefix 指纹
+// 的 group 如果不包含目标 prefix, 同样直接跳过
+class TierLevelIterator final : public InternalIterator {
+ public:
+  TierLevelIterator(TableCache* table_cache, const ReadOptions& read_options,
+                    const FileOptions& file_options,
+                    const InternalKeyComparator& icomparator,
+                    const std::vector<TierVerticalGroup>* groups,
+                    const SliceTransform* prefix_extractor, bool should_sample,
+                    HistogramImpl* file_read_hist, TableReaderCaller caller,
+                    bool skip_filters, int level,
+                    RangeDelAggregator* range_del_agg,
+                    PersistentArena* filter_arena, uint32_t cf_id)
+      : table_cache_(table_cache),
+        read_options_(read_options),
+        file_options_(file_options),
+        icomparator_(icomparator),
+        user_comparator_(icomparator.user_comparator()),
+        groups_(groups),
+        prefix_extractor_(prefix_extractor),
+        file_read_hist_(file_read_hist),
+        should_sample_(should_sample),
+        caller_(caller),
+        skip_filters_(skip_filters),
+        group_index_(groups_->size()),
+        level_(level),
+        range_del_agg_(range_del_agg),
+        pinned_iters_mgr_(nullptr),
+        filter_arena_(filter_arena),
+        cf_id_(cf_id),
+        prefix_filter_id_(0),
+        use_seek_prefix_(false) {
+    // Empty level is not supported.
+    assert(groups_ != nullptr && !groups_->empty());
+    if (filter_arena_ != nullptr && !skip_filters_ &&
+        prefix_extractor_ != nullptr && !read_options_.total_order_seek &&
+        !read_options_.auto_prefix_mode) {
+      prefix_filter_id_ = TierPrefixFilterId(prefix_extractor_);
+    }
+  }
+
+  ~TierLevelIterator() override { delete group_iter_.Set(nullptr); }
+
+  void Seek(const Slice& target) override;
+  void SeekForPrev(const Slice& target) override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  void Next() final override;
+  bool NextAndGetResult(IterateResult* result) override;
+  void Prev() override;
+
+  bool Valid() const override { return group_iter_.Valid(); }
+  Slice key() const override {
+    assert(Valid());
+    return group_iter_.key();
+  }
+
+  Slice value() const override {
+    assert(Valid());
+    return group_iter_.value();
+  }
+
+  Status status() const override {
+    return group_iter_.iter() ? group_iter_.status() : Status::OK();
+  }
+
+  inline bool MayBeOutOfLowerBound() override {
+    assert(Valid());
+    return may_be_out_of_lower_bound_ && group_iter_.MayBeOutOfLowerBound();
+  }
+
+  inline bool MayBeOutOfUpperBound() override {
+    assert(Valid());
+    return group_iter_.MayBeOutOfUpperBound();
+  }
+
+  void SetPinnedItersMgr(PinnedIteratorsManager* pinned_iters_mgr) override {
+    pinned_iters_mgr_ = pinned_iters_mgr;
+    if (group_iter_.iter()) {
+      group_iter_.SetPinnedItersMgr(pinned_iters_mgr);
+    }
+  }
+
+  bool IsKeyPinned() const override {
+    return pinned_iters_mgr_ && pinned_iters_mgr_->PinningEnabled() &&
+           group_iter_.iter() && group_iter_.IsKeyPinned();
+  }
+
+  bool IsValuePinned() const override {
+    return pinned_iters_mgr_ && pinned_iters_mgr_->PinningEnabled() &&
+           group_iter_.iter() && group_iter_.IsValuePinned();
+  }
+
+ private:
+  // Return true if at least one invalid group is seen and skipped.
+  bool SkipEmptyGroupForward();
+  void SkipEmptyGroupBackward();
+  void SetGroupIterator(InternalIterator* iter);
+  void InitGroupIterator(size_t new_group_index);
+  InternalIterator* NewGroupIterator();
+
+  // 记录 Seek 的目标 prefix, 之后定位到的 group 都需要包含这个 prefix
+  void SetSeekPrefix(const Slice& target);
+  // 第一个下标 >= group_index, 并且可能包含目标 prefix 的 group.
+  // 后面的 group 都不可能包含目标 prefix 时返回 groups_->size()
+  size_t SkipGroupsWithoutPrefix(size_t group_index);
+  bool GroupMayContainPrefix(const TierVerticalGroup& group);
+
+  void NextImpl() {
+    assert(Valid());
+    group_iter_.Next();
+    SkipEmptyGroupForward();
+  }
+
+  // 第一个 largest >= target 的 group
+  size_t FindGroup(const Slice& target) const {
+    size_t left = 0;
+    size_t right = groups_->size();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      if (icomparator_.InternalKeyComparator::Compare(
+              (*groups_)[mid].largest.Encode(), target) < 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return right;
+  }
+
+  bool KeyReachedUpperBound(const Slice& internal_key) {
+    return read_options_.iterate_upper_bound != nullptr &&
+           user_comparator_.CompareWithoutTimestamp(
+               ExtractUserKey(internal_key), /*a_has_ts=*/true,
+               *read_options_.iterate_upper_bound, /*b_has_ts=*/false) >= 0;
+  }
+
+  bool KeyBeforeLowerBound(const Slice& internal_key) {
+    return read_options_.iterate_lower_bound != nullptr &&
+           user_comparator_.CompareWithoutTimestamp(
+               ExtractUserKey(internal_key), /*a_has_ts=*/true,
+               *read_options_.iterate_lower_bound, /*b_has_ts=*/false) < 0;
+  }
+
+  void CheckMayBeOutOfLowerBound() {
+    if (read_options_.iterate_lower_bound != nullptr &&
+        group_index_ < groups_->size()) {
+      may_be_out_of_lower_bound_ =
+          KeyBeforeLowerBound((*groups_)[group_index_].smallest.Encode());
+    }
+  }
+
+  TableCache* table_cache_;
+  const ReadOptions read_options_;
+  const FileOptions& file_options_;
+  const InternalKeyComparator& icomparator_;
+  const UserComparatorWrapper user_comparator_;
+  const std::vector<TierVerticalGroup>* groups_;
+  const SliceTransform* prefix_extractor_;
+
+  HistogramImpl* file_read_hist_;
+  bool should_sample_;
+  TableReaderCaller caller_;
+  bool skip_filters_;
+  bool may_be_out_of_lower_bound_ = true;
+  size_t group_index_;
+  int level_;
+  RangeDelAggregator* range_del_agg_;
+  IteratorWrapper group_iter_;  // May be nullptr
+  PinnedIteratorsManager* pinned_iters_mgr_;
+
+  PersistentArena* filter_arena_;
+  uint32_t cf_id_;
+  // 为 0 时不使用 group filter 中的 prefix 指纹
+  uint32_t prefix_filter_id_;
+  bool use_seek_prefix_;
+  std::string seek_prefix_;
+  CuckooFilter::KeyTags seek_prefix_tags_;
+};
+
+void TierLevelIterator::SetSeekPrefix(const Slice& target) {
+  use_seek_prefix_ = false;
+  if (prefix_filter_id_ == 0) {
+    return;
+  }
+  Slice target_user_key = ExtractUserKey(target);
+  if (!prefix_extractor_->InDomain(target_user_key)) {
+    return;
+  }
+  Slice prefix = prefix_extractor_->Transform(target_user_key);
+  seek_prefix_.assign(prefix.data(), prefix.size());
+  seek_prefix_tags_ = CuckooFilter::ComputePrefixTags(
+      filter_arena_->GetBlockSize(), prefix.data(), prefix.size());
+  use_seek_prefix_ = true;
+}
+
+bool TierLevelIterator::GroupMayContainPrefix(const TierVerticalGroup& group) {
+  uint64_t last_block_num = 0;
+  for (FileMetaData* f : group.files) {
+    uint64_t block_num = f->pmem_block_num;
+    if (block_num == last_block_num && block_num != 0) {
+      continue;
+    }
+    // 没有 filter, 或者 filter 中没有同一个 prefix_extractor 的 prefix 指纹
+    if (!filter_arena_->IsFilterBlock(cf_id_, block_num) ||
+        filter_arena_->GetPrefixId(block_num) != prefix_filter_id_) {
+      return true;
+    }
+    if (CuckooFilter::KeyExists(filter_arena_, block_num, seek_prefix_tags_)) {
+      return true;
+    }
+    last_block_num = block_num;
+  }
+  return false;
+}
+
+size_t TierLevelIterator::SkipGroupsWithoutPrefix(size_t group_index) {
+  if (!use_seek_prefix_) {
+    return group_index;
+  }
+  for (; group_index < groups_->size(); group_index++) {
+    const TierVerticalGroup& group = (*groups_)[group_index];
+    Slice smallest_user_key = group.smallest.user_key();
+    if (user_comparator_.Compare(smallest_user_key, seek_prefix_) > 0 &&
+        (!prefix_extractor_->InDomain(smallest_user_key) ||
+         user_comparator_.Compare(
+             prefix_extractor_->Transform(smallest_user_key), seek_prefix_) !=
+             0)) {
+      // group 从目标 prefix 之后开始, 之后的 group 同样如此
+      return groups_->size();
+    }
+    if (GroupMayContainPrefix(group)) {
+      return group_index;
+    }
+  }
+  return group_index;
+}
+
+void TierLevelIterator::Seek(const Slice& target) {
+  SetSeekPrefix(target);
+  InitGroupIterator(SkipGroupsWithoutPrefix(FindGroup(target)));
+  if (group_iter_.iter() != nullptr) {
+    group_iter_.Seek(target);
+  }
+  if (SkipEmptyGroupForward() && prefix_extractor_ != nullptr &&
+      !read_options_.total_order_seek && !read_options_.auto_prefix_mode &&
+      group_iter_.iter() != nullptr && group_iter_.Valid()) {
+    // Same as LevelIterator::Seek(): once the group we were positioned to is
+    // exhausted, invalidate the iterator if the prefix has been passed.
+    Slice target_user_key = ExtractUserKey(target);
+    Slice group_user_key = ExtractUserKey(group_iter_.key());
+    if (prefix_extractor_->InDomain(target_user_key) &&
+        (!prefix_extractor_->InDomain(group_user_key) ||
+         user_comparator_.Compare(
+             prefix_extractor_->Transform(target_user_key),
+             prefix_extractor_->Transform(group_user_key)) != 0)) {
+      SetGroupIterator(nullptr);
+    }
+  }
+  CheckMayBeOutOfLowerBound();
+}
+
+void TierLevelIterator::SeekForPrev(const Slice& target) {
+  use_seek_prefix_ = false;
+  size_t new_group_index = FindGroup(target);
+  if (new_group_index >= groups_->size()) {
+    new_group_index = groups_->size() - 1;
+  }
+
+  InitGroupIterator(new_group_index);
+  if (group_iter_.iter() != nullptr) {
+    group_iter_.SeekForPrev(target);
+    SkipEmptyGroupBackward();
+  }
+  CheckMayBeOutOfLowerBound();
+}
+
+void TierLevelIterator::SeekToFirst() {
+  use_seek_prefix_ = false;
+  InitGroupIterator(0);
+  if (group_iter_.iter() != nullptr) {
+    group_iter_.SeekToFirst();
+  }
+  SkipEmptyGroupForward();
+  CheckMayBeOutOfLowerBound();
+}
+
+void TierLevelIterator::SeekToLast() {
+  use_seek_prefix_ = false;
+  InitGroupIterator(groups_->size() - 1);
+  if (group_iter_.iter() != nullptr) {
+    group_iter_.SeekToLast();
+  }
+  SkipEmptyGroupBackward();
+  CheckMayBeOutOfLowerBound();
+}
+
+void TierLevelIterator::Next() { NextImpl(); }
+
+bool TierLevelIterator::NextAndGetResult(IterateResult* result) {
+  NextImpl();
+  bool is_valid = Valid();
+  if (is_valid) {
+    result->key = key();
+    result->may_be_out_of_upper_bound = MayBeOutOfUpperBound();
+  }
+  return is_valid;
+}
+
+void TierLevelIterator::Prev() {
+  assert(Valid());
+  group_iter_.Prev();
+  SkipEmptyGroupBackward();
+}
+
+bool TierLevelIterator::SkipEmptyGroupForward() {
+  bool seen_empty_group = false;
+  while (group_iter_.iter() == nullptr ||
+         (!group_iter_.Valid() && group_iter_.status().ok() &&
+          !group_iter_.iter()->IsOutOfBound())) {
+    seen_empty_group = true;
+    if (group_index_ >= groups_->size() - 1) {
+      // Already at the last group
+      SetGroupIterator(nullptr);
+      break;
+    }
+    size_t next_group_index = SkipGroupsWithoutPrefix(group_index_ + 1);
+    if (next_group_index >= groups_->size()) {
+      // No later group contains the seek prefix
+      InitGroupIterator(next_group_index);
+      break;
+    }
+    if (KeyReachedUpperBound((*groups_)[next_group_index].smallest.Encode())) {
+      SetGroupIterator(nullptr);
+      break;
+    }
+    InitGroupIterator(next_group_index);
+    if (group_iter_.iter() != nullptr) {
+      group_iter_.SeekToFirst();
+    }
+  }
+  return seen_empty_group;
+}
+
+void TierLevelIterator::SkipEmptyGroupBackward() {
+  while (group_iter_.iter() == nullptr ||
+         (!group_iter_.Valid() && group_iter_.status().ok())) {
+    if (group_index_ == 0) {
+      // Already the first group
+      SetGroupIterator(nullptr);
+      return;
+    }
+    if (KeyBeforeLowerBound((*groups_)[group_index_ - 1].largest.Encode())) {
+      SetGroupIterator(nullptr);
+      return;
+    }
+    InitGroupIterator(group_index_ - 1);
+    if (group_iter_.iter() != nullptr) {
+      group_iter_.SeekToLast();
+    }
+  }
+}
+
+void TierLevelIterator::SetGroupIterator(InternalIterator* iter) {
+  if (pinned_iters_mgr_ && iter) {
+    iter->SetPinnedItersMgr(pinned_iters_mgr_);
+  }
+
+  InternalIterator* old_iter = group_iter_.Set(iter);
+  if (pinned_iters_mgr_ && pinned_iters_mgr_->PinningEnabled()) {
+    pinned_iters_mgr_->PinIterator(old_iter);
+  } else {
+    delete old_iter;
+  }
+}
+
+void TierLevelIterator::InitGroupIterator(size_t new_group_index) {
+  if (new_group_index >= groups_->size()) {
+    group_index_ = new_group_index;
+    SetGroupIterator(nullptr);
+    return;
+  }
+  if (group_iter_.iter() != nullptr && !group_iter_.status().IsIncomplete() &&
+      new_group_index == group_index_) {
+    // group_iter_ is already constructed for this group
+    return;
+  }
+  group_index_ = new_group_index;
+  SetGroupIterator(NewGroupIterator());
+}
+
+InternalIterator* TierLevelIterator::NewGroupIterator() {
+  assert(group_index_ < groups_->size());
+  const TierVerticalGroup& group = (*groups_)[group_index_];
+  std::vector<InternalIterator*> children;
+  children.reserve(group.files.size());
+  for (FileMetaData* file_meta : group.files) {
+    // group 中的文件按 smallest 排序, 之后的文件都不会有上界以内的 key
+    if (KeyReachedUpperBound(file_meta->smallest.Encode())) {
+      break;
+    }
+    if (should_sample_) {
+      sample_file_read_inc(file_meta);
+    }
+    children.push_back(table_cache_->NewIterator(
+        read_options_, file_options_, icomparator_, *file_meta, range_del_agg_,
+        prefix_extractor_, nullptr /* don't need reference to table */,
+        file_read_hist_, caller_, /*arena=*/nullptr, skip_filters_, level_,
+        /*smallest_compaction_key=*/nullptr,
+        /*largest_compaction_key=*/nullptr));
+  }
+  CheckMayBeOutOfLowerBound();
+  return NewMergingIterator(
+      &icomparator_, children.data(), static_cast<int>(children.size()),
+      /*arena=*/nullptr,
+      prefix_extractor_ != nullptr && !read_options_.total_order_seek);
+}
 }  // anonymous namespace
 
 Status Version::GetTableProperties(std::shared_ptr<const TableProperties>* tp,
@@ -1808,6 +2494,16 @@ void Version::AddIteratorsForLevel(const ReadOptions& read_options,
         sample_file_read_inc(meta);
       }
     }
+  } else if (cfd_->ioptions()->compaction_style == kCompactionStyleTier) {
+    // Tier 模式下同一个 group 中的文件相互重叠, 按 group 依次归并
+    auto* mem = arena->AllocateAligned(sizeof(TierLevelIterator));
+    merge_iter_builder->AddIterator(new (mem) TierLevelIterator(
+        cfd_->table_cache(), read_options, soptions,
+        cfd_->internal_comparator(), &storage_info_.TierLevelGroups(level),
+        mutable_cf_options_.prefix_extractor.get(), should_sample_file_read(),
+        cfd_->internal_stats()->GetFileReadHist(level),
+        TableReaderCaller::kUserIterator, IsFilterSkipped(level), level,
+        range_del_agg, cfd_->GetPersistentArena(), cfd_->GetID()));
   } else if (storage_info_.LevelFilesBrief(level).num_files > 0) {
     // For levels > 0, we can use a concatenating iterator that sequentially
     // walks through the non-overlapping files in the level, opening them
@@ -1862,6 +2558,18 @@ Status Version::OverlapWithLevelIterator(const ReadOptions& read_options,
         break;
       }
     }
+  } else if (cfd_->ioptions()->compaction_style == kCompactionStyleTier &&
+             storage_info_.LevelFilesBrief(level).num_files > 0) {
+    auto mem = arena.AllocateAligned(sizeof(TierLevelIterator));
+    ScopedArenaIterator iter(new (mem) TierLevelIterator(
+        cfd_->table_cache(), read_options, file_options,
+        cfd_->internal_comparator(), &storage_info_.TierLevelGroups(level),
+        mutable_cf_options_.prefix_extractor.get(), should_sample_file_read(),
+        cfd_->internal_stats()->GetFileReadHist(level),
+        TableReaderCaller::kUserIterator, IsFilterSkipped(level), level,
+        &range_del_agg, cfd_->GetPersistentArena(), cfd_->GetID()));
+    status = OverlapWithIterator(
+        ucmp, smallest_user_key, largest_user_key, iter.get(), overlap);
   } else if (storage_info_.LevelFilesBrief(level).num_files > 0) {
     auto mem = arena.AllocateAligned(sizeof(LevelIterator));
     ScopedArenaIterator iter(new (mem) LevelIterator(
@@ -1997,7 +2705,8 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
   TierFilePicker fp(cfd_,
     storage_info_.files_, user_key, ikey, &storage_info_.level_files_brief_,
     storage_info_.num_non_empty_levels_, &storage_info_.file_indexer_,
-    user_comparator(), internal_comparator());
+    user_comparator(), internal_comparator(), db_statistics_,
+    &storage_info_.tier_level_groups_);
   f = fp.GetNextFile();
 
   while (f != nullptr) {
@@ -2014,6 +2723,7 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
         GetPerfLevel() >= PerfLevel::kEnableTimeExceptForMutex &&
         get_perf_context()->per_level_perf_context_enabled;
     StopWatchNano timer(env_, timer_enabled /* auto_start */);
+    RecordTick(db_statistics_, GET_SST_FILES_READ);
     *status = table_cache_->Get(
         read_options, *internal_comparator(), *f->file_metadata, ikey,
         &get_context, mutable_cf_options_.prefix_extractor.get(),
@@ -2103,6 +2813,20 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
 
 void Version::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
                        ReadCallback* callback, bool* is_blob) {
+  // FilePickerMultiGet expects the files of L1+ not to overlap, which the
+  // vertical groups of a tier level do. Look the keys up one at a time, which
+  // also goes through the group filters.
+  if (storage_info_.compaction_style() == kCompactionStyleTier) {
+    for (auto iter = range->begin(); iter != range->end(); ++iter) {
+      Get(read_options, *iter->lkey, iter->value, iter->timestamp, iter->s,
+          &iter->merge_context, &iter->max_covering_tombstone_seq,
+          nullptr /* value_found */, nullptr /* key_exists */,
+          nullptr /* seq */, callback, is_blob);
+      range->MarkKeyDone(iter);
+    }
+    return;
+  }
+
   PinnedIteratorsManager pinned_iters_mgr;
 
   // Pin blocks that we read to hold merge operands
@@ -2140,6 +2864,40 @@ void Version::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
     iter->get_context = &(get_ctx[get_ctx_index]);
   }
 
+  // With async_io, start reading the blocks of every file the batch may
+  // visit before resolving the keys in the first one.
+  std::unique_ptr<MultiGetFilePrefetcher> prefetcher;
+  const int prefetch_threads =
+      read_options.async_io && read_options.fill_cache &&
+              read_options.read_tier != kBlockCacheTier
+          ? env_->GetBackgroundThreads(Env::Priority::USER)
+          : 0;
+  if (prefetch_threads > 0) {
+    prefetcher.reset(new MultiGetFilePrefetcher(
+        env_, table_cache_, read_options, internal_comparator(),
+        mutable_cf_options_.prefix_extractor.get()));
+    MultiGetRange prefetch_range(*range, range->begin(), range->end());
+    FilePickerMultiGet prefetch_fp(
+        &prefetch_range, &storage_info_.level_files_brief_,
+        storage_info_.num_non_empty_levels_, &storage_info_.file_indexer_,
+        user_comparator(), internal_comparator());
+    for (FdWithKeyRange* pf = prefetch_fp.GetNextFile(); pf != nullptr;
+         pf = prefetch_fp.GetNextFile()) {
+      int level = static_cast<int>(prefetch_fp.GetHitFileLevel());
+      prefetcher->AddFile(
+          pf, prefetch_fp.CurrentFileRange(),
+          cfd_->internal_stats()->GetFileReadHist(level),
+          IsFilterSkipped(level, prefetch_fp.IsHitFileLastInLevel()),
+          prefetch_fp.GetCurrentLevel());
+    }
+    if (prefetcher->NumFiles() > 1) {
+      prefetcher->Start(prefetch_threads);
+    } else {
+      // A single file is read with one MultiRead by the lookup anyway.
+      prefetcher.reset();
+    }
+  }
+
   MultiGetRange file_picker_range(*range, range->begin(), range->end());
   FilePickerMultiGet fp(
       &file_picker_range,
@@ -2149,6 +2907,9 @@ void Version::MultiGet(const ReadOptions& read_options, MultiGetRange* range,
 
   while (f != nullptr) {
     MultiGetRange file_range = fp.CurrentFileRange();
+    if (prefetcher) {
+      prefetcher->WaitForFile(f);
+    }
     bool timer_enabled =
         GetPerfLevel() >= PerfLevel::kEnableTimeExceptForMutex &&
         get_perf_context()->per_level_perf_context_enabled;
@@ -2298,6 +3059,18 @@ void VersionStorageInfo::GenerateLevelFilesBrief() {
   }
 }
 
+void VersionStorageInfo::GenerateTierLevelGroups() {
+  if (compaction_style_ != kCompactionStyleTier) {
+    return;
+  }
+  tier_level_groups_.resize(num_non_empty_levels_);
+  for (int level = 1; level < num_non_empty_levels_; level++) {
+    BuildTierVerticalGroups(*internal_comparator_, files_[level],
+                            false /* skip_being_compacted */,
+                            &tier_level_groups_[level]);
+  }
+}
+
 void Version::PrepareApply(
     const MutableCFOptions& mutable_cf_options,
     bool update_stats) {
@@ -2307,6 +3080,7 @@ void Version::PrepareApply(
   storage_info_.UpdateFilesByCompactionPri(cfd_->ioptions()->compaction_pri);
   storage_info_.GenerateFileIndexer();
   storage_info_.GenerateLevelFilesBrief();
+  storage_info_.GenerateTierLevelGroups();
   storage_info_.GenerateLevel0NonOverlapping();
   storage_info_.GenerateBottommostFiles();
 }
@@ -2576,6 +3350,7 @@ uint32_t GetExpiredTtlFilesCount(const ImmutableCFOptions& ioptions,
 void VersionStorageInfo::ComputeCompactionScore(
     const ImmutableCFOptions& immutable_cf_options,
     const MutableCFOptions& mutable_cf_options) {
+  tier_max_group_depth_ = 0;
   for (int level = 0; level <= MaxInputLevel(); level++) {
     double score;
     if (level == 0) {
@@ -2648,6 +3423,49 @@ void VersionStorageInfo::ComputeCompactionScore(
       }
       score = static_cast<double>(level_bytes_no_compacting) /
               MaxBytesForLevel(level);
+      if (compaction_style_ == kCompactionStyleTier) {
+        // Tier 模式下一次点查在某一层中需要读的文件数由 group 的深度决定,
+        // 与该层的大小无关, 所以 score 还需要考虑 group 的最大深度和平均深度
+        std::vector<TierVerticalGroup> groups;
+        BuildTierVerticalGroups(*internal_comparator_, files_[level],
+                                true /* skip_being_compacted */, &groups);
+        int max_depth = 0;
+        uint64_t total_depth = 0;
+        for (const auto& group : groups) {
+          max_depth = std::max(max_depth, group.depth);
+          total_depth += group.depth;
+        }
+        // 正在 compaction 的文件在 compaction 完成之前仍然会被点查读取,
+        // write stall 按照包含这些文件的 group 深度判断, 只有选择
+        // compaction 时才忽略它们
+        int read_depth = max_depth;
+        for (auto* f : files_[level]) {
+          if (f->being_compacted) {
+            std::vector<TierVerticalGroup> read_groups;
+            BuildTierVerticalGroups(*internal_comparator_, files_[level],
+                                    false /* skip_being_compacted */,
+                                    &read_groups);
+            for (const auto& group : read_groups) {
+              read_depth = std::max(read_depth, group.depth);
+            }
+            break;
+          }
+        }
+        tier_max_group_depth_ = std::max(tier_max_group_depth_, read_depth);
+        if (!groups.empty()) {
+          double avg_depth = static_cast<double>(total_depth) / groups.size();
+          if (immutable_cf_options.tier_max_group_depth_trigger > 0) {
+            score = std::max(
+                score, static_cast<double>(max_depth) /
+                           immutable_cf_options.tier_max_group_depth_trigger);
+          }
+          if (immutable_cf_options.tier_avg_group_depth_trigger > 0) {
+            score = std::max(
+                score,
+                avg_depth / immutable_cf_options.tier_avg_group_depth_trigger);
+          }
+        }
+      }
     }
     compaction_level_[level] = level;
     compaction_score_[level] = score;
@@ -3107,9 +3925,11 @@ bool VersionStorageInfo::OverlapInLevel(int level,
     // empty level, no overlap
     return false;
   }
-  return SomeFileOverlapsRange(*internal_comparator_, (level > 0),
-                               level_files_brief_[level], smallest_user_key,
-                               largest_user_key);
+  // The files of a tier level overlap within their vertical groups
+  return SomeFileOverlapsRange(
+      *internal_comparator_,
+      level > 0 && compaction_style_ != kCompactionStyleTier,
+      level_files_brief_[level], smallest_user_key, largest_user_key);
 }
 
 // Store in "*inputs" all files in "level" that overlap [begin,end]
@@ -5768,6 +6588,35 @@ void VersionSet::AddLiveFiles(std::vector<FileDescriptor>* live_list) {
   }
 }
 
+uint64_t VersionSet::ReclaimPersistentFilterBlocks() {
+  PersistentArena* arena = column_family_set_->GetPersistentArena();
+  if (arena == nullptr) {
+    return 0;
+  }
+  // 一个 block 被同一个 group 中的所有文件共享, 只要还有一个存活的 Version
+  // 引用了其中的文件, 读路径就可能访问这个 block
+  std::unordered_map<uint32_t, std::unordered_set<uint64_t>> live_blocks;
+  for (auto cfd : *column_family_set_) {
+    if (!cfd->initialized()) {
+      continue;
+    }
+    auto& live = live_blocks[cfd->GetID()];
+    Version* dummy_versions = cfd->dummy_versions();
+    for (Version* v = dummy_versions->next_; v != dummy_versions;
+         v = v->next_) {
+      const auto* vstorage = v->storage_info();
+      for (int level = 0; level < vstorage->num_levels(); level++) {
+        for (const auto& f : vstorage->LevelFiles(level)) {
+          if (f->pmem_block_num != 0) {
+            live.insert(f->pmem_block_num);
+          }
+        }
+      }
+    }
+  }
+  return arena->ReclaimBlocks(live_blocks);
+}
+
 InternalIterator* VersionSet::MakeInputIterator(
     const Compaction* c, RangeDelAggregator* range_del_agg,
     const FileOptions& file_options_compactions) {
@@ -5780,18 +6629,28 @@ InternalIterator* VersionSet::MakeInputIterator(
   // (a) concurrent compactions,
   // (b) CompactionFilter::Decision::kRemoveAndSkipUntil.
   read_options.total_order_seek = true;
+  // Overlaps reading the next compaction_readahead_size window of an input
+  // file with merging the current one, if the USER pool has threads.
+  read_options.async_io = true;
 
   // Level-0 files have to be merged together.  For other levels,
   // we will make a concatenating iterator per level.
   // TODO(opt): use concatenating iterator for level-0 if there is no overlap
-  const size_t space = (c->level() == 0 ? c->input_levels(0)->num_files +
-                                              c->num_input_levels() - 1
-                                        : c->num_input_levels());
+  // In tier mode the input files of a level form an overlapping vertical
+  // group, so they are merged together like level-0 files.
+  const bool is_tiered =
+      cfd->ioptions()->compaction_style == kCompactionStyleTier;
+  size_t space = 0;
+  for (size_t which = 0; which < c->num_input_levels(); which++) {
+    space += (c->level(which) == 0 || is_tiered)
+                 ? c->input_levels(which)->num_files
+                 : 1;
+  }
   InternalIterator** list = new InternalIterator* [space];
   size_t num = 0;
   for (size_t which = 0; which < c->num_input_levels(); which++) {
     if (c->input_levels(which)->num_files != 0) {
-      if (c->level(which) == 0) {
+      if (c->level(which) == 0 || is_tiered) {
         const LevelFilesBrief* flevel = c->input_levels(which);
         for (size_t i = 0; i < flevel->num_files; i++) {
           list[num++] = cfd->table_cache()->NewIterator(
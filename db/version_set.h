@@ -39,6 +39,7 @@
 #include "db/range_del_aggregator.h"
 #include "db/read_callback.h"
 #include "db/table_cache.h"
+#include "db/tier_vertical_group.h"
 #include "db/version_builder.h"
 #include "db/version_edit.h"
 #include "db/write_controller.h"
@@ -180,6 +181,8 @@ class VersionStorageInfo {
 
   // Generate level_files_brief_ from files_
   void GenerateLevelFilesBrief();
+  // Tier 模式下将 L1+ 的文件划分为 vertical group, 供读路径的迭代器使用
+  void GenerateTierLevelGroups();
   // Sort all files for this version based on their file size and
   // record results in files_by_compaction_pri_. The largest files are listed
   // first.
@@ -255,6 +258,8 @@ class VersionStorageInfo {
 
   int num_levels() const { return num_levels_; }
 
+  CompactionStyle compaction_style() const { return compaction_style_; }
+
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   int num_non_empty_levels() const {
     assert(finalized_);
@@ -269,6 +274,11 @@ class VersionStorageInfo {
 
   void set_l0_delay_trigger_count(int v) { l0_delay_trigger_count_ = v; }
 
+  // Tier 模式下, 除最后一层以外 L1+ 中 vertical group 的最大深度,
+  // 包括正在 compaction 的文件. 由 ComputeCompactionScore() 计算,
+  // 用于触发 write stall
+  int tier_max_group_depth() const { return tier_max_group_depth_; }
+
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   int NumLevelFiles(int level) const {
     assert(finalized_);
@@ -292,6 +302,12 @@ class VersionStorageInfo {
     return level_files_brief_[level];
   }
 
+  // Tier 模式下 level 中的 vertical group, 按 key range 从小到大排列
+  const std::vector<TierVerticalGroup>& TierLevelGroups(int level) const {
+    assert(level < static_cast<int>(tier_level_groups_.size()));
+    return tier_level_groups_[level];
+  }
+
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   const std::vector<int>& FilesByCompactionPri(int level) const {
     assert(finalized_);
@@ -452,6 +468,8 @@ class VersionStorageInfo {
 
   // A short brief metadata of files per level
   autovector<ROCKSDB_NAMESPACE::LevelFilesBrief> level_files_brief_;
+  // Tier 模式下每一层的 vertical group (包含正在 compaction 的文件)
+  std::vector<std::vector<TierVerticalGroup>> tier_level_groups_;
   FileIndexer file_indexer_;
   Arena arena_;  // Used to allocate space for file_levels_
 
@@ -531,6 +549,8 @@ class VersionStorageInfo {
   std::vector<int> compaction_level_;
   int l0_delay_trigger_count_ = 0;  // Count used to trigger slow down and stop
                                     // for number of L0 files.
+  int tier_max_group_depth_ = 0;    // Count used to trigger slow down and stop
+                                    // for depth of tier vertical groups.
 
   // the following are the sampled temporary stats.
   // the current accumulated size of sampled files.
@@ -1035,6 +1055,11 @@ class VersionSet {
   // Add all files listed in any live version to *live.
   void AddLiveFiles(std::vector<FileDescriptor>* live_list);
 
+  // Tier 模式: 释放 filter pool 中不再被任何存活 Version 引用的
+  // group filter block. 返回释放的 block 数.
+  // REQUIRES: DB mutex held
+  uint64_t ReclaimPersistentFilterBlocks();
+
   // Return the approximate size of data to be scanned for range [start, end)
   // in levels [start_level, end_level). If end_level == -1 it will search
   // through all non-empty levels
@@ -0,0 +1,237 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/wal_compression.h"
+
+#include <string.h>
+
+#include "util/compression.h"
+
+// ZSTD_compressStream2() and ZSTD_e_flush are stable since zstd 1.4.0
+#if defined(ZSTD) && ZSTD_VERSION_NUMBER >= 10400
+#define WAL_COMPRESSION_ZSTD
+#endif
+#if defined(LZ4) && LZ4_VERSION_NUMBER >= 10700  // r129+
+#define WAL_COMPRESSION_LZ4
+#endif
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+#ifdef WAL_COMPRESSION_ZSTD
+// The whole log file is a single zstd frame. Every record is flushed as one
+// or more blocks that can be decoded as soon as they are read, and the
+// window of the frame spans the earlier records.
+class ZstdWalCompressor : public WalCompressor {
+ public:
+  ZstdWalCompressor() : ctx_(ZSTD_createCCtx()) {}
+  ~ZstdWalCompressor() override { ZSTD_freeCCtx(ctx_); }
+
+  bool Compress(const Slice& input, std::string* output) override {
+    if (ctx_ == nullptr) {
+      return false;
+    }
+    const size_t start = output->size();
+    const size_t chunk = ZSTD_CStreamOutSize();
+    ZSTD_inBuffer in = {input.data(), input.size(), 0};
+    size_t pos = start;
+    size_t remaining;
+    do {
+      output->resize(pos + chunk);
+      ZSTD_outBuffer out = {&(*output)[pos], chunk, 0};
+      remaining = ZSTD_compressStream2(ctx_, &out, &in, ZSTD_e_flush);
+      if (ZSTD_isError(remaining)) {
+        output->resize(start);
+        return false;
+      }
+      pos += out.pos;
+    } while (remaining != 0);
+    output->resize(pos);
+    return true;
+  }
+
+ private:
+  ZSTD_CCtx* ctx_;
+};
+
+class ZstdWalUncompressor : public WalUncompressor {
+ public:
+  ZstdWalUncompressor() : ctx_(ZSTD_createDCtx()), failed_(false) {}
+  ~ZstdWalUncompressor() override { ZSTD_freeDCtx(ctx_); }
+
+  bool Uncompress(const Slice& input, size_t uncompressed_size,
+                  std::string* output) override {
+    if (ctx_ == nullptr || failed_) {
+      return false;
+    }
+    output->resize(uncompressed_size);
+    ZSTD_inBuffer in = {input.data(), input.size(), 0};
+    ZSTD_outBuffer out = {&(*output)[0], uncompressed_size, 0};
+    while (in.pos < in.size) {
+      const size_t in_pos = in.pos;
+      const size_t out_pos = out.pos;
+      size_t ret = ZSTD_decompressStream(ctx_, &out, &in);
+      if (ZSTD_isError(ret) || (in.pos == in_pos && out.pos == out_pos)) {
+        failed_ = true;
+        return false;
+      }
+    }
+    if (out.pos != uncompressed_size) {
+      failed_ = true;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  ZSTD_DCtx* ctx_;
+  bool failed_;
+};
+#endif  // WAL_COMPRESSION_ZSTD
+
+#ifdef WAL_COMPRESSION_LZ4
+// LZ4 refers back at most 64KB
+const size_t kLz4HistorySize = 64 << 10;
+
+// Records are compressed as independent LZ4 blocks that use the last 64KB of
+// the earlier records as their dictionary
+class Lz4WalCompressor : public WalCompressor {
+ public:
+  Lz4WalCompressor()
+      : stream_(LZ4_createStream()),
+        buffer_(new char[2 * kLz4HistorySize]),
+        buffer_size_(2 * kLz4HistorySize),
+        dict_size_(0) {}
+  ~Lz4WalCompressor() override { LZ4_freeStream(stream_); }
+
+  bool Compress(const Slice& input, std::string* output) override {
+    if (stream_ == nullptr || input.size() > LZ4_MAX_INPUT_SIZE) {
+      return false;
+    }
+    // The input is copied right behind the history, so that LZ4 sees the
+    // history and the record as one contiguous stream
+    if (dict_size_ + input.size() > buffer_size_) {
+      size_t new_size = dict_size_ + input.size();
+      std::unique_ptr<char[]> new_buffer(new char[new_size]);
+      memcpy(new_buffer.get(), buffer_.get(), dict_size_);
+      buffer_ = std::move(new_buffer);
+      buffer_size_ = new_size;
+      LZ4_loadDict(stream_, buffer_.get(), static_cast<int>(dict_size_));
+    }
+    char* src = buffer_.get() + dict_size_;
+    memcpy(src, input.data(), input.size());
+
+    const int bound = LZ4_compressBound(static_cast<int>(input.size()));
+    const size_t start = output->size();
+    output->resize(start + bound);
+    int n = LZ4_compress_fast_continue(stream_, src, &(*output)[start],
+                                       static_cast<int>(input.size()), bound,
+                                       1 /* acceleration */);
+    if (n <= 0) {
+      output->resize(start);
+      return false;
+    }
+    output->resize(start + n);
+    dict_size_ = static_cast<size_t>(LZ4_saveDict(
+        stream_, buffer_.get(), static_cast<int>(kLz4HistorySize)));
+    return true;
+  }
+
+ private:
+  LZ4_stream_t* stream_;
+  std::unique_ptr<char[]> buffer_;
+  size_t buffer_size_;
+  // The history is kept at the start of buffer_
+  size_t dict_size_;
+};
+
+class Lz4WalUncompressor : public WalUncompressor {
+ public:
+  Lz4WalUncompressor() : failed_(false) {}
+
+  bool Uncompress(const Slice& input, size_t uncompressed_size,
+                  std::string* output) override {
+    if (failed_ || input.size() > static_cast<size_t>(LZ4_MAX_INPUT_SIZE) ||
+        uncompressed_size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+      failed_ = true;
+      return false;
+    }
+    output->resize(uncompressed_size);
+    int n = LZ4_decompress_safe_usingDict(
+        input.data(), &(*output)[0], static_cast<int>(input.size()),
+        static_cast<int>(uncompressed_size), history_.data(),
+        static_cast<int>(history_.size()));
+    if (n < 0 || static_cast<size_t>(n) != uncompressed_size) {
+      failed_ = true;
+      return false;
+    }
+    if (uncompressed_size >= kLz4HistorySize) {
+      history_.assign(output->data() + uncompressed_size - kLz4HistorySize,
+                      kLz4HistorySize);
+    } else {
+      history_.append(*output);
+      if (history_.size() > kLz4HistorySize) {
+        history_.erase(0, history_.size() - kLz4HistorySize);
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::string history_;
+  bool failed_;
+};
+#endif  // WAL_COMPRESSION_LZ4
+
+}  // namespace
+
+bool WalCompressionTypeSupported(CompressionType type) {
+  switch (type) {
+#ifdef WAL_COMPRESSION_ZSTD
+    case kZSTD:
+      return true;
+#endif
+#ifdef WAL_COMPRESSION_LZ4
+    case kLZ4Compression:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+std::unique_ptr<WalCompressor> WalCompressor::Create(CompressionType type) {
+  switch (type) {
+#ifdef WAL_COMPRESSION_ZSTD
+    case kZSTD:
+      return std::unique_ptr<WalCompressor>(new ZstdWalCompressor());
+#endif
+#ifdef WAL_COMPRESSION_LZ4
+    case kLZ4Compression:
+      return std::unique_ptr<WalCompressor>(new Lz4WalCompressor());
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+std::unique_ptr<WalUncompressor> WalUncompressor::Create(
+    CompressionType type) {
+  switch (type) {
+#ifdef WAL_COMPRESSION_ZSTD
+    case kZSTD:
+      return std::unique_ptr<WalUncompressor>(new ZstdWalUncompressor());
+#endif
+#ifdef WAL_COMPRESSION_LZ4
+    case kLZ4Compression:
+      return std::unique_ptr<WalUncompressor>(new Lz4WalUncompressor());
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
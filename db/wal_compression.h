@@ -0,0 +1,58 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Streaming compression of WAL records. A log file is compressed as one
+// stream: every record may refer back to the data of the earlier records of
+// the same file, so the history acts as a dictionary that grows with the
+// file. This matters for WAL records, which are usually small and repeat
+// the same keys and value structure.
+//
+// As a consequence a record can only be uncompressed after all the earlier
+// records of its file, in order, by the same WalUncompressor.
+
+// Returns true if the WAL can be compressed with `type` in this build.
+// Only kZSTD (zstd 1.4.0+) and kLZ4Compression are supported.
+bool WalCompressionTypeSupported(CompressionType type);
+
+class WalCompressor {
+ public:
+  // Returns nullptr if `type` is not supported
+  static std::unique_ptr<WalCompressor> Create(CompressionType type);
+
+  virtual ~WalCompressor() {}
+
+  // Compresses `input` as the next record of the stream and appends the
+  // result to *output. The uncompressed size is not recorded.
+  virtual bool Compress(const Slice& input, std::string* output) = 0;
+};
+
+class WalUncompressor {
+ public:
+  // Returns nullptr if `type` is not supported
+  static std::unique_ptr<WalUncompressor> Create(CompressionType type);
+
+  virtual ~WalUncompressor() {}
+
+  // Uncompresses the next record of the stream, which is known to be
+  // `uncompressed_size` bytes long, into *output. Returns false if `input`
+  // is not the next record of the stream; the stream can't be used after
+  // that.
+  virtual bool Uncompress(const Slice& input, size_t uncompressed_size,
+                          std::string* output) = 0;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
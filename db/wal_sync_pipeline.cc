@@ -0,0 +1,75 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/wal_sync_pipeline.h"
+
+#include <cassert>
+
+#include "test_util/sync_point.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+WalSyncPipeline::WalSyncPipeline(std::function<Status()> sync_wal)
+    : sync_wal_(std::move(sync_wal)) {
+  thread_ = port::Thread(&WalSyncPipeline::BGThread, this);
+}
+
+WalSyncPipeline::~WalSyncPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    closing_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  // The served callers may still have to reacquire mu_
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [&] { return waiters_ == 0; });
+}
+
+Status WalSyncPipeline::Sync() {
+  std::unique_lock<std::mutex> lock(mu_);
+  const uint64_t request = ++requested_;
+  waiters_++;
+  TEST_SYNC_POINT("WalSyncPipeline::Sync:Requested");
+  cv_.notify_all();
+  cv_.wait(lock, [&] { return completed_ >= request; });
+  Status s = status_;
+  if (--waiters_ == 0) {
+    cv_.notify_all();
+  }
+  return s;
+}
+
+void WalSyncPipeline::ClearError() {
+  std::lock_guard<std::mutex> lock(mu_);
+  status_ = Status::OK();
+}
+
+void WalSyncPipeline::BGThread() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [&] { return closing_ || requested_ > completed_; });
+    if (requested_ == completed_) {
+      assert(closing_);
+      break;
+    }
+    // Everything the requests up to here have appended is covered by a sync
+    // that starts now
+    const uint64_t target = requested_;
+    Status s;
+    if (status_.ok()) {
+      lock.unlock();
+      s = sync_wal_();
+      lock.lock();
+    }
+    if (!s.ok() && status_.ok()) {
+      status_ = s;
+    }
+    completed_ = target;
+    cv_.notify_all();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
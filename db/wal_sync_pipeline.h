@@ -0,0 +1,69 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "port/port.h"
+#include "rocksdb/status.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Syncs the WAL on a dedicated thread on behalf of sync writes. The write
+// group leader appends the group to the WAL and hands over to the next group
+// right away; the writers of the group then wait here until a sync that
+// started after their append has completed. Requests that arrive while a
+// sync is in flight are served together by the next one, so the fsync of
+// one group overlaps with the append of the following groups.
+//
+// The group is inserted into the memtable and its sequence numbers are
+// published before the sync, so readers can see data that a crash during
+// the sync still loses; only the sync writes themselves wait for it.
+class WalSyncPipeline {
+ public:
+  // sync_wal syncs all the WAL data appended before it is called. It is only
+  // called from the pipeline thread.
+  explicit WalSyncPipeline(std::function<Status()> sync_wal);
+
+  // Serves the pending requests and waits for their callers to return, then
+  // stops the thread
+  ~WalSyncPipeline();
+
+  WalSyncPipeline(const WalSyncPipeline&) = delete;
+  WalSyncPipeline& operator=(const WalSyncPipeline&) = delete;
+
+  // Blocks until the WAL data appended before the call is synced. Once a
+  // sync has failed, all requests fail with its status until ClearError():
+  // a later sync may succeed even though the data of the failed one was
+  // lost.
+  Status Sync();
+
+  // Lets the requests sync again after a failed sync. Called once the DB has
+  // recovered from the error (DB::Resume), which flushes the memtables.
+  void ClearError();
+
+ private:
+  void BGThread();
+
+  std::function<Status()> sync_wal_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  // Requests are numbered in arrival order; a sync started after request N
+  // was made completes all the requests up to N.
+  uint64_t requested_ = 0;
+  uint64_t completed_ = 0;
+  // Callers currently inside Sync()
+  int waiters_ = 0;
+  Status status_;
+  bool closing_ = false;
+  port::Thread thread_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,145 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/wal_sync_pipeline.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "port/port.h"
+#include "test_util/sync_point.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class WalSyncPipelineTest : public testing::Test {
+ public:
+  WalSyncPipelineTest() {
+    SyncPoint::GetInstance()->SetCallBack(
+        "WalSyncPipeline::Sync:Requested",
+        [this](void*) { requests_.fetch_add(1); });
+    SyncPoint::GetInstance()->EnableProcessing();
+  }
+
+  ~WalSyncPipelineTest() override {
+    SyncPoint::GetInstance()->DisableProcessing();
+    SyncPoint::GetInstance()->ClearAllCallBacks();
+  }
+
+  // The sync function of the pipeline. Blocks while the gate is closed.
+  Status SyncWal() {
+    std::unique_lock<std::mutex> lock(mu_);
+    syncs_++;
+    cv_.notify_all();
+    cv_.wait(lock, [this] { return gate_open_; });
+    if (fail_next_) {
+      fail_next_ = false;
+      return Status::IOError("injected sync failure");
+    }
+    return Status::OK();
+  }
+
+  void SetGate(bool open) {
+    std::lock_guard<std::mutex> lock(mu_);
+    gate_open_ = open;
+    cv_.notify_all();
+  }
+
+  void WaitForSyncs(int syncs) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&] { return syncs_ >= syncs; });
+  }
+
+  void WaitForRequests(int requests) {
+    while (requests_.load() < requests) {
+      std::this_thread::yield();
+    }
+  }
+
+  int syncs() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return syncs_;
+  }
+
+  std::unique_ptr<WalSyncPipeline> NewPipeline() {
+    return std::unique_ptr<WalSyncPipeline>(
+        new WalSyncPipeline([this]() { return SyncWal(); }));
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool gate_open_ = true;
+  bool fail_next_ = false;
+  int syncs_ = 0;
+  std::atomic<int> requests_{0};
+};
+
+// The tests that wait for requests to queue up count them with a sync point
+#ifndef NDEBUG
+TEST_F(WalSyncPipelineTest, RequestsDuringSyncShareTheNextOne) {
+  std::unique_ptr<WalSyncPipeline> pipeline = NewPipeline();
+  SetGate(false);
+  port::Thread first([&]() { ASSERT_OK(pipeline->Sync()); });
+  WaitForSyncs(1);
+
+  // These arrive while the first sync is in flight
+  const int kWaiters = 8;
+  std::vector<port::Thread> waiters;
+  for (int i = 0; i < kWaiters; i++) {
+    waiters.emplace_back([&]() { ASSERT_OK(pipeline->Sync()); });
+  }
+  WaitForRequests(1 + kWaiters);
+  SetGate(true);
+  first.join();
+  for (auto& waiter : waiters) {
+    waiter.join();
+  }
+  ASSERT_EQ(2, syncs());
+}
+
+TEST_F(WalSyncPipelineTest, DestructorServesPendingRequests) {
+  std::unique_ptr<WalSyncPipeline> pipeline = NewPipeline();
+  SetGate(false);
+  port::Thread first([&]() { ASSERT_OK(pipeline->Sync()); });
+  WaitForSyncs(1);
+  port::Thread second([&]() { ASSERT_OK(pipeline->Sync()); });
+  WaitForRequests(2);
+
+  port::Thread closer([&]() { pipeline.reset(); });
+  SetGate(true);
+  closer.join();
+  first.join();
+  second.join();
+  ASSERT_EQ(2, syncs());
+}
+#endif  // !NDEBUG
+
+TEST_F(WalSyncPipelineTest, FailureIsStickyUntilCleared) {
+  std::unique_ptr<WalSyncPipeline> pipeline = NewPipeline();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    fail_next_ = true;
+  }
+  ASSERT_TRUE(pipeline->Sync().IsIOError());
+  // The data of the failed sync may be lost, so a later successful sync
+  // must not be reported
+  ASSERT_TRUE(pipeline->Sync().IsIOError());
+  ASSERT_EQ(1, syncs());
+
+  pipeline->ClearError();
+  ASSERT_OK(pipeline->Sync());
+  ASSERT_EQ(2, syncs());
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
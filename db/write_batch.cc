@@ -2080,6 +2080,25 @@ Status WriteBatchInternal::Append(WriteBatch* dst, const WriteBatch* src,
   return Status::OK();
 }
 
+Slice WriteBatchInternal::WalEntries(const WriteBatch* src, uint32_t* count) {
+  const SavePoint& batch_end = src->GetWalTerminationPoint();
+  assert(src->rep_.size() >= WriteBatchInternal::kHeader);
+  if (!batch_end.is_cleared()) {
+    *count = batch_end.count;
+    return Slice(src->rep_.data() + WriteBatchInternal::kHeader,
+                 batch_end.size - WriteBatchInternal::kHeader);
+  }
+  *count = Count(src);
+  return Slice(src->rep_.data() + WriteBatchInternal::kHeader,
+               src->rep_.size() - WriteBatchInternal::kHeader);
+}
+
+void WriteBatchInternal::EncodeHeader(char* buf, SequenceNumber seq,
+                                      uint32_t count) {
+  EncodeFixed64(buf, seq);
+  EncodeFixed32(buf + 8, count);
+}
+
 size_t WriteBatchInternal::AppendedByteSize(size_t leftByteSize,
                                             size_t rightByteSize) {
   if (leftByteSize == 0 || rightByteSize == 0) {
@@ -0,0 +1,34 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/write_batch_cache.h"
+
+#include <cassert>
+
+namespace ROCKSDB_NAMESPACE {
+
+WriteBatch* WriteBatchCache::Borrow(size_t* idx) {
+  auto p = per_core_batches_.AccessElementAndIndex();
+  CachedBatch* cached = p.first;
+  if (cached->in_use.load(std::memory_order_relaxed) ||
+      cached->in_use.exchange(true, std::memory_order_acquire)) {
+    return nullptr;
+  }
+  *idx = p.second;
+  return &cached->batch;
+}
+
+void WriteBatchCache::Return(size_t idx) {
+  CachedBatch* cached = per_core_batches_.AccessAtCore(idx);
+  assert(cached->in_use.load(std::memory_order_relaxed));
+  if (cached->batch.Data().capacity() > kMaxCachedBatchSize) {
+    cached->batch = WriteBatch();
+  } else {
+    cached->batch.Clear();
+  }
+  cached->in_use.store(false, std::memory_order_release);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,52 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <atomic>
+
+#include "port/port.h"
+#include "rocksdb/write_batch.h"
+#include "util/core_local.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Caches the batches of the single-key write APIs (Put, Delete, SingleDelete
+// and Merge) on a per core basis, so that a write reuses the buffer of an
+// earlier one instead of allocating and growing a new batch. A borrowed batch
+// is marked in use for the time of the write. If another write on the same
+// core is already using it, Borrow() returns nullptr and the caller uses a
+// batch of its own.
+class WriteBatchCache {
+ public:
+  WriteBatchCache() {}
+  WriteBatchCache(const WriteBatchCache&) = delete;
+  WriteBatchCache& operator=(const WriteBatchCache&) = delete;
+
+  // Returns an empty batch and sets *idx to the index to return it with, or
+  // returns nullptr if the batch of the current core is in use.
+  WriteBatch* Borrow(size_t* idx);
+
+  // Clears the batch borrowed with idx and puts it back into circulation.
+  void Return(size_t idx);
+
+ private:
+  // Batches whose buffer grew beyond this size are released on return rather
+  // than kept around by an occasional large write.
+  static const size_t kMaxCachedBatchSize = 64 << 10;
+
+  struct CachedBatch {
+    WriteBatch batch;
+    std::atomic<bool> in_use{false};
+
+    char padding[(CACHE_LINE_SIZE -
+                  (sizeof(WriteBatch) + sizeof(std::atomic<bool>)) %
+                      CACHE_LINE_SIZE)];  // unused padding field
+  };
+
+  CoreLocalArray<CachedBatch> per_core_batches_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
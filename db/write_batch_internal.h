@@ -194,6 +194,14 @@ class WriteBatchInternal {
   static Status Append(WriteBatch* dst, const WriteBatch* src,
                        const bool WAL_only = false);
 
+  // Returns the entries of src that Append(dst, src, /*WAL_only*/ true) would
+  // append, i.e. the contents without the header, and their count.
+  static Slice WalEntries(const WriteBatch* src, uint32_t* count);
+
+  // Encodes into buf (kHeader bytes) the header of a batch with the given
+  // sequence number and count.
+  static void EncodeHeader(char* buf, SequenceNumber seq, uint32_t count);
+
   // Returns the byte size of appending a WriteBatch with ByteSize
   // leftByteSize and a WriteBatch with ByteSize rightByteSize
   static size_t AppendedByteSize(size_t leftByteSize, size_t rightByteSize);
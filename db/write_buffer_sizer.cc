@@ -0,0 +1,146 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/write_buffer_sizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "db/column_family.h"
+#include "db/memtable.h"
+#include "db/version_set.h"
+#include "rocksdb/env.h"
+#include "rocksdb/write_buffer_manager.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+// Bounds of the write_buffer_size given to a column family, relative to its
+// configured write_buffer_size
+const double kMinWriteBufferSizeRatio = 0.25;
+const double kMaxWriteBufferSizeRatio = 4.0;
+
+// Relative cost of a flush of cfd: one, plus one for every
+// level0_file_num_compaction_trigger L0 files waiting for compaction
+double FlushCost(ColumnFamilyData* cfd) {
+  const int l0_files = cfd->current()->storage_info()->NumLevelFiles(0);
+  const int trigger = std::max(
+      cfd->GetLatestMutableCFOptions()->level0_file_num_compaction_trigger, 1);
+  return 1.0 + static_cast<double>(l0_files) / trigger;
+}
+}  // namespace
+
+WriteBufferSizer::WriteBufferSizer(Env* env,
+                                   WriteBufferManager* write_buffer_manager)
+    : env_(env),
+      write_buffer_manager_(write_buffer_manager),
+      start_micros_(env->NowMicros()) {}
+
+double WriteBufferSizer::EstimateWriteRate(ColumnFamilyData* cfd,
+                                           uint64_t now) {
+  auto it = write_rates_.find(cfd->GetID());
+  if (it == write_rates_.end()) {
+    it = write_rates_.emplace(cfd->GetID(), WriteRate()).first;
+    it->second.memtable_start_micros = start_micros_;
+  }
+  const WriteRate& rate = it->second;
+  const double bytes =
+      rate.bytes + static_cast<double>(cfd->mem()->get_data_size());
+  double micros = rate.micros;
+  if (now > rate.memtable_start_micros) {
+    micros += static_cast<double>(now - rate.memtable_start_micros);
+  }
+  return micros > 0 ? bytes * 1e6 / micros : 0;
+}
+
+size_t WriteBufferSizer::OnSwitchMemtable(ColumnFamilyData* cfd,
+                                          ColumnFamilySet* column_family_set) {
+  const uint64_t now = env_->NowMicros();
+  const size_t configured =
+      cfd->GetLatestMutableCFOptions()->write_buffer_size;
+
+  double total_weight = 0;
+  double weight = 0;
+  size_t total_configured = 0;
+  size_t num_column_families = 0;
+  for (auto c : *column_family_set) {
+    if (c->IsDropped()) {
+      continue;
+    }
+    const double w = std::sqrt(FlushCost(c) * EstimateWriteRate(c, now));
+    total_weight += w;
+    if (c == cfd) {
+      weight = w;
+    }
+    total_configured += c->GetLatestMutableCFOptions()->write_buffer_size;
+    num_column_families++;
+  }
+
+  // The memtable being switched becomes the most recent observation of the
+  // write rate of cfd
+  WriteRate& rate = write_rates_[cfd->GetID()];
+  rate.bytes =
+      rate.bytes / 2 + static_cast<double>(cfd->mem()->get_data_size());
+  if (now > rate.memtable_start_micros) {
+    rate.micros = rate.micros / 2 +
+                  static_cast<double>(now - rate.memtable_start_micros);
+  }
+  rate.memtable_start_micros = now;
+
+  // Forget the column families dropped since the last switch
+  if (write_rates_.size() > num_column_families) {
+    for (auto it = write_rates_.begin(); it != write_rates_.end();) {
+      ColumnFamilyData* c = column_family_set->GetColumnFamily(it->first);
+      if (c == nullptr || c->IsDropped()) {
+        it = write_rates_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (total_weight <= 0) {
+    return configured;
+  }
+  // Half of the write buffer manager's budget is left for the memtables
+  // being flushed
+  const double budget =
+      write_buffer_manager_ != nullptr && write_buffer_manager_->enabled()
+          ? static_cast<double>(write_buffer_manager_->buffer_size()) / 2
+          : static_cast<double>(total_configured);
+  const double size = std::min(
+      std::max(budget * weight / total_weight,
+               static_cast<double>(configured) * kMinWriteBufferSizeRatio),
+      static_cast<double>(configured) * kMaxWriteBufferSizeRatio);
+  return static_cast<size_t>(size);
+}
+
+ColumnFamilyData* WriteBufferSizer::PickColumnFamilyToFlush(
+    ColumnFamilySet* column_family_set) {
+  const uint64_t now = env_->NowMicros();
+  ColumnFamilyData* picked = nullptr;
+  double picked_seconds = 0;
+  for (auto cfd : *column_family_set) {
+    if (cfd->IsDropped() || cfd->mem()->IsEmpty()) {
+      continue;
+    }
+    // Seconds the column family takes to write as much as its mutable
+    // memtable holds
+    const double rate = EstimateWriteRate(cfd, now);
+    const double seconds =
+        rate > 0
+            ? static_cast<double>(cfd->mem()->ApproximateMemoryUsageFast()) /
+                  rate
+            : std::numeric_limits<double>::max();
+    if (picked == nullptr || seconds > picked_seconds) {
+      picked = cfd;
+      picked_seconds = seconds;
+    }
+  }
+  return picked;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,68 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include "rocksdb/rocksdb_namespace.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class ColumnFamilyData;
+class ColumnFamilySet;
+class Env;
+class WriteBufferManager;
+
+// WriteBufferSizer implements DBOptions::adaptive_write_buffer_size. It
+// keeps track of the rate at which every column family fills its memtables
+// and distributes the memtable budget of the DB among them.
+//
+// Memtables of size s_i filled at rate r_i are flushed r_i / s_i times per
+// second. Weighting every flush of column family i by c_i, the cost of the
+// L0 files it adds, the total cost sum(c_i * r_i / s_i) for a fixed budget
+// sum(s_i) is the lowest with s_i proportional to sqrt(c_i * r_i). The cost
+// of a flush grows with the number of L0 files already waiting for
+// compaction.
+//
+// All of the methods need to be called while holding DB mutex.
+class WriteBufferSizer {
+ public:
+  WriteBufferSizer(Env* env, WriteBufferManager* write_buffer_manager);
+
+  // Records the memtable of cfd being switched and returns the
+  // write_buffer_size of the memtable replacing it.
+  size_t OnSwitchMemtable(ColumnFamilyData* cfd,
+                          ColumnFamilySet* column_family_set);
+
+  // Returns the column family whose mutable memtable holds the most memory
+  // relative to its write rate, i.e. the coldest data, or nullptr if all of
+  // the mutable memtables are empty.
+  ColumnFamilyData* PickColumnFamilyToFlush(ColumnFamilySet* column_family_set);
+
+ private:
+  struct WriteRate {
+    // Start of the life of the current memtable
+    uint64_t memtable_start_micros = 0;
+    // Bytes written to and lifetime of the earlier memtables, halved at
+    // every switch so that the recent memtables count the most
+    double bytes = 0;
+    double micros = 0;
+  };
+
+  // Bytes per second written to cfd, from its earlier memtables and the
+  // current one
+  double EstimateWriteRate(ColumnFamilyData* cfd, uint64_t now);
+
+  Env* env_;
+  WriteBufferManager* write_buffer_manager_;
+  uint64_t start_micros_;
+  std::unordered_map<uint32_t, WriteRate> write_rates_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -721,7 +721,11 @@ void WriteThread::ExitAsBatchGroupLeader(WriteGroup& write_group,
     // leader now
 
     while (last_writer != leader) {
-      last_writer->status = status;
+      // A follower whose own memtable insert failed keeps its status when
+      // the rest of the group succeeded
+      if (!status.ok()) {
+        last_writer->status = status;
+      }
       // we need to read link_older before calling SetState, because as soon
       // as it is marked committed the other thread's Await may return and
       // deallocate the Writer.
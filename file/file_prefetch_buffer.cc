@@ -17,10 +17,18 @@
 #include "monitoring/iostats_context_imp.h"
 #include "port/port.h"
 #include "test_util/sync_point.h"
+#include "util/mutexlock.h"
 #include "util/random.h"
 #include "util/rate_limiter.h"
 
 namespace ROCKSDB_NAMESPACE {
+FilePrefetchBuffer::~FilePrefetchBuffer() {
+  if (async_read_ != nullptr) {
+    bool waited;
+    FinishAsyncRead(&waited);
+  }
+}
+
 Status FilePrefetchBuffer::Prefetch(RandomAccessFileReader* reader,
                                     uint64_t offset, size_t n,
                                     bool for_compaction) {
@@ -113,6 +121,10 @@ bool FilePrefetchBuffer::TryReadFromCache(uint64_t offset, size_t n,
     if (readahead_size_ > 0) {
       assert(file_reader_ != nullptr);
       assert(max_readahead_size_ >= readahead_size_);
+      if (async_read_ != nullptr &&
+          TryReadFromAsyncRead(offset, n, result, for_compaction)) {
+        return true;
+      }
       Status s;
       if (for_compaction) {
         s = Prefetch(file_reader_, offset, std::max(n, readahead_size_),
@@ -124,6 +136,9 @@ bool FilePrefetchBuffer::TryReadFromCache(uint64_t offset, size_t n,
         return false;
       }
       readahead_size_ = std::min(max_readahead_size_, readahead_size_ * 2);
+      if (async_read_ != nullptr) {
+        ScheduleAsyncRead(for_compaction);
+      }
     } else {
       return false;
     }
@@ -133,4 +148,139 @@ bool FilePrefetchBuffer::TryReadFromCache(uint64_t offset, size_t n,
   *result = Slice(buffer_.BufferStart() + offset_in_buffer, n);
   return true;
 }
+
+void FilePrefetchBuffer::AsyncReadWork(void* arg) {
+  std::unique_ptr<std::shared_ptr<AsyncRead>> holder(
+      reinterpret_cast<std::shared_ptr<AsyncRead>*>(arg));
+  AsyncRead* async_read = holder->get();
+  {
+    MutexLock l(&async_read->mu);
+    // Dropped, or already claimed by the job of an earlier read that was
+    // dropped before it got to run.
+    if (async_read->state != AsyncRead::kPending) {
+      return;
+    }
+    async_read->state = AsyncRead::kRunning;
+  }
+  TEST_SYNC_POINT("FilePrefetchBuffer::AsyncReadWork:Start");
+
+  Slice result;
+  Status s = async_read->reader->Read(
+      async_read->offset, async_read->len, &result,
+      async_read->buffer.BufferStart(), nullptr, async_read->for_compaction);
+
+  MutexLock l(&async_read->mu);
+  async_read->status = s;
+  if (s.ok()) {
+    assert(result.data() == async_read->buffer.BufferStart());
+    async_read->buffer.Size(result.size());
+  }
+  async_read->state = AsyncRead::kDone;
+  async_read->cv.SignalAll();
+}
+
+void FilePrefetchBuffer::ScheduleAsyncRead(bool for_compaction) {
+  bool waited;
+  FinishAsyncRead(&waited);
+
+  AsyncRead* async_read = async_read_.get();
+  size_t alignment = file_reader_->file()->GetRequiredBufferAlignment();
+  async_read->reader = file_reader_;
+  async_read->offset = Rounddown(
+      static_cast<size_t>(buffer_offset_ + buffer_.CurrentSize()), alignment);
+  async_read->len = Roundup(readahead_size_, alignment);
+  async_read->for_compaction = for_compaction;
+  if (async_read->buffer.Capacity() < async_read->len) {
+    async_read->buffer.Alignment(alignment);
+    async_read->buffer.AllocateNewBuffer(async_read->len);
+  }
+  async_read->buffer.Size(0);
+  async_read->status = Status::OK();
+  {
+    MutexLock l(&async_read->mu);
+    async_read->state = AsyncRead::kPending;
+  }
+  async_env_->Schedule(&FilePrefetchBuffer::AsyncReadWork,
+                       new std::shared_ptr<AsyncRead>(async_read_),
+                       Env::Priority::USER);
+}
+
+bool FilePrefetchBuffer::FinishAsyncRead(bool* waited) {
+  AsyncRead* async_read = async_read_.get();
+  *waited = false;
+  MutexLock l(&async_read->mu);
+  if (async_read->state == AsyncRead::kPending) {
+    // Cheaper to read it on this thread when it is needed than to wait for
+    // a USER thread to pick it up.
+    async_read->state = AsyncRead::kIdle;
+    return false;
+  }
+  while (async_read->state == AsyncRead::kRunning) {
+    *waited = true;
+    async_read->cv.Wait();
+  }
+  return async_read->state == AsyncRead::kDone;
+}
+
+bool FilePrefetchBuffer::TryReadFromAsyncRead(uint64_t offset, size_t n,
+                                              Slice* result,
+                                              bool for_compaction) {
+  AsyncRead* async_read = async_read_.get();
+  // offset and len are only written by this thread, so they can be read
+  // without the lock.
+  const uint64_t buffer_end = buffer_offset_ + buffer_.CurrentSize();
+  const uint64_t async_end = async_read->offset + async_read->len;
+  const bool in_window = offset >= async_read->offset && offset + n <= async_end;
+  const bool straddles = offset >= buffer_offset_ && offset < buffer_end &&
+                         async_read->offset <= buffer_end &&
+                         offset + n <= async_end;
+  if (!in_window && !straddles) {
+    // Not a sequential read. The window is dropped when the next one is
+    // scheduled.
+    return false;
+  }
+
+  TEST_SYNC_POINT("FilePrefetchBuffer::TryReadFromAsyncRead:Wait");
+  bool waited;
+  if (!FinishAsyncRead(&waited)) {
+    return false;
+  }
+  TEST_SYNC_POINT("FilePrefetchBuffer::TryReadFromAsyncRead:Done");
+  const size_t read_size = async_read->buffer.CurrentSize();
+  if (!async_read->status.ok() ||
+      offset + n > async_read->offset + read_size) {
+    // Past the end of the file, or the read failed. The synchronous path
+    // deals with it.
+    async_read->state = AsyncRead::kIdle;
+    return false;
+  }
+
+  if (in_window) {
+    *result = Slice(async_read->buffer.BufferStart() +
+                        (offset - async_read->offset),
+                    n);
+  } else {
+    // Copied now, before the buffers are swapped below
+    overlap_buf_.assign(buffer_.BufferStart() + (offset - buffer_offset_),
+                        static_cast<size_t>(buffer_end - offset));
+    overlap_buf_.append(
+        async_read->buffer.BufferStart() + (buffer_end - async_read->offset),
+        static_cast<size_t>(offset + n - buffer_end));
+    *result = Slice(overlap_buf_);
+  }
+  // The old buffer becomes the target of the next background read
+  std::swap(buffer_, async_read->buffer);
+  buffer_offset_ = async_read->offset;
+  async_read->state = AsyncRead::kIdle;
+
+  // Only grow the window when the reader had to wait for it, i.e. when it
+  // consumes data faster than a window is read.
+  if (waited) {
+    readahead_size_ = std::min(max_readahead_size_, readahead_size_ * 2);
+  }
+  if (read_size == async_read->len) {
+    ScheduleAsyncRead(for_compaction);
+  }
+  return true;
+}
 }  // namespace ROCKSDB_NAMESPACE
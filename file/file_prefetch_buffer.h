@@ -9,6 +9,7 @@
 
 #pragma once
 #include <atomic>
+#include <memory>
 #include <sstream>
 #include <string>
 #include "file/random_access_file_reader.h"
@@ -37,6 +38,12 @@ class FilePrefetchBuffer {
   // track_min_offset : Track the minimum offset ever read and collect stats on
   //   it. Used for adaptable readahead of the file footer/metadata.
   //
+  // async_env : if set and its Env::Priority::USER pool has threads, the
+  //   automatic readahead is double-buffered: whenever the buffer is filled,
+  //   the window after it is read on a USER thread while the buffer is
+  //   consumed. The readahead size then only grows when the reader catches
+  //   up with the background read.
+  //
   // Automatic readhead is enabled for a file if file_reader, readahead_size,
   // and max_readahead_size are passed in.
   // If file_reader is a nullptr, setting readadhead_size and max_readahead_size
@@ -45,14 +52,26 @@ class FilePrefetchBuffer {
   // `Prefetch` to load data into the buffer.
   FilePrefetchBuffer(RandomAccessFileReader* file_reader = nullptr,
                      size_t readadhead_size = 0, size_t max_readahead_size = 0,
-                     bool enable = true, bool track_min_offset = false)
+                     bool enable = true, bool track_min_offset = false,
+                     Env* async_env = nullptr)
       : buffer_offset_(0),
         file_reader_(file_reader),
         readahead_size_(readadhead_size),
         max_readahead_size_(max_readahead_size),
         min_offset_read_(port::kMaxSizet),
         enable_(enable),
-        track_min_offset_(track_min_offset) {}
+        track_min_offset_(track_min_offset),
+        async_env_(nullptr) {
+    if (async_env != nullptr && file_reader != nullptr &&
+        readadhead_size > 0 &&
+        async_env->GetBackgroundThreads(Env::Priority::USER) > 0) {
+      async_env_ = async_env;
+      async_read_ = std::make_shared<AsyncRead>();
+    }
+  }
+
+  // Waits for the background read, if one is running
+  ~FilePrefetchBuffer();
 
   // Load data into the buffer from a file.
   // reader : the file reader.
@@ -80,6 +99,42 @@ class FilePrefetchBuffer {
   size_t min_offset_read() const { return min_offset_read_; }
 
  private:
+  // The read of the window after buffer_, shared with the USER thread that
+  // does it so that it can find out it was abandoned if it only gets to run
+  // after the FilePrefetchBuffer is gone.
+  struct AsyncRead {
+    enum State { kIdle, kPending, kRunning, kDone };
+
+    AsyncRead() : cv(&mu) {}
+
+    port::Mutex mu;
+    port::CondVar cv;
+    // Guarded by mu. Only the USER thread touches the fields below while
+    // the read is kRunning; otherwise they belong to the FilePrefetchBuffer.
+    State state = kIdle;
+    RandomAccessFileReader* reader = nullptr;
+    uint64_t offset = 0;
+    size_t len = 0;
+    bool for_compaction = false;
+    AlignedBuffer buffer;
+    Status status;
+  };
+
+  static void AsyncReadWork(void* arg);
+
+  // Starts reading the window after buffer_ in the background.
+  void ScheduleAsyncRead(bool for_compaction);
+
+  // Waits for the background read to finish, or drops it if it did not
+  // start yet. Returns true if it completed, and sets `waited` if it was
+  // still running.
+  bool FinishAsyncRead(bool* waited);
+
+  // Serves [offset, offset + n) from buffer_ and the background read if they
+  // cover it, making the read the new buffer_.
+  bool TryReadFromAsyncRead(uint64_t offset, size_t n, Slice* result,
+                            bool for_compaction);
+
   AlignedBuffer buffer_;
   uint64_t buffer_offset_;
   RandomAccessFileReader* file_reader_;
@@ -93,5 +148,10 @@ class FilePrefetchBuffer {
   // If true, track minimum `offset` ever passed to TryReadFromCache(), which
   // can be fetched from min_offset_read().
   bool track_min_offset_;
+  // Set when the readahead is double-buffered
+  Env* async_env_;
+  std::shared_ptr<AsyncRead> async_read_;
+  // Holds requests that span the end of buffer_ and the background read
+  std::string overlap_buf_;
 };
 }  // namespace ROCKSDB_NAMESPACE
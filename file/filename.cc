@@ -24,6 +24,7 @@ namespace ROCKSDB_NAMESPACE {
 static const std::string kRocksDbTFileExt = "sst";
 static const std::string kLevelDbTFileExt = "ldb";
 static const std::string kRocksDBBlobFileExt = "blob";
+static const std::string kTierFilterFileExt = "tierfilter";
 
 // Given a path, flatten the path name by replacing all chars not in
 // {[0-9,a-z,A-Z,-,_,.]} with _. And append '_LOG\0' at the end.
@@ -223,6 +224,49 @@ std::string TempOptionsFileName(const std::string& dbname, uint64_t file_num) {
   return dbname + "/" + buffer;
 }
 
+std::string TierFilterFileName(const std::string& dbname, uint64_t block_num,
+                               uint32_t cf_id, uint32_t crc) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "/%06" PRIu64 ".%u.%08x.%s", block_num,
+           cf_id, crc, kTierFilterFileExt.c_str());
+  return dbname + buffer;
+}
+
+bool ParseTierFilterFileName(const std::string& fname, uint64_t* block_num,
+                             uint32_t* cf_id, uint32_t* crc) {
+  Slice rest(fname);
+  uint64_t num;
+  if (!ConsumeDecimalNumber(&rest, &num) || !rest.starts_with(".")) {
+    return false;
+  }
+  *block_num = num;
+  rest.remove_prefix(1);
+  if (!ConsumeDecimalNumber(&rest, &num) || num > port::kMaxUint32 ||
+      !rest.starts_with(".")) {
+    return false;
+  }
+  *cf_id = static_cast<uint32_t>(num);
+  rest.remove_prefix(1);
+  uint32_t value = 0;
+  size_t digits = 0;
+  for (; digits < 8 && digits < rest.size(); digits++) {
+    char c = rest[digits];
+    if (c >= '0' && c <= '9') {
+      value = (value << 4) | static_cast<uint32_t>(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      value = (value << 4) | static_cast<uint32_t>(c - 'a' + 10);
+    } else {
+      return false;
+    }
+  }
+  rest.remove_prefix(digits);
+  if (digits != 8 || rest != Slice("." + kTierFilterFileExt)) {
+    return false;
+  }
+  *crc = value;
+  return true;
+}
+
 std::string MetaDatabaseName(const std::string& dbname, uint64_t number) {
   char buf[100];
   snprintf(buf, sizeof(buf), "/METADB-%llu",
@@ -343,6 +387,12 @@ bool ParseFileName(const std::string& fname, uint64_t* number,
     if (rest.size() <= 1 || rest[0] != '.') {
       return false;
     }
+    if (!archive_dir_found &&
+        rest.ends_with(Slice("." + kTierFilterFileExt))) {
+      *type = kTierFilterFile;
+      *number = num;
+      return true;
+    }
     rest.remove_prefix(1);
 
     Slice suffix = rest;
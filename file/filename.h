@@ -46,7 +46,8 @@ enum FileType {
   kMetaDatabase,
   kIdentityFile,
   kOptionsFile,
-  kBlobFile
+  kBlobFile,
+  kTierFilterFile
 };
 
 // Return the name of the log file with the specified number
@@ -151,6 +152,20 @@ extern std::string TempOptionsFileName(const std::string& dbname,
 extern std::string MetaDatabaseName(const std::string& dbname,
                                     uint64_t number);
 
+// Return the name of the file that holds a copy of the tier mode group filter
+// in pool block "block_num" of column family "cf_id", used by checkpoint and
+// backup. "crc" is the checksum of the contents, so a changed filter always
+// gets a new name.
+// Format:  [block_num].[cf_id].[crc].tierfilter
+extern std::string TierFilterFileName(const std::string& dbname,
+                                      uint64_t block_num, uint32_t cf_id,
+                                      uint32_t crc);
+
+// Parse a file name (without directory) produced by TierFilterFileName.
+extern bool ParseTierFilterFileName(const std::string& fname,
+                                    uint64_t* block_num, uint32_t* cf_id,
+                                    uint32_t* crc);
+
 // Return the name of the Identity file which stores a unique number for the db
 // that will get regenerated if the db loses all its data and is recreated fresh
 // either from a backup-image or empty
@@ -130,6 +130,23 @@ extern std::shared_ptr<Cache> NewClockCache(
     bool strict_capacity_limit = false,
     CacheMetadataChargePolicy metadata_charge_policy =
         kDefaultCacheMetadataChargePolicy);
+
+// Similar to NewClockCache, but lookups and releases never take a lock, so
+// that hits on popular blocks do not serialize on a shard mutex. Each shard
+// uses a fixed-size hash table sized from capacity / estimated_entry_charge;
+// estimated_entry_charge should be close to the typical charge of an entry
+// (e.g. block_size for a block cache holding only data blocks). If it is much
+// too large the cache holds fewer entries than its capacity allows, if it is
+// much too small the tables waste memory.
+//
+// Return nullptr if estimated_entry_charge is 0 or num_shard_bits is too
+// large.
+extern std::shared_ptr<Cache> NewLockFreeClockCache(
+    size_t capacity, size_t estimated_entry_charge, int num_shard_bits = -1,
+    bool strict_capacity_limit = false,
+    CacheMetadataChargePolicy metadata_charge_policy =
+        kDefaultCacheMetadataChargePolicy);
+
 class Cache {
  public:
   // Depending on implementation, cache entries with high priority could be less
@@ -225,6 +242,13 @@ class Cache {
   // purge the released entries from the cache in order to lower the usage
   virtual void SetCapacity(size_t capacity) = 0;
 
+  // Returns true while the cache drops its entries because SetCapacity()
+  // is running or the cache is being destroyed, rather than evicting them to
+  // make room for new ones. Deleters can check it to skip work that only
+  // pays off for entries evicted in normal use. Entries that other threads
+  // evict in the meantime may see it set too.
+  virtual bool IsDraining() const { return false; }
+
   // Set whether to return error on insertion when cache reaches its full
   // capacity.
   virtual void SetStrictCapacityLimit(bool strict_capacity_limit) = 0;
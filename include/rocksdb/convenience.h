@@ -128,6 +128,22 @@ namespace ROCKSDB_NAMESPACE {
 //     [Example]:
 //     * {"memtable", "hash_linkedlist:1000"} is equivalent to
 //       setting memtable to NewHashLinkListRepFactory(1000).
+//   - HashIndexedSkipList:
+//     Pass "hash_indexed_skip_list:<hash_bucket_count>" to config memtable
+//     to use HashIndexedSkipList, or simply "hash_indexed_skip_list" to use
+//     the default HashIndexedSkipList.
+//     [Example]:
+//     * {"memtable", "hash_indexed_skip_list:1000"} is equivalent to
+//       setting memtable to NewHashIndexedSkipListRepFactory(1000).
+//   - AdaptiveRadixTree:
+//     Pass "adaptive_radix_tree" to config memtable to use
+//     AdaptiveRadixTree.
+//   - BulkLoad:
+//     Pass "bulk_load:<sort_threads>" to config memtable to use BulkLoad,
+//     or simply "bulk_load" to use the default BulkLoad memtable.
+//     [Example]:
+//     * {"memtable", "bulk_load:8"} is equivalent to setting memtable to
+//       NewBulkLoadRepFactory(8).
 //   - VectorRepFactory:
 //     Pass "vector:<count>" to config memtable to use VectorRepFactory,
 //     or simply "vector" to use the default Vector memtable.
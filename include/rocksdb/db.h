@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -626,6 +627,30 @@ class DB {
     }
   }
 
+  // Called when a lookup started with GetAsync() is done, with the status of
+  // the lookup and, if it is OK, the value. `value` is only valid for the
+  // duration of the call.
+  using GetCallback =
+      std::function<void(const Status& status, const Slice& value)>;
+
+  // Asynchronous variant of Get(). The key is copied, so only the column
+  // family and the snapshot, timestamp and other pointers in `options` need
+  // to stay valid until `callback` was called. Lookups that are pending at
+  // the same time are served in batches through MultiGet() by the threads of
+  // the Env::Priority::USER pool, which call the callbacks, so that a few
+  // threads can keep many reads in flight. Without USER threads, or with
+  // the default implementation here, the lookup is done and the callback
+  // called before GetAsync() returns. StackableDB keeps the default
+  // implementation, so that the lookups of a wrapped DB (TTL, transactions,
+  // BlobDB) go through the Get() of the wrapper.
+  virtual void GetAsync(const ReadOptions& options,
+                        ColumnFamilyHandle* column_family, const Slice& key,
+                        GetCallback callback) {
+    PinnableSlice value;
+    Status s = Get(options, column_family, key, &value);
+    callback(s, value);
+  }
+
   // If the key definitely does not exist in the database, then this method
   // returns false, else true. If the caller wants to obtain value when the key
   // is found in memory, a bool for 'value_found' must be passed. 'value_found'
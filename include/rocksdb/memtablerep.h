@@ -40,11 +40,14 @@
 #include <stdlib.h>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace ROCKSDB_NAMESPACE {
 
 class Arena;
+class Comparator;
 class Allocator;
+class Env;
 class LookupKey;
 class SliceTransform;
 class Logger;
@@ -75,6 +78,10 @@ class MemTableRep {
     virtual int operator()(const char* prefix_len_key,
                            const Slice& key) const = 0;
 
+    // The comparator of the user keys, if known. MemTableReps that order the
+    // keys by their bytes can use it to check that this is valid.
+    virtual const Comparator* user_comparator() const { return nullptr; }
+
     virtual ~KeyComparator() {}
   };
 
@@ -194,6 +201,16 @@ class MemTableRep {
     return 0;
   }
 
+  // Appends to *entries about num_samples entries of the collection, which
+  // holds about num_entries entries, in no particular order. Used to split
+  // the flush of an immutable memtable into key ranges.
+  //
+  // Default:
+  // Iterate over the whole collection and keep every
+  // (num_entries / num_samples)-th entry.
+  virtual void SampleEntries(uint64_t num_entries, size_t num_samples,
+                             std::vector<const char*>* entries);
+
   // Report an approximation of how much memory has been used other than memory
   // that was allocated through the allocator.  Safe to call from any thread.
   virtual size_t ApproximateMemoryUsage() = 0;
@@ -381,5 +398,37 @@ extern MemTableRepFactory* NewHashLinkListRepFactory(
     bool if_log_bucket_dist_when_flash = true,
     uint32_t threshold_use_skiplist = 256);
 
+// This creates MemTableReps that keep the entries in a skip list, for
+// iteration and flush, and index them by user key in a hash table, for
+// point lookups in expected O(1) time. Unlike the other hash based
+// memtables it supports allow_concurrent_memtable_write and does not need a
+// prefix extractor. Not suitable for user-defined timestamps, since the
+// timestamp is hashed as part of the user key.
+// @bucket_count: number of buckets of the hash index. Lookups stay O(1) as
+//                long as the number of entries is in the order of it.
+extern MemTableRepFactory* NewHashIndexedSkipListRepFactory(
+    size_t bucket_count = 1000000);
+
+// This creates MemTableReps that keep the user keys in an adaptive radix
+// tree, which compares long common key prefixes once instead of at every
+// level of a skip list. Supports allow_concurrent_memtable_write. Needs the
+// bytewise comparator; with any other comparator a skip list is used.
+extern MemTableRepFactory* NewAdaptiveRadixTreeRepFactory();
+
+// This creates MemTableReps for bulk loading. Writers append to a buffer of
+// their core without ordering the entries, which makes inserts cheap and
+// free of contention with allow_concurrent_memtable_write. The entries are
+// sorted in parallel and in the background once the memtable is full, before
+// it is flushed. Point lookups are served by a hash index of every buffer.
+// Iterating over the active memtable sorts a copy of it, like with
+// VectorRepFactory.
+// @sort_threads: number of threads that sort a full memtable
+// @env: the sort runs on the HIGH pool of this Env, or on its LOW pool when
+//       the HIGH pool has no threads, with the thread that needs the sorted
+//       entries taking over the parts not started yet. nullptr means
+//       Env::Default().
+extern MemTableRepFactory* NewBulkLoadRepFactory(size_t sort_threads = 4,
+                                                 Env* env = nullptr);
+
 #endif  // ROCKSDB_LITE
 }  // namespace ROCKSDB_NAMESPACE
@@ -589,6 +589,16 @@ struct DBOptions {
   // Default: -1
   int max_background_flushes = -1;
 
+  // This value represents the maximum number of threads that will
+  // concurrently perform a flush job by splitting the memtables into key
+  // ranges, sampled from the memtables, and writing each range into its own
+  // L0 file. The files of one flush are installed together.
+  // Only used with kCompactionStyleLevel, and not for flushes of memtables
+  // that contain range deletions, atomic flushes, or column families with
+  // user-defined timestamps.
+  // Default: 1 (i.e. no subflushes)
+  uint32_t max_subflushes = 1;
+
   // Specify the maximal size of the info log file. If the log file
   // is larger than `max_log_file_size`, a new info log file will
   // be created.
@@ -747,6 +757,20 @@ struct DBOptions {
   // Default: null
   std::shared_ptr<WriteBufferManager> write_buffer_manager = nullptr;
 
+  // If true, the write_buffer_size of every new memtable is chosen from the
+  // observed write rates of the column families instead of being taken as
+  // is. The memtable budget, the write buffer manager's size if it is
+  // enabled and the sum of the configured write_buffer_size otherwise, is
+  // redistributed so that column families with more writes (and more L0
+  // files to compact) get larger memtables, within [1/4, 4] times their
+  // configured write_buffer_size. When the write buffer manager asks for a
+  // flush, the column family holding the most memory relative to its write
+  // rate is flushed first, rather than the one with the oldest memtable.
+  // Not used with atomic_flush.
+  //
+  // Default: false
+  bool adaptive_write_buffer_size = false;
+
   // Specify the file access pattern once a compaction is started.
   // It will be applied to all input files of a compaction.
   // Default: NORMAL
@@ -1086,6 +1110,58 @@ struct DBOptions {
   // file.
   bool manual_wal_flush = false;
 
+  // If greater than 1, the WAL is split into this many shards, each with its
+  // own log file and its own write queue, so that writes hashed to different
+  // shards (by the CPU core of the writing thread) group-commit and append to
+  // their logs in parallel. Sequence numbers are still allocated and
+  // published in order; recovery replays the logs merged by sequence number.
+  //
+  // A sync write waits for the writes of all the shards before it and syncs
+  // all the logs, as SyncWAL() does.
+  //
+  // Requires allow_concurrent_memtable_write, and is not supported together
+  // with enable_pipelined_write, unordered_write, two_write_queues,
+  // allow_2pc, manual_wal_flush, allow_mmap_writes or write callbacks
+  // (OptimisticTransactionDB).
+  // recycle_log_file_num is ignored. DB::GetUpdatesSince() is not supported.
+  //
+  // Default: 1
+  size_t wal_shards = 1;
+
+  // If true, sync writes do not sync the WAL while leading their write
+  // group. The group is appended and handed over to the next group, and its
+  // writers then wait for a dedicated thread to sync the WAL; requests that
+  // arrive during a sync are served together by the next one. This overlaps
+  // the fsync of a group with the appends of the following groups.
+  //
+  // A write becomes visible to readers once appended, possibly before it is
+  // synced; the sync write itself returns only after it is durable. So,
+  // unlike the default path, a reader can see data that a crash during the
+  // sync loses.
+  //
+  // A failed sync is reported to the background error handler like a
+  // failed inline sync. After it, sync writes fail until DB::Resume()
+  // succeeds, since a later sync may not cover the lost data.
+  //
+  // Only applies to the default write path, i.e. not with
+  // enable_pipelined_write, two_write_queues, unordered_write or
+  // wal_shards > 1, and is ignored with allow_mmap_writes.
+  //
+  // Default: false
+  bool pipelined_wal_sync = false;
+
+  // If not kNoCompression, WAL records are compressed with this algorithm.
+  // Each WAL file is compressed as a single stream, so a record can refer
+  // back to the earlier records of its file, which works well for small
+  // batches with repetitive keys and values. Only kZSTD (zstd 1.4.0+) and
+  // kLZ4Compression are supported. Log file recycling is disabled when set.
+  //
+  // WAL files written this way can't be read by versions without WAL
+  // compression support.
+  //
+  // Default: kNoCompression
+  CompressionType wal_compression = kNoCompression;
+
   // If true, RocksDB supports flushing multiple column families and committing
   // their results atomically to MANIFEST. Note that it is not
   // necessary to set atomic_flush to true if WAL is always enabled since WAL
@@ -1127,10 +1203,69 @@ struct DBOptions {
   size_t log_readahead_size = 0;
 
   // 添加持久化内存文件的路径
+  // 每个 DB 独占一个 pool, pool 中记录了所属 DB 的 id. 打开 checkpoint 或者
+  // 从 backup 恢复的 DB 时需要使用另外的路径, group filter 会从 checkpoint /
+  // backup 中的 *.tierfilter 文件导入. 已有的 DB 遇到属于其他 DB 的 pool 时
+  // 不使用 group filter (见 info log), 新建的 DB 会重新创建 pool
   std::string persistent_file_path_ = "./pmem";
 
+  // 整个 DB 的所有 column family 共享同一个 filter pool,
+  // persistent_file_size_ 为 pool 的初始大小, 也是 pool 每次增长的大小,
+  // 会按照 persistent_block_size_ 对齐
+  uint64_t persistent_file_size_ = 1024 * 1024 * 1024;
+
+  // filter pool 最多增长到的大小. 达到上限并且空间紧张时, 超出软配额
+  // (上限 / column family 数) 的 column family 新生成的 group 不再带 filter
+  uint64_t persistent_file_max_size_ = 8ull * 1024 * 1024 * 1024;
+
+  // pool 中每个 block 的大小, 一个 block 存放一个 group cuckoo filter
+  // 注意: 已经存在的 pool 文件必须使用创建时相同的 block 大小打开
+  uint64_t persistent_block_size_ = 1024 * 1024;
+
+  // PMem 延迟模拟, 用于没有 PMem 的机器上测试 group filter.
+  // 任意一个延迟不为 0 时开启: 对 filter pool 的访问按 persistent_emulate_
+  // access_granularity_ 字节为单位计费, 每个单位的读 / 写分别自旋等待对应的
+  // 纳秒数, 每次持久化额外等待 flush 延迟. 此时 persistent_file_path_ 可以
+  // 指向普通内存 (例如 /dev/shm). Optane 的参考值: 读约 300ns, 粒度 256 字节
+  uint64_t persistent_emulate_read_latency_ns_ = 0;
+  uint64_t persistent_emulate_write_latency_ns_ = 0;
+  uint64_t persistent_emulate_flush_latency_ns_ = 0;
+  uint64_t persistent_emulate_access_granularity_ = 256;
+
+  // filter pool 的映射方式, 用于降低重启之后以及随机访问 filter 时的延迟
+  // - persistent_map_prefault_threads_ > 0: 打开已有的 pool 后用这么多个
+  //   后台线程预先访问所有页, 避免重启后的查询承担缺页开销
+  // - persistent_map_huge_pages_: 新建的 pool 按 2MB 对齐并请求透明大页
+  // - persistent_map_numa_node_ >= 0: 将 pool 绑定到该 NUMA 节点;
+  //   否则 persistent_map_numa_interleave_ 为 true 时在所有节点间交错分布.
+  //   NUMA 策略需要以 WITH_NUMA 编译
+  int persistent_map_prefault_threads_ = 0;
+  bool persistent_map_huge_pages_ = false;
+  int persistent_map_numa_node_ = -1;
+  bool persistent_map_numa_interleave_ = false;
+
   // 是否开启 Tiered 模式
   bool is_tiered = false;
+
+  // Tier 模式下 L1+ 的 compaction score 由 vertical group 的深度决定
+  // (group 的深度: 同一个 key 最多被 group 中的多少个文件覆盖)
+  // 某一层 group 的最大深度达到 tier_max_group_depth_trigger,
+  // 或者平均深度达到 tier_avg_group_depth_trigger 时, 该层的 score 达到 1
+  // 该层的总大小超过 MaxBytesForLevel 时同样会触发 compaction
+  int tier_max_group_depth_trigger = 8;
+  double tier_avg_group_depth_trigger = 4;
+
+  // L1+ 中 group 的最大深度达到以下阈值时, 分别减缓/停止写入
+  // 作用与 level0_slowdown_writes_trigger / level0_stop_writes_trigger 相同
+  // 小于等于 0 表示不因 group 深度减缓/停止写入
+  int tier_group_depth_slowdown_writes_trigger = 20;
+  int tier_group_depth_stop_writes_trigger = 36;
+
+  // Tier 模式下, 在 group filter 中额外插入 prefix_extractor 得到的
+  // prefix 的指纹. prefix seek 时跳过不包含该 prefix 的 group, 不需要
+  // 打开其中的文件. prefix 指纹与 key 共用 filter 的空间
+  // 只对设置了 prefix_extractor 的 column family 生效
+  bool tier_prefix_filter = false;
   // If user does NOT provide the checksum generator factory, the file checksum
   // will NOT be used. A new file checksum generator object will be created
   // when a SST file is created. Therefore, each created FileChecksumGenerator
@@ -1351,6 +1486,21 @@ struct ReadOptions {
   const Slice* timestamp;
   const Slice* iter_start_ts;
 
+  // If true, MultiGet reads the data blocks of all the SST files and levels a
+  // batch may have to visit concurrently, on the threads of the
+  // Env::Priority::USER thread pool, instead of one file after another. The
+  // keys are still resolved level by level, so a key found in a newer file
+  // may have had blocks of older files read for nothing. Has no effect
+  // unless the USER pool has threads (Env::SetBackgroundThreads), a block
+  // cache is configured and fill_cache is set.
+  // Iterators that read ahead through a prefetch buffer (readahead_size set,
+  // or automatic readahead with direct I/O) also read the next readahead
+  // window on a USER thread while the current one is consumed. Compaction
+  // does this for its input files when compaction_readahead_size is set and
+  // the USER pool has threads.
+  // Default: false
+  bool async_io;
+
   ReadOptions();
   ReadOptions(bool cksum, bool cache);
 };
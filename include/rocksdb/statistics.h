@@ -342,6 +342,25 @@ enum Tickers : uint32_t {
   BLOCK_CACHE_COMPRESSION_DICT_ADD,
   BLOCK_CACHE_COMPRESSION_DICT_BYTES_INSERT,
   BLOCK_CACHE_COMPRESSION_DICT_BYTES_EVICT,
+
+  // # of group cuckoo filter lookups done by point lookups in tier mode.
+  TIER_GROUP_FILTER_PROBED,
+  // # of times a group cuckoo filter excluded an SST file from a point lookup.
+  TIER_GROUP_FILTER_USEFUL,
+  // # of SST files a point lookup actually read (called TableReader::Get on).
+  GET_SST_FILES_READ,
+  // # of tier compaction output groups written without a group cuckoo filter
+  // because the shared filter pool refused the allocation.
+  TIER_GROUP_FILTER_DEGRADED,
+  // PMem latency emulation of the group filter pool: # of access-granularity
+  // units read / written, # of flushes, and total nanoseconds spent stalling.
+  TIER_PMEM_EMULATED_READS,
+  TIER_PMEM_EMULATED_WRITES,
+  TIER_PMEM_EMULATED_FLUSHES,
+  TIER_PMEM_EMULATED_STALL_NANOS,
+  // # of tier compaction outputs that moved to a new group cuckoo filter
+  // because the group's filter was saturated or too full for the inputs.
+  TIER_GROUP_FILTER_GROWN,
   TICKER_ENUM_MAX
 };
 
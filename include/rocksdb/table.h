@@ -163,6 +163,30 @@ struct BlockBasedTableOptions {
   //       same type of object there.
   std::shared_ptr<Cache> block_cache_compressed = nullptr;
 
+  // If set, `block_cache_compressed` becomes a second tier under
+  // `block_cache`: data blocks evicted from `block_cache` are compressed
+  // with this algorithm and moved to `block_cache_compressed`, and move back
+  // when they are read again, so that a block is in at most one of the two
+  // caches. A block is only kept if it shrinks by at least 1/8 and
+  // `block_cache_compressed_admission_history` lets it in. Blocks of tables
+  // with a compression dictionary are not demoted. Blocks are compressed on
+  // every eviction, so a fast algorithm such as kLZ4Compression is usually
+  // the best choice.
+  // With kNoCompression, blocks that are compressed in the file are added
+  // to `block_cache_compressed` as they are read, and stay in `block_cache`
+  // as well.
+  CompressionType block_cache_compressed_compression = kNoCompression;
+
+  // Admission policy of the blocks demoted to `block_cache_compressed`, see
+  // `block_cache_compressed_compression`. The keys of the last this many
+  // blocks turned away are remembered, and a block is only admitted when it
+  // is evicted again while its key is remembered. This keeps blocks that
+  // are read once, e.g. by scans, from pushing the ones that keep being read
+  // out of the compressed cache. Blocks that were in the compressed cache
+  // before are always admitted back. 0 admits every block.
+  // Costs 8 bytes per key remembered.
+  size_t block_cache_compressed_admission_history = 0;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -0,0 +1,1018 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// An adaptive radix tree (ART, Leis et al., ICDE 2013) over the user keys
+// of the memtable. Keys are consumed one byte per level, runs of bytes
+// shared by all the keys below a node are stored once as the node's prefix
+// (path compression) and inner nodes come in four sizes, so long common
+// prefixes like tenant/table/row are compared once instead of at every
+// level of a skip list.
+//
+// Every user key has a leaf holding the list of its entries, newest first.
+// A key that is a prefix of other keys hangs off the `end` slot of the
+// inner node where it ends, which sorts before all the children.
+//
+// Concurrency: readers never lock or retry. Inner nodes are only changed by
+// appending a child, by setting `end` or by replacing a child pointer with a
+// node that holds a superset of the keys, so a reader always sees a
+// consistent subset of the tree. Changes that can't be done in place
+// (growing a node, splitting its prefix) build a new copy and mark the old
+// node obsolete. Writers descend optimistically, lock the node they modify
+// (and its parent if the node is replaced), and restart from the root if
+// the locked nodes turned obsolete or changed in between.
+//
+// Nodes and entries are allocated from the memtable's allocator and are
+// never freed, so stale pointers held by readers stay valid.
+
+#ifndef ROCKSDB_LITE
+#include "memtable/art_rep.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "logging/logging.h"
+#include "memory/arena.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/memtablerep.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+enum NodeType : uint8_t {
+  kLeaf = 0,
+  kNode4 = 1,
+  kNode16 = 2,
+  kNode48 = 3,
+  kNode256 = 4,
+};
+
+// Placed right before every key handed out by Allocate()
+struct Entry {
+  std::atomic<Entry*> next;
+
+  const char* key() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+inline uint64_t EntryTrailer(const Entry* entry) {
+  return ExtractInternalKeyFooter(GetLengthPrefixedSlice(entry->key()));
+}
+
+struct Node {
+  explicit Node(NodeType t) : type(t) {}
+  const NodeType type;
+};
+
+struct Leaf : public Node {
+  Leaf(const Slice& k, Entry* first) : Node(kLeaf), user_key(k) {
+    entries.store(first, std::memory_order_relaxed);
+  }
+
+  // Points into the first entry of the key
+  const Slice user_key;
+  // Sorted by sequence number, descending
+  std::atomic<Entry*> entries;
+};
+
+struct InnerNode : public Node {
+  InnerNode(NodeType t, const char* p, uint32_t len)
+      : Node(t), prefix(p), prefix_len(len) {
+    num_children.store(0, std::memory_order_relaxed);
+    obsolete.store(false, std::memory_order_relaxed);
+    end.store(nullptr, std::memory_order_relaxed);
+  }
+
+  // Points into the user key of an entry below the node
+  const char* const prefix;
+  const uint32_t prefix_len;
+  std::atomic<uint32_t> num_children;
+  std::atomic<bool> obsolete;
+  // The leaf of the key that ends right after the prefix
+  std::atomic<Leaf*> end;
+  // Taken by writers only
+  SpinMutex mutex;
+};
+
+// Node4 and Node16. Children are kept in insertion order, so that adding
+// one never moves the others under a concurrent reader; the arrays are
+// small enough to be scanned.
+template <NodeType kType, uint32_t kCapacity>
+struct ArrayNode : public InnerNode {
+  ArrayNode(const char* p, uint32_t len) : InnerNode(kType, p, len) {}
+
+  static const uint32_t kMaxChildren = kCapacity;
+
+  std::atomic<Node*>* Find(uint8_t b) {
+    const uint32_t n = num_children.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < n; ++i) {
+      if (keys[i] == b) {
+        return &children[i];
+      }
+    }
+    return nullptr;
+  }
+
+  void Add(uint8_t b, Node* child) {
+    const uint32_t n = num_children.load(std::memory_order_relaxed);
+    assert(n < kCapacity);
+    keys[n] = b;
+    children[n].store(child, std::memory_order_relaxed);
+    num_children.store(n + 1, std::memory_order_release);
+  }
+
+  // The child with the smallest byte greater than `after`
+  Node* Next(int after, uint8_t* b) {
+    const uint32_t n = num_children.load(std::memory_order_acquire);
+    int best = 256;
+    uint32_t best_i = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      if (keys[i] > after && keys[i] < best) {
+        best = keys[i];
+        best_i = i;
+      }
+    }
+    if (best == 256) {
+      return nullptr;
+    }
+    *b = static_cast<uint8_t>(best);
+    return children[best_i].load(std::memory_order_acquire);
+  }
+
+  // The child with the largest byte less than `before`
+  Node* Prev(int before, uint8_t* b) {
+    const uint32_t n = num_children.load(std::memory_order_acquire);
+    int best = -1;
+    uint32_t best_i = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      if (keys[i] < before && keys[i] > best) {
+        best = keys[i];
+        best_i = i;
+      }
+    }
+    if (best == -1) {
+      return nullptr;
+    }
+    *b = static_cast<uint8_t>(best);
+    return children[best_i].load(std::memory_order_acquire);
+  }
+
+  uint8_t keys[kCapacity];
+  std::atomic<Node*> children[kCapacity];
+};
+
+typedef ArrayNode<kNode4, 4> Node4;
+typedef ArrayNode<kNode16, 16> Node16;
+
+struct Node48 : public InnerNode {
+  Node48(const char* p, uint32_t len) : InnerNode(kNode48, p, len) {
+    for (auto& i : index) {
+      i.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  static const uint32_t kMaxChildren = 48;
+
+  std::atomic<Node*>* Find(uint8_t b) {
+    const uint8_t i = index[b].load(std::memory_order_acquire);
+    return i == 0 ? nullptr : &children[i - 1];
+  }
+
+  void Add(uint8_t b, Node* child) {
+    const uint32_t n = num_children.load(std::memory_order_relaxed);
+    assert(n < kMaxChildren);
+    children[n].store(child, std::memory_order_relaxed);
+    index[b].store(static_cast<uint8_t>(n + 1), std::memory_order_release);
+    num_children.store(n + 1, std::memory_order_release);
+  }
+
+  Node* Next(int after, uint8_t* b) {
+    for (int c = after + 1; c < 256; ++c) {
+      const uint8_t i = index[c].load(std::memory_order_acquire);
+      if (i != 0) {
+        *b = static_cast<uint8_t>(c);
+        return children[i - 1].load(std::memory_order_acquire);
+      }
+    }
+    return nullptr;
+  }
+
+  Node* Prev(int before, uint8_t* b) {
+    for (int c = before - 1; c >= 0; --c) {
+      const uint8_t i = index[c].load(std::memory_order_acquire);
+      if (i != 0) {
+        *b = static_cast<uint8_t>(c);
+        return children[i - 1].load(std::memory_order_acquire);
+      }
+    }
+    return nullptr;
+  }
+
+  // 0 if there is no child for the byte, else the slot in children + 1
+  std::atomic<uint8_t> index[256];
+  std::atomic<Node*> children[kMaxChildren];
+};
+
+struct Node256 : public InnerNode {
+  Node256(const char* p, uint32_t len) : InnerNode(kNode256, p, len) {
+    for (auto& c : children) {
+      c.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  static const uint32_t kMaxChildren = 256;
+
+  std::atomic<Node*>* Find(uint8_t b) {
+    return children[b].load(std::memory_order_acquire) == nullptr
+               ? nullptr
+               : &children[b];
+  }
+
+  void Add(uint8_t b, Node* child) {
+    children[b].store(child, std::memory_order_release);
+    num_children.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Node* Next(int after, uint8_t* b) {
+    for (int c = after + 1; c < 256; ++c) {
+      Node* child = children[c].load(std::memory_order_acquire);
+      if (child != nullptr) {
+        *b = static_cast<uint8_t>(c);
+        return child;
+      }
+    }
+    return nullptr;
+  }
+
+  Node* Prev(int before, uint8_t* b) {
+    for (int c = before - 1; c >= 0; --c) {
+      Node* child = children[c].load(std::memory_order_acquire);
+      if (child != nullptr) {
+        *b = static_cast<uint8_t>(c);
+        return child;
+      }
+    }
+    return nullptr;
+  }
+
+  std::atomic<Node*> children[kMaxChildren];
+};
+
+std::atomic<Node*>* FindChild(InnerNode* node, uint8_t b) {
+  switch (node->type) {
+    case kNode4:
+      return static_cast<Node4*>(node)->Find(b);
+    case kNode16:
+      return static_cast<Node16*>(node)->Find(b);
+    case kNode48:
+      return static_cast<Node48*>(node)->Find(b);
+    default:
+      assert(node->type == kNode256);
+      return static_cast<Node256*>(node)->Find(b);
+  }
+}
+
+// Requires node->mutex, or a node that is not published yet
+void AddChild(InnerNode* node, uint8_t b, Node* child) {
+  switch (node->type) {
+    case kNode4:
+      static_cast<Node4*>(node)->Add(b, child);
+      break;
+    case kNode16:
+      static_cast<Node16*>(node)->Add(b, child);
+      break;
+    case kNode48:
+      static_cast<Node48*>(node)->Add(b, child);
+      break;
+    default:
+      assert(node->type == kNode256);
+      static_cast<Node256*>(node)->Add(b, child);
+      break;
+  }
+}
+
+bool IsFull(const InnerNode* node) {
+  const uint32_t n = node->num_children.load(std::memory_order_acquire);
+  switch (node->type) {
+    case kNode4:
+      return n == Node4::kMaxChildren;
+    case kNode16:
+      return n == Node16::kMaxChildren;
+    case kNode48:
+      return n == Node48::kMaxChildren;
+    default:
+      return false;
+  }
+}
+
+// `after` is -1 to get the first child
+Node* NextChild(InnerNode* node, int after, uint8_t* b) {
+  switch (node->type) {
+    case kNode4:
+      return static_cast<Node4*>(node)->Next(after, b);
+    case kNode16:
+      return static_cast<Node16*>(node)->Next(after, b);
+    case kNode48:
+      return static_cast<Node48*>(node)->Next(after, b);
+    default:
+      assert(node->type == kNode256);
+      return static_cast<Node256*>(node)->Next(after, b);
+  }
+}
+
+// `before` is 256 to get the last child
+Node* PrevChild(InnerNode* node, int before, uint8_t* b) {
+  switch (node->type) {
+    case kNode4:
+      return static_cast<Node4*>(node)->Prev(before, b);
+    case kNode16:
+      return static_cast<Node16*>(node)->Prev(before, b);
+    case kNode48:
+      return static_cast<Node48*>(node)->Prev(before, b);
+    default:
+      assert(node->type == kNode256);
+      return static_cast<Node256*>(node)->Prev(before, b);
+  }
+}
+
+class AdaptiveRadixTreeRep : public MemTableRep {
+ public:
+  AdaptiveRadixTreeRep(const MemTableRep::KeyComparator& compare,
+                       Allocator* allocator);
+
+  KeyHandle Allocate(const size_t len, char** buf) override {
+    char* mem = allocator_->AllocateAligned(sizeof(Entry) + len);
+    Entry* entry = new (mem) Entry;
+    entry->next.store(nullptr, std::memory_order_relaxed);
+    *buf = mem + sizeof(Entry);
+    return static_cast<KeyHandle>(*buf);
+  }
+
+  void Insert(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKey(KeyHandle handle) override;
+
+  // Inserts are always safe to run concurrently
+  void InsertConcurrently(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override {
+    return InsertKey(handle);
+  }
+
+  bool Contains(const char* key) const override;
+
+  size_t ApproximateMemoryUsage() override {
+    // All memory is allocated through allocator; nothing to report here
+    return 0;
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  ~AdaptiveRadixTreeRep() override {}
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override;
+
+ private:
+  template <typename T>
+  T* NewNode(const char* prefix, uint32_t prefix_len) {
+    auto mem = allocator_->AllocateAligned(sizeof(T));
+    return new (mem) T(prefix, prefix_len);
+  }
+
+  InnerNode* NewInnerNode(NodeType type, const char* prefix,
+                          uint32_t prefix_len);
+
+  // Returns a copy of node with the given type and prefix. Requires
+  // node->mutex.
+  InnerNode* CopyNode(InnerNode* node, NodeType type, const char* prefix,
+                      uint32_t prefix_len);
+
+  Leaf* NewLeaf(const Slice& user_key, Entry* entry) {
+    auto mem = allocator_->AllocateAligned(sizeof(Leaf));
+    return new (mem) Leaf(user_key, entry);
+  }
+
+  // Returns the leaf of user_key, or nullptr if there is none
+  Leaf* FindLeaf(const Slice& user_key) const;
+
+  // Returns the leaf of user_key, after creating it with entry as its only
+  // entry if there was none, and sets *created accordingly. Returns nullptr
+  // if the tree changed under it and the insert has to be restarted.
+  Leaf* TryAddLeaf(const Slice& user_key, Entry* entry, bool* created);
+
+  // Returns false if an entry with the same sequence number and type is
+  // already in the leaf
+  static bool AddToLeaf(Leaf* leaf, Entry* entry, uint64_t trailer);
+
+  const MemTableRep::KeyComparator& compare_;
+  // A Node256 without prefix, so it never needs to be replaced
+  InnerNode* const root_;
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const AdaptiveRadixTreeRep* rep)
+        : rep_(rep), leaf_(nullptr), entry_(nullptr) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return entry_ != nullptr; }
+
+    const char* key() const override {
+      assert(Valid());
+      return entry_->key();
+    }
+
+    void Next() override;
+
+    void Prev() override;
+
+    void Seek(const Slice& internal_key, const char* memtable_key) override;
+
+    void SeekForPrev(const Slice& internal_key,
+                     const char* memtable_key) override;
+
+    void SeekToFirst() override {
+      stack_.clear();
+      SeekToFirstIn(rep_->root_);
+    }
+
+    void SeekToLast() override {
+      stack_.clear();
+      SeekToLastIn(rep_->root_);
+    }
+
+   private:
+    // An inner node on the path to the current leaf, and the byte of the
+    // child that was taken, or -1 for the end leaf of the node
+    struct Frame {
+      InnerNode* node;
+      int pos;
+    };
+
+    void Invalidate() {
+      stack_.clear();
+      leaf_ = nullptr;
+      entry_ = nullptr;
+    }
+
+    void SetFirstEntry(Leaf* leaf) {
+      leaf_ = leaf;
+      entry_ = leaf->entries.load(std::memory_order_acquire);
+    }
+
+    void SetLastEntry(Leaf* leaf) {
+      leaf_ = leaf;
+      Entry* entry = leaf->entries.load(std::memory_order_acquire);
+      Entry* next;
+      while ((next = entry->next.load(std::memory_order_acquire)) !=
+             nullptr) {
+        entry = next;
+      }
+      entry_ = entry;
+    }
+
+    // Positions at the first or last entry in the subtree of node
+    void SeekToFirstIn(InnerNode* node);
+    void SeekToLastIn(InnerNode* node);
+
+    // Positions at the first entry of the next or previous leaf
+    void NextLeaf();
+    void PrevLeaf();
+
+    const AdaptiveRadixTreeRep* rep_;
+    std::vector<Frame> stack_;
+    Leaf* leaf_;
+    Entry* entry_;
+  };
+};
+
+AdaptiveRadixTreeRep::AdaptiveRadixTreeRep(
+    const MemTableRep::KeyComparator& compare, Allocator* allocator)
+    : MemTableRep(allocator),
+      compare_(compare),
+      root_(NewNode<Node256>(nullptr, 0)) {}
+
+InnerNode* AdaptiveRadixTreeRep::NewInnerNode(NodeType type,
+                                              const char* prefix,
+                                              uint32_t prefix_len) {
+  switch (type) {
+    case kNode4:
+      return NewNode<Node4>(prefix, prefix_len);
+    case kNode16:
+      return NewNode<Node16>(prefix, prefix_len);
+    case kNode48:
+      return NewNode<Node48>(prefix, prefix_len);
+    default:
+      assert(type == kNode256);
+      return NewNode<Node256>(prefix, prefix_len);
+  }
+}
+
+InnerNode* AdaptiveRadixTreeRep::CopyNode(InnerNode* node, NodeType type,
+                                          const char* prefix,
+                                          uint32_t prefix_len) {
+  InnerNode* copy = NewInnerNode(type, prefix, prefix_len);
+  copy->end.store(node->end.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  uint8_t b;
+  int after = -1;
+  for (Node* child; (child = NextChild(node, after, &b)) != nullptr;
+       after = b) {
+    AddChild(copy, b, child);
+  }
+  return copy;
+}
+
+Leaf* AdaptiveRadixTreeRep::FindLeaf(const Slice& user_key) const {
+  InnerNode* node = root_;
+  size_t depth = 0;
+  while (true) {
+    if (node->prefix_len > 0) {
+      if (user_key.size() - depth < node->prefix_len ||
+          memcmp(user_key.data() + depth, node->prefix, node->prefix_len) !=
+              0) {
+        return nullptr;
+      }
+      depth += node->prefix_len;
+    }
+    if (depth == user_key.size()) {
+      return node->end.load(std::memory_order_acquire);
+    }
+    std::atomic<Node*>* slot =
+        FindChild(node, static_cast<uint8_t>(user_key[depth]));
+    if (slot == nullptr) {
+      return nullptr;
+    }
+    Node* child = slot->load(std::memory_order_acquire);
+    if (child->type == kLeaf) {
+      Leaf* leaf = static_cast<Leaf*>(child);
+      return leaf->user_key == user_key ? leaf : nullptr;
+    }
+    node = static_cast<InnerNode*>(child);
+    ++depth;
+  }
+}
+
+Leaf* AdaptiveRadixTreeRep::TryAddLeaf(const Slice& user_key, Entry* entry,
+                                       bool* created) {
+  InnerNode* parent = nullptr;
+  std::atomic<Node*>* parent_slot = nullptr;
+  InnerNode* node = root_;
+  size_t depth = 0;
+  while (true) {
+    uint32_t matched = 0;
+    while (matched < node->prefix_len && depth + matched < user_key.size() &&
+           node->prefix[matched] == user_key[depth + matched]) {
+      ++matched;
+    }
+
+    if (matched < node->prefix_len) {
+      // The key leaves the compressed path of the node: put a Node4 in
+      // front of it that holds the matched part of the prefix
+      assert(parent != nullptr);
+      std::unique_lock<SpinMutex> parent_lock(parent->mutex);
+      std::unique_lock<SpinMutex> lock(node->mutex);
+      if (parent->obsolete.load(std::memory_order_relaxed) ||
+          node->obsolete.load(std::memory_order_relaxed) ||
+          parent_slot->load(std::memory_order_relaxed) != node) {
+        return nullptr;
+      }
+      InnerNode* split = NewInnerNode(kNode4, node->prefix, matched);
+      // The prefix of a published node never changes, so the rest of the
+      // path goes to a copy
+      AddChild(split, static_cast<uint8_t>(node->prefix[matched]),
+               CopyNode(node, node->type, node->prefix + matched + 1,
+                        node->prefix_len - matched - 1));
+      Leaf* leaf = NewLeaf(user_key, entry);
+      if (depth + matched == user_key.size()) {
+        split->end.store(leaf, std::memory_order_relaxed);
+      } else {
+        AddChild(split, static_cast<uint8_t>(user_key[depth + matched]), leaf);
+      }
+      node->obsolete.store(true, std::memory_order_relaxed);
+      parent_slot->store(split, std::memory_order_release);
+      *created = true;
+      return leaf;
+    }
+    depth += node->prefix_len;
+
+    if (depth == user_key.size()) {
+      Leaf* leaf = node->end.load(std::memory_order_acquire);
+      if (leaf == nullptr) {
+        std::lock_guard<SpinMutex> lock(node->mutex);
+        if (node->obsolete.load(std::memory_order_relaxed)) {
+          return nullptr;
+        }
+        leaf = node->end.load(std::memory_order_relaxed);
+        if (leaf == nullptr) {
+          leaf = NewLeaf(user_key, entry);
+          node->end.store(leaf, std::memory_order_release);
+          *created = true;
+          return leaf;
+        }
+      }
+      *created = false;
+      return leaf;
+    }
+
+    const uint8_t b = static_cast<uint8_t>(user_key[depth]);
+    std::atomic<Node*>* slot = FindChild(node, b);
+
+    if (slot == nullptr) {
+      // A full node only gets replaced, never emptier, so this can be
+      // checked before locking
+      const bool grow = IsFull(node);
+      std::unique_lock<SpinMutex> parent_lock;
+      if (grow) {
+        assert(parent != nullptr);
+        parent_lock = std::unique_lock<SpinMutex>(parent->mutex);
+        if (parent->obsolete.load(std::memory_order_relaxed) ||
+            parent_slot->load(std::memory_order_relaxed) != node) {
+          return nullptr;
+        }
+      }
+      std::lock_guard<SpinMutex> lock(node->mutex);
+      if (node->obsolete.load(std::memory_order_relaxed) ||
+          IsFull(node) != grow || FindChild(node, b) != nullptr) {
+        return nullptr;
+      }
+      Leaf* leaf = NewLeaf(user_key, entry);
+      if (grow) {
+        InnerNode* bigger =
+            CopyNode(node, static_cast<NodeType>(node->type + 1), node->prefix,
+                     node->prefix_len);
+        AddChild(bigger, b, leaf);
+        node->obsolete.store(true, std::memory_order_relaxed);
+        parent_slot->store(bigger, std::memory_order_release);
+      } else {
+        AddChild(node, b, leaf);
+      }
+      *created = true;
+      return leaf;
+    }
+
+    Node* child = slot->load(std::memory_order_acquire);
+    if (child->type == kLeaf) {
+      Leaf* other = static_cast<Leaf*>(child);
+      if (other->user_key == user_key) {
+        *created = false;
+        return other;
+      }
+      // Replace the leaf by a Node4 holding both keys, with their common
+      // bytes as its prefix
+      std::lock_guard<SpinMutex> lock(node->mutex);
+      if (node->obsolete.load(std::memory_order_relaxed) ||
+          slot->load(std::memory_order_relaxed) != child) {
+        return nullptr;
+      }
+      const Slice& other_key = other->user_key;
+      size_t d = depth + 1;
+      size_t common = 0;
+      while (d + common < user_key.size() && d + common < other_key.size() &&
+             user_key[d + common] == other_key[d + common]) {
+        ++common;
+      }
+      InnerNode* split = NewInnerNode(kNode4, user_key.data() + d,
+                                      static_cast<uint32_t>(common));
+      d += common;
+      Leaf* leaf = NewLeaf(user_key, entry);
+      if (d == other_key.size()) {
+        split->end.store(other, std::memory_order_relaxed);
+      } else {
+        AddChild(split, static_cast<uint8_t>(other_key[d]), other);
+      }
+      if (d == user_key.size()) {
+        split->end.store(leaf, std::memory_order_relaxed);
+      } else {
+        AddChild(split, static_cast<uint8_t>(user_key[d]), leaf);
+      }
+      slot->store(split, std::memory_order_release);
+      *created = true;
+      return leaf;
+    }
+
+    parent = node;
+    parent_slot = slot;
+    node = static_cast<InnerNode*>(child);
+    ++depth;
+  }
+}
+
+bool AdaptiveRadixTreeRep::AddToLeaf(Leaf* leaf, Entry* entry,
+                                     uint64_t trailer) {
+  std::atomic<Entry*>* prev = &leaf->entries;
+  Entry* next = prev->load(std::memory_order_acquire);
+  while (true) {
+    while (next != nullptr) {
+      const uint64_t next_trailer = EntryTrailer(next);
+      if (next_trailer < trailer) {
+        break;
+      }
+      if (next_trailer == trailer) {
+        return false;
+      }
+      prev = &next->next;
+      next = prev->load(std::memory_order_acquire);
+    }
+    entry->next.store(next, std::memory_order_relaxed);
+    // Entries are never removed, so on failure prev still precedes the new
+    // entry and the search resumes from there
+    if (prev->compare_exchange_weak(next, entry, std::memory_order_release,
+                                    std::memory_order_acquire)) {
+      return true;
+    }
+  }
+}
+
+bool AdaptiveRadixTreeRep::InsertKey(KeyHandle handle) {
+  const char* key = static_cast<char*>(handle);
+  Entry* entry = reinterpret_cast<Entry*>(const_cast<char*>(key)) - 1;
+  const Slice internal_key = GetLengthPrefixedSlice(key);
+  const Slice user_key = ExtractUserKey(internal_key);
+
+  Leaf* leaf;
+  bool created = false;
+  while ((leaf = TryAddLeaf(user_key, entry, &created)) == nullptr) {
+  }
+  return created ||
+         AddToLeaf(leaf, entry, ExtractInternalKeyFooter(internal_key));
+}
+
+bool AdaptiveRadixTreeRep::Contains(const char* key) const {
+  const Slice internal_key = GetLengthPrefixedSlice(key);
+  Leaf* leaf = FindLeaf(ExtractUserKey(internal_key));
+  if (leaf == nullptr) {
+    return false;
+  }
+  const uint64_t trailer = ExtractInternalKeyFooter(internal_key);
+  for (Entry* entry = leaf->entries.load(std::memory_order_acquire);
+       entry != nullptr; entry = entry->next.load(std::memory_order_acquire)) {
+    const uint64_t entry_trailer = EntryTrailer(entry);
+    if (entry_trailer <= trailer) {
+      return entry_trailer == trailer;
+    }
+  }
+  return false;
+}
+
+void AdaptiveRadixTreeRep::Get(const LookupKey& k, void* callback_args,
+                               bool (*callback_func)(void* arg,
+                                                     const char* entry)) {
+  Leaf* leaf = FindLeaf(k.user_key());
+  if (leaf == nullptr) {
+    return;
+  }
+  // The callback would stop at the first entry of the next user key, so
+  // there is no need to leave the leaf
+  const uint64_t trailer = ExtractInternalKeyFooter(k.internal_key());
+  for (Entry* entry = leaf->entries.load(std::memory_order_acquire);
+       entry != nullptr; entry = entry->next.load(std::memory_order_acquire)) {
+    if (EntryTrailer(entry) <= trailer &&
+        !callback_func(callback_args, entry->key())) {
+      break;
+    }
+  }
+}
+
+MemTableRep::Iterator* AdaptiveRadixTreeRep::GetIterator(Arena* arena) {
+  void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                    : operator new(sizeof(Iterator));
+  return new (mem) Iterator(this);
+}
+
+void AdaptiveRadixTreeRep::Iterator::Next() {
+  assert(Valid());
+  entry_ = entry_->next.load(std::memory_order_acquire);
+  if (entry_ == nullptr) {
+    NextLeaf();
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::Prev() {
+  assert(Valid());
+  // Entry lists are singly linked, but short
+  Entry* prev = nullptr;
+  for (Entry* entry = leaf_->entries.load(std::memory_order_acquire);
+       entry != entry_; entry = entry->next.load(std::memory_order_acquire)) {
+    prev = entry;
+  }
+  if (prev != nullptr) {
+    entry_ = prev;
+  } else {
+    PrevLeaf();
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::Seek(const Slice& internal_key,
+                                          const char* memtable_key) {
+  const Slice ikey = memtable_key != nullptr
+                         ? GetLengthPrefixedSlice(memtable_key)
+                         : internal_key;
+  const Slice user_key = ExtractUserKey(ikey);
+  const uint64_t trailer = ExtractInternalKeyFooter(ikey);
+
+  stack_.clear();
+  InnerNode* node = rep_->root_;
+  size_t depth = 0;
+  while (true) {
+    for (uint32_t i = 0; i < node->prefix_len; ++i) {
+      if (depth + i == user_key.size() ||
+          static_cast<uint8_t>(user_key[depth + i]) <
+              static_cast<uint8_t>(node->prefix[i])) {
+        // Every key below the node is greater
+        SeekToFirstIn(node);
+        return;
+      }
+      if (user_key[depth + i] != node->prefix[i]) {
+        // Every key below the node is smaller
+        NextLeaf();
+        return;
+      }
+    }
+    depth += node->prefix_len;
+
+    if (depth == user_key.size()) {
+      stack_.push_back({node, -1});
+      Leaf* leaf = node->end.load(std::memory_order_acquire);
+      if (leaf == nullptr) {
+        NextLeaf();
+        return;
+      }
+      leaf_ = leaf;
+      break;
+    }
+
+    const uint8_t b = static_cast<uint8_t>(user_key[depth]);
+    stack_.push_back({node, b});
+    std::atomic<Node*>* slot = FindChild(node, b);
+    if (slot == nullptr) {
+      NextLeaf();
+      return;
+    }
+    Node* child = slot->load(std::memory_order_acquire);
+    if (child->type == kLeaf) {
+      Leaf* leaf = static_cast<Leaf*>(child);
+      const int cmp = leaf->user_key.compare(user_key);
+      if (cmp > 0) {
+        SetFirstEntry(leaf);
+        return;
+      } else if (cmp < 0) {
+        NextLeaf();
+        return;
+      }
+      leaf_ = leaf;
+      break;
+    }
+    node = static_cast<InnerNode*>(child);
+    ++depth;
+  }
+
+  // Found the leaf of the user key: skip the entries newer than the target
+  Entry* entry = leaf_->entries.load(std::memory_order_acquire);
+  while (entry != nullptr && EntryTrailer(entry) > trailer) {
+    entry = entry->next.load(std::memory_order_acquire);
+  }
+  entry_ = entry;
+  if (entry_ == nullptr) {
+    NextLeaf();
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::SeekForPrev(const Slice& internal_key,
+                                                 const char* memtable_key) {
+  const Slice ikey = memtable_key != nullptr
+                         ? GetLengthPrefixedSlice(memtable_key)
+                         : internal_key;
+  Seek(ikey, nullptr);
+  if (!Valid()) {
+    SeekToLast();
+  }
+  while (Valid() && rep_->compare_(entry_->key(), ikey) > 0) {
+    Prev();
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::SeekToFirstIn(InnerNode* node) {
+  while (true) {
+    Leaf* leaf = node->end.load(std::memory_order_acquire);
+    if (leaf != nullptr) {
+      stack_.push_back({node, -1});
+      SetFirstEntry(leaf);
+      return;
+    }
+    uint8_t b;
+    Node* child = NextChild(node, -1, &b);
+    if (child == nullptr) {
+      // Only the root can be empty
+      Invalidate();
+      return;
+    }
+    stack_.push_back({node, b});
+    if (child->type == kLeaf) {
+      SetFirstEntry(static_cast<Leaf*>(child));
+      return;
+    }
+    node = static_cast<InnerNode*>(child);
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::SeekToLastIn(InnerNode* node) {
+  while (true) {
+    uint8_t b;
+    Node* child = PrevChild(node, 256, &b);
+    if (child == nullptr) {
+      Leaf* leaf = node->end.load(std::memory_order_acquire);
+      if (leaf == nullptr) {
+        // Only the root can be empty
+        Invalidate();
+        return;
+      }
+      stack_.push_back({node, -1});
+      SetLastEntry(leaf);
+      return;
+    }
+    stack_.push_back({node, b});
+    if (child->type == kLeaf) {
+      SetLastEntry(static_cast<Leaf*>(child));
+      return;
+    }
+    node = static_cast<InnerNode*>(child);
+  }
+}
+
+void AdaptiveRadixTreeRep::Iterator::NextLeaf() {
+  while (!stack_.empty()) {
+    Frame& frame = stack_.back();
+    uint8_t b;
+    Node* child = NextChild(frame.node, frame.pos, &b);
+    if (child != nullptr) {
+      frame.pos = b;
+      if (child->type == kLeaf) {
+        SetFirstEntry(static_cast<Leaf*>(child));
+      } else {
+        SeekToFirstIn(static_cast<InnerNode*>(child));
+      }
+      return;
+    }
+    stack_.pop_back();
+  }
+  Invalidate();
+}
+
+void AdaptiveRadixTreeRep::Iterator::PrevLeaf() {
+  while (!stack_.empty()) {
+    Frame& frame = stack_.back();
+    if (frame.pos >= 0) {
+      uint8_t b;
+      Node* child = PrevChild(frame.node, frame.pos, &b);
+      if (child != nullptr) {
+        frame.pos = b;
+        if (child->type == kLeaf) {
+          SetLastEntry(static_cast<Leaf*>(child));
+        } else {
+          SeekToLastIn(static_cast<InnerNode*>(child));
+        }
+        return;
+      }
+      Leaf* leaf = frame.node->end.load(std::memory_order_acquire);
+      if (leaf != nullptr) {
+        frame.pos = -1;
+        SetLastEntry(leaf);
+        return;
+      }
+    }
+    stack_.pop_back();
+  }
+  Invalidate();
+}
+
+}  // anon namespace
+
+MemTableRep* AdaptiveRadixTreeRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, Allocator* allocator,
+    const SliceTransform* transform, Logger* logger) {
+  // The tree orders the keys by their bytes
+  if (compare.user_comparator() != BytewiseComparator()) {
+    ROCKS_LOG_WARN(logger,
+                   "AdaptiveRadixTreeRepFactory needs the bytewise comparator, "
+                   "falling back to a skip list memtable");
+    return SkipListFactory().CreateMemTableRep(compare, allocator, transform,
+                                               logger);
+  }
+  return new AdaptiveRadixTreeRep(compare, allocator);
+}
+
+MemTableRepFactory* NewAdaptiveRadixTreeRepFactory() {
+  return new AdaptiveRadixTreeRepFactory();
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,322 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "memtable/art_rep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "memory/concurrent_arena.h"
+#include "port/port.h"
+#include "rocksdb/comparator.h"
+#include "test_util/testharness.h"
+#include "util/coding.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class ArtRepTest : public testing::Test {
+ public:
+  ArtRepTest() : icmp_(BytewiseComparator()), compare_(icmp_), rnd_(301) {}
+
+  std::unique_ptr<MemTableRep> NewRep(Allocator* allocator) {
+    std::unique_ptr<MemTableRepFactory> factory(
+        NewAdaptiveRadixTreeRepFactory());
+    return std::unique_ptr<MemTableRep>(
+        factory->CreateMemTableRep(compare_, allocator, nullptr, nullptr));
+  }
+
+  // Inserts an entry with an empty value through the rep's own allocation
+  static bool Insert(MemTableRep* rep, const Slice& user_key,
+                     SequenceNumber seq, bool concurrently = false) {
+    InternalKey ikey(user_key, seq, kTypeValue);
+    const Slice encoded = ikey.Encode();
+    const size_t encoded_len = VarintLength(encoded.size()) + encoded.size() +
+                               VarintLength(0);
+    char* buf;
+    KeyHandle handle = rep->Allocate(encoded_len, &buf);
+    char* p = EncodeVarint32(buf, static_cast<uint32_t>(encoded.size()));
+    memcpy(p, encoded.data(), encoded.size());
+    EncodeVarint32(p + encoded.size(), 0);
+    return concurrently ? rep->InsertKeyConcurrently(handle)
+                        : rep->InsertKey(handle);
+  }
+
+  static std::string MemtableKey(const Slice& user_key, SequenceNumber seq) {
+    std::string key;
+    PutLengthPrefixedSlice(&key,
+                           InternalKey(user_key, seq, kTypeValue).Encode());
+    return key;
+  }
+
+  // Random keys over a few byte values, so that they share prefixes, are
+  // prefixes of each other and split compressed paths
+  std::string RandomKey() {
+    static const char kBytes[] = {'\0', 'a', 'b', 'c', '\xff'};
+    std::string key = "tenant/";
+    const int len = rnd_.Uniform(12);
+    for (int i = 0; i < len; i++) {
+      key.push_back(kBytes[rnd_.Uniform(sizeof(kBytes))]);
+    }
+    return key;
+  }
+
+  // The internal keys of the entries, in the order of the comparator
+  std::vector<std::string> Sorted() {
+    std::vector<std::string> sorted = model_;
+    std::sort(sorted.begin(), sorted.end(),
+              [this](const std::string& a, const std::string& b) {
+                return icmp_.Compare(a, b) < 0;
+              });
+    return sorted;
+  }
+
+  void InsertAndRecord(MemTableRep* rep, const std::string& user_key,
+                       SequenceNumber seq) {
+    const bool inserted = Insert(rep, user_key, seq);
+    const std::string ikey = InternalKey(user_key, seq, kTypeValue).Encode()
+                                 .ToString();
+    const bool exists =
+        std::find(model_.begin(), model_.end(), ikey) != model_.end();
+    ASSERT_EQ(!exists, inserted);
+    if (inserted) {
+      model_.push_back(ikey);
+    }
+  }
+
+  void VerifyAgainstModel(MemTableRep* rep) {
+    const std::vector<std::string> sorted = Sorted();
+    std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+
+    size_t i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_LT(i, sorted.size());
+      ASSERT_EQ(sorted[i], GetLengthPrefixedSlice(iter->key()).ToString());
+    }
+    ASSERT_EQ(sorted.size(), i);
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_GT(i, 0U);
+      ASSERT_EQ(sorted[--i], GetLengthPrefixedSlice(iter->key()).ToString());
+    }
+    ASSERT_EQ(0U, i);
+
+    for (int n = 0; n < 1000; n++) {
+      const std::string target_user_key = RandomKey();
+      const SequenceNumber target_seq = rnd_.Uniform(4);
+      const std::string target =
+          InternalKey(target_user_key, target_seq, kTypeValue).Encode()
+              .ToString();
+      auto lower = std::lower_bound(
+          sorted.begin(), sorted.end(), target,
+          [this](const std::string& a, const std::string& b) {
+            return icmp_.Compare(a, b) < 0;
+          });
+
+      iter->Seek(target, nullptr);
+      if (lower == sorted.end()) {
+        ASSERT_FALSE(iter->Valid());
+      } else {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(*lower, GetLengthPrefixedSlice(iter->key()).ToString());
+      }
+
+      const std::string memtable_key =
+          MemtableKey(target_user_key, target_seq);
+      iter->SeekForPrev(Slice(), memtable_key.data());
+      auto upper = lower;
+      if (upper != sorted.end() && icmp_.Compare(*upper, target) == 0) {
+        ++upper;
+      }
+      if (upper == sorted.begin()) {
+        ASSERT_FALSE(iter->Valid());
+      } else {
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(*(upper - 1), GetLengthPrefixedSlice(iter->key()).ToString());
+      }
+
+      ASSERT_EQ(lower != sorted.end() && icmp_.Compare(*lower, target) == 0,
+                rep->Contains(memtable_key.data()));
+    }
+  }
+
+  // The sequence numbers of the entries Get() hands out for the key
+  static std::vector<SequenceNumber> GetSeqs(MemTableRep* rep,
+                                             const Slice& user_key,
+                                             SequenceNumber seq) {
+    std::vector<SequenceNumber> seqs;
+    LookupKey lkey(user_key, seq);
+    rep->Get(lkey, &seqs, [](void* arg, const char* entry) {
+      ParsedInternalKey parsed;
+      EXPECT_TRUE(ParseInternalKey(GetLengthPrefixedSlice(entry), &parsed));
+      static_cast<std::vector<SequenceNumber>*>(arg)->push_back(
+          parsed.sequence);
+      return true;
+    });
+    return seqs;
+  }
+
+  InternalKeyComparator icmp_;
+  MemTable::KeyComparator compare_;
+  Random rnd_;
+  std::vector<std::string> model_;
+};
+
+TEST_F(ArtRepTest, RandomKeys) {
+  Arena arena;
+  std::unique_ptr<MemTableRep> rep = NewRep(&arena);
+  VerifyAgainstModel(rep.get());
+  for (int i = 0; i < 5000; i++) {
+    InsertAndRecord(rep.get(), RandomKey(), 1 + rnd_.Uniform(3));
+  }
+  VerifyAgainstModel(rep.get());
+}
+
+TEST_F(ArtRepTest, NodeGrowth) {
+  Arena arena;
+  std::unique_ptr<MemTableRep> rep = NewRep(&arena);
+  // Every node size, and keys ending at every inner node
+  for (int fanout : {1, 4, 5, 16, 17, 48, 49, 256}) {
+    const std::string prefix = "fanout" + ToString(fanout);
+    for (int b = fanout - 1; b >= 0; b--) {
+      InsertAndRecord(rep.get(), prefix + static_cast<char>(b) + "suffix", 1);
+    }
+    InsertAndRecord(rep.get(), prefix, 1);
+    InsertAndRecord(rep.get(), prefix + '\0', 2);
+  }
+  InsertAndRecord(rep.get(), "", 1);
+  InsertAndRecord(rep.get(), "fanout", 1);
+  VerifyAgainstModel(rep.get());
+}
+
+TEST_F(ArtRepTest, Versions) {
+  Arena arena;
+  std::unique_ptr<MemTableRep> rep = NewRep(&arena);
+  for (SequenceNumber seq : {5, 1, 9, 3}) {
+    ASSERT_TRUE(Insert(rep.get(), "key", seq));
+  }
+  ASSERT_TRUE(Insert(rep.get(), "ke", 4));
+  ASSERT_TRUE(Insert(rep.get(), "key1", 4));
+  // Same sequence number and type
+  ASSERT_FALSE(Insert(rep.get(), "key", 5));
+
+  ASSERT_EQ(std::vector<SequenceNumber>({9, 5, 3, 1}),
+            GetSeqs(rep.get(), "key", kMaxSequenceNumber));
+  ASSERT_EQ(std::vector<SequenceNumber>({3, 1}),
+            GetSeqs(rep.get(), "key", 4));
+  ASSERT_TRUE(GetSeqs(rep.get(), "key", 0).empty());
+  ASSERT_TRUE(GetSeqs(rep.get(), "k", kMaxSequenceNumber).empty());
+  ASSERT_TRUE(GetSeqs(rep.get(), "key0", kMaxSequenceNumber).empty());
+
+  ASSERT_TRUE(rep->Contains(MemtableKey("key", 3).data()));
+  ASSERT_FALSE(rep->Contains(MemtableKey("key", 4).data()));
+
+  // Prev() within the entries of a key
+  std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+  iter->SeekToLast();
+  ASSERT_EQ("key1",
+            ExtractUserKey(GetLengthPrefixedSlice(iter->key())).ToString());
+  std::vector<SequenceNumber> seqs;
+  for (iter->Prev(); iter->Valid(); iter->Prev()) {
+    ParsedInternalKey parsed;
+    ASSERT_TRUE(ParseInternalKey(GetLengthPrefixedSlice(iter->key()), &parsed));
+    seqs.push_back(parsed.sequence);
+  }
+  ASSERT_EQ(std::vector<SequenceNumber>({1, 3, 5, 9, 4}), seqs);
+}
+
+TEST_F(ArtRepTest, ConcurrentInserts) {
+  ConcurrentArena arena;
+  std::unique_ptr<MemTableRep> rep = NewRep(&arena);
+  const int kNumThreads = 4;
+  const int kNumKeys = 2000;
+  std::vector<std::string> keys;
+  for (int i = 0; i < kNumKeys; i++) {
+    keys.push_back(RandomKey() + ToString(i));
+  }
+
+  // Every thread inserts its own version of every key, while a reader
+  // keeps checking that the iteration order holds
+  std::atomic<bool> done(false);
+  port::Thread reader([&]() {
+    while (!done.load()) {
+      std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+      const char* prev = nullptr;
+      for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        if (prev != nullptr) {
+          ASSERT_LT(compare_(prev, iter->key()), 0);
+        }
+        prev = iter->key();
+      }
+    }
+  });
+  std::vector<port::Thread> writers;
+  for (int t = 0; t < kNumThreads; t++) {
+    writers.emplace_back([&, t]() {
+      for (int i = 0; i < kNumKeys; i++) {
+        const std::string& key = keys[(i * 7 + t * 13) % kNumKeys];
+        ASSERT_TRUE(Insert(rep.get(), key, 1 + t, true /* concurrently */));
+      }
+    });
+  }
+  for (auto& t : writers) {
+    t.join();
+  }
+  done.store(true);
+  reader.join();
+
+  for (const auto& key : keys) {
+    for (int t = 0; t < kNumThreads; t++) {
+      model_.push_back(InternalKey(key, 1 + t, kTypeValue).Encode().ToString());
+    }
+    ASSERT_EQ(std::vector<SequenceNumber>({4, 3, 2, 1}),
+              GetSeqs(rep.get(), key, kMaxSequenceNumber));
+  }
+  VerifyAgainstModel(rep.get());
+}
+
+TEST_F(ArtRepTest, OtherComparatorFallsBack) {
+  InternalKeyComparator icmp(ReverseBytewiseComparator());
+  MemTable::KeyComparator compare(icmp);
+  std::unique_ptr<MemTableRepFactory> factory(
+      NewAdaptiveRadixTreeRepFactory());
+  Arena arena;
+  std::unique_ptr<MemTableRep> rep(
+      factory->CreateMemTableRep(compare, &arena, nullptr, nullptr));
+  for (const char* key : {"b", "a", "c", "ab"}) {
+    ASSERT_TRUE(Insert(rep.get(), key, 1));
+  }
+
+  // The order of the comparator, not the bytes
+  std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+  std::vector<std::string> keys;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    keys.push_back(
+        ExtractUserKey(GetLengthPrefixedSlice(iter->key())).ToString());
+  }
+  ASSERT_EQ(std::vector<std::string>({"c", "b", "ab", "a"}), keys);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr,
+          "SKIPPED as AdaptiveRadixTreeRep is not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+#endif  // ROCKSDB_LITE
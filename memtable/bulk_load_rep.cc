@@ -0,0 +1,490 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+// A memtable for bulk loading. Writers append to a buffer of their core
+// without ordering anything, and the entries are only sorted once the
+// memtable turns read-only, in parallel and in the background on the flush
+// pool of the Env, so that the sort is done or well under way when the flush
+// starts iterating.
+//
+// Point lookups on the memtable, including before it is sorted, are served
+// by a hash index over the user keys kept by every buffer.
+
+#ifndef ROCKSDB_LITE
+#include "memtable/bulk_load_rep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "memtable/stl_wrappers.h"
+#include "port/port.h"
+#include "rocksdb/comparator.h"
+#include "util/autovector.h"
+#include "util/core_local.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+#include "util/run_in_parallel.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// Below this many entries per thread a parallel sort does not pay off
+const size_t kMinEntriesPerSortThread = 16 << 10;
+
+// Number of splitter candidates taken from every chunk, per thread
+const size_t kSamplesPerThread = 32;
+
+// The pool sorts run on. They hold up flushes, so they go to the flush pool
+// unless it has no threads, in which case flushes run on the LOW pool too.
+Env::Priority SortPriority(Env* env) {
+  return env->GetBackgroundThreads(Env::Priority::HIGH) > 0
+             ? Env::Priority::HIGH
+             : Env::Priority::LOW;
+}
+
+}  // namespace
+
+void ParallelSortEntries(std::vector<const char*>* entries,
+                         const MemTableRep::KeyComparator& compare,
+                         size_t num_threads, Env* env) {
+  const stl_wrappers::Compare less(compare);
+  const size_t n = entries->size();
+  num_threads = std::min(num_threads, n / kMinEntriesPerSortThread);
+  if (num_threads <= 1) {
+    std::sort(entries->begin(), entries->end(), less);
+    return;
+  }
+
+  // Sort one chunk per thread
+  std::vector<size_t> bounds(num_threads + 1);
+  for (size_t c = 0; c <= num_threads; ++c) {
+    bounds[c] = n * c / num_threads;
+  }
+  const auto begin = entries->begin();
+  RunInParallel(env, SortPriority(env), num_threads, [&](size_t c) {
+    std::sort(begin + bounds[c], begin + bounds[c + 1], less);
+  });
+
+  // Thread t merges the entries from splitters[t - 1] up to splitters[t]
+  const size_t samples_per_chunk = kSamplesPerThread * num_threads;
+  std::vector<const char*> samples;
+  samples.reserve(samples_per_chunk * num_threads);
+  for (size_t c = 0; c < num_threads; ++c) {
+    const size_t chunk_size = bounds[c + 1] - bounds[c];
+    for (size_t s = 0; s < samples_per_chunk; ++s) {
+      samples.push_back(
+          (*entries)[bounds[c] + chunk_size * s / samples_per_chunk]);
+    }
+  }
+  std::sort(samples.begin(), samples.end(), less);
+
+  // cuts[t][c] is where the part of chunk c merged by thread t starts
+  std::vector<std::vector<size_t>> cuts(num_threads + 1,
+                                        std::vector<size_t>(num_threads));
+  for (size_t c = 0; c < num_threads; ++c) {
+    cuts[0][c] = bounds[c];
+    cuts[num_threads][c] = bounds[c + 1];
+    for (size_t t = 1; t < num_threads; ++t) {
+      const char* splitter = samples[samples.size() * t / num_threads];
+      cuts[t][c] = std::lower_bound(begin + cuts[t - 1][c],
+                                    begin + bounds[c + 1], splitter, less) -
+                   begin;
+    }
+  }
+
+  std::vector<const char*> output(n);
+  RunInParallel(env, SortPriority(env), num_threads, [&](size_t t) {
+    size_t out = 0;
+    for (size_t c = 0; c < num_threads; ++c) {
+      out += cuts[t][c] - bounds[c];
+    }
+    // The next position and the end of every chunk, smallest key on top
+    typedef std::pair<size_t, size_t> Cursor;
+    auto greater = [&](const Cursor& a, const Cursor& b) {
+      return less((*entries)[b.first], (*entries)[a.first]);
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(
+        greater);
+    for (size_t c = 0; c < num_threads; ++c) {
+      if (cuts[t][c] < cuts[t + 1][c]) {
+        heap.push(Cursor(cuts[t][c], cuts[t + 1][c]));
+      }
+    }
+    while (!heap.empty()) {
+      Cursor cursor = heap.top();
+      heap.pop();
+      output[out++] = (*entries)[cursor.first];
+      if (++cursor.first < cursor.second) {
+        heap.push(cursor);
+      }
+    }
+  });
+  entries->swap(output);
+}
+
+namespace {
+
+typedef std::vector<const char*> Entries;
+
+class SortedEntriesIterator : public MemTableRep::Iterator {
+ public:
+  SortedEntriesIterator(std::shared_ptr<Entries> entries,
+                        const MemTableRep::KeyComparator& compare)
+      : entries_(std::move(entries)), compare_(compare) {
+    pos_ = entries_->size();
+  }
+
+  ~SortedEntriesIterator() override {}
+
+  bool Valid() const override { return pos_ < entries_->size(); }
+
+  const char* key() const override {
+    assert(Valid());
+    return (*entries_)[pos_];
+  }
+
+  void Next() override {
+    assert(Valid());
+    ++pos_;
+  }
+
+  void Prev() override {
+    assert(Valid());
+    pos_ = pos_ == 0 ? entries_->size() : pos_ - 1;
+  }
+
+  void Seek(const Slice& internal_key, const char* memtable_key) override {
+    const char* target = memtable_key != nullptr
+                             ? memtable_key
+                             : EncodeKey(&tmp_, internal_key);
+    pos_ = std::lower_bound(entries_->begin(), entries_->end(), target,
+                            stl_wrappers::Compare(compare_)) -
+           entries_->begin();
+  }
+
+  void SeekForPrev(const Slice& internal_key,
+                   const char* memtable_key) override {
+    const char* target = memtable_key != nullptr
+                             ? memtable_key
+                             : EncodeKey(&tmp_, internal_key);
+    pos_ = std::upper_bound(entries_->begin(), entries_->end(), target,
+                            stl_wrappers::Compare(compare_)) -
+           entries_->begin();
+    pos_ = pos_ == 0 ? entries_->size() : pos_ - 1;
+  }
+
+  void SeekToFirst() override { pos_ = 0; }
+
+  void SeekToLast() override {
+    pos_ = entries_->empty() ? 0 : entries_->size() - 1;
+  }
+
+ private:
+  std::shared_ptr<Entries> entries_;
+  const MemTableRep::KeyComparator& compare_;
+  size_t pos_;
+  std::string tmp_;  // For passing to EncodeKey
+};
+
+class BulkLoadRep : public MemTableRep {
+ public:
+  BulkLoadRep(const KeyComparator& compare, Allocator* allocator,
+              size_t ts_sz, size_t sort_threads, Env* env);
+
+  ~BulkLoadRep() override;
+
+  void Insert(KeyHandle handle) override;
+
+  // Writers on different cores never share a buffer
+  void InsertConcurrently(KeyHandle handle) override { Insert(handle); }
+
+  bool Contains(const char* key) const override;
+
+  void MarkReadOnly() override;
+
+  size_t ApproximateMemoryUsage() override {
+    // Per entry: a pointer in its buffer, a chain link and about one bucket
+    // of the hash index, and a pointer in the sorted array
+    return num_entries_.load(std::memory_order_relaxed) *
+           (2 * sizeof(const char*) + 2 * sizeof(uint32_t));
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  MemTableRep::Iterator* GetIterator(Arena* arena) override;
+
+ private:
+  // The entries appended by the threads running on one core
+  struct Buffer {
+    SpinMutex mutex;
+    Entries entries;
+    // Hash index over the user keys of the entries. A bucket holds the
+    // position + 1 of its newest entry and chain[i] the position + 1 of the
+    // next older entry in the bucket of entry i; 0 ends a chain.
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> chain;
+  };
+
+  // The part of the user key that is hashed; timestamps are left out, since
+  // lookups don't know the timestamp of the entries they look for
+  Slice IndexedKey(const char* key) const {
+    return StripTimestampFromUserKey(UserKey(key), ts_sz_);
+  }
+
+  // Adds the last entry of the buffer to its index. Requires buffer->mutex.
+  void AddToIndex(Buffer* buffer, uint32_t hash);
+
+  // Calls fn on every entry of the buffers that has the same indexed key as
+  // the one given, until fn returns false
+  void FindEntries(const Slice& indexed_key,
+                   const std::function<bool(const char*)>& fn) const;
+
+  void CollectEntries(Entries* entries) const;
+
+  // Sorts all the entries into sorted_
+  void Sort();
+
+  // Waits for the background sort scheduled by MarkReadOnly(), or sorts if
+  // no pool thread has started it
+  void EnsureSorted();
+
+  enum SortState { kPending, kRunning, kDone };
+
+  // Shared with the pool thread scheduled for the sort, which may only get
+  // to run after the sort was done by a reader or the rep was destroyed, and
+  // must then find nothing left to do
+  struct SortJob {
+    SortJob() : cv(&mu) {}
+
+    BulkLoadRep* rep = nullptr;
+    port::Mutex mu;
+    port::CondVar cv;
+    // Guarded by mu
+    SortState state = kPending;
+    bool scheduled = false;
+  };
+
+  // Sorts unless a thread already did or is doing it. Requires job->mu.
+  static void RunSortJob(SortJob* job);
+
+  static void BGSort(void* arg);
+
+  const KeyComparator& compare_;
+  const size_t ts_sz_;
+  const size_t sort_threads_;
+  Env* const env_;
+  CoreLocalArray<Buffer> buffers_;
+  std::atomic<size_t> num_entries_;
+  std::atomic<bool> immutable_;
+
+  std::shared_ptr<SortJob> sort_job_;
+  // All the entries in order, once read-only and sorted
+  std::shared_ptr<Entries> sorted_;
+};
+
+BulkLoadRep::BulkLoadRep(const KeyComparator& compare, Allocator* allocator,
+                         size_t ts_sz, size_t sort_threads, Env* env)
+    : MemTableRep(allocator),
+      compare_(compare),
+      ts_sz_(ts_sz),
+      sort_threads_(sort_threads),
+      env_(env),
+      num_entries_(0),
+      immutable_(false),
+      sort_job_(std::make_shared<SortJob>()) {
+  sort_job_->rep = this;
+}
+
+BulkLoadRep::~BulkLoadRep() {
+  MutexLock l(&sort_job_->mu);
+  // Nobody needs the sorted entries any more
+  if (sort_job_->state == kPending) {
+    sort_job_->state = kDone;
+  }
+  while (sort_job_->state != kDone) {
+    sort_job_->cv.Wait();
+  }
+}
+
+void BulkLoadRep::Insert(KeyHandle handle) {
+  const char* key = static_cast<char*>(handle);
+  assert(!immutable_.load(std::memory_order_relaxed));
+  const uint32_t hash = GetSliceHash(IndexedKey(key));
+  Buffer* buffer = buffers_.Access();
+  {
+    std::lock_guard<SpinMutex> lock(buffer->mutex);
+    buffer->entries.push_back(key);
+    AddToIndex(buffer, hash);
+  }
+  num_entries_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BulkLoadRep::AddToIndex(Buffer* buffer, uint32_t hash) {
+  const size_t n = buffer->entries.size();
+  if (n > buffer->buckets.size()) {
+    // Keep at most one entry per bucket on average
+    buffer->buckets.assign(std::max<size_t>(256, buffer->buckets.size() * 2),
+                           0);
+    buffer->chain.resize(n);
+    const size_t mask = buffer->buckets.size() - 1;
+    for (size_t i = 0; i < n; ++i) {
+      const uint32_t h =
+          i + 1 == n ? hash : GetSliceHash(IndexedKey(buffer->entries[i]));
+      uint32_t& head = buffer->buckets[h & mask];
+      buffer->chain[i] = head;
+      head = static_cast<uint32_t>(i + 1);
+    }
+    return;
+  }
+  uint32_t& head = buffer->buckets[hash & (buffer->buckets.size() - 1)];
+  buffer->chain.push_back(head);
+  head = static_cast<uint32_t>(n);
+}
+
+void BulkLoadRep::FindEntries(
+    const Slice& indexed_key,
+    const std::function<bool(const char*)>& fn) const {
+  const uint32_t hash = GetSliceHash(indexed_key);
+  for (size_t i = 0; i < buffers_.Size(); ++i) {
+    Buffer* buffer = buffers_.AccessAtCore(i);
+    std::lock_guard<SpinMutex> lock(buffer->mutex);
+    if (buffer->buckets.empty()) {
+      continue;
+    }
+    for (uint32_t pos = buffer->buckets[hash & (buffer->buckets.size() - 1)];
+         pos != 0; pos = buffer->chain[pos - 1]) {
+      const char* key = buffer->entries[pos - 1];
+      if (IndexedKey(key) == indexed_key && !fn(key)) {
+        return;
+      }
+    }
+  }
+}
+
+bool BulkLoadRep::Contains(const char* key) const {
+  bool found = false;
+  FindEntries(IndexedKey(key), [&](const char* entry) {
+    found = compare_(entry, key) == 0;
+    return !found;
+  });
+  return found;
+}
+
+void BulkLoadRep::Get(const LookupKey& k, void* callback_args,
+                      bool (*callback_func)(void* arg, const char* entry)) {
+  const Slice target = k.internal_key();
+  autovector<const char*> entries;
+  FindEntries(StripTimestampFromUserKey(k.user_key(), ts_sz_),
+              [&](const char* entry) {
+                if (compare_(entry, target) >= 0) {
+                  entries.push_back(entry);
+                }
+                return true;
+              });
+  std::sort(entries.begin(), entries.end(), stl_wrappers::Compare(compare_));
+  for (const char* entry : entries) {
+    if (!callback_func(callback_args, entry)) {
+      break;
+    }
+  }
+}
+
+void BulkLoadRep::CollectEntries(Entries* entries) const {
+  entries->reserve(num_entries_.load(std::memory_order_relaxed));
+  for (size_t i = 0; i < buffers_.Size(); ++i) {
+    Buffer* buffer = buffers_.AccessAtCore(i);
+    std::lock_guard<SpinMutex> lock(buffer->mutex);
+    entries->insert(entries->end(), buffer->entries.begin(),
+                    buffer->entries.end());
+  }
+}
+
+void BulkLoadRep::Sort() {
+  std::shared_ptr<Entries> entries(new Entries());
+  CollectEntries(entries.get());
+  ParallelSortEntries(entries.get(), compare_, sort_threads_, env_);
+  sorted_ = entries;
+}
+
+void BulkLoadRep::RunSortJob(SortJob* job) {
+  if (job->state != kPending) {
+    return;
+  }
+  job->state = kRunning;
+  job->mu.Unlock();
+  job->rep->Sort();
+  job->mu.Lock();
+  job->state = kDone;
+  job->cv.SignalAll();
+}
+
+void BulkLoadRep::BGSort(void* arg) {
+  std::unique_ptr<std::shared_ptr<SortJob>> job_ptr(
+      static_cast<std::shared_ptr<SortJob>*>(arg));
+  SortJob* job = job_ptr->get();
+  MutexLock l(&job->mu);
+  RunSortJob(job);
+}
+
+void BulkLoadRep::MarkReadOnly() {
+  immutable_.store(true, std::memory_order_release);
+  MutexLock l(&sort_job_->mu);
+  if (!sort_job_->scheduled && sort_job_->state == kPending) {
+    sort_job_->scheduled = true;
+    env_->Schedule(&BulkLoadRep::BGSort,
+                   new std::shared_ptr<SortJob>(sort_job_),
+                   SortPriority(env_));
+  }
+}
+
+void BulkLoadRep::EnsureSorted() {
+  MutexLock l(&sort_job_->mu);
+  RunSortJob(sort_job_.get());
+  while (sort_job_->state != kDone) {
+    sort_job_->cv.Wait();
+  }
+}
+
+MemTableRep::Iterator* BulkLoadRep::GetIterator(Arena* arena) {
+  std::shared_ptr<Entries> entries;
+  if (immutable_.load(std::memory_order_acquire)) {
+    EnsureSorted();
+    entries = sorted_;
+  } else {
+    // Sort a snapshot of the entries
+    entries.reset(new Entries());
+    CollectEntries(entries.get());
+    ParallelSortEntries(entries.get(), compare_, sort_threads_, env_);
+  }
+  void* mem = arena ? arena->AllocateAligned(sizeof(SortedEntriesIterator))
+                    : operator new(sizeof(SortedEntriesIterator));
+  return new (mem) SortedEntriesIterator(std::move(entries), compare_);
+}
+
+}  // anon namespace
+
+MemTableRep* BulkLoadRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, Allocator* allocator,
+    const SliceTransform* /*transform*/, Logger* /*logger*/) {
+  const Comparator* ucmp = compare.user_comparator();
+  return new BulkLoadRep(compare, allocator,
+                         ucmp != nullptr ? ucmp->timestamp_size() : 0,
+                         sort_threads_, env_);
+}
+
+MemTableRepFactory* NewBulkLoadRepFactory(size_t sort_threads, Env* env) {
+  return new BulkLoadRepFactory(sort_threads, env);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
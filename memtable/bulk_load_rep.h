@@ -0,0 +1,49 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "rocksdb/memtablerep.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class BulkLoadRepFactory : public MemTableRepFactory {
+ public:
+  explicit BulkLoadRepFactory(size_t sort_threads, Env* env = nullptr)
+      : sort_threads_(sort_threads > 0 ? sort_threads : 1),
+        env_(env != nullptr ? env : Env::Default()) {}
+
+  virtual ~BulkLoadRepFactory() {}
+
+  using MemTableRepFactory::CreateMemTableRep;
+  virtual MemTableRep* CreateMemTableRep(
+      const MemTableRep::KeyComparator& compare, Allocator* allocator,
+      const SliceTransform* transform, Logger* logger) override;
+
+  virtual const char* Name() const override { return "BulkLoadRepFactory"; }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+
+ private:
+  const size_t sort_threads_;
+  Env* const env_;
+};
+
+// Sorts the entries with up to num_threads threads: the calling one and
+// threads of the HIGH pool of env, or of its LOW pool when the HIGH pool has
+// no threads. The array is cut into one chunk per thread, the chunks are
+// sorted in parallel and then merged in parallel, every thread producing the
+// range of the output between two splitter keys sampled from the chunks.
+// The calling thread runs the parts no pool thread has started, so the sort
+// finishes even if the pool is busy.
+extern void ParallelSortEntries(std::vector<const char*>* entries,
+                                const MemTableRep::KeyComparator& compare,
+                                size_t num_threads, Env* env);
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,254 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#ifndef ROCKSDB_LITE
+#include "memtable/bulk_load_rep.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+// Keeps the scheduled jobs instead of running them, until RunJobs()
+class DeferredEnv : public EnvWrapper {
+ public:
+  DeferredEnv() : EnvWrapper(Env::Default()) {}
+
+  ~DeferredEnv() override { RunJobs(); }
+
+  void Schedule(void (*function)(void* arg), void* arg, Priority /*pri*/,
+                void* /*tag*/ = nullptr,
+                void (*/*unschedFunction*/)(void* arg) = nullptr) override {
+    jobs_.emplace_back(function, arg);
+  }
+
+  int GetBackgroundThreads(Priority /*pri*/) override { return 1; }
+
+  size_t NumJobs() const { return jobs_.size(); }
+
+  void RunJobs() {
+    std::vector<std::pair<void (*)(void*), void*>> jobs;
+    jobs.swap(jobs_);
+    for (auto& job : jobs) {
+      job.first(job.second);
+    }
+  }
+
+ private:
+  std::vector<std::pair<void (*)(void*), void*>> jobs_;
+};
+
+// Returns a memtable entry with an empty value
+const char* EncodeEntry(Arena* arena, const Slice& user_key,
+                        SequenceNumber seq) {
+  std::string entry;
+  InternalKey ikey(user_key, seq, kTypeValue);
+  PutLengthPrefixedSlice(&entry, ikey.Encode());
+  PutVarint32(&entry, 0);
+  char* buf = arena->Allocate(entry.size());
+  memcpy(buf, entry.data(), entry.size());
+  return buf;
+}
+
+ParsedInternalKey DecodeEntry(const char* entry) {
+  ParsedInternalKey parsed;
+  EXPECT_TRUE(ParseInternalKey(GetLengthPrefixedSlice(entry), &parsed));
+  return parsed;
+}
+
+std::string Key(int i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "key%08d", i);
+  return buf;
+}
+
+}  // namespace
+
+class BulkLoadRepTest : public testing::Test {
+ public:
+  BulkLoadRepTest()
+      : icmp_(BytewiseComparator()), compare_(icmp_), rnd_(301) {}
+
+  // Entries of num_keys keys in random order, two versions of each
+  std::vector<const char*> NewEntries(int num_keys) {
+    std::vector<const char*> entries;
+    for (int i = 0; i < num_keys; i++) {
+      for (SequenceNumber seq = 1; seq <= 2; seq++) {
+        entries.push_back(EncodeEntry(&arena_, Key(i), seq));
+      }
+    }
+    std::shuffle(entries.begin(), entries.end(), rnd_);
+    return entries;
+  }
+
+  void AssertSorted(const std::vector<const char*>& entries,
+                    size_t expected_size) {
+    ASSERT_EQ(expected_size, entries.size());
+    for (size_t i = 1; i < entries.size(); i++) {
+      ASSERT_LT(compare_(entries[i - 1], entries[i]), 0);
+    }
+  }
+
+  std::unique_ptr<MemTableRep> NewRep(Env* env) {
+    std::unique_ptr<MemTableRepFactory> factory(
+        NewBulkLoadRepFactory(2, env));
+    return std::unique_ptr<MemTableRep>(
+        factory->CreateMemTableRep(compare_, &arena_, nullptr, nullptr));
+  }
+
+  void InsertKeys(MemTableRep* rep, int num_keys) {
+    for (const char* entry : NewEntries(num_keys)) {
+      rep->Insert(const_cast<char*>(entry));
+    }
+  }
+
+  // The sequence numbers of the entries Get() hands out for the key
+  std::vector<SequenceNumber> GetSeqs(MemTableRep* rep, int i) {
+    std::vector<SequenceNumber> seqs;
+    LookupKey lkey(Key(i), kMaxSequenceNumber);
+    rep->Get(lkey, &seqs, [](void* arg, const char* entry) {
+      ParsedInternalKey parsed = DecodeEntry(entry);
+      static_cast<std::vector<SequenceNumber>*>(arg)->push_back(
+          parsed.sequence);
+      return true;
+    });
+    return seqs;
+  }
+
+  void AssertIteratesInOrder(MemTableRep* rep, size_t expected_size) {
+    std::unique_ptr<MemTableRep::Iterator> iter(rep->GetIterator(nullptr));
+    std::vector<const char*> entries;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      entries.push_back(iter->key());
+    }
+    AssertSorted(entries, expected_size);
+  }
+
+  InternalKeyComparator icmp_;
+  MemTable::KeyComparator compare_;
+  Arena arena_;
+  std::mt19937 rnd_;
+};
+
+TEST_F(BulkLoadRepTest, ParallelSortOnPool) {
+  Env* env = Env::Default();
+  env->SetBackgroundThreads(4, Env::Priority::HIGH);
+  // Large enough for every thread to get a chunk
+  const int kNumKeys = 64 << 10;
+  for (size_t threads : {1, 2, 3, 4, 7}) {
+    std::vector<const char*> entries = NewEntries(kNumKeys);
+    ParallelSortEntries(&entries, compare_, threads, env);
+    AssertSorted(entries, 2 * kNumKeys);
+  }
+}
+
+TEST_F(BulkLoadRepTest, ParallelSortWithoutPoolThreads) {
+  // No pool thread gets to run before the sort is over, so the calling
+  // thread sorts and merges every chunk
+  DeferredEnv env;
+  const int kNumKeys = 64 << 10;
+  std::vector<const char*> entries = NewEntries(kNumKeys);
+  ParallelSortEntries(&entries, compare_, 4, &env);
+  AssertSorted(entries, 2 * kNumKeys);
+  ASSERT_EQ(6U, env.NumJobs());
+  // The late jobs find nothing left to do
+  env.RunJobs();
+}
+
+TEST_F(BulkLoadRepTest, LookupWhileUnsorted) {
+  DeferredEnv env;
+  std::unique_ptr<MemTableRep> rep = NewRep(&env);
+  const int kNumKeys = 1000;
+  InsertKeys(rep.get(), kNumKeys);
+
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(std::vector<SequenceNumber>({2, 1}), GetSeqs(rep.get(), i));
+  }
+  ASSERT_TRUE(GetSeqs(rep.get(), kNumKeys).empty());
+  ASSERT_TRUE(rep->Contains(EncodeEntry(&arena_, Key(3), 2)));
+  ASSERT_FALSE(rep->Contains(EncodeEntry(&arena_, Key(3), 3)));
+
+  // The sort is scheduled but no pool thread has run it
+  rep->MarkReadOnly();
+  ASSERT_EQ(1U, env.NumJobs());
+  for (int i = 0; i < kNumKeys; i++) {
+    ASSERT_EQ(std::vector<SequenceNumber>({2, 1}), GetSeqs(rep.get(), i));
+  }
+}
+
+TEST_F(BulkLoadRepTest, SortOnPool) {
+  DeferredEnv env;
+  std::unique_ptr<MemTableRep> rep = NewRep(&env);
+  const int kNumKeys = 1000;
+  InsertKeys(rep.get(), kNumKeys);
+  rep->MarkReadOnly();
+  rep->MarkReadOnly();
+  ASSERT_EQ(1U, env.NumJobs());
+  env.RunJobs();
+  AssertIteratesInOrder(rep.get(), 2 * kNumKeys);
+}
+
+TEST_F(BulkLoadRepTest, IteratorSortsBeforePool) {
+  DeferredEnv env;
+  std::unique_ptr<MemTableRep> rep = NewRep(&env);
+  const int kNumKeys = 1000;
+  InsertKeys(rep.get(), kNumKeys);
+  rep->MarkReadOnly();
+  // The iterator sorts on its own thread, and the pool thread finds the
+  // sort done
+  AssertIteratesInOrder(rep.get(), 2 * kNumKeys);
+  env.RunJobs();
+  AssertIteratesInOrder(rep.get(), 2 * kNumKeys);
+}
+
+TEST_F(BulkLoadRepTest, DestroyedBeforeSort) {
+  DeferredEnv env;
+  std::unique_ptr<MemTableRep> rep = NewRep(&env);
+  InsertKeys(rep.get(), 100);
+  rep->MarkReadOnly();
+  rep.reset();
+  // The scheduled sort must not touch the destroyed rep
+  env.RunJobs();
+}
+
+TEST_F(BulkLoadRepTest, IterateMutable) {
+  DeferredEnv env;
+  std::unique_ptr<MemTableRep> rep = NewRep(&env);
+  const int kNumKeys = 1000;
+  InsertKeys(rep.get(), kNumKeys);
+  AssertIteratesInOrder(rep.get(), 2 * kNumKeys);
+  // More entries after the snapshot was sorted
+  rep->Insert(const_cast<char*>(EncodeEntry(&arena_, Key(kNumKeys), 1)));
+  AssertIteratesInOrder(rep.get(), 2 * kNumKeys + 1);
+  ASSERT_EQ(0U, env.NumJobs());
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#else
+#include <stdio.h>
+
+int main(int /*argc*/, char** /*argv*/) {
+  fprintf(stderr, "SKIPPED as BulkLoadRep is not supported in ROCKSDB_LITE\n");
+  return 0;
+}
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,268 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+//
+
+#ifndef ROCKSDB_LITE
+#include "memtable/hash_indexed_skiplist_rep.h"
+
+#include <atomic>
+
+#include "db/memtable.h"
+#include "memory/arena.h"
+#include "memtable/inlineskiplist.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/slice.h"
+#include "util/murmurhash.h"
+
+namespace ROCKSDB_NAMESPACE {
+namespace {
+
+// Keeps all the entries in a concurrent skip list, which serves the
+// iterators and the flush, and indexes them by user key in a hash table for
+// point lookups.
+//
+// Every bucket of the hash table is a singly linked list of the entries
+// whose user key hashes to it, sorted by internal key, so the versions of a
+// user key are adjacent and newest first. Links are only ever inserted, with
+// a CAS on the predecessor, which makes the lists safe for concurrent inserts
+// and lock-free for readers.
+class HashIndexedSkipListRep : public MemTableRep {
+ public:
+  HashIndexedSkipListRep(const MemTableRep::KeyComparator& compare,
+                         Allocator* allocator, size_t bucket_size);
+
+  KeyHandle Allocate(const size_t len, char** buf) override {
+    *buf = skip_list_.AllocateKey(len);
+    return static_cast<KeyHandle>(*buf);
+  }
+
+  void Insert(KeyHandle handle) override { InsertKey(handle); }
+
+  bool InsertKey(KeyHandle handle) override;
+
+  void InsertWithHint(KeyHandle handle, void** hint) override {
+    InsertKeyWithHint(handle, hint);
+  }
+
+  bool InsertKeyWithHint(KeyHandle handle, void** hint) override;
+
+  void InsertWithHintConcurrently(KeyHandle handle, void** hint) override {
+    InsertKeyWithHintConcurrently(handle, hint);
+  }
+
+  bool InsertKeyWithHintConcurrently(KeyHandle handle, void** hint) override;
+
+  void InsertConcurrently(KeyHandle handle) override {
+    InsertKeyConcurrently(handle);
+  }
+
+  bool InsertKeyConcurrently(KeyHandle handle) override;
+
+  bool Contains(const char* key) const override;
+
+  size_t ApproximateMemoryUsage() override {
+    // All memory is allocated through allocator; nothing to report here
+    return 0;
+  }
+
+  void Get(const LookupKey& k, void* callback_args,
+           bool (*callback_func)(void* arg, const char* entry)) override;
+
+  uint64_t ApproximateNumEntries(const Slice& start_ikey,
+                                 const Slice& end_ikey) override;
+
+  ~HashIndexedSkipListRep() override {}
+
+  MemTableRep::Iterator* GetIterator(Arena* arena = nullptr) override;
+
+ private:
+  typedef InlineSkipList<const MemTableRep::KeyComparator&> List;
+
+  struct Link {
+    std::atomic<Link*> next;
+    const char* key;
+  };
+
+  size_t GetHash(const Slice& user_key) const {
+    return MurmurHash(user_key.data(), static_cast<int>(user_key.size()), 0) %
+           bucket_size_;
+  }
+
+  // Returns the first link of the bucket with a key >= key
+  Link* FindGreaterOrEqual(const char* key) const;
+
+  void AddToIndex(const char* key);
+
+  List skip_list_;
+  const MemTableRep::KeyComparator& compare_;
+  size_t bucket_size_;
+  std::atomic<Link*>* buckets_;
+
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    explicit Iterator(const List* list) : iter_(list) {}
+
+    ~Iterator() override {}
+
+    bool Valid() const override { return iter_.Valid(); }
+
+    const char* key() const override { return iter_.key(); }
+
+    void Next() override { iter_.Next(); }
+
+    void Prev() override { iter_.Prev(); }
+
+    void Seek(const Slice& user_key, const char* memtable_key) override {
+      if (memtable_key != nullptr) {
+        iter_.Seek(memtable_key);
+      } else {
+        iter_.Seek(EncodeKey(&tmp_, user_key));
+      }
+    }
+
+    void SeekForPrev(const Slice& user_key, const char* memtable_key) override {
+      if (memtable_key != nullptr) {
+        iter_.SeekForPrev(memtable_key);
+      } else {
+        iter_.SeekForPrev(EncodeKey(&tmp_, user_key));
+      }
+    }
+
+    void SeekToFirst() override { iter_.SeekToFirst(); }
+
+    void SeekToLast() override { iter_.SeekToLast(); }
+
+   private:
+    List::Iterator iter_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+};
+
+HashIndexedSkipListRep::HashIndexedSkipListRep(
+    const MemTableRep::KeyComparator& compare, Allocator* allocator,
+    size_t bucket_size)
+    : MemTableRep(allocator),
+      skip_list_(compare, allocator),
+      compare_(compare),
+      bucket_size_(bucket_size > 0 ? bucket_size : 1) {
+  auto mem =
+      allocator->AllocateAligned(sizeof(std::atomic<Link*>) * bucket_size_);
+  buckets_ = new (mem) std::atomic<Link*>[bucket_size_];
+
+  for (size_t i = 0; i < bucket_size_; ++i) {
+    buckets_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+bool HashIndexedSkipListRep::InsertKey(KeyHandle handle) {
+  const char* key = static_cast<char*>(handle);
+  if (!skip_list_.Insert(key)) {
+    return false;
+  }
+  AddToIndex(key);
+  return true;
+}
+
+bool HashIndexedSkipListRep::InsertKeyWithHint(KeyHandle handle, void** hint) {
+  const char* key = static_cast<char*>(handle);
+  if (!skip_list_.InsertWithHint(key, hint)) {
+    return false;
+  }
+  AddToIndex(key);
+  return true;
+}
+
+bool HashIndexedSkipListRep::InsertKeyWithHintConcurrently(KeyHandle handle,
+                                                           void** hint) {
+  const char* key = static_cast<char*>(handle);
+  if (!skip_list_.InsertWithHintConcurrently(key, hint)) {
+    return false;
+  }
+  AddToIndex(key);
+  return true;
+}
+
+bool HashIndexedSkipListRep::InsertKeyConcurrently(KeyHandle handle) {
+  const char* key = static_cast<char*>(handle);
+  if (!skip_list_.InsertConcurrently(key)) {
+    return false;
+  }
+  AddToIndex(key);
+  return true;
+}
+
+void HashIndexedSkipListRep::AddToIndex(const char* key) {
+  auto mem = allocator_->AllocateAligned(sizeof(Link));
+  Link* link = new (mem) Link;
+  link->key = key;
+  std::atomic<Link*>* prev = &buckets_[GetHash(UserKey(key))];
+  Link* next = prev->load(std::memory_order_acquire);
+  while (true) {
+    while (next != nullptr && compare_(next->key, key) < 0) {
+      prev = &next->next;
+      next = prev->load(std::memory_order_acquire);
+    }
+    link->next.store(next, std::memory_order_relaxed);
+    // Links are never removed, so on failure prev still precedes the key
+    // and the search resumes from there
+    if (prev->compare_exchange_weak(next, link, std::memory_order_release,
+                                    std::memory_order_acquire)) {
+      return;
+    }
+  }
+}
+
+HashIndexedSkipListRep::Link* HashIndexedSkipListRep::FindGreaterOrEqual(
+    const char* key) const {
+  Link* link = buckets_[GetHash(UserKey(key))].load(std::memory_order_acquire);
+  while (link != nullptr && compare_(link->key, key) < 0) {
+    link = link->next.load(std::memory_order_acquire);
+  }
+  return link;
+}
+
+bool HashIndexedSkipListRep::Contains(const char* key) const {
+  Link* link = FindGreaterOrEqual(key);
+  return link != nullptr && compare_(link->key, key) == 0;
+}
+
+void HashIndexedSkipListRep::Get(const LookupKey& k, void* callback_args,
+                                 bool (*callback_func)(void* arg,
+                                                       const char* entry)) {
+  // Entries of other user keys in the bucket make the callback stop
+  for (Link* link = FindGreaterOrEqual(k.memtable_key().data());
+       link != nullptr && callback_func(callback_args, link->key);
+       link = link->next.load(std::memory_order_acquire)) {
+  }
+}
+
+uint64_t HashIndexedSkipListRep::ApproximateNumEntries(const Slice& start_ikey,
+                                                       const Slice& end_ikey) {
+  std::string tmp;
+  uint64_t start_count = skip_list_.EstimateCount(EncodeKey(&tmp, start_ikey));
+  uint64_t end_count = skip_list_.EstimateCount(EncodeKey(&tmp, end_ikey));
+  return (end_count >= start_count) ? (end_count - start_count) : 0;
+}
+
+MemTableRep::Iterator* HashIndexedSkipListRep::GetIterator(Arena* arena) {
+  void* mem = arena ? arena->AllocateAligned(sizeof(Iterator))
+                    : operator new(sizeof(Iterator));
+  return new (mem) Iterator(&skip_list_);
+}
+
+}  // anon namespace
+
+MemTableRep* HashIndexedSkipListRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, Allocator* allocator,
+    const SliceTransform* /*transform*/, Logger* /*logger*/) {
+  return new HashIndexedSkipListRep(compare, allocator, bucket_count_);
+}
+
+MemTableRepFactory* NewHashIndexedSkipListRepFactory(size_t bucket_count) {
+  return new HashIndexedSkipListRepFactory(bucket_count);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+#endif  // ROCKSDB_LITE
@@ -46,12 +46,14 @@
 #include <algorithm>
 #include <atomic>
 #include <type_traits>
+#include <vector>
 #include "memory/allocator.h"
 #include "port/likely.h"
 #include "port/port.h"
 #include "rocksdb/slice.h"
 #include "util/coding.h"
 #include "util/random.h"
+#include "util/thread_local.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -78,6 +80,8 @@ class InlineSkipList {
   InlineSkipList(const InlineSkipList&) = delete;
   InlineSkipList& operator=(const InlineSkipList&) = delete;
 
+  ~InlineSkipList();
+
   // Allocates a key and a skip-list node, returning a pointer to the key
   // portion of the node.  This method is thread-safe if the allocator
   // is thread-safe.
@@ -114,7 +118,10 @@ class InlineSkipList {
   // REQUIRES: no concurrent calls that use same hint
   bool InsertWithHintConcurrently(const char* key, void** hint);
 
-  // Like Insert, but external synchronization is not required.
+  // Like Insert, but external synchronization is not required. Every thread
+  // keeps the splice of its previous concurrent insert into the list as a
+  // finger, so a key close to it is inserted in O(log D), where D is the
+  // number of nodes in between.
   bool InsertConcurrently(const char* key);
 
   // Inserts a node into the skip list.  key must have been allocated by
@@ -141,6 +148,13 @@ class InlineSkipList {
   // Return estimated number of entries smaller than `key`.
   uint64_t EstimateCount(const char* key) const;
 
+  // Appends to *keys about `target` keys sampled uniformly from the list,
+  // which holds about `num_entries` keys. Node heights are random, so the
+  // nodes linked at any level are a uniform sample of the list; this walks
+  // the highest level expected to link at least `target` nodes.
+  void SampleKeys(uint64_t num_entries, size_t target,
+                  std::vector<const char*>* keys) const;
+
   // Validate correctness of the skip-list.
   void TEST_Validate() const;
 
@@ -171,7 +185,9 @@ class InlineSkipList {
     // REQUIRES: Valid()
     void Prev();
 
-    // Advance to the first entry with a key >= target
+    // Advance to the first entry with a key >= target. If the calling thread
+    // has inserted concurrently into the list, the search starts from its
+    // finger.
     void Seek(const char* target);
 
     // Retreat to the last entry with a key <= target
@@ -210,6 +226,10 @@ class InlineSkipList {
   // non-concurrent insertion.
   Splice* seq_splice_;
 
+  // Per-thread splices used by InsertConcurrently(). Created by the first
+  // concurrent insert.
+  std::atomic<ThreadLocalPtr*> fingers_;
+
   inline int GetMaxHeight() const {
     return max_height_.load(std::memory_order_relaxed);
   }
@@ -235,6 +255,18 @@ class InlineSkipList {
   // Return nullptr if there is no such node.
   Node* FindGreaterOrEqual(const char* key) const;
 
+  // Like FindGreaterOrEqual(), but starts from the lowest level of the
+  // calling thread's finger that brackets the key, if it has one.
+  Node* FindGreaterOrEqualFromFinger(const char* key) const;
+
+  // Returns the calling thread's splice for concurrent inserts, allocating
+  // it if needed.
+  Splice* GetFinger();
+
+  static void DeleteSplice(void* splice) {
+    delete[] reinterpret_cast<char*>(splice);
+  }
+
   // Return the latest node with a key < key.
   // Return head_ if there is no such node.
   // Fills prev[level] with pointer to previous node at "level" for every
@@ -260,12 +292,12 @@ class InlineSkipList {
   // node isn't conveniently available.
   template<bool prefetch_before>
   void FindSpliceForLevel(const DecodedKey& key, Node* before, Node* after, int level,
-                          Node** out_prev, Node** out_next);
+                          Node** out_prev, Node** out_next) const;
 
   // Recomputes Splice levels from highest_level (inclusive) down to
   // lowest_level (inclusive).
   void RecomputeSpliceLevels(const DecodedKey& key, Splice* splice,
-                             int recompute_level);
+                             int recompute_level) const;
 };
 
 // Implementation details follow
@@ -397,7 +429,7 @@ inline void InlineSkipList<Comparator>::Iterator::Prev() {
 
 template <class Comparator>
 inline void InlineSkipList<Comparator>::Iterator::Seek(const char* target) {
-  node_ = list_->FindGreaterOrEqual(target);
+  node_ = list_->FindGreaterOrEqualFromFinger(target);
 }
 
 template <class Comparator>
@@ -494,6 +526,49 @@ InlineSkipList<Comparator>::FindGreaterOrEqual(const char* key) const {
   }
 }
 
+template <class Comparator>
+typename InlineSkipList<Comparator>::Node*
+InlineSkipList<Comparator>::FindGreaterOrEqualFromFinger(
+    const char* key) const {
+  ThreadLocalPtr* fingers = fingers_.load(std::memory_order_acquire);
+  const Splice* finger =
+      fingers != nullptr ? static_cast<Splice*>(fingers->Get()) : nullptr;
+  if (finger == nullptr || finger->height_ < GetMaxHeight()) {
+    return FindGreaterOrEqual(key);
+  }
+  // Walk up the finger until a level brackets the key, skipping levels that
+  // share the node already found not to bracket it. Nodes are never removed,
+  // so a bracket stays valid; nodes inserted into it since the finger was
+  // taken are walked over below.
+  const DecodedKey key_decoded = compare_.decode_key(key);
+  int level = 0;
+  while (level < finger->height_) {
+    Node* prev = finger->prev_[level];
+    Node* next = finger->next_[level];
+    if (prev != head_ && !KeyIsAfterNode(key_decoded, prev)) {
+      while (level < finger->height_ && finger->prev_[level] == prev) {
+        ++level;
+      }
+    } else if (KeyIsAfterNode(key_decoded, next)) {
+      while (level < finger->height_ && finger->next_[level] == next) {
+        ++level;
+      }
+    } else {
+      break;
+    }
+  }
+  if (level == finger->height_) {
+    return FindGreaterOrEqual(key);
+  }
+  Node* before = finger->prev_[level];
+  Node* after = finger->next_[level];
+  for (; level >= 0; --level) {
+    FindSpliceForLevel<false>(key_decoded, before, after, level, &before,
+                              &after);
+  }
+  return after;
+}
+
 template <class Comparator>
 typename InlineSkipList<Comparator>::Node*
 InlineSkipList<Comparator>::FindLessThan(const char* key, Node** prev) const {
@@ -586,6 +661,20 @@ uint64_t InlineSkipList<Comparator>::EstimateCount(const char* key) const {
   }
 }
 
+template <class Comparator>
+void InlineSkipList<Comparator>::SampleKeys(
+    uint64_t num_entries, size_t target, std::vector<const char*>* keys) const {
+  int level = 0;
+  uint64_t expected = num_entries;
+  while (level + 1 < GetMaxHeight() && expected / kBranching_ >= target) {
+    expected /= kBranching_;
+    level++;
+  }
+  for (Node* x = head_->Next(level); x != nullptr; x = x->Next(level)) {
+    keys->push_back(x->Key());
+  }
+}
+
 template <class Comparator>
 InlineSkipList<Comparator>::InlineSkipList(const Comparator cmp,
                                            Allocator* allocator,
@@ -598,7 +687,8 @@ InlineSkipList<Comparator>::InlineSkipList(const Comparator cmp,
       compare_(cmp),
       head_(AllocateNode(0, max_height)),
       max_height_(1),
-      seq_splice_(AllocateSplice()) {
+      seq_splice_(AllocateSplice()),
+      fingers_(nullptr) {
   assert(max_height > 0 && kMaxHeight_ == static_cast<uint32_t>(max_height));
   assert(branching_factor > 1 &&
          kBranching_ == static_cast<uint32_t>(branching_factor));
@@ -609,6 +699,11 @@ InlineSkipList<Comparator>::InlineSkipList(const Comparator cmp,
   }
 }
 
+template <class Comparator>
+InlineSkipList<Comparator>::~InlineSkipList() {
+  delete fingers_.load(std::memory_order_relaxed);
+}
+
 template <class Comparator>
 char* InlineSkipList<Comparator>::AllocateKey(size_t key_size) {
   return const_cast<char*>(AllocateNode(key_size, RandomHeight())->Key());
@@ -668,14 +763,29 @@ bool InlineSkipList<Comparator>::Insert(const char* key) {
   return Insert<false>(key, seq_splice_, false);
 }
 
+template <class Comparator>
+typename InlineSkipList<Comparator>::Splice*
+InlineSkipList<Comparator>::GetFinger() {
+  ThreadLocalPtr* fingers = fingers_.load(std::memory_order_acquire);
+  if (fingers == nullptr) {
+    ThreadLocalPtr* created = new ThreadLocalPtr(&DeleteSplice);
+    if (fingers_.compare_exchange_strong(fingers, created)) {
+      fingers = created;
+    } else {
+      delete created;
+    }
+  }
+  Splice* splice = static_cast<Splice*>(fingers->Get());
+  if (splice == nullptr) {
+    splice = AllocateSpliceOnHeap();
+    fingers->Reset(splice);
+  }
+  return splice;
+}
+
 template <class Comparator>
 bool InlineSkipList<Comparator>::InsertConcurrently(const char* key) {
-  Node* prev[kMaxPossibleHeight];
-  Node* next[kMaxPossibleHeight];
-  Splice splice;
-  splice.prev_ = prev;
-  splice.next_ = next;
-  return Insert<true>(key, &splice, false);
+  return Insert<true>(key, GetFinger(), true);
 }
 
 template <class Comparator>
@@ -706,7 +816,7 @@ template <bool prefetch_before>
 void InlineSkipList<Comparator>::FindSpliceForLevel(const DecodedKey& key,
                                                     Node* before, Node* after,
                                                     int level, Node** out_prev,
-                                                    Node** out_next) {
+                                                    Node** out_next) const {
   while (true) {
     Node* next = before->Next(level);
     if (next != nullptr) {
@@ -731,9 +841,8 @@ void InlineSkipList<Comparator>::FindSpliceForLevel(const DecodedKey& key,
 }
 
 template <class Comparator>
-void InlineSkipList<Comparator>::RecomputeSpliceLevels(const DecodedKey& key,
-                                                       Splice* splice,
-                                                       int recompute_level) {
+void InlineSkipList<Comparator>::RecomputeSpliceLevels(
+    const DecodedKey& key, Splice* splice, int recompute_level) const {
   assert(recompute_level > 0);
   assert(recompute_level <= splice->height_);
   for (int i = recompute_level - 1; i >= 0; --i) {
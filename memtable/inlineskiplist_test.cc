@@ -488,6 +488,177 @@ class ConcurrentTest {
 };
 const uint32_t ConcurrentTest::K;
 
+TEST_F(InlineSkipTest, ConcurrentInsertWithFinger) {
+  // Every thread appends ascending keys, like a time series writer, and
+  // seeks around its finger while the other threads insert.
+  const int kThreads = 4;
+  const Key kKeysPerThread = 10000;
+  ConcurrentArena arena;
+  TestComparator cmp;
+  TestInlineSkipList list(cmp, &arena);
+  std::vector<port::Thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      TestInlineSkipList::Iterator iter(&list);
+      for (Key i = 0; i < kKeysPerThread; ++i) {
+        Key key = i * kThreads + t;
+        char* buf = list.AllocateKey(sizeof(Key));
+        memcpy(buf, &key, sizeof(Key));
+        ASSERT_TRUE(list.InsertConcurrently(buf));
+
+        Key target = key > 0 ? key - 1 : 0;
+        iter.Seek(Encode(&target));
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_GE(Decode(iter.key()), target);
+        ASSERT_LE(Decode(iter.key()), key);
+
+        // An earlier key of this thread, behind the finger
+        Key earlier = (i / 2) * kThreads + t;
+        iter.Seek(Encode(&earlier));
+        ASSERT_TRUE(iter.Valid());
+        ASSERT_EQ(earlier, Decode(iter.key()));
+      }
+      Key past_end = kThreads * kKeysPerThread;
+      iter.Seek(Encode(&past_end));
+      ASSERT_FALSE(iter.Valid());
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TestInlineSkipList::Iterator iter(&list);
+  Key expected = 0;
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next(), ++expected) {
+    ASSERT_EQ(expected, Decode(iter.key()));
+  }
+  ASSERT_EQ(kThreads * kKeysPerThread, expected);
+  list.TEST_Validate();
+}
+
+namespace {
+// Inserts key through the calling thread's finger
+bool InsertConcurrently(TestInlineSkipList* list, Key key) {
+  char* buf = list->AllocateKey(sizeof(Key));
+  memcpy(buf, &key, sizeof(Key));
+  return list->InsertConcurrently(buf);
+}
+
+// Checks that a Seek() to target lands on the first key >= target
+void AssertSeek(TestInlineSkipList* list, const std::set<Key>& keys,
+                Key target) {
+  TestInlineSkipList::Iterator iter(list);
+  iter.Seek(Encode(&target));
+  auto it = keys.lower_bound(target);
+  if (it == keys.end()) {
+    ASSERT_FALSE(iter.Valid()) << target;
+  } else {
+    ASSERT_TRUE(iter.Valid()) << target;
+    ASSERT_EQ(*it, Decode(iter.key())) << target;
+  }
+}
+}  // namespace
+
+TEST_F(InlineSkipTest, FingerSeek) {
+  ConcurrentArena arena;
+  TestComparator cmp;
+  TestInlineSkipList list(cmp, &arena);
+  std::set<Key> keys;
+  // No finger yet
+  AssertSeek(&list, keys, 0);
+
+  Random rnd(301);
+  Key key = 0;
+  for (int i = 0; i < 5000; ++i) {
+    // Runs of nearby keys, then a jump
+    key = i % 10 == 0 ? rnd.Uniform(5000) * 2 : (key + 2) % 10000;
+    ASSERT_EQ(keys.insert(key).second, InsertConcurrently(&list, key));
+    // Seeks on both sides of the finger, far and near
+    for (Key target : {key, key + 1, key > 0 ? key - 1 : 0,
+                       static_cast<Key>(rnd.Uniform(10002)), Key(0),
+                       Key(10001)}) {
+      AssertSeek(&list, keys, target);
+    }
+  }
+  list.TEST_Validate();
+}
+
+TEST_F(InlineSkipTest, FingerOfShorterList) {
+  ConcurrentArena arena;
+  TestComparator cmp;
+  TestInlineSkipList list(cmp, &arena);
+  std::set<Key> keys;
+  // The finger is taken while the list is short
+  const Key kLast = 1000000;
+  ASSERT_TRUE(InsertConcurrently(&list, kLast));
+  keys.insert(kLast);
+
+  // Another thread makes the list taller
+  const Key kNumKeys = 20000;
+  port::Thread writer([&]() {
+    for (Key i = 0; i < kNumKeys; ++i) {
+      ASSERT_TRUE(InsertConcurrently(&list, i * 2));
+    }
+  });
+  writer.join();
+  for (Key i = 0; i < kNumKeys; ++i) {
+    keys.insert(i * 2);
+  }
+
+  for (Key target = 0; target < 2 * kNumKeys + 2; target += 7) {
+    AssertSeek(&list, keys, target);
+  }
+  AssertSeek(&list, keys, kLast + 1);
+
+  // A new insert refreshes the finger at the current height
+  ASSERT_TRUE(InsertConcurrently(&list, 2 * kNumKeys + 1));
+  keys.insert(2 * kNumKeys + 1);
+  for (Key target = 0; target < 2 * kNumKeys + 2; target += 7) {
+    AssertSeek(&list, keys, target);
+  }
+  list.TEST_Validate();
+}
+
+TEST_F(InlineSkipTest, FingersArePerList) {
+  ConcurrentArena arena;
+  TestComparator cmp;
+  std::set<Key> odd_keys;
+  std::set<Key> even_keys;
+  {
+    TestInlineSkipList odd(cmp, &arena);
+    TestInlineSkipList even(cmp, &arena);
+    for (Key i = 0; i < 2000; ++i) {
+      // Alternate between the lists, from the ends towards the middle
+      Key key = i % 2 == 0 ? i : 4000 - i;
+      ASSERT_TRUE(InsertConcurrently(&odd, key * 2 + 1));
+      odd_keys.insert(key * 2 + 1);
+      ASSERT_TRUE(InsertConcurrently(&even, key * 2));
+      even_keys.insert(key * 2);
+      AssertSeek(&odd, odd_keys, key * 2);
+      AssertSeek(&even, even_keys, key * 2 + 1);
+    }
+    // A thread that exits before the lists are destroyed
+    port::Thread writer([&]() {
+      ASSERT_TRUE(InsertConcurrently(&odd, 100001));
+      ASSERT_TRUE(InsertConcurrently(&even, 100000));
+    });
+    writer.join();
+    odd_keys.insert(100001);
+    even_keys.insert(100000);
+    for (Key target = 0; target < 8010; target += 3) {
+      AssertSeek(&odd, odd_keys, target);
+      AssertSeek(&even, even_keys, target);
+    }
+  }
+
+  // The fingers of the destroyed lists are not reused
+  TestInlineSkipList list(cmp, &arena);
+  ASSERT_TRUE(InsertConcurrently(&list, 5));
+  AssertSeek(&list, {5}, 0);
+  AssertSeek(&list, {5}, 6);
+  list.TEST_Validate();
+}
+
 // Simple test that does single-threaded testing of the ConcurrentTest
 // scaffolding.
 TEST_F(InlineSkipTest, ConcurrentReadWithoutThreads) {
@@ -16,6 +16,7 @@ int main() {
 #else
 
 #include <atomic>
+#include <cinttypes>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -25,6 +26,7 @@ int main() {
 #include "db/dbformat.h"
 #include "db/memtable.h"
 #include "memory/arena.h"
+#include "memory/concurrent_arena.h"
 #include "port/port.h"
 #include "port/stack_trace.h"
 #include "rocksdb/comparator.h"
@@ -45,8 +47,13 @@ DEFINE_string(benchmarks, "fillrandom",
               "Comma-separated list of benchmarks to run. Options:\n"
               "\tfillrandom             -- write N random values\n"
               "\tfillseq                -- write N values in sequential order\n"
+              "\tfillrandomconcurrent   -- N threads write random values "
+              "concurrently,\n"
+              "\t                          then the order of the entries is "
+              "verified\n"
               "\treadrandom             -- read N values in random order\n"
               "\treadseq                -- scan the DB\n"
+              "\tseekrandom             -- seek to N values in random order\n"
               "\treadwrite              -- 1 thread writes while N - 1 threads "
               "do random\n"
               "\t                          reads\n"
@@ -61,12 +68,20 @@ DEFINE_string(memtablerep, "skiplist",
               "\tvector              -- backed by an std::vector\n"
               "\thashskiplist        -- backed by a hash skip list\n"
               "\thashlinklist        -- backed by a hash linked list\n"
+              "\thashindexedskiplist -- backed by a skiplist with a hash "
+              "index\n"
+              "\tart                 -- backed by an adaptive radix tree\n"
+              "\tbulkload            -- backed by per-core append buffers "
+              "sorted in parallel\n"
               "\tcuckoo              -- backed by a cuckoo hash table");
 
 DEFINE_int64(bucket_count, 1000000,
              "bucket_count parameter to pass into NewHashSkiplistRepFactory or "
              "NewHashLinkListRepFactory");
 
+DEFINE_int32(sort_threads, 4,
+             "sort_threads parameter to pass into NewBulkLoadRepFactory");
+
 DEFINE_int32(
     hashskiplist_height, 4,
     "skiplist_height parameter to pass into NewHashSkiplistRepFactory");
@@ -109,6 +124,10 @@ DEFINE_int32(num_scans, 10,
 
 DEFINE_int32(item_size, 100, "Number of bytes each item should be");
 
+DEFINE_int32(key_prefix_size, 0,
+             "Number of bytes of a prefix shared by all the keys, like the "
+             "tenant and table in front of a row key");
+
 DEFINE_int32(prefix_length, 8,
              "Prefix length to pass into NewFixedPrefixTransform");
 
@@ -197,6 +216,28 @@ class KeyGenerator {
   std::vector<uint64_t> values_;
 };
 
+// All the keys are key_prefix_size bytes of a common prefix followed by the
+// key number
+size_t UserKeySize() { return FLAGS_key_prefix_size + 8; }
+
+char* EncodeUserKey(char* p, uint64_t key) {
+  memset(p, 'p', FLAGS_key_prefix_size);
+  p += FLAGS_key_prefix_size;
+  EncodeFixed64(p, key);
+  return p + 8;
+}
+
+std::string UserKey(uint64_t key) {
+  std::string user_key(UserKeySize(), '\0');
+  EncodeUserKey(&user_key[0], key);
+  return user_key;
+}
+
+size_t EntrySize() {
+  const size_t internal_key_size = UserKeySize() + 8;
+  return VarintLength(internal_key_size) + internal_key_size + FLAGS_item_size;
+}
+
 class BenchmarkThread {
  public:
   explicit BenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -235,15 +276,13 @@ class FillBenchmarkThread : public BenchmarkThread {
 
   void FillOne() {
     char* buf = nullptr;
-    auto internal_key_size = 16;
-    auto encoded_len =
-        FLAGS_item_size + VarintLength(internal_key_size) + internal_key_size;
+    auto internal_key_size = static_cast<uint32_t>(UserKeySize() + 8);
+    auto encoded_len = EntrySize();
     KeyHandle handle = table_->Allocate(encoded_len, &buf);
     assert(buf != nullptr);
     char* p = EncodeVarint32(buf, internal_key_size);
     auto key = key_gen_->Next();
-    EncodeFixed64(p, key);
-    p += 8;
+    p = EncodeUserKey(p, key);
     EncodeFixed64(p, ++(*sequence_));
     p += 8;
     Slice bytes = generator_.Generate(FLAGS_item_size);
@@ -285,6 +324,60 @@ class ConcurrentFillBenchmarkThread : public FillBenchmarkThread {
   std::atomic_int* threads_done_;
 };
 
+// Inserts the keys thread_id, thread_id + num_threads, ... in random order
+// with InsertConcurrently
+class ConcurrentInsertBenchmarkThread {
+ public:
+  ConcurrentInsertBenchmarkThread(MemTableRep* table, uint32_t thread_id,
+                                  uint32_t num_threads, uint64_t num_ops,
+                                  std::atomic<uint64_t>* sequence,
+                                  std::atomic<uint64_t>* bytes_written)
+      : table_(table),
+        thread_id_(thread_id),
+        num_threads_(num_threads),
+        num_ops_(num_ops),
+        sequence_(sequence),
+        bytes_written_(bytes_written) {}
+
+  void operator()() {
+    std::vector<uint64_t> keys(num_ops_);
+    for (uint64_t i = 0; i < num_ops_; ++i) {
+      keys[i] = i * num_threads_ + thread_id_;
+    }
+    std::shuffle(keys.begin(), keys.end(),
+                 std::default_random_engine(
+                     static_cast<unsigned int>(FLAGS_seed + thread_id_)));
+    uint64_t bytes_written = 0;
+    for (uint64_t key : keys) {
+      char* buf = nullptr;
+      auto internal_key_size = static_cast<uint32_t>(UserKeySize() + 8);
+      auto encoded_len = EntrySize();
+      KeyHandle handle = table_->Allocate(encoded_len, &buf);
+      assert(buf != nullptr);
+      char* p = EncodeVarint32(buf, internal_key_size);
+      p = EncodeUserKey(p, key);
+      EncodeFixed64(p, sequence_->fetch_add(1) + 1);
+      p += 8;
+      Slice bytes = generator_.Generate(FLAGS_item_size);
+      memcpy(p, bytes.data(), FLAGS_item_size);
+      p += FLAGS_item_size;
+      assert(p == buf + encoded_len);
+      table_->InsertConcurrently(handle);
+      bytes_written += encoded_len;
+    }
+    bytes_written_->fetch_add(bytes_written);
+  }
+
+ private:
+  MemTableRep* table_;
+  uint32_t thread_id_;
+  uint32_t num_threads_;
+  uint64_t num_ops_;
+  std::atomic<uint64_t>* sequence_;
+  std::atomic<uint64_t>* bytes_written_;
+  RandomGenerator generator_;
+};
+
 class ReadBenchmarkThread : public BenchmarkThread {
  public:
   ReadBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -308,10 +401,8 @@ class ReadBenchmarkThread : public BenchmarkThread {
   }
 
   void ReadOne() {
-    std::string user_key;
     auto key = key_gen_->Next();
-    PutFixed64(&user_key, key);
-    LookupKey lookup_key(user_key, *sequence_);
+    LookupKey lookup_key(UserKey(key), *sequence_);
     InternalKeyComparator internal_key_comp(BytewiseComparator());
     CallbackVerifyArgs verify_args;
     verify_args.found = false;
@@ -320,7 +411,7 @@ class ReadBenchmarkThread : public BenchmarkThread {
     verify_args.comparator = &internal_key_comp;
     table_->Get(lookup_key, &verify_args, callback);
     if (verify_args.found) {
-      *bytes_read_ += VarintLength(16) + 16 + FLAGS_item_size;
+      *bytes_read_ += EntrySize();
       ++*read_hits_;
     }
   }
@@ -331,6 +422,33 @@ class ReadBenchmarkThread : public BenchmarkThread {
   }
 };
 
+class SeekBenchmarkThread : public BenchmarkThread {
+ public:
+  SeekBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
+                      uint64_t* bytes_written, uint64_t* bytes_read,
+                      uint64_t* sequence, uint64_t num_ops, uint64_t* read_hits)
+      : BenchmarkThread(table, key_gen, bytes_written, bytes_read, sequence,
+                        num_ops, read_hits) {}
+
+  void SeekOne(MemTableRep::Iterator* iter) {
+    auto key = key_gen_->Next();
+    LookupKey lookup_key(UserKey(key), *sequence_);
+    iter->Seek(lookup_key.internal_key(), lookup_key.memtable_key().data());
+    if (iter->Valid()) {
+      // pretend to read the value
+      *bytes_read_ += EntrySize();
+      ++*read_hits_;
+    }
+  }
+
+  void operator()() override {
+    std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
+    for (unsigned int i = 0; i < num_ops_; ++i) {
+      SeekOne(iter.get());
+    }
+  }
+};
+
 class SeqReadBenchmarkThread : public BenchmarkThread {
  public:
   SeqReadBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -344,7 +462,7 @@ class SeqReadBenchmarkThread : public BenchmarkThread {
     std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
     for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
       // pretend to read the value
-      *bytes_read_ += VarintLength(16) + 16 + FLAGS_item_size;
+      *bytes_read_ += EntrySize();
     }
     ++*read_hits_;
   }
@@ -474,6 +592,64 @@ class FillBenchmark : public Benchmark {
   }
 };
 
+class ConcurrentFillBenchmark : public Benchmark {
+ public:
+  explicit ConcurrentFillBenchmark(MemTableRep* table,
+                                   const MemTableRep::KeyComparator& cmp,
+                                   uint64_t* sequence)
+      : Benchmark(table, nullptr, sequence, FLAGS_num_threads), cmp_(cmp) {
+    num_write_ops_per_thread_ = FLAGS_num_operations / FLAGS_num_threads;
+  }
+
+  void Run() override {
+    Benchmark::Run();
+    Verify();
+  }
+
+  void RunThreads(std::vector<port::Thread>* threads, uint64_t* bytes_written,
+                  uint64_t* /*bytes_read*/, bool /*write*/,
+                  uint64_t* /*read_hits*/) override {
+    std::atomic<uint64_t> sequence(*sequence_);
+    std::atomic<uint64_t> written(0);
+    for (int i = 0; i < FLAGS_num_threads; ++i) {
+      threads->emplace_back(ConcurrentInsertBenchmarkThread(
+          table_, i, FLAGS_num_threads, num_write_ops_per_thread_, &sequence,
+          &written));
+    }
+    for (auto& thread : *threads) {
+      thread.join();
+    }
+    *sequence_ = sequence.load();
+    *bytes_written = written.load();
+  }
+
+ private:
+  // Checks that iteration returns all the inserted entries in order, as it
+  // does when the memtable is flushed
+  void Verify() {
+    uint64_t count = 0;
+    const char* prev = nullptr;
+    std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      if (prev != nullptr && cmp_(prev, iter->key()) >= 0) {
+        fprintf(stderr, "Entries are out of order\n");
+        exit(1);
+      }
+      prev = iter->key();
+      ++count;
+    }
+    if (count != num_write_ops_per_thread_ * FLAGS_num_threads) {
+      fprintf(stderr, "Expected %" PRIu64 " entries, found %" PRIu64 "\n",
+              num_write_ops_per_thread_ * FLAGS_num_threads, count);
+      exit(1);
+    }
+    std::cout << "Verified " << count << " entries" << std::endl;
+  }
+
+  const MemTableRep::KeyComparator& cmp_;
+};
+
+template <class ReadThreadType>
 class ReadBenchmark : public Benchmark {
  public:
   explicit ReadBenchmark(MemTableRep* table, KeyGenerator* key_gen,
@@ -487,8 +663,8 @@ class ReadBenchmark : public Benchmark {
                   uint64_t* read_hits) override {
     for (int i = 0; i < FLAGS_num_threads; ++i) {
       threads->emplace_back(
-          ReadBenchmarkThread(table_, key_gen_, bytes_written, bytes_read,
-                              sequence_, num_read_ops_per_thread_, read_hits));
+          ReadThreadType(table_, key_gen_, bytes_written, bytes_read,
+                         sequence_, num_read_ops_per_thread_, read_hits));
     }
     for (auto& thread : *threads) {
       thread.join();
@@ -587,6 +763,14 @@ int main(int argc, char** argv) {
         FLAGS_hashskiplist_branching_factor));
     options.prefix_extractor.reset(
         ROCKSDB_NAMESPACE::NewFixedPrefixTransform(FLAGS_prefix_length));
+  } else if (FLAGS_memtablerep == "hashindexedskiplist") {
+    factory.reset(
+        ROCKSDB_NAMESPACE::NewHashIndexedSkipListRepFactory(FLAGS_bucket_count));
+  } else if (FLAGS_memtablerep == "art") {
+    factory.reset(ROCKSDB_NAMESPACE::NewAdaptiveRadixTreeRepFactory());
+  } else if (FLAGS_memtablerep == "bulkload") {
+    factory.reset(
+        ROCKSDB_NAMESPACE::NewBulkLoadRepFactory(FLAGS_sort_threads));
   } else if (FLAGS_memtablerep == "hashlinklist") {
     factory.reset(ROCKSDB_NAMESPACE::NewHashLinkListRepFactory(
         FLAGS_bucket_count, FLAGS_huge_page_tlb_size,
@@ -604,11 +788,13 @@ int main(int argc, char** argv) {
       ROCKSDB_NAMESPACE::BytewiseComparator());
   ROCKSDB_NAMESPACE::MemTable::KeyComparator key_comp(internal_key_comp);
   ROCKSDB_NAMESPACE::Arena arena;
+  // For the benchmarks that insert concurrently
+  ROCKSDB_NAMESPACE::ConcurrentArena concurrent_arena;
   ROCKSDB_NAMESPACE::WriteBufferManager wb(FLAGS_write_buffer_size);
   uint64_t sequence;
-  auto createMemtableRep = [&] {
+  auto createMemtableRep = [&](ROCKSDB_NAMESPACE::Allocator* allocator) {
     sequence = 0;
-    return factory->CreateMemTableRep(key_comp, &arena,
+    return factory->CreateMemTableRep(key_comp, allocator,
                                       options.prefix_extractor.get(),
                                       options.info_log.get());
   };
@@ -628,21 +814,37 @@ int main(int argc, char** argv) {
     }
     std::unique_ptr<ROCKSDB_NAMESPACE::Benchmark> benchmark;
     if (name == ROCKSDB_NAMESPACE::Slice("fillseq")) {
-      memtablerep.reset(createMemtableRep());
+      memtablerep.reset(createMemtableRep(&arena));
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::SEQUENTIAL, FLAGS_num_operations));
       benchmark.reset(new ROCKSDB_NAMESPACE::FillBenchmark(
           memtablerep.get(), key_gen.get(), &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("fillrandom")) {
-      memtablerep.reset(createMemtableRep());
+      memtablerep.reset(createMemtableRep(&arena));
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::UNIQUE_RANDOM, FLAGS_num_operations));
       benchmark.reset(new ROCKSDB_NAMESPACE::FillBenchmark(
           memtablerep.get(), key_gen.get(), &sequence));
+    } else if (name == ROCKSDB_NAMESPACE::Slice("fillrandomconcurrent")) {
+      if (!factory->IsInsertConcurrentlySupported()) {
+        fprintf(stdout, "%s does not support concurrent inserts\n",
+                factory->Name());
+        exit(1);
+      }
+      memtablerep.reset(createMemtableRep(&concurrent_arena));
+      benchmark.reset(new ROCKSDB_NAMESPACE::ConcurrentFillBenchmark(
+          memtablerep.get(), key_comp, &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("readrandom")) {
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
-      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark(
+      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark<
+                      ROCKSDB_NAMESPACE::ReadBenchmarkThread>(
+          memtablerep.get(), key_gen.get(), &sequence));
+    } else if (name == ROCKSDB_NAMESPACE::Slice("seekrandom")) {
+      key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
+          &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
+      benchmark.reset(new ROCKSDB_NAMESPACE::ReadBenchmark<
+                      ROCKSDB_NAMESPACE::SeekBenchmarkThread>(
           memtablerep.get(), key_gen.get(), &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("readseq")) {
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
@@ -650,14 +852,14 @@ int main(int argc, char** argv) {
       benchmark.reset(new ROCKSDB_NAMESPACE::SeqReadBenchmark(memtablerep.get(),
                                                               &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("readwrite")) {
-      memtablerep.reset(createMemtableRep());
+      memtablerep.reset(createMemtableRep(&arena));
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
       benchmark.reset(new ROCKSDB_NAMESPACE::ReadWriteBenchmark<
                       ROCKSDB_NAMESPACE::ConcurrentReadBenchmarkThread>(
           memtablerep.get(), key_gen.get(), &sequence));
     } else if (name == ROCKSDB_NAMESPACE::Slice("seqreadwrite")) {
-      memtablerep.reset(createMemtableRep());
+      memtablerep.reset(createMemtableRep(&arena));
       key_gen.reset(new ROCKSDB_NAMESPACE::KeyGenerator(
           &rng, ROCKSDB_NAMESPACE::RANDOM, FLAGS_num_operations));
       benchmark.reset(new ROCKSDB_NAMESPACE::ReadWriteBenchmark<
@@ -95,6 +95,11 @@ public:
     return (end_count >= start_count) ? (end_count - start_count) : 0;
   }
 
+  void SampleEntries(uint64_t num_entries, size_t num_samples,
+                     std::vector<const char*>* entries) override {
+    skip_list_.SampleKeys(num_entries, num_samples, entries);
+  }
+
   ~SkipListRep() override {}
 
   // Iteration over the contents of a skip list
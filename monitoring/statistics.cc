@@ -176,6 +176,15 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
      "rocksdb.block.cache.compression.dict.bytes.insert"},
     {BLOCK_CACHE_COMPRESSION_DICT_BYTES_EVICT,
      "rocksdb.block.cache.compression.dict.bytes.evict"},
+    {TIER_GROUP_FILTER_PROBED, "rocksdb.tier.group.filter.probed"},
+    {TIER_GROUP_FILTER_USEFUL, "rocksdb.tier.group.filter.useful"},
+    {GET_SST_FILES_READ, "rocksdb.get.sst.files.read"},
+    {TIER_GROUP_FILTER_DEGRADED, "rocksdb.tier.group.filter.degraded"},
+    {TIER_PMEM_EMULATED_READS, "rocksdb.tier.pmem.emulated.reads"},
+    {TIER_PMEM_EMULATED_WRITES, "rocksdb.tier.pmem.emulated.writes"},
+    {TIER_PMEM_EMULATED_FLUSHES, "rocksdb.tier.pmem.emulated.flushes"},
+    {TIER_PMEM_EMULATED_STALL_NANOS, "rocksdb.tier.pmem.emulated.stall.nanos"},
+    {TIER_GROUP_FILTER_GROWN, "rocksdb.tier.group.filter.grown"},
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
@@ -513,7 +513,16 @@ ImmutableCFOptions::ImmutableCFOptions(const ImmutableDBOptions& db_options,
       cf_paths(cf_options.cf_paths),
       compaction_thread_limiter(cf_options.compaction_thread_limiter),
       persistent_file_path_(db_options.persistent_file_path_),
+      persistent_file_size_(db_options.persistent_file_size_),
+      persistent_block_size_(db_options.persistent_block_size_),
       is_tiered(db_options.is_tiered),
+      tier_max_group_depth_trigger(db_options.tier_max_group_depth_trigger),
+      tier_avg_group_depth_trigger(db_options.tier_avg_group_depth_trigger),
+      tier_group_depth_slowdown_writes_trigger(
+          db_options.tier_group_depth_slowdown_writes_trigger),
+      tier_group_depth_stop_writes_trigger(
+          db_options.tier_group_depth_stop_writes_trigger),
+      tier_prefix_filter(db_options.tier_prefix_filter),
       file_checksum_gen_factory(db_options.file_checksum_gen_factory.get()) {}
 
 // Multiple two operands. If they overflow, return op1.
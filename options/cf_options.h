@@ -123,8 +123,20 @@ struct ImmutableCFOptions {
   // 添加持久化内存文件的路径
   std::string persistent_file_path_;
 
+  // 持久化内存文件的大小以及其中 block 的大小
+  uint64_t persistent_file_size_;
+  uint64_t persistent_block_size_;
+
   // 是否开启 Tiered 模式
   bool is_tiered;
+
+  // Tier 模式下基于 group 深度的 compaction 以及 write stall 阈值
+  int tier_max_group_depth_trigger;
+  double tier_avg_group_depth_trigger;
+  int tier_group_depth_slowdown_writes_trigger;
+  int tier_group_depth_stop_writes_trigger;
+  // group filter 中是否插入 prefix 指纹
+  bool tier_prefix_filter;
   FileChecksumGenFactory* file_checksum_gen_factory;
 };
 
@@ -16,6 +16,7 @@
 #include "rocksdb/file_system.h"
 #include "rocksdb/sst_file_manager.h"
 #include "rocksdb/wal_filter.h"
+#include "util/compression.h"
 
 namespace ROCKSDB_NAMESPACE {
 #ifndef ROCKSDB_LITE
@@ -149,6 +150,11 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"db_write_buffer_size",
          {offsetof(struct DBOptions, db_write_buffer_size), OptionType::kSizeT,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone, 0}},
+        {"adaptive_write_buffer_size",
+         {offsetof(struct DBOptions, adaptive_write_buffer_size),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone,
+          offsetof(struct ImmutableDBOptions, adaptive_write_buffer_size)}},
         {"keep_log_file_num",
          {offsetof(struct DBOptions, keep_log_file_num), OptionType::kSizeT,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone, 0}},
@@ -174,6 +180,10 @@ std::unordered_map<std::string, OptionTypeInfo>
         {"max_subcompactions",
          {offsetof(struct DBOptions, max_subcompactions), OptionType::kUInt32T,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone, 0}},
+        {"max_subflushes",
+         {offsetof(struct DBOptions, max_subflushes), OptionType::kUInt32T,
+          OptionVerificationType::kNormal, OptionTypeFlags::kNone,
+          offsetof(struct ImmutableDBOptions, max_subflushes)}},
         {"WAL_size_limit_MB",
          {offsetof(struct DBOptions, WAL_size_limit_MB), OptionType::kUInt64T,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone, 0}},
@@ -304,6 +314,19 @@ std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct DBOptions, two_write_queues), OptionType::kBoolean,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone,
           offsetof(struct ImmutableDBOptions, two_write_queues)}},
+        {"wal_shards",
+         {offsetof(struct DBOptions, wal_shards), OptionType::kSizeT,
+          OptionVerificationType::kNormal, OptionTypeFlags::kNone,
+          offsetof(struct ImmutableDBOptions, wal_shards)}},
+        {"pipelined_wal_sync",
+         {offsetof(struct DBOptions, pipelined_wal_sync), OptionType::kBoolean,
+          OptionVerificationType::kNormal, OptionTypeFlags::kNone,
+          offsetof(struct ImmutableDBOptions, pipelined_wal_sync)}},
+        {"wal_compression",
+         {offsetof(struct DBOptions, wal_compression),
+          OptionType::kCompressionType, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone,
+          offsetof(struct ImmutableDBOptions, wal_compression)}},
         {"manual_wal_flush",
          {offsetof(struct DBOptions, manual_wal_flush), OptionType::kBoolean,
           OptionVerificationType::kNormal, OptionTypeFlags::kNone,
@@ -355,6 +378,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       wal_dir(options.wal_dir),
       max_subcompactions(options.max_subcompactions),
       max_background_flushes(options.max_background_flushes),
+      max_subflushes(options.max_subflushes),
       max_log_file_size(options.max_log_file_size),
       log_file_time_to_roll(options.log_file_time_to_roll),
       keep_log_file_num(options.keep_log_file_num),
@@ -376,6 +400,7 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       advise_random_on_open(options.advise_random_on_open),
       db_write_buffer_size(options.db_write_buffer_size),
       write_buffer_manager(options.write_buffer_manager),
+      adaptive_write_buffer_size(options.adaptive_write_buffer_size),
       access_hint_on_compaction_start(options.access_hint_on_compaction_start),
       new_table_reader_for_compaction_inputs(
           options.new_table_reader_for_compaction_inputs),
@@ -405,6 +430,9 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       allow_ingest_behind(options.allow_ingest_behind),
       preserve_deletes(options.preserve_deletes),
       two_write_queues(options.two_write_queues),
+      wal_shards(options.wal_shards),
+      pipelined_wal_sync(options.pipelined_wal_sync),
+      wal_compression(options.wal_compression),
       manual_wal_flush(options.manual_wal_flush),
       atomic_flush(options.atomic_flush),
       avoid_unnecessary_blocking_io(options.avoid_unnecessary_blocking_io),
@@ -412,7 +440,31 @@ ImmutableDBOptions::ImmutableDBOptions(const DBOptions& options)
       write_dbid_to_manifest(options.write_dbid_to_manifest),
       log_readahead_size(options.log_readahead_size),
       persistent_file_path_(options.persistent_file_path_),
+      persistent_file_size_(options.persistent_file_size_),
+      persistent_block_size_(options.persistent_block_size_),
+      persistent_file_max_size_(options.persistent_file_max_size_),
+      persistent_emulate_read_latency_ns_(
+          options.persistent_emulate_read_latency_ns_),
+      persistent_emulate_write_latency_ns_(
+          options.persistent_emulate_write_latency_ns_),
+      persistent_emulate_flush_latency_ns_(
+          options.persistent_emulate_flush_latency_ns_),
+      persistent_emulate_access_granularity_(
+          options.persistent_emulate_access_granularity_),
+      persistent_map_prefault_threads_(
+          options.persistent_map_prefault_threads_),
+      persistent_map_huge_pages_(options.persistent_map_huge_pages_),
+      persistent_map_numa_node_(options.persistent_map_numa_node_),
+      persistent_map_numa_interleave_(
+          options.persistent_map_numa_interleave_),
       is_tiered(options.is_tiered),
+      tier_max_group_depth_trigger(options.tier_max_group_depth_trigger),
+      tier_avg_group_depth_trigger(options.tier_avg_group_depth_trigger),
+      tier_group_depth_slowdown_writes_trigger(
+          options.tier_group_depth_slowdown_writes_trigger),
+      tier_group_depth_stop_writes_trigger(
+          options.tier_group_depth_stop_writes_trigger),
+      tier_prefix_filter(options.tier_prefix_filter),
       file_checksum_gen_factory(options.file_checksum_gen_factory),
       best_efforts_recovery(options.best_efforts_recovery) {
 }
@@ -476,6 +528,9 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    max_subcompactions);
   ROCKS_LOG_HEADER(log, "                 Options.max_background_flushes: %d",
                    max_background_flushes);
+  ROCKS_LOG_HEADER(log,
+                   "                         Options.max_subflushes: %" PRIu32,
+                   max_subflushes);
   ROCKS_LOG_HEADER(log,
                    "                        Options.WAL_ttl_seconds: %" PRIu64,
                    wal_ttl_seconds);
@@ -498,6 +553,8 @@ void ImmutableDBOptions::Dump(Logger* log) const {
       db_write_buffer_size);
   ROCKS_LOG_HEADER(log, "                   Options.write_buffer_manager: %p",
                    write_buffer_manager.get());
+  ROCKS_LOG_HEADER(log, "             Options.adaptive_write_buffer_size: %d",
+                   adaptive_write_buffer_size);
   ROCKS_LOG_HEADER(log, "        Options.access_hint_on_compaction_start: %d",
                    static_cast<int>(access_hint_on_compaction_start));
   ROCKS_LOG_HEADER(log, " Options.new_table_reader_for_compaction_inputs: %d",
@@ -552,6 +609,12 @@ void ImmutableDBOptions::Dump(Logger* log) const {
                    preserve_deletes);
   ROCKS_LOG_HEADER(log, "            Options.two_write_queues: %d",
                    two_write_queues);
+  ROCKS_LOG_HEADER(log, "                  Options.wal_shards: %" ROCKSDB_PRIszt,
+                   wal_shards);
+  ROCKS_LOG_HEADER(log, "          Options.pipelined_wal_sync: %d",
+                   pipelined_wal_sync);
+  ROCKS_LOG_HEADER(log, "             Options.wal_compression: %s",
+                   CompressionTypeToString(wal_compression).c_str());
   ROCKS_LOG_HEADER(log, "            Options.manual_wal_flush: %d",
                    manual_wal_flush);
   ROCKS_LOG_HEADER(log, "            Options.atomic_flush: %d", atomic_flush);
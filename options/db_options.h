@@ -36,6 +36,7 @@ struct ImmutableDBOptions {
   std::string wal_dir;
   uint32_t max_subcompactions;
   int max_background_flushes;
+  uint32_t max_subflushes;
   size_t max_log_file_size;
   size_t log_file_time_to_roll;
   size_t keep_log_file_num;
@@ -55,6 +56,7 @@ struct ImmutableDBOptions {
   bool advise_random_on_open;
   size_t db_write_buffer_size;
   std::shared_ptr<WriteBufferManager> write_buffer_manager;
+  bool adaptive_write_buffer_size;
   DBOptions::AccessHint access_hint_on_compaction_start;
   bool new_table_reader_for_compaction_inputs;
   size_t random_access_max_buffer_size;
@@ -81,6 +83,9 @@ struct ImmutableDBOptions {
   bool allow_ingest_behind;
   bool preserve_deletes;
   bool two_write_queues;
+  size_t wal_shards;
+  bool pipelined_wal_sync;
+  CompressionType wal_compression;
   bool manual_wal_flush;
   bool atomic_flush;
   bool avoid_unnecessary_blocking_io;
@@ -92,8 +97,27 @@ struct ImmutableDBOptions {
   // 传递给 ImmutableCFOptions
   // 添加持久化内存文件的路径
   std::string persistent_file_path_;
+  // 持久化内存文件的大小以及其中 block 的大小
+  uint64_t persistent_file_size_;
+  uint64_t persistent_block_size_;
+  uint64_t persistent_file_max_size_;
+  // PMem 延迟模拟的参数
+  uint64_t persistent_emulate_read_latency_ns_;
+  uint64_t persistent_emulate_write_latency_ns_;
+  uint64_t persistent_emulate_flush_latency_ns_;
+  uint64_t persistent_emulate_access_granularity_;
+  int persistent_map_prefault_threads_;
+  bool persistent_map_huge_pages_;
+  int persistent_map_numa_node_;
+  bool persistent_map_numa_interleave_;
   // 是否开启 Tiered 模式
   bool is_tiered;
+  // Tier 模式下基于 group 深度的 compaction 以及 write stall 阈值
+  int tier_max_group_depth_trigger;
+  double tier_avg_group_depth_trigger;
+  int tier_group_depth_slowdown_writes_trigger;
+  int tier_group_depth_stop_writes_trigger;
+  bool tier_prefix_filter;
   std::shared_ptr<FileChecksumGenFactory> file_checksum_gen_factory;
   bool best_efforts_recovery;
 };
@@ -62,6 +62,7 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.strict_bytes_per_sync = mutable_db_options.strict_bytes_per_sync;
   options.max_subcompactions = immutable_db_options.max_subcompactions;
   options.max_background_flushes = immutable_db_options.max_background_flushes;
+  options.max_subflushes = immutable_db_options.max_subflushes;
   options.max_log_file_size = immutable_db_options.max_log_file_size;
   options.log_file_time_to_roll = immutable_db_options.log_file_time_to_roll;
   options.keep_log_file_num = immutable_db_options.keep_log_file_num;
@@ -89,6 +90,8 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.advise_random_on_open = immutable_db_options.advise_random_on_open;
   options.db_write_buffer_size = immutable_db_options.db_write_buffer_size;
   options.write_buffer_manager = immutable_db_options.write_buffer_manager;
+  options.adaptive_write_buffer_size =
+      immutable_db_options.adaptive_write_buffer_size;
   options.access_hint_on_compaction_start =
       immutable_db_options.access_hint_on_compaction_start;
   options.new_table_reader_for_compaction_inputs =
@@ -137,11 +140,45 @@ DBOptions BuildDBOptions(const ImmutableDBOptions& immutable_db_options,
   options.preserve_deletes =
       immutable_db_options.preserve_deletes;
   options.two_write_queues = immutable_db_options.two_write_queues;
+  options.wal_shards = immutable_db_options.wal_shards;
+  options.pipelined_wal_sync = immutable_db_options.pipelined_wal_sync;
+  options.wal_compression = immutable_db_options.wal_compression;
   options.manual_wal_flush = immutable_db_options.manual_wal_flush;
   options.atomic_flush = immutable_db_options.atomic_flush;
   options.avoid_unnecessary_blocking_io =
       immutable_db_options.avoid_unnecessary_blocking_io;
   options.log_readahead_size = immutable_db_options.log_readahead_size;
+  options.persistent_file_path_ = immutable_db_options.persistent_file_path_;
+  options.persistent_file_size_ = immutable_db_options.persistent_file_size_;
+  options.persistent_block_size_ = immutable_db_options.persistent_block_size_;
+  options.persistent_file_max_size_ =
+      immutable_db_options.persistent_file_max_size_;
+  options.persistent_emulate_read_latency_ns_ =
+      immutable_db_options.persistent_emulate_read_latency_ns_;
+  options.persistent_emulate_write_latency_ns_ =
+      immutable_db_options.persistent_emulate_write_latency_ns_;
+  options.persistent_emulate_flush_latency_ns_ =
+      immutable_db_options.persistent_emulate_flush_latency_ns_;
+  options.persistent_emulate_access_granularity_ =
+      immutable_db_options.persistent_emulate_access_granularity_;
+  options.persistent_map_prefault_threads_ =
+      immutable_db_options.persistent_map_prefault_threads_;
+  options.persistent_map_huge_pages_ =
+      immutable_db_options.persistent_map_huge_pages_;
+  options.persistent_map_numa_node_ =
+      immutable_db_options.persistent_map_numa_node_;
+  options.persistent_map_numa_interleave_ =
+      immutable_db_options.persistent_map_numa_interleave_;
+  options.is_tiered = immutable_db_options.is_tiered;
+  options.tier_max_group_depth_trigger =
+      immutable_db_options.tier_max_group_depth_trigger;
+  options.tier_avg_group_depth_trigger =
+      immutable_db_options.tier_avg_group_depth_trigger;
+  options.tier_group_depth_slowdown_writes_trigger =
+      immutable_db_options.tier_group_depth_slowdown_writes_trigger;
+  options.tier_group_depth_stop_writes_trigger =
+      immutable_db_options.tier_group_depth_stop_writes_trigger;
+  options.tier_prefix_filter = immutable_db_options.tier_prefix_filter;
   options.file_checksum_gen_factory =
       immutable_db_options.file_checksum_gen_factory;
   options.best_efforts_recovery = immutable_db_options.best_efforts_recovery;
@@ -1326,7 +1363,8 @@ std::unordered_map<std::string, CompactionStyle>
         {"kCompactionStyleLevel", kCompactionStyleLevel},
         {"kCompactionStyleUniversal", kCompactionStyleUniversal},
         {"kCompactionStyleFIFO", kCompactionStyleFIFO},
-        {"kCompactionStyleNone", kCompactionStyleNone}};
+        {"kCompactionStyleNone", kCompactionStyleNone},
+        {"kCompactionStyleTier", kCompactionStyleTier}};
 
 std::unordered_map<std::string, CompactionPri>
     OptionsHelper::compaction_pri_string_map = {
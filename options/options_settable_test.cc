@@ -172,6 +172,8 @@ TEST_F(OptionsSettableTest, BlockBasedTableOptionsAllFieldsSettable) {
       "format_version=1;"
       "hash_index_allow_collision=false;"
       "verify_compression=true;read_amp_bytes_per_bit=0;"
+      "block_cache_compressed_compression=kLZ4Compression;"
+      "block_cache_compressed_admission_history=4096;"
       "enable_index_compression=false;"
       "block_align=true",
       new_bbto));
@@ -255,7 +257,9 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "max_write_batch_group_size_bytes=1048576;"
                              "wal_dir=path/to/wal_dir;"
                              "db_write_buffer_size=2587;"
+                             "adaptive_write_buffer_size=true;"
                              "max_subcompactions=64330;"
+                             "max_subflushes=3;"
                              "table_cache_numshardbits=28;"
                              "max_open_files=72;"
                              "max_file_opening_threads=35;"
@@ -317,6 +321,9 @@ TEST_F(OptionsSettableTest, DBOptionsAllFieldsSettable) {
                              "preserve_deletes=false;"
                              "concurrent_prepare=false;"
                              "two_write_queues=false;"
+                             "wal_shards=1;"
+                             "pipelined_wal_sync=false;"
+                             "wal_compression=kZSTD;"
                              "manual_wal_flush=false;"
                              "seq_per_batch=false;"
                              "atomic_flush=false;"
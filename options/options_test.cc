@@ -749,6 +749,26 @@ TEST_F(OptionsTest, GetMemTableRepFactoryFromString) {
   ASSERT_NOK(GetMemTableRepFactoryFromString("hash_linkedlist:1000:invalid_opt",
                                              &new_mem_factory));
 
+  ASSERT_OK(GetMemTableRepFactoryFromString("hash_indexed_skip_list",
+                                            &new_mem_factory));
+  ASSERT_OK(GetMemTableRepFactoryFromString("hash_indexed_skip_list:1000",
+                                            &new_mem_factory));
+  ASSERT_EQ(std::string(new_mem_factory->Name()),
+            "HashIndexedSkipListRepFactory");
+  ASSERT_NOK(GetMemTableRepFactoryFromString(
+      "hash_indexed_skip_list:1000:invalid_opt", &new_mem_factory));
+
+  ASSERT_OK(GetMemTableRepFactoryFromString("adaptive_radix_tree",
+                                            &new_mem_factory));
+  ASSERT_EQ(std::string(new_mem_factory->Name()),
+            "AdaptiveRadixTreeRepFactory");
+
+  ASSERT_OK(GetMemTableRepFactoryFromString("bulk_load", &new_mem_factory));
+  ASSERT_OK(GetMemTableRepFactoryFromString("bulk_load:8", &new_mem_factory));
+  ASSERT_EQ(std::string(new_mem_factory->Name()), "BulkLoadRepFactory");
+  ASSERT_NOK(GetMemTableRepFactoryFromString("bulk_load:8:invalid_opt",
+                                             &new_mem_factory));
+
   ASSERT_OK(GetMemTableRepFactoryFromString("vector", &new_mem_factory));
   ASSERT_OK(GetMemTableRepFactoryFromString("vector:1024", &new_mem_factory));
   ASSERT_EQ(std::string(new_mem_factory->Name()), "VectorRepFactory");
@@ -21,6 +21,7 @@
 #include "table/block_based/block_based_table_builder.h"
 #include "table/block_based/block_based_table_factory.h"
 #include "table/block_based/block_based_table_reader.h"
+#include "table/block_based/block_cache_demotion.h"
 #include "table/format.h"
 #include "util/mutexlock.h"
 #include "util/string_util.h"
@@ -262,6 +263,16 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct BlockBasedTableOptions, read_amp_bytes_per_bit),
           OptionType::kSizeT, OptionVerificationType::kNormal,
           OptionTypeFlags::kNone, 0}},
+        {"block_cache_compressed_compression",
+         {offsetof(struct BlockBasedTableOptions,
+                   block_cache_compressed_compression),
+          OptionType::kCompressionType, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone, 0}},
+        {"block_cache_compressed_admission_history",
+         {offsetof(struct BlockBasedTableOptions,
+                   block_cache_compressed_admission_history),
+          OptionType::kSizeT, OptionVerificationType::kNormal,
+          OptionTypeFlags::kNone, 0}},
         {"enable_index_compression",
          {offsetof(struct BlockBasedTableOptions, enable_index_compression),
           OptionType::kBoolean, OptionVerificationType::kNormal,
@@ -296,6 +307,10 @@ BlockBasedTableFactory::BlockBasedTableFactory(
     co.high_pri_pool_ratio = 0.0;
     table_options_.block_cache = NewLRUCache(co);
   }
+  if (table_options_.block_cache_compressed_admission_history > 0) {
+    compressed_cache_admission_ = std::make_shared<CompressedCacheAdmission>(
+        table_options_.block_cache_compressed_admission_history);
+  }
   if (table_options_.block_size_deviation < 0 ||
       table_options_.block_size_deviation > 100) {
     table_options_.block_size_deviation = 0;
@@ -331,7 +346,7 @@ Status BlockBasedTableFactory::NewTableReader(
       prefetch_index_and_filter_in_cache, table_reader_options.skip_filters,
       table_reader_options.level, table_reader_options.immortal,
       table_reader_options.largest_seqno, &tail_prefetch_stats_,
-      table_reader_options.block_cache_tracer);
+      table_reader_options.block_cache_tracer, compressed_cache_admission_);
 }
 
 TableBuilder* BlockBasedTableFactory::NewTableBuilder(
@@ -393,6 +408,15 @@ Status BlockBasedTableFactory::SanitizeOptions(
     return Status::InvalidArgument(
         "block size exceeds maximum number (4GiB) allowed");
   }
+  if (table_options_.block_cache_compressed_compression != kNoCompression &&
+      !CompressionTypeSupported(
+          table_options_.block_cache_compressed_compression)) {
+    return Status::InvalidArgument(
+        "Compression type " +
+        CompressionTypeToString(
+            table_options_.block_cache_compressed_compression) +
+        " for block_cache_compressed is not linked with the binary.");
+  }
   if (table_options_.data_block_index_type ==
           BlockBasedTableOptions::kDataBlockBinaryAndHash &&
       table_options_.data_block_hash_table_util_ratio <= 0) {
@@ -479,6 +503,16 @@ std::string BlockBasedTableFactory::GetPrintableTableOptions() const {
     }
     ret.append("  block_cache_compressed_options:\n");
     ret.append(table_options_.block_cache_compressed->GetPrintableOptions());
+    snprintf(buffer, kBufferSize, "  block_cache_compressed_compression: %s\n",
+             CompressionTypeToString(
+                 table_options_.block_cache_compressed_compression)
+                 .c_str());
+    ret.append(buffer);
+    snprintf(buffer, kBufferSize,
+             "  block_cache_compressed_admission_history: %" ROCKSDB_PRIszt
+             "\n",
+             table_options_.block_cache_compressed_admission_history);
+    ret.append(buffer);
   }
   snprintf(buffer, kBufferSize, "  persistent_cache: %p\n",
            static_cast<void*>(table_options_.persistent_cache.get()));
@@ -24,6 +24,7 @@ namespace ROCKSDB_NAMESPACE {
 struct EnvOptions;
 
 class BlockBasedTableBuilder;
+class CompressedCacheAdmission;
 
 // A class used to track actual bytes written from the tail in the recent SST
 // file opens, and provide a suggestion for following open.
@@ -80,6 +81,8 @@ class BlockBasedTableFactory : public TableFactory {
  private:
   BlockBasedTableOptions table_options_;
   mutable TailPrefetchStats tail_prefetch_stats_;
+  // Shared by the tables, whose evicted blocks may outlive the factory
+  std::shared_ptr<CompressedCacheAdmission> compressed_cache_admission_;
 };
 
 extern const std::string kHashIndexPrefixesBlock;
@@ -234,7 +234,8 @@ void BlockBasedTableIterator::InitDataBlock() {
     //   Enabled from the very first IO when ReadOptions.readahead_size is set.
     block_prefetcher_.PrefetchIfNeeded(rep, data_block_handle,
                                        read_options_.readahead_size,
-                                       is_for_compaction);
+                                       is_for_compaction,
+                                       read_options_.async_io);
 
     Status s;
     table_->NewDataBlockIterator<DataBlockIter>(
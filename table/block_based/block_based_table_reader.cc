@@ -36,6 +36,7 @@
 #include "table/block_based/block_based_filter_block.h"
 #include "table/block_based/block_based_table_factory.h"
 #include "table/block_based/block_based_table_iterator.h"
+#include "table/block_based/block_cache_demotion.h"
 #include "table/block_based/block_prefix_index.h"
 #include "table/block_based/filter_block.h"
 #include "table/block_based/full_filter_block.h"
@@ -74,6 +75,9 @@ typedef BlockBasedTable::IndexReader IndexReader;
 const size_t BlockBasedTable::kMaxAutoReadaheadSize = 256 * 1024;
 
 BlockBasedTable::~BlockBasedTable() {
+  if (rep_->block_cache_demotion != nullptr) {
+    rep_->block_cache_demotion->TableClosed();
+  }
   delete rep_;
 }
 
@@ -128,6 +132,45 @@ class BlocklikeTraits<Block> {
   }
 };
 
+// Data blocks move to the compressed block cache when the block cache evicts
+// them if the table options ask for it, see DemotableBlock. Other entries
+// are never demoted.
+template <typename TBlocklike>
+class DemotionTraits {
+ public:
+  static const bool kDemotable = false;
+
+  static TBlocklike* Create(
+      BlockContents&& /* contents */, size_t /* read_amp_bytes_per_bit */,
+      Statistics* /* statistics */,
+      const std::shared_ptr<const BlockCacheDemotion>& /* demotion */,
+      const Slice& /* compressed_cache_key */,
+      bool /* from_compressed_cache */) {
+    assert(false);
+    return nullptr;
+  }
+
+  static void Delete(TBlocklike* /* block */) { assert(false); }
+};
+
+template <>
+class DemotionTraits<Block> {
+ public:
+  static const bool kDemotable = true;
+
+  static Block* Create(BlockContents&& contents,
+                       size_t read_amp_bytes_per_bit, Statistics* statistics,
+                       const std::shared_ptr<const BlockCacheDemotion>& demotion,
+                       const Slice& compressed_cache_key,
+                       bool from_compressed_cache) {
+    return new DemotableBlock(std::move(contents), read_amp_bytes_per_bit,
+                              statistics, demotion, compressed_cache_key,
+                              from_compressed_cache);
+  }
+
+  static void Delete(Block* block) { DemotableBlock::Delete(block); }
+};
+
 template <>
 class BlocklikeTraits<UncompressionDict> {
  public:
@@ -222,6 +265,7 @@ CacheAllocationPtr CopyBufferToHeap(MemoryAllocator* allocator, Slice& buf) {
   memcpy(heap_buf.get(), buf.data(), buf.size());
   return heap_buf;
 }
+
 }  // namespace
 
 void BlockBasedTable::UpdateCacheHitMetrics(BlockType block_type,
@@ -574,7 +618,9 @@ Status BlockBasedTable::Open(
     const bool prefetch_index_and_filter_in_cache, const bool skip_filters,
     const int level, const bool immortal_table,
     const SequenceNumber largest_seqno, TailPrefetchStats* tail_prefetch_stats,
-    BlockCacheTracer* const block_cache_tracer) {
+    BlockCacheTracer* const block_cache_tracer,
+    const std::shared_ptr<CompressedCacheAdmission>&
+        compressed_cache_admission) {
   table_reader->reset();
 
   Status s;
@@ -631,6 +677,13 @@ Status BlockBasedTable::Open(
         new InternalKeySliceTransform(prefix_extractor));
   }
   SetupCacheKeyPrefix(rep);
+  if (table_options.block_cache_compressed != nullptr &&
+      table_options.block_cache_compressed_compression != kNoCompression) {
+    rep->block_cache_demotion = std::make_shared<BlockCacheDemotion>(
+        table_options.block_cache.get(), table_options.block_cache_compressed,
+        table_options.block_cache_compressed_compression,
+        table_options.format_version, compressed_cache_admission);
+  }
   std::unique_ptr<BlockBasedTable> new_table(
       new BlockBasedTable(rep, block_cache_tracer));
 
@@ -1165,26 +1218,46 @@ Status BlockBasedTable::GetDataBlockFromCache(
 
   // Insert uncompressed block into block cache
   if (s.ok()) {
+    // A block moved up from a demoting compressed block cache leaves it, and
+    // goes back when the block cache evicts it
+    const bool demote = DemotionTraits<TBlocklike>::kDemotable &&
+                        block_type == BlockType::kData &&
+                        rep_->block_cache_demotion != nullptr &&
+                        uncompression_dict.GetRawDict().empty() &&
+                        block_cache != nullptr && contents.own_bytes() &&
+                        read_options.fill_cache;
     std::unique_ptr<TBlocklike> block_holder(
-        BlocklikeTraits<TBlocklike>::Create(
-            std::move(contents), read_amp_bytes_per_bit, statistics,
-            rep_->blocks_definitely_zstd_compressed,
-            rep_->table_options.filter_policy.get()));  // uncompressed block
+        demote ? DemotionTraits<TBlocklike>::Create(
+                     std::move(contents), read_amp_bytes_per_bit, statistics,
+                     rep_->block_cache_demotion, compressed_block_cache_key,
+                     true /* from_compressed_cache */)
+               : BlocklikeTraits<TBlocklike>::Create(
+                     std::move(contents), read_amp_bytes_per_bit, statistics,
+                     rep_->blocks_definitely_zstd_compressed,
+                     rep_->table_options.filter_policy.get()));
 
     if (block_cache != nullptr && block_holder->own_bytes() &&
         read_options.fill_cache) {
       size_t charge = block_holder->ApproximateMemoryUsage();
       Cache::Handle* cache_handle = nullptr;
       s = block_cache->Insert(block_cache_key, block_holder.get(), charge,
-                              &DeleteCachedEntry<TBlocklike>, &cache_handle);
+                              demote ? &DemotableBlock::DemoteAndDelete
+                                     : &DeleteCachedEntry<TBlocklike>,
+                              &cache_handle);
       if (s.ok()) {
         assert(cache_handle != nullptr);
         block->SetCachedValue(block_holder.release(), block_cache,
                               cache_handle);
+        if (demote) {
+          block_cache_compressed->Erase(compressed_block_cache_key);
+        }
 
         UpdateCacheInsertionMetrics(block_type, get_context, charge);
       } else {
         RecordTick(statistics, BLOCK_CACHE_ADD_FAILURES);
+        if (demote) {
+          DemotionTraits<TBlocklike>::Delete(block_holder.release());
+        }
       }
     } else {
       block->SetOwnedValue(block_holder.release());
@@ -1224,6 +1297,28 @@ Status BlockBasedTable::PutDataBlockToCache(
   Status s;
   Statistics* statistics = ioptions.statistics;
 
+  // With a demoting compressed block cache, data blocks only go to the
+  // block cache, and move to the compressed block cache when evicted
+  const bool demote = DemotionTraits<TBlocklike>::kDemotable &&
+                      block_type == BlockType::kData &&
+                      rep_->block_cache_demotion != nullptr &&
+                      uncompression_dict.GetRawDict().empty() &&
+                      block_cache != nullptr;
+  bool demotable = false;
+  auto create_block = [&](BlockContents&& contents) -> TBlocklike* {
+    if (demote && contents.own_bytes()) {
+      demotable = true;
+      return DemotionTraits<TBlocklike>::Create(
+          std::move(contents), read_amp_bytes_per_bit, statistics,
+          rep_->block_cache_demotion, compressed_block_cache_key,
+          false /* from_compressed_cache */);
+    }
+    return BlocklikeTraits<TBlocklike>::Create(
+        std::move(contents), read_amp_bytes_per_bit, statistics,
+        rep_->blocks_definitely_zstd_compressed,
+        rep_->table_options.filter_policy.get());
+  };
+
   std::unique_ptr<TBlocklike> block_holder;
   if (raw_block_comp_type != kNoCompression) {
     // Retrieve the uncompressed contents into a new buffer
@@ -1238,20 +1333,14 @@ Status BlockBasedTable::PutDataBlockToCache(
       return s;
     }
 
-    block_holder.reset(BlocklikeTraits<TBlocklike>::Create(
-        std::move(uncompressed_block_contents), read_amp_bytes_per_bit,
-        statistics, rep_->blocks_definitely_zstd_compressed,
-        rep_->table_options.filter_policy.get()));
+    block_holder.reset(create_block(std::move(uncompressed_block_contents)));
   } else {
-    block_holder.reset(BlocklikeTraits<TBlocklike>::Create(
-        std::move(*raw_block_contents), read_amp_bytes_per_bit, statistics,
-        rep_->blocks_definitely_zstd_compressed,
-        rep_->table_options.filter_policy.get()));
+    block_holder.reset(create_block(std::move(*raw_block_contents)));
   }
 
   // Insert compressed block into compressed block cache.
   // Release the hold on the compressed cache entry immediately.
-  if (block_cache_compressed != nullptr &&
+  if (block_cache_compressed != nullptr && !demote &&
       raw_block_comp_type != kNoCompression && raw_block_contents != nullptr &&
       raw_block_contents->own_bytes()) {
 #ifndef NDEBUG
@@ -1280,8 +1369,9 @@ Status BlockBasedTable::PutDataBlockToCache(
     size_t charge = block_holder->ApproximateMemoryUsage();
     Cache::Handle* cache_handle = nullptr;
     s = block_cache->Insert(block_cache_key, block_holder.get(), charge,
-                            &DeleteCachedEntry<TBlocklike>, &cache_handle,
-                            priority);
+                            demotable ? &DemotableBlock::DemoteAndDelete
+                                      : &DeleteCachedEntry<TBlocklike>,
+                            &cache_handle, priority);
     if (s.ok()) {
       assert(cache_handle != nullptr);
       cached_block->SetCachedValue(block_holder.release(), block_cache,
@@ -1290,6 +1380,9 @@ Status BlockBasedTable::PutDataBlockToCache(
       UpdateCacheInsertionMetrics(block_type, get_context, charge);
     } else {
       RecordTick(statistics, BLOCK_CACHE_ADD_FAILURES);
+      if (demotable) {
+        DemotionTraits<TBlocklike>::Delete(block_holder.release());
+      }
     }
   } else {
     cached_block->SetOwnedValue(block_holder.release());
@@ -2612,6 +2705,116 @@ void BlockBasedTable::MultiGet(const ReadOptions& read_options,
   }
 }
 
+Status BlockBasedTable::PrefetchForMultiGet(
+    const ReadOptions& read_options, const MultiGetRange* mget_range,
+    const SliceTransform* prefix_extractor, bool skip_filters) {
+  if (rep_->table_options.block_cache == nullptr || !read_options.fill_cache ||
+      read_options.read_tier == kBlockCacheTier) {
+    // The blocks would be dropped right after being read.
+    return Status::OK();
+  }
+
+  FilterBlockReader* const filter =
+      !skip_filters ? rep_->filter.get() : nullptr;
+  MultiGetRange data_block_range(*mget_range, mget_range->begin(),
+                                 mget_range->end());
+  BlockCacheLookupContext lookup_context{TableReaderCaller::kUserMultiGet};
+  FullFilterKeysMayMatch(read_options, filter, &data_block_range,
+                         false /* no_io */, prefix_extractor, &lookup_context);
+  if (data_block_range.empty()) {
+    return Status::OK();
+  }
+
+  IndexBlockIter iiter_on_stack;
+  bool need_upper_bound_check = false;
+  if (rep_->index_type == BlockBasedTableOptions::kHashSearch) {
+    need_upper_bound_check = PrefixExtractorChanged(
+        rep_->table_properties.get(), prefix_extractor);
+  }
+  auto iiter = NewIndexIterator(read_options, need_upper_bound_check,
+                                &iiter_on_stack, /*get_context=*/nullptr,
+                                &lookup_context);
+  std::unique_ptr<InternalIteratorBase<IndexValue>> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+
+  CachableEntry<UncompressionDict> uncompression_dict;
+  if (rep_->uncompression_dict_reader) {
+    Status s =
+        rep_->uncompression_dict_reader->GetOrReadUncompressionDictionary(
+            nullptr /* prefetch_buffer */, false /* no_io */,
+            nullptr /* get_context */, &lookup_context, &uncompression_dict);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  const UncompressionDict& dict = uncompression_dict.GetValue()
+                                      ? *uncompression_dict.GetValue()
+                                      : UncompressionDict::GetEmptyDict();
+
+  // Same block selection as MultiGet(), minus the lookups: only the first
+  // block each key maps to is read, and blocks already cached are skipped.
+  uint64_t offset = std::numeric_limits<uint64_t>::max();
+  autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> block_handles;
+  autovector<CachableEntry<Block>, MultiGetContext::MAX_BATCH_SIZE> results;
+  autovector<Status, MultiGetContext::MAX_BATCH_SIZE> statuses;
+  size_t total_len = 0;
+  ReadOptions ro = read_options;
+  ro.read_tier = kBlockCacheTier;
+  for (auto miter = data_block_range.begin(); miter != data_block_range.end();
+       ++miter) {
+    iiter->Seek(miter->ikey);
+    if (!iiter->Valid()) {
+      data_block_range.SkipKey(miter);
+      continue;
+    }
+    statuses.emplace_back();
+    results.emplace_back();
+    BlockHandle handle = iiter->value().handle;
+    if (handle.offset() == offset) {
+      block_handles.emplace_back(BlockHandle::NullBlockHandle());
+      continue;
+    }
+    offset = handle.offset();
+    BlockCacheLookupContext lookup_data_block_context(
+        TableReaderCaller::kUserMultiGet);
+    Status s = RetrieveBlock(
+        nullptr, ro, handle, dict, &(results.back()), BlockType::kData,
+        nullptr /* get_context */, &lookup_data_block_context,
+        /* for_compaction */ false, /* use_cache */ true);
+    if (s.ok() && !results.back().IsEmpty()) {
+      block_handles.emplace_back(BlockHandle::NullBlockHandle());
+    } else {
+      block_handles.emplace_back(handle);
+      total_len += block_size(handle);
+    }
+  }
+
+  if (total_len) {
+    char stack_buf[kMultiGetReadStackBufSize];
+    std::unique_ptr<char[]> block_buf;
+    char* scratch = nullptr;
+    if (rep_->table_options.block_cache_compressed == nullptr &&
+        rep_->blocks_maybe_compressed) {
+      if (total_len <= kMultiGetReadStackBufSize) {
+        scratch = stack_buf;
+      } else {
+        scratch = new char[total_len];
+        block_buf.reset(scratch);
+      }
+    }
+    RetrieveMultipleBlocks(read_options, &data_block_range, &block_handles,
+                           &statuses, &results, scratch, dict);
+    for (const Status& s : statuses) {
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  return iiter->status();
+}
+
 Status BlockBasedTable::Prefetch(const Slice* const begin,
                                  const Slice* const end) {
   auto& comparator = rep_->internal_comparator;
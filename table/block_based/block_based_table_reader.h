@@ -24,7 +24,9 @@
 
 namespace ROCKSDB_NAMESPACE {
 
+class BlockCacheDemotion;
 class Cache;
+class CompressedCacheAdmission;
 class FilterBlockReader;
 class BlockBasedFilterBlockReader;
 class FullFilterBlockReader;
@@ -98,7 +100,9 @@ class BlockBasedTable : public TableReader {
                      const bool immortal_table = false,
                      const SequenceNumber largest_seqno = 0,
                      TailPrefetchStats* tail_prefetch_stats = nullptr,
-                     BlockCacheTracer* const block_cache_tracer = nullptr);
+                     BlockCacheTracer* const block_cache_tracer = nullptr,
+                     const std::shared_ptr<CompressedCacheAdmission>&
+                         compressed_cache_admission = nullptr);
 
   bool PrefixMayMatch(const Slice& internal_key,
                       const ReadOptions& read_options,
@@ -131,6 +135,11 @@ class BlockBasedTable : public TableReader {
                 const SliceTransform* prefix_extractor,
                 bool skip_filters = false) override;
 
+  Status PrefetchForMultiGet(const ReadOptions& readOptions,
+                             const MultiGetContext::Range* mget_range,
+                             const SliceTransform* prefix_extractor,
+                             bool skip_filters = false) override;
+
   // Pre-fetch the disk blocks that correspond to the key range specified by
   // (kbegin, kend). The call will return error status in the event of
   // IO or iteration error.
@@ -563,6 +572,10 @@ struct BlockBasedTable::Rep {
   bool index_key_includes_seq = true;
   bool index_value_is_full = true;
 
+  // Moves evicted data blocks to the compressed block cache, if
+  // block_cache_compressed_compression is set
+  std::shared_ptr<BlockCacheDemotion> block_cache_demotion;
+
   const bool immortal_table;
 
   SequenceNumber get_global_seqno(BlockType block_type) const {
@@ -589,12 +602,15 @@ struct BlockBasedTable::Rep {
   uint64_t sst_number_for_tracing() const {
     return file ? TableFileNameToNumber(file->file_name()) : UINT64_MAX;
   }
-  void CreateFilePrefetchBuffer(
-      size_t readahead_size, size_t max_readahead_size,
-      std::unique_ptr<FilePrefetchBuffer>* fpb) const {
-    fpb->reset(new FilePrefetchBuffer(file.get(), readahead_size,
-                                      max_readahead_size,
-                                      !ioptions.allow_mmap_reads /* enable */));
+  // async_io double-buffers the readahead on the Env::Priority::USER pool
+  void CreateFilePrefetchBuffer(size_t readahead_size,
+                                size_t max_readahead_size,
+                                std::unique_ptr<FilePrefetchBuffer>* fpb,
+                                bool async_io = false) const {
+    fpb->reset(new FilePrefetchBuffer(
+        file.get(), readahead_size, max_readahead_size,
+        !ioptions.allow_mmap_reads /* enable */, false /* track_min_offset */,
+        async_io ? ioptions.env : nullptr));
   }
 };
 }  // namespace ROCKSDB_NAMESPACE
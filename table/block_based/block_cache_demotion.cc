@@ -0,0 +1,144 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "table/block_based/block_cache_demotion.h"
+
+#include <string.h>
+
+#include "memory/memory_allocator.h"
+#include "table/block_based/block_based_table_builder.h"
+#include "table/format.h"
+#include "util/compression.h"
+#include "util/hash.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+
+// Compresses the contents of a block so that they can be kept in the
+// compressed block cache. The result is laid out like a raw block read from
+// the file, i.e. followed by its compression type. Returns nullptr if the
+// block does not compress well enough to be worth caching.
+BlockContents* CompressBlockForCache(const Slice& raw, CompressionType type,
+                                     uint32_t format_version,
+                                     MemoryAllocator* allocator) {
+  CompressionOptions opts;
+  CompressionContext context(type);
+  CompressionInfo info(opts, context, CompressionDict::GetEmptyDict(), type,
+                       0 /* sample_for_compression */);
+  std::string compressed;
+  CompressionType result_type;
+  Slice result =
+      CompressBlock(raw, info, &result_type, format_version,
+                    false /* do_sample */, &compressed, nullptr, nullptr);
+  if (result_type == kNoCompression) {
+    return nullptr;
+  }
+  CacheAllocationPtr buf = AllocateBlock(result.size() + 1, allocator);
+  memcpy(buf.get(), result.data(), result.size());
+  buf[result.size()] = static_cast<char>(result_type);
+  BlockContents* contents = new BlockContents(std::move(buf), result.size());
+#ifndef NDEBUG
+  contents->is_raw_block = true;
+#endif  // NDEBUG
+  return contents;
+}
+
+void DeleteCompressedBlock(const Slice& /*key*/, void* value) {
+  delete reinterpret_cast<BlockContents*>(value);
+}
+
+}  // namespace
+
+CompressedCacheAdmission::CompressedCacheAdmission(size_t history)
+    : history_(history),
+      keys_(history > 0 ? new std::atomic<uint64_t>[history] : nullptr) {
+  for (size_t i = 0; i < history_; i++) {
+    keys_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+bool CompressedCacheAdmission::Admit(const Slice& key) {
+  if (history_ == 0) {
+    return true;
+  }
+  // Never 0, which marks an empty slot
+  const uint64_t hash = GetSliceNPHash64(key) | 1;
+  std::atomic<uint64_t>& slot = keys_[hash % history_];
+  // Racing evictions may lose a key or admit a block twice, which only
+  // makes the policy a little less precise.
+  if (slot.load(std::memory_order_relaxed) == hash) {
+    slot.store(0, std::memory_order_relaxed);
+    return true;
+  }
+  slot.store(hash, std::memory_order_relaxed);
+  return false;
+}
+
+BlockCacheDemotion::BlockCacheDemotion(
+    Cache* block_cache, std::shared_ptr<Cache> compressed_cache,
+    CompressionType compression_type, uint32_t format_version,
+    std::shared_ptr<CompressedCacheAdmission> admission)
+    : block_cache_(block_cache),
+      compressed_cache_(std::move(compressed_cache)),
+      compression_type_(compression_type),
+      format_version_(format_version),
+      admission_(std::move(admission)),
+      table_closed_(false) {}
+
+void BlockCacheDemotion::Demote(const Slice& key, const Slice& contents,
+                                bool from_compressed_cache) const {
+  // The blocks of a closed table are not read through it again, and a block
+  // cache that shrinks or is destroyed drops many blocks at once on the
+  // thread resizing or destroying it. Compressing those would only slow
+  // that thread down.
+  if (table_closed_.load(std::memory_order_relaxed) ||
+      (block_cache_ != nullptr && block_cache_->IsDraining())) {
+    return;
+  }
+  if (!from_compressed_cache && admission_ != nullptr &&
+      !admission_->Admit(key)) {
+    return;
+  }
+  std::unique_ptr<BlockContents> compressed(
+      CompressBlockForCache(contents, compression_type_, format_version_,
+                            compressed_cache_->memory_allocator()));
+  if (compressed == nullptr) {
+    return;
+  }
+  const size_t charge = compressed->ApproximateMemoryUsage();
+  if (compressed_cache_
+          ->Insert(key, compressed.get(), charge, &DeleteCompressedBlock)
+          .ok()) {
+    compressed.release();
+  }
+}
+
+DemotableBlock::DemotableBlock(
+    BlockContents&& contents, size_t read_amp_bytes_per_bit,
+    Statistics* statistics, std::shared_ptr<const BlockCacheDemotion> demotion,
+    const Slice& compressed_cache_key, bool from_compressed_cache)
+    : Block(std::move(contents), read_amp_bytes_per_bit, statistics),
+      demotion_(std::move(demotion)),
+      compressed_cache_key_(compressed_cache_key.ToString()),
+      from_compressed_cache_(from_compressed_cache) {}
+
+void DemotableBlock::DemoteAndDelete(const Slice& /*key*/, void* value) {
+  DemotableBlock* block =
+      static_cast<DemotableBlock*>(static_cast<Block*>(value));
+  // A block that failed to parse has a size of 0
+  if (block->size() > 0) {
+    block->demotion_->Demote(block->compressed_cache_key_,
+                             Slice(block->data(), block->size()),
+                             block->from_compressed_cache_);
+  }
+  delete block;
+}
+
+void DemotableBlock::Delete(Block* block) {
+  delete static_cast<DemotableBlock*>(block);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,95 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "rocksdb/cache.h"
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "table/block_based/block.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Admission policy of the compressed block cache for the blocks evicted from
+// the block cache. It remembers the keys of the last blocks it turned away
+// and admits a block when it is evicted again while its key is still
+// remembered, so that blocks read once, e.g. by a scan, do not push the ones
+// that keep being read out of the compressed block cache.
+class CompressedCacheAdmission {
+ public:
+  // @history: number of keys remembered; 0 admits every block
+  explicit CompressedCacheAdmission(size_t history);
+
+  // Called with the compressed block cache key of every evicted block
+  bool Admit(const Slice& key);
+
+ private:
+  const size_t history_;
+  // Hashes of the keys turned away, 0 for none. A key replaces the one
+  // remembered in its slot.
+  std::unique_ptr<std::atomic<uint64_t>[]> keys_;
+};
+
+// Moves the data blocks of a table that the block cache evicts to the
+// compressed block cache, compressed with
+// BlockBasedTableOptions::block_cache_compressed_compression.
+class BlockCacheDemotion {
+ public:
+  // @block_cache: the cache holding the blocks of the table, may be nullptr
+  BlockCacheDemotion(Cache* block_cache,
+                     std::shared_ptr<Cache> compressed_cache,
+                     CompressionType compression_type,
+                     uint32_t format_version,
+                     std::shared_ptr<CompressedCacheAdmission> admission);
+
+  // Adds the contents of an evicted block to the compressed block cache
+  // under `key`, if the admission policy lets them in and they compress
+  // well. Blocks that came from the compressed block cache are let in
+  // without asking the admission policy. Nothing is added once the table is
+  // closed or while the block cache is draining.
+  void Demote(const Slice& key, const Slice& contents,
+              bool from_compressed_cache) const;
+
+  // Called when the table is closed, e.g. because its file was deleted
+  void TableClosed() { table_closed_.store(true, std::memory_order_relaxed); }
+
+ private:
+  Cache* const block_cache_;
+  const std::shared_ptr<Cache> compressed_cache_;
+  const CompressionType compression_type_;
+  const uint32_t format_version_;
+  const std::shared_ptr<CompressedCacheAdmission> admission_;
+  std::atomic<bool> table_closed_;
+};
+
+// A data block in the block cache that is demoted to the compressed block
+// cache when the block cache evicts it. The deleter of its cache entry is
+// DemoteAndDelete(); a block that never made it into the block cache is
+// deleted with Delete().
+class DemotableBlock : public Block {
+ public:
+  DemotableBlock(BlockContents&& contents, size_t read_amp_bytes_per_bit,
+                 Statistics* statistics,
+                 std::shared_ptr<const BlockCacheDemotion> demotion,
+                 const Slice& compressed_cache_key,
+                 bool from_compressed_cache);
+
+  static void DemoteAndDelete(const Slice& key, void* value);
+
+  static void Delete(Block* block);
+
+ private:
+  const std::shared_ptr<const BlockCacheDemotion> demotion_;
+  const std::string compressed_cache_key_;
+  const bool from_compressed_cache_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -12,7 +12,8 @@ namespace ROCKSDB_NAMESPACE {
 void BlockPrefetcher::PrefetchIfNeeded(const BlockBasedTable::Rep* rep,
                                        const BlockHandle& handle,
                                        size_t readahead_size,
-                                       bool is_for_compaction) {
+                                       bool is_for_compaction,
+                                       bool async_io) {
   if (!is_for_compaction) {
     if (readahead_size == 0) {
       // Implicit auto readahead
@@ -37,7 +38,7 @@ void BlockPrefetcher::PrefetchIfNeeded(const BlockBasedTable::Rep* rep,
           // Let FilePrefetchBuffer take care of the readahead.
           rep->CreateFilePrefetchBuffer(BlockBasedTable::kInitAutoReadaheadSize,
                                         BlockBasedTable::kMaxAutoReadaheadSize,
-                                        &prefetch_buffer_);
+                                        &prefetch_buffer_, async_io);
         }
       }
     } else if (!prefetch_buffer_) {
@@ -45,12 +46,12 @@ void BlockPrefetcher::PrefetchIfNeeded(const BlockBasedTable::Rep* rep,
       // The actual condition is:
       // if (readahead_size != 0 && !prefetch_buffer_)
       rep->CreateFilePrefetchBuffer(readahead_size, readahead_size,
-                                    &prefetch_buffer_);
+                                    &prefetch_buffer_, async_io);
     }
   } else if (!prefetch_buffer_) {
     rep->CreateFilePrefetchBuffer(compaction_readahead_size_,
                                   compaction_readahead_size_,
-                                  &prefetch_buffer_);
+                                  &prefetch_buffer_, async_io);
   }
 }
 }  // namespace ROCKSDB_NAMESPACE
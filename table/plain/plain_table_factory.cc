@@ -166,6 +166,30 @@ Status GetMemTableRepFactoryFromString(
     } else if (1 == len) {
       mem_factory = NewHashLinkListRepFactory();
     }
+  } else if (opts_list[0] == "hash_indexed_skip_list") {
+    // Expecting format
+    // hash_indexed_skip_list:<hash_bucket_count>
+    if (2 == len) {
+      size_t hash_bucket_count = ParseSizeT(opts_list[1]);
+      mem_factory = NewHashIndexedSkipListRepFactory(hash_bucket_count);
+    } else if (1 == len) {
+      mem_factory = NewHashIndexedSkipListRepFactory();
+    }
+  } else if (opts_list[0] == "adaptive_radix_tree") {
+    // Expecting format
+    // adaptive_radix_tree
+    if (1 == len) {
+      mem_factory = NewAdaptiveRadixTreeRepFactory();
+    }
+  } else if (opts_list[0] == "bulk_load") {
+    // Expecting format
+    // bulk_load:<sort_threads>
+    if (2 == len) {
+      size_t sort_threads = ParseSizeT(opts_list[1]);
+      mem_factory = NewBulkLoadRepFactory(sort_threads);
+    } else if (1 == len) {
+      mem_factory = NewBulkLoadRepFactory();
+    }
   } else if (opts_list[0] == "vector") {
     // Expecting format
     // vector:<count>
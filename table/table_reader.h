@@ -110,6 +110,19 @@ class TableReader {
     }
   }
 
+  // Reads the data blocks that the keys in `mget_range` may live in into the
+  // block cache without looking the keys up, so that a later MultiGet() of
+  // the same keys does not have to wait for I/O. The keys do not need to
+  // have a GetContext. Lets MultiGet issue the reads of several files
+  // concurrently.
+  virtual Status PrefetchForMultiGet(
+      const ReadOptions& /*readOptions*/,
+      const MultiGetContext::Range* /*mget_range*/,
+      const SliceTransform* /*prefix_extractor*/,
+      bool /*skip_filters*/ = false) {
+    return Status::OK();
+  }
+
   // Prefetch data corresponding to a give range of keys
   // Typically this functionality is required for table implementations that
   // persists the data on a non volatile storage medium like disk/SSD
@@ -126,7 +126,9 @@ DEFINE_string(
     "randomtransaction,"
     "randomreplacekeys,"
     "timeseries,"
-    "getmergeoperands",
+    "getmergeoperands,"
+    "readrandomtier,"
+    "tiercompare",
 
     "Comma-separated list of operations to run in the specified"
     " order. Available benchmarks:\n"
@@ -151,6 +153,8 @@ DEFINE_string(
     "\treadreverse   -- read N times in reverse order\n"
     "\treadrandom    -- read N times in random order\n"
     "\treadmissing   -- read N missing keys in random order\n"
+    "\treadrandomasync -- readrandom through GetAsync with up to "
+    "async_get_depth lookups in flight per thread\n"
     "\treadwhilewriting      -- 1 writer, N threads doing random "
     "reads\n"
     "\treadwhilemerging      -- 1 merger, N threads doing random "
@@ -188,6 +192,13 @@ DEFINE_string(
     "the old version and putting the new version\n\n"
     "\ttimeseries            -- 1 writer generates time series data "
     "and multiple readers doing random reads on id\n\n"
+    "\treadrandomtier        -- readrandom that also reports the SST files "
+    "probed through group filters and the SST files read per Get. "
+    "Requires --statistics\n"
+    "\ttiercompare           -- run fillrandom, overwrite and readrandom "
+    "against a fresh leveled DB and a fresh tier DB and print write "
+    "amplification, read amplification and filter skip ratios side by "
+    "side\n\n"
     "Meta operations:\n"
     "\tcompact     -- Compact the entire DB; If multiple, randomly choose one\n"
     "\tcompactall  -- Compact the entire DB\n"
@@ -320,6 +331,11 @@ DEFINE_int64(db_write_buffer_size,
 DEFINE_bool(cost_write_buffer_to_cache, false,
             "The usage of memtable is costed to the block cache");
 
+DEFINE_bool(adaptive_write_buffer_size,
+            ROCKSDB_NAMESPACE::Options().adaptive_write_buffer_size,
+            "Size new memtables from the observed write rates of the column "
+            "families");
+
 DEFINE_int64(write_buffer_size, ROCKSDB_NAMESPACE::Options().write_buffer_size,
              "Number of bytes to buffer in memtable before compacting");
 
@@ -398,6 +414,13 @@ static const bool FLAGS_subcompactions_dummy
     __attribute__((__unused__)) = RegisterFlagValidator(&FLAGS_subcompactions,
                                                     &ValidateUint32Range);
 
+DEFINE_uint64(subflushes, 1,
+              "Maximum number of threads splitting a memtable flush into "
+              "key ranges written to separate L0 files.");
+static const bool FLAGS_subflushes_dummy
+    __attribute__((__unused__)) = RegisterFlagValidator(&FLAGS_subflushes,
+                                                    &ValidateUint32Range);
+
 DEFINE_int32(max_background_flushes,
              ROCKSDB_NAMESPACE::Options().max_background_flushes,
              "The maximum number of concurrent background flushes"
@@ -534,6 +557,16 @@ DEFINE_double(data_block_hash_table_util_ratio, 0.75,
 DEFINE_int64(compressed_cache_size, -1,
              "Number of bytes to use as a cache of compressed data.");
 
+DEFINE_string(compressed_cache_compression, "none",
+              "Algorithm used to compress data blocks evicted from the block "
+              "cache and move them to the compressed block cache (none = "
+              "cache blocks compressed on disk as they are read)");
+
+DEFINE_int64(compressed_cache_admission_history, 0,
+             "Number of keys of blocks turned away from the compressed block "
+             "cache that are remembered; a demoted block is only admitted if "
+             "it is evicted again while remembered (0 = admit every block)");
+
 DEFINE_int64(row_cache_size, 0,
              "Number of bytes to use as a cache of individual rows"
              " (0 = disabled).");
@@ -1006,6 +1039,19 @@ DEFINE_bool(
     "Enable the unordered write feature, which provides higher throughput but "
     "relaxes the guarantees around atomic reads and immutable snapshots");
 
+DEFINE_uint64(wal_shards, ROCKSDB_NAMESPACE::Options().wal_shards,
+              "Number of WAL shards appended in parallel. Values above 1 "
+              "disable enable_pipelined_write");
+
+DEFINE_bool(pipelined_wal_sync, ROCKSDB_NAMESPACE::Options().pipelined_wal_sync,
+            "Sync the WAL for sync writes on a dedicated thread, overlapping "
+            "the sync of a write group with the append of the next ones. "
+            "Requires --enable_pipelined_write=false");
+
+DEFINE_string(wal_compression, "none",
+              "Algorithm to compress the WAL with as a stream per log file. "
+              "Only zstd and lz4 are supported");
+
 DEFINE_bool(allow_concurrent_memtable_write, true,
             "Allow multi-writers to update mem tables in parallel.");
 
@@ -1266,11 +1312,27 @@ DEFINE_int64(multiread_stride, 0,
              "Stride length for the keys in a MultiGet batch");
 DEFINE_bool(multiread_batched, false, "Use the new MultiGet API");
 
+DEFINE_bool(async_io, false,
+            "Read the blocks of all the files a MultiGet batch may visit "
+            "concurrently, and the next readahead window of seekrandom "
+            "scans in the background, on num_user_threads threads");
+
+DEFINE_int32(num_user_threads, 0,
+             "Size of the USER thread pool, used by --async_io and "
+             "readrandomasync");
+
+DEFINE_int32(async_get_depth, 32,
+             "Number of GetAsync lookups each readrandomasync thread keeps "
+             "in flight");
+
 enum RepFactory {
   kSkipList,
   kPrefixHash,
   kVectorRep,
   kHashLinkedList,
+  kHashIndexedSkipList,
+  kAdaptiveRadixTree,
+  kBulkLoad,
 };
 
 static enum RepFactory StringToRepFactory(const char* ctype) {
@@ -1284,6 +1346,12 @@ static enum RepFactory StringToRepFactory(const char* ctype) {
     return kVectorRep;
   else if (!strcasecmp(ctype, "hash_linkedlist"))
     return kHashLinkedList;
+  else if (!strcasecmp(ctype, "hash_indexed_skip_list"))
+    return kHashIndexedSkipList;
+  else if (!strcasecmp(ctype, "adaptive_radix_tree"))
+    return kAdaptiveRadixTree;
+  else if (!strcasecmp(ctype, "bulk_load"))
+    return kBulkLoad;
 
   fprintf(stdout, "Cannot parse memreptable %s\n", ctype);
   return kSkipList;
@@ -1315,6 +1383,68 @@ DEFINE_int32(readahead_size, 0, "Iterator readahead size");
 
 DEFINE_string(persistent_file_path, "/mnt/pmem0", "The path of the persistent memory file");
 DEFINE_bool(is_tiered, false, "if use Tiered Compaction Read Mode");
+DEFINE_uint64(persistent_file_size, 1024 * 1024 * 1024,
+              "Initial size (and growth step) of the persistent memory pool "
+              "holding the group filters of all column families in Tiered "
+              "mode");
+DEFINE_uint64(persistent_file_max_size,
+              ROCKSDB_NAMESPACE::Options().persistent_file_max_size_,
+              "Size the group filter pool may grow to. Once it is reached, "
+              "column families over their share of the pool write new groups "
+              "without a group filter");
+DEFINE_uint64(persistent_emulate_read_latency_ns,
+              ROCKSDB_NAMESPACE::Options().persistent_emulate_read_latency_ns_,
+              "Emulated PMem read latency (ns) per access granule of the "
+              "group filter pool. Any non-zero emulated latency turns PMem "
+              "emulation on, so the pool can live in ordinary memory");
+DEFINE_uint64(persistent_emulate_write_latency_ns,
+              ROCKSDB_NAMESPACE::Options().persistent_emulate_write_latency_ns_,
+              "Emulated PMem write latency (ns) per access granule");
+DEFINE_uint64(persistent_emulate_flush_latency_ns,
+              ROCKSDB_NAMESPACE::Options().persistent_emulate_flush_latency_ns_,
+              "Emulated PMem latency (ns) of one persist/flush");
+DEFINE_uint64(persistent_emulate_access_granularity,
+              ROCKSDB_NAMESPACE::Options().persistent_emulate_access_granularity_,
+              "Emulated PMem internal access granularity in bytes");
+DEFINE_int32(persistent_map_prefault_threads,
+             ROCKSDB_NAMESPACE::Options().persistent_map_prefault_threads_,
+             "Number of background threads that prefault an existing group "
+             "filter pool right after it is opened. 0 disables prefaulting");
+DEFINE_bool(persistent_map_huge_pages,
+            ROCKSDB_NAMESPACE::Options().persistent_map_huge_pages_,
+            "Align a new group filter pool to 2MB and ask for transparent "
+            "huge pages when mapping it");
+DEFINE_int32(persistent_map_numa_node,
+             ROCKSDB_NAMESPACE::Options().persistent_map_numa_node_,
+             "Bind the group filter pool to this NUMA node. -1 leaves the "
+             "placement to persistent_map_numa_interleave");
+DEFINE_bool(persistent_map_numa_interleave,
+            ROCKSDB_NAMESPACE::Options().persistent_map_numa_interleave_,
+            "Interleave the group filter pool across all NUMA nodes");
+DEFINE_uint64(persistent_block_size, 1024 * 1024,
+              "Size of one block (one group filter) in the persistent memory "
+              "file. Must match the block size the file was created with");
+DEFINE_int32(tier_max_group_depth_trigger,
+             ROCKSDB_NAMESPACE::Options().tier_max_group_depth_trigger,
+             "In Tiered mode, a level is compacted once one of its vertical "
+             "groups is this many files deep");
+DEFINE_double(tier_avg_group_depth_trigger,
+              ROCKSDB_NAMESPACE::Options().tier_avg_group_depth_trigger,
+              "In Tiered mode, a level is compacted once the average depth of "
+              "its vertical groups reaches this value");
+DEFINE_int32(tier_group_depth_slowdown_writes_trigger,
+             ROCKSDB_NAMESPACE::Options()
+                 .tier_group_depth_slowdown_writes_trigger,
+             "In Tiered mode, writes are slowed down once a vertical group is "
+             "this many files deep");
+DEFINE_int32(tier_group_depth_stop_writes_trigger,
+             ROCKSDB_NAMESPACE::Options().tier_group_depth_stop_writes_trigger,
+             "In Tiered mode, writes are stopped once a vertical group is this "
+             "many files deep");
+DEFINE_bool(tier_prefix_filter,
+            ROCKSDB_NAMESPACE::Options().tier_prefix_filter,
+            "In Tiered mode, also add key prefixes to the group filters so "
+            "that prefix seeks can skip vertical groups");
 
 static const bool FLAGS_soft_rate_limit_dummy __attribute__((__unused__)) =
     RegisterFlagValidator(&FLAGS_soft_rate_limit, &ValidateRateLimit);
@@ -2331,6 +2461,27 @@ class Benchmark {
   bool use_blob_db_;
   std::vector<std::string> keys_;
 
+  // Point lookup counters used by the tier benchmarks.
+  struct TierReadCounters {
+    uint64_t gets = 0;
+    uint64_t filter_probed = 0;
+    uint64_t filter_useful = 0;
+    uint64_t bloom_useful = 0;
+    uint64_t files_read = 0;
+
+    explicit TierReadCounters(Statistics* stats = nullptr) {
+      if (stats != nullptr) {
+        gets = stats->getTickerCount(NUMBER_KEYS_READ);
+        filter_probed = stats->getTickerCount(TIER_GROUP_FILTER_PROBED);
+        filter_useful = stats->getTickerCount(TIER_GROUP_FILTER_USEFUL);
+        bloom_useful = stats->getTickerCount(BLOOM_FILTER_USEFUL);
+        files_read = stats->getTickerCount(GET_SST_FILES_READ);
+      }
+    }
+  };
+  // Snapshot taken right before readrandomtier starts.
+  TierReadCounters tier_read_base_;
+
   class ErrorHandlerListener : public EventListener {
    public:
 #ifndef ROCKSDB_LITE
@@ -2491,6 +2642,15 @@ class Benchmark {
       case kHashLinkedList:
         fprintf(stdout, "Memtablerep: hash_linkedlist\n");
         break;
+      case kHashIndexedSkipList:
+        fprintf(stdout, "Memtablerep: hash_indexed_skip_list\n");
+        break;
+      case kAdaptiveRadixTree:
+        fprintf(stdout, "Memtablerep: adaptive_radix_tree\n");
+        break;
+      case kBulkLoad:
+        fprintf(stdout, "Memtablerep: bulk_load\n");
+        break;
     }
     fprintf(stdout, "Perf Level: %d\n", FLAGS_perf_level);
 
@@ -3018,6 +3178,18 @@ class Benchmark {
                   entries_per_batch_);
         }
         method = &Benchmark::ReadRandom;
+      } else if (name == "readrandomtier") {
+        if (dbstats == nullptr) {
+          fprintf(stderr, "readrandomtier requires --statistics\n");
+          exit(1);
+        }
+        tier_read_base_ = TierReadCounters(dbstats.get());
+        method = &Benchmark::ReadRandom;
+        post_process_method = &Benchmark::ReportTierReadAmp;
+      } else if (name == "tiercompare") {
+        TierCompare();
+      } else if (name == "readrandomasync") {
+        method = &Benchmark::ReadRandomAsync;
       } else if (name == "readrandomfast") {
         method = &Benchmark::ReadRandomFast;
       } else if (name == "multireadrandom") {
@@ -3631,6 +3803,7 @@ class Benchmark {
       options.write_buffer_manager.reset(
           new WriteBufferManager(FLAGS_db_write_buffer_size, cache_));
     }
+    options.adaptive_write_buffer_size = FLAGS_adaptive_write_buffer_size;
     options.write_buffer_size = FLAGS_write_buffer_size;
     options.max_write_buffer_number = FLAGS_max_write_buffer_number;
     options.min_write_buffer_number_to_merge =
@@ -3643,6 +3816,7 @@ class Benchmark {
     options.max_background_compactions = FLAGS_max_background_compactions;
     options.max_subcompactions = static_cast<uint32_t>(FLAGS_subcompactions);
     options.max_background_flushes = FLAGS_max_background_flushes;
+    options.max_subflushes = static_cast<uint32_t>(FLAGS_subflushes);
     options.compaction_style = FLAGS_compaction_style_e;
     options.compaction_pri = FLAGS_compaction_pri_e;
     options.allow_mmap_reads = FLAGS_mmap_read;
@@ -3696,7 +3870,31 @@ class Benchmark {
     options.max_bytes_for_level_multiplier =
         FLAGS_max_bytes_for_level_multiplier;
     options.persistent_file_path_ = FLAGS_persistent_file_path;
+    options.persistent_file_size_ = FLAGS_persistent_file_size;
+    options.persistent_block_size_ = FLAGS_persistent_block_size;
+    options.persistent_file_max_size_ = FLAGS_persistent_file_max_size;
+    options.persistent_emulate_read_latency_ns_ =
+        FLAGS_persistent_emulate_read_latency_ns;
+    options.persistent_emulate_write_latency_ns_ =
+        FLAGS_persistent_emulate_write_latency_ns;
+    options.persistent_emulate_flush_latency_ns_ =
+        FLAGS_persistent_emulate_flush_latency_ns;
+    options.persistent_emulate_access_granularity_ =
+        FLAGS_persistent_emulate_access_granularity;
+    options.persistent_map_prefault_threads_ =
+        FLAGS_persistent_map_prefault_threads;
+    options.persistent_map_huge_pages_ = FLAGS_persistent_map_huge_pages;
+    options.persistent_map_numa_node_ = FLAGS_persistent_map_numa_node;
+    options.persistent_map_numa_interleave_ =
+        FLAGS_persistent_map_numa_interleave;
     options.is_tiered = FLAGS_is_tiered;
+    options.tier_max_group_depth_trigger = FLAGS_tier_max_group_depth_trigger;
+    options.tier_avg_group_depth_trigger = FLAGS_tier_avg_group_depth_trigger;
+    options.tier_group_depth_slowdown_writes_trigger =
+        FLAGS_tier_group_depth_slowdown_writes_trigger;
+    options.tier_group_depth_stop_writes_trigger =
+        FLAGS_tier_group_depth_stop_writes_trigger;
+    options.tier_prefix_filter = FLAGS_tier_prefix_filter;
     if ((FLAGS_prefix_size == 0) && (FLAGS_rep_factory == kPrefixHash ||
                                      FLAGS_rep_factory == kHashLinkedList)) {
       fprintf(stderr, "prefix_size should be non-zero if PrefixHash or "
@@ -3717,6 +3915,16 @@ class Benchmark {
         options.memtable_factory.reset(NewHashLinkListRepFactory(
             FLAGS_hash_bucket_count));
         break;
+      case kHashIndexedSkipList:
+        options.memtable_factory.reset(
+            NewHashIndexedSkipListRepFactory(FLAGS_hash_bucket_count));
+        break;
+      case kAdaptiveRadixTree:
+        options.memtable_factory.reset(NewAdaptiveRadixTreeRepFactory());
+        break;
+      case kBulkLoad:
+        options.memtable_factory.reset(NewBulkLoadRepFactory());
+        break;
       case kVectorRep:
         options.memtable_factory.reset(
           new VectorRepFactory
@@ -3838,6 +4046,10 @@ class Benchmark {
       }
       block_based_options.block_cache = cache_;
       block_based_options.block_cache_compressed = compressed_cache_;
+      block_based_options.block_cache_compressed_compression =
+          StringToCompressionType(FLAGS_compressed_cache_compression.c_str());
+      block_based_options.block_cache_compressed_admission_history =
+          static_cast<size_t>(FLAGS_compressed_cache_admission_history);
       block_based_options.block_size = FLAGS_block_size;
       block_based_options.block_restart_interval = FLAGS_block_restart_interval;
       block_based_options.index_block_restart_interval =
@@ -3948,6 +4160,14 @@ class Benchmark {
         FLAGS_enable_write_thread_adaptive_yield;
     options.enable_pipelined_write = FLAGS_enable_pipelined_write;
     options.unordered_write = FLAGS_unordered_write;
+    options.wal_shards = static_cast<size_t>(FLAGS_wal_shards);
+    options.pipelined_wal_sync = FLAGS_pipelined_wal_sync;
+    options.wal_compression =
+        StringToCompressionType(FLAGS_wal_compression.c_str());
+    if (options.wal_shards > 1) {
+      // The shards have their own write queues
+      options.enable_pipelined_write = false;
+    }
     options.write_thread_max_yield_usec = FLAGS_write_thread_max_yield_usec;
     options.write_thread_slow_yield_usec = FLAGS_write_thread_slow_yield_usec;
     options.rate_limit_delay_max_milliseconds =
@@ -5134,6 +5354,63 @@ class Benchmark {
     }
   }
 
+  // Like ReadRandom, but keeps up to FLAGS_async_get_depth GetAsync lookups
+  // in flight.
+  void ReadRandomAsync(ThreadState* thread) {
+    int64_t read = 0;
+    ReadOptions options(FLAGS_verify_checksum, true);
+    std::unique_ptr<const char[]> key_guard;
+    Slice key = AllocateKey(&key_guard);
+    std::mutex mu;
+    std::condition_variable cv;
+    int in_flight = 0;
+    int64_t found = 0;
+    int64_t bytes = 0;
+
+    Duration duration(FLAGS_duration, reads_);
+    while (!duration.Done(1)) {
+      DBWithColumnFamilies* db_with_cfh = SelectDBWithCfh(thread);
+      int64_t key_rand = GetRandomKey(&thread->rand);
+      GenerateKeyFromInt(key_rand, FLAGS_num, &key);
+      ColumnFamilyHandle* cfh = FLAGS_num_column_families > 1
+                                    ? db_with_cfh->GetCfh(key_rand)
+                                    : db_with_cfh->db->DefaultColumnFamily();
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return in_flight < FLAGS_async_get_depth; });
+        in_flight++;
+      }
+      read++;
+      size_t key_size = key.size();
+      db_with_cfh->db->GetAsync(
+          options, cfh, key, [&, key_size](const Status& s, const Slice& v) {
+            if (!s.ok() && !s.IsNotFound()) {
+              fprintf(stderr, "Get returned an error: %s\n",
+                      s.ToString().c_str());
+              abort();
+            }
+            std::lock_guard<std::mutex> lock(mu);
+            if (s.ok()) {
+              found++;
+              bytes += key_size + v.size();
+            }
+            in_flight--;
+            cv.notify_all();
+          });
+      thread->stats.FinishedOps(db_with_cfh, db_with_cfh->db, 1, kRead);
+    }
+    {
+      std::unique_lock<std::mutex> lock(mu);
+      cv.wait(lock, [&] { return in_flight == 0; });
+    }
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%" PRIu64 " of %" PRIu64 " found)\n",
+             found, read);
+    thread->stats.AddBytes(bytes);
+    thread->stats.AddMessage(msg);
+  }
+
   // Calls MultiGet over a list of keys from a random distribution.
   // Returns the total number of keys found.
   void MultiReadRandom(ThreadState* thread) {
@@ -5141,6 +5418,7 @@ class Benchmark {
     int64_t num_multireads = 0;
     int64_t found = 0;
     ReadOptions options(FLAGS_verify_checksum, true);
+    options.async_io = FLAGS_async_io;
     std::vector<Slice> keys;
     std::vector<std::unique_ptr<const char[]> > key_guards;
     std::vector<std::string> values(entries_per_batch_);
@@ -5664,6 +5942,7 @@ class Benchmark {
     options.prefix_same_as_start = FLAGS_prefix_same_as_start;
     options.tailing = FLAGS_use_tailing_iterator;
     options.readahead_size = FLAGS_readahead_size;
+    options.async_io = FLAGS_async_io;
 
     Iterator* single_iter = nullptr;
     std::vector<Iterator*> multi_iters;
@@ -6879,6 +7158,187 @@ class Benchmark {
     }
   }
 
+  // Reports how many SST files the Gets issued by readrandomtier looked at
+  // through group filters and how many of them they actually read.
+  void ReportTierReadAmp() {
+    TierReadCounters now(dbstats.get());
+    uint64_t gets = now.gets - tier_read_base_.gets;
+    if (gets == 0) {
+      return;
+    }
+    double probed = static_cast<double>(now.filter_probed -
+                                        tier_read_base_.filter_probed);
+    double skipped = static_cast<double>(now.filter_useful -
+                                         tier_read_base_.filter_useful);
+    double read =
+        static_cast<double>(now.files_read - tier_read_base_.files_read);
+    fprintf(stdout,
+            "readrandomtier : %" PRIu64
+            " Gets, per Get: %.3f files probed by group filters, %.3f "
+            "skipped by them, %.3f table probes, %.3f files probed in "
+            "total\n",
+            gets, probed / gets, skipped / gets, read / gets,
+            (skipped + read) / gets);
+  }
+
+  struct TierCompareResult {
+    double write_amp = 0;
+    double files_probed_per_get = 0;
+    double files_read_per_get = 0;
+    double group_filter_skip_ratio = 0;
+    double bloom_filter_skip_ratio = 0;
+    double write_micros_per_op = 0;
+    double read_micros_per_op = 0;
+  };
+
+  // Writes num_ random keys twice (fillrandom followed by overwrite), waits
+  // for the LSM tree to settle and then issues reads_ random Gets.
+  TierCompareResult RunTierCompareWorkload(DB* db, Statistics* stats) {
+    TierCompareResult result;
+    std::unique_ptr<const char[]> key_guard;
+    Slice key = AllocateKey(&key_guard);
+    RandomGenerator gen;
+    Random64 rand(FLAGS_seed);
+
+    uint64_t start = FLAGS_env->NowMicros();
+    for (int pass = 0; pass < 2; pass++) {
+      for (int64_t i = 0; i < num_; i++) {
+        GenerateKeyFromInt(rand.Next() % FLAGS_num, FLAGS_num, &key);
+        Status s = db->Put(write_options_, key, gen.Generate());
+        if (!s.ok()) {
+          fprintf(stderr, "tiercompare: put error: %s\n",
+                  s.ToString().c_str());
+          exit(1);
+        }
+      }
+    }
+    if (num_ > 0) {
+      result.write_micros_per_op =
+          static_cast<double>(FLAGS_env->NowMicros() - start) / (2 * num_);
+    }
+
+    db->Flush(FlushOptions());
+    uint64_t pending = 1;
+    uint64_t running = 1;
+    while (pending > 0 || running > 0) {
+      FLAGS_env->SleepForMicroseconds(100000);
+      if (!db->GetIntProperty(DB::Properties::kCompactionPending, &pending) ||
+          !db->GetIntProperty(DB::Properties::kNumRunningCompactions,
+                              &running)) {
+        break;
+      }
+    }
+
+    uint64_t user_bytes = stats->getTickerCount(BYTES_WRITTEN);
+    if (user_bytes > 0) {
+      result.write_amp =
+          static_cast<double>(stats->getTickerCount(FLUSH_WRITE_BYTES) +
+                              stats->getTickerCount(COMPACT_WRITE_BYTES)) /
+          user_bytes;
+    }
+
+    TierReadCounters before(stats);
+    ReadOptions options(FLAGS_verify_checksum, true);
+    PinnableSlice pinnable_val;
+    start = FLAGS_env->NowMicros();
+    for (int64_t i = 0; i < reads_; i++) {
+      GenerateKeyFromInt(rand.Next() % FLAGS_num, FLAGS_num, &key);
+      pinnable_val.Reset();
+      Status s =
+          db->Get(options, db->DefaultColumnFamily(), key, &pinnable_val);
+      if (!s.ok() && !s.IsNotFound()) {
+        fprintf(stderr, "tiercompare: get error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+    }
+    uint64_t read_micros = FLAGS_env->NowMicros() - start;
+    TierReadCounters after(stats);
+
+    double gets = static_cast<double>(after.gets - before.gets);
+    double probed = static_cast<double>(after.filter_probed -
+                                        before.filter_probed);
+    double skipped =
+        static_cast<double>(after.filter_useful - before.filter_useful);
+    double read = static_cast<double>(after.files_read - before.files_read);
+    if (gets > 0) {
+      // A file is probed either by its table reader (and its bloom filter)
+      // or, in tier mode, by a group filter that rules it out first. Only
+      // the latter are missing from the table probes, so both modes are
+      // counted the same way.
+      result.files_probed_per_get = (skipped + read) / gets;
+      result.files_read_per_get = read / gets;
+      result.read_micros_per_op = read_micros / gets;
+    }
+    if (probed > 0) {
+      result.group_filter_skip_ratio = skipped / probed;
+    }
+    if (read > 0) {
+      result.bloom_filter_skip_ratio =
+          (after.bloom_useful - before.bloom_useful) / read;
+    }
+    return result;
+  }
+
+  // Runs the same workload against a fresh leveled DB and a fresh tier DB
+  // built from the current flags and prints the results side by side.
+  void TierCompare() {
+    const char* kModes[] = {"leveled", "tier"};
+    TierCompareResult results[2];
+    for (int m = 0; m < 2; m++) {
+      bool tier = m == 1;
+      Options options = open_options_;
+      options.create_if_missing = true;
+      options.compaction_style =
+          tier ? kCompactionStyleTier : kCompactionStyleLevel;
+      options.is_tiered = tier;
+      options.statistics = CreateDBStatistics();
+      std::string path = FLAGS_db + "/tiercompare_" + kModes[m];
+      if (tier) {
+        // Keep the group filters of this run apart from the main DB's pool.
+        options.persistent_file_path_ =
+            FLAGS_persistent_file_path + "/tiercompare";
+        FLAGS_env->CreateDirIfMissing(options.persistent_file_path_);
+        std::vector<std::string> children;
+        FLAGS_env->GetChildren(options.persistent_file_path_, &children);
+        for (const auto& child : children) {
+          FLAGS_env->DeleteFile(options.persistent_file_path_ + "/" + child);
+        }
+      }
+      DestroyDB(path, options);
+      DB* db = nullptr;
+      Status s = DB::Open(options, path, &db);
+      if (!s.ok()) {
+        fprintf(stderr, "tiercompare: open %s error: %s\n", path.c_str(),
+                s.ToString().c_str());
+        exit(1);
+      }
+      results[m] = RunTierCompareWorkload(db, options.statistics.get());
+      delete db;
+    }
+
+    fprintf(stdout,
+            "tiercompare : %" PRIi64 " keys written twice, %" PRIi64
+            " random reads\n",
+            num_, reads_);
+    fprintf(stdout, "%-32s %12s %12s\n", "", kModes[0], kModes[1]);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "write amplification",
+            results[0].write_amp, results[1].write_amp);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "files probed per Get",
+            results[0].files_probed_per_get, results[1].files_probed_per_get);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "table probes per Get",
+            results[0].files_read_per_get, results[1].files_read_per_get);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "group filter skip ratio",
+            results[0].group_filter_skip_ratio,
+            results[1].group_filter_skip_ratio);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "bloom filter skip ratio",
+            results[0].bloom_filter_skip_ratio,
+            results[1].bloom_filter_skip_ratio);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "write micros/op",
+            results[0].write_micros_per_op, results[1].write_micros_per_op);
+    fprintf(stdout, "%-32s %12.3f %12.3f\n", "read micros/op",
+            results[0].read_micros_per_op, results[1].read_micros_per_op);
+  }
+
   void ResetStats() {
     if (db_.db != nullptr) {
       db_.db->ResetStats();
@@ -7079,6 +7539,8 @@ int db_bench_tool(int argc, char** argv) {
                                   ROCKSDB_NAMESPACE::Env::Priority::BOTTOM);
   FLAGS_env->SetBackgroundThreads(FLAGS_num_low_pri_threads,
                                   ROCKSDB_NAMESPACE::Env::Priority::LOW);
+  FLAGS_env->SetBackgroundThreads(FLAGS_num_user_threads,
+                                  ROCKSDB_NAMESPACE::Env::Priority::USER);
 
   // Choose a location for the test database if none given with --db=<path>
   if (FLAGS_db.empty()) {
@@ -0,0 +1,76 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "util/mutexlock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Shared with the pool threads of a RunInParallel() call, which may only get
+// to run after it returned and must then find nothing left to do.
+struct ParallelRunState {
+  ParallelRunState() : cv(&mu) {}
+
+  const std::function<void(size_t)>* fn = nullptr;
+  size_t num_tasks = 0;
+
+  port::Mutex mu;
+  port::CondVar cv;
+  // The next task to start and the number of tasks done. Guarded by mu.
+  size_t next_task = 0;
+  size_t done_tasks = 0;
+
+  // Runs the tasks no thread has started yet. Requires mu.
+  void RunPendingTasks() {
+    while (next_task < num_tasks) {
+      const size_t task = next_task++;
+      mu.Unlock();
+      (*fn)(task);
+      mu.Lock();
+      done_tasks++;
+      cv.SignalAll();
+    }
+  }
+
+  static void BGRunPendingTasks(void* arg) {
+    std::unique_ptr<std::shared_ptr<ParallelRunState>> state_ptr(
+        static_cast<std::shared_ptr<ParallelRunState>*>(arg));
+    ParallelRunState* state = state_ptr->get();
+    MutexLock l(&state->mu);
+    state->RunPendingTasks();
+  }
+};
+
+// Runs fn(0), ..., fn(n - 1) on the calling thread and up to n - 1 threads of
+// the pri pool of env. The calling thread takes every task no pool thread
+// has started, so a busy pool only makes this slower, and without pool
+// threads everything runs on the calling thread.
+inline void RunInParallel(Env* env, Env::Priority pri, size_t n,
+                          const std::function<void(size_t)>& fn) {
+  std::shared_ptr<ParallelRunState> state =
+      std::make_shared<ParallelRunState>();
+  state->fn = &fn;
+  state->num_tasks = n;
+  const size_t pool_threads =
+      static_cast<size_t>(std::max(0, env->GetBackgroundThreads(pri)));
+  for (size_t i = 1; i < std::min(n, pool_threads + 1); ++i) {
+    env->Schedule(&ParallelRunState::BGRunPendingTasks,
+                  new std::shared_ptr<ParallelRunState>(state), pri);
+  }
+  MutexLock l(&state->mu);
+  state->RunPendingTasks();
+  while (state->done_tasks < n) {
+    state->cv.Wait();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
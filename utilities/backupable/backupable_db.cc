@@ -863,7 +863,10 @@ Status BackupEngineImpl::CreateNewBackupWithMetadata(
           Log(options_.info_log, "add file for backup %s", fname.c_str());
           uint64_t size_bytes = 0;
           Status st;
-          if (type == kTableFile) {
+          // Tier mode group filter files are named after their contents and
+          // never change, so they are shared across backups like table files.
+          bool shareable = type == kTableFile || type == kTierFilterFile;
+          if (shareable) {
             st = db_env_->GetFileSize(src_dirname + fname, &size_bytes);
           }
           EnvOptions src_env_options;
@@ -890,10 +893,9 @@ Status BackupEngineImpl::CreateNewBackupWithMetadata(
           if (st.ok()) {
             st = AddBackupFileWorkItem(
                 live_dst_paths, backup_items_to_finish, new_backup_id,
-                options_.share_table_files && type == kTableFile, src_dirname,
-                fname, src_env_options, rate_limiter, size_bytes,
-                size_limit_bytes,
-                options_.share_files_with_checksum && type == kTableFile,
+                options_.share_table_files && shareable, src_dirname, fname,
+                src_env_options, rate_limiter, size_bytes, size_limit_bytes,
+                options_.share_files_with_checksum && shareable,
                 options.progress_callback);
           }
           return st;
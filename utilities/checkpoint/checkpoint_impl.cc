@@ -16,6 +16,7 @@
 #include <string>
 #include <vector>
 
+#include "db/db_impl/db_impl.h"
 #include "db/wal_manager.h"
 #include "file/file_util.h"
 #include "file/filename.h"
@@ -26,9 +27,25 @@
 #include "rocksdb/transaction_log.h"
 #include "rocksdb/utilities/checkpoint.h"
 #include "test_util/sync_point.h"
+#include "util/cast_util.h"
 
 namespace ROCKSDB_NAMESPACE {
 
+namespace {
+// The group filters of a tiered DB can only be exported by its DBImpl, which
+// a tiered DB always is at its root.
+Status GetLiveFilesToCopy(DB* db, const DBOptions& db_options,
+                          std::vector<std::string>& live_files,
+                          uint64_t* manifest_file_size, bool flush_memtable) {
+  if (!db_options.is_tiered) {
+    return db->GetLiveFiles(live_files, manifest_file_size, flush_memtable);
+  }
+  DBImpl* db_impl = static_cast_with_check<DBImpl, DB>(db->GetRootDB());
+  return db_impl->GetLiveFilesWithTierFilters(live_files, manifest_file_size,
+                                              flush_memtable);
+}
+}  // namespace
+
 Status Checkpoint::Create(DB* db, Checkpoint** checkpoint_ptr) {
   *checkpoint_ptr = new CheckpointImpl(db);
   return Status::OK();
@@ -211,8 +228,10 @@ Status CheckpointImpl::CreateCustomCheckpoint(
       }
     }
 
-    // this will return live_files prefixed with "/"
-    s = db_->GetLiveFiles(live_files, &manifest_file_size, flush_memtable);
+    // this will return live_files prefixed with "/", and in tier mode also
+    // the group filters exported for them
+    s = GetLiveFilesToCopy(db_, db_options, live_files, &manifest_file_size,
+                           flush_memtable);
 
     if (s.ok() && db_options.allow_2pc) {
       // If 2PC is enabled, we need to get minimum log number after the flush.
@@ -238,7 +257,8 @@ Status CheckpointImpl::CreateCustomCheckpoint(
       // We cannot get min_log_num before calling the GetLiveFiles() for the
       // first time, because if we do that, all the logs files will be included,
       // far more than needed.
-      s = db_->GetLiveFiles(live_files, &manifest_file_size, flush_memtable);
+      s = GetLiveFilesToCopy(db_, db_options, live_files, &manifest_file_size,
+                             flush_memtable);
     }
 
     TEST_SYNC_POINT("CheckpointImpl::CreateCheckpoint:SavedLiveFiles1");
@@ -265,9 +285,11 @@ Status CheckpointImpl::CreateCustomCheckpoint(
       s = Status::Corruption("Can't parse file name. This is very bad");
       break;
     }
-    // we should only get sst, options, manifest and current files here
+    // we should only get sst, options, manifest, current and (in tier mode)
+    // group filter files here
     assert(type == kTableFile || type == kDescriptorFile ||
-           type == kCurrentFile || type == kOptionsFile);
+           type == kCurrentFile || type == kOptionsFile ||
+           type == kTierFilterFile);
     assert(live_files[i].size() > 0 && live_files[i][0] == '/');
     if (type == kCurrentFile) {
       // We will craft the current file manually to ensure it's consistent with
@@ -281,17 +303,18 @@ Status CheckpointImpl::CreateCustomCheckpoint(
     std::string src_fname = live_files[i];
 
     // rules:
-    // * if it's kTableFile, then it's shared
+    // * if it's kTableFile or kTierFilterFile, then it's shared
     // * if it's kDescriptorFile, limit the size to manifest_file_size
     // * always copy if cross-device link
-    if ((type == kTableFile) && same_fs) {
+    bool shared = type == kTableFile || type == kTierFilterFile;
+    if (shared && same_fs) {
       s = link_file_cb(db_->GetName(), src_fname, type);
       if (s.IsNotSupported()) {
         same_fs = false;
         s = Status::OK();
       }
     }
-    if ((type != kTableFile) || (!same_fs)) {
+    if (!shared || !same_fs) {
       s = copy_file_cb(db_->GetName(), src_fname,
                        (type == kDescriptorFile) ? manifest_file_size : 0,
                        type);
@@ -1,23 +1,36 @@
 #include "cuckoo_filter.h"
 
+#include "port/port.h"
+
 namespace rocksdb {
     CuckooBucket::CuckooBucket(CuckooSlot *pmem_slot, uint64_t slot_size, bool is_create) :
             pmem_slots_(pmem_slot), slot_size_(slot_size) {
         if (is_create) {
-            for (size_t i = 0; i < slot_size_; i++) {
-                pmem_slots_[i].status_ = CuckooSlot::AVAILIBLE;
-            }
+            // 未使用的 slot 全为 0 (AVAILIBLE), 导出时可以跳过
+            memset(pmem_slots_, 0, sizeof(CuckooSlot) * slot_size_);
         }
     }
 
-    CuckooFilter::CuckooFilter(PersistentArena *pmem_arena, uint64_t level, uint64_t &block_num) {
+    CuckooFilter::CuckooFilter(PersistentArena *pmem_arena, uint32_t cf_id, uint64_t level,
+                               uint64_t &block_num) {
         pmem_arena_ = pmem_arena;
+        emulator_ = pmem_arena_->GetEmulator();
 
-        filter_addr_ =
-                pmem_arena_->AllocateBlock(level, block_num) + sizeof(AllocatedBlockListNode);
-        assert(filter_addr_ != nullptr);
+        char *block = pmem_arena_->AllocateBlock(cf_id, level, block_num);
+        if (block == nullptr) {
+            block_num = 0;
+            block_num_ = 0;
+            cuckoo_mutex_ = &pmem_arena_->GetBlockMutex(0);
+            filter_addr_ = nullptr;
+            bucket_size_ = 0;
+            pmem_buckets_ = nullptr;
+            return;
+        }
+        block_num_ = block_num;
+        filter_addr_ = block + sizeof(AllocatedBlockListNode);
+        cuckoo_mutex_ = &pmem_arena_->GetBlockMutex(block_num);
 
-        uint64_t max_filter_size = BLOCK_SIZE - sizeof(AllocatedBlockListNode);
+        uint64_t max_filter_size = pmem_arena_->GetBlockSize() - sizeof(AllocatedBlockListNode);
         uint64_t max_slot_num = max_filter_size / sizeof(CuckooSlot);
         bucket_size_ = max_slot_num / SLOT_PER_BUCKET;
         uint64_t slot_num = bucket_size_ * SLOT_PER_BUCKET;
@@ -32,14 +45,22 @@ namespace rocksdb {
             pmem_buckets_[i] = new CuckooBucket((CuckooSlot *) tmp, SLOT_PER_BUCKET);
             tmp += (sizeof(CuckooSlot) * SLOT_PER_BUCKET);
         }
+        if (emulator_) {
+            // 创建时初始化并持久化了整个 filter
+            emulator_->ChargeWrite(filter_addr_, tmp - filter_addr_);
+            emulator_->ChargeFlush(filter_addr_, tmp - filter_addr_);
+        }
     }
 
     CuckooFilter::CuckooFilter(PersistentArena *pmem_arena, uint64_t block_num) {
         pmem_arena_ = pmem_arena;
+        emulator_ = pmem_arena_->GetEmulator();
 
+        block_num_ = block_num;
         filter_addr_ = pmem_arena_->GetBlockWithBlockNum(block_num) + sizeof(AllocatedBlockListNode);
+        cuckoo_mutex_ = &pmem_arena_->GetBlockMutex(block_num);
 
-        uint64_t max_filter_size = BLOCK_SIZE - sizeof(AllocatedBlockListNode);
+        uint64_t max_filter_size = pmem_arena_->GetBlockSize() - sizeof(AllocatedBlockListNode);
         uint64_t max_slot_num = max_filter_size / sizeof(CuckooSlot);
         bucket_size_ = max_slot_num / SLOT_PER_BUCKET;
         uint64_t slot_num = bucket_size_ * SLOT_PER_BUCKET;
@@ -60,11 +81,45 @@ namespace rocksdb {
         for (size_t i = 0; i < bucket_size_; i++) {
             delete pmem_buckets_[i];
         }
-        delete pmem_buckets_;
+        delete[] pmem_buckets_;
     }
 
-// BKDRHash Impl
-    uint64_t CuckooFilter::CuckooHash1(const char *str, size_t size) {
+    bool CuckooFilter::IsSaturated() {
+        return IsValid() && pmem_arena_->IsSaturated(block_num_);
+    }
+
+    uint64_t CuckooFilter::OccupiedSlotNum() {
+        if (!IsValid()) {
+            return 0;
+        }
+        uint64_t occupied = 0;
+        std::lock_guard<std::mutex> lock(*cuckoo_mutex_);
+        for (size_t b = 0; b < bucket_size_; b++) {
+            CuckooBucket *bucket = pmem_buckets_[b];
+            ChargeRead(bucket);
+            for (size_t i = 0; i < bucket->slot_size_; i++) {
+                if (bucket->pmem_slots_[i].status_ == CuckooSlot::OCCUPIED) {
+                    occupied++;
+                }
+            }
+        }
+        return occupied;
+    }
+
+    void CuckooFilter::ChargeRead(CuckooBucket *bucket) {
+        if (emulator_) {
+            emulator_->ChargeRead(bucket->pmem_slots_, sizeof(CuckooSlot) * bucket->slot_size_);
+        }
+    }
+
+    void CuckooFilter::ChargeWrite(CuckooSlot *slot) {
+        if (emulator_) {
+            emulator_->ChargeWrite(slot, sizeof(CuckooSlot));
+            emulator_->ChargeFlush(slot, sizeof(CuckooSlot));
+        }
+    }
+
+    uint64_t CuckooFilter::BKDRHash(const char *str, size_t size) {
         uint64_t seed = 131;
         uint64_t hash = 0;
 
@@ -72,11 +127,10 @@ namespace rocksdb {
             hash = hash * seed + str[i];
         }
 
-        return hash % bucket_size_;
+        return hash;
     }
 
-// APHash Impl
-    uint64_t CuckooFilter::CuckooHash2(const char *str, size_t size) {
+    uint64_t CuckooFilter::APHash(const char *str, size_t size) {
         uint64_t hash = 0;
 
         for (size_t i = 0; i < size; i++) {
@@ -87,7 +141,81 @@ namespace rocksdb {
             }
         }
 
-        return hash % bucket_size_;
+        return hash;
+    }
+
+    uint64_t CuckooFilter::CuckooHash1(const char *str, size_t size) {
+        return BKDRHash(str, size) % bucket_size_;
+    }
+
+    uint64_t CuckooFilter::CuckooHash2(const char *str, size_t size) {
+        return APHash(str, size) % bucket_size_;
+    }
+
+    CuckooFilter::KeyTags CuckooFilter::ComputeKeyTags(uint64_t block_size,
+                                                       const char *str, size_t size) {
+        uint64_t bucket_num = BucketNum(block_size);
+        KeyTags tags;
+        tags.tag1 = BKDRHash(str, size) % bucket_num;
+        tags.tag2 = APHash(str, size) % bucket_num;
+        if (tags.tag1 == tags.tag2) {
+            tags.tag2 = (tags.tag2 + 1) % bucket_num;
+        }
+        return tags;
+    }
+
+    CuckooFilter::KeyTags CuckooFilter::ComputePrefixTags(uint64_t block_size,
+                                                          const char *prefix, size_t size) {
+        static const char kPrefixSuffix[] = "\xff#prefix";
+        std::string salted(prefix, size);
+        salted.append(kPrefixSuffix, sizeof(kPrefixSuffix) - 1);
+        return ComputeKeyTags(block_size, salted.data(), salted.size());
+    }
+
+    void CuckooFilter::PrefetchKey(PersistentArena *pmem_arena, uint64_t block_num,
+                                   const KeyTags &tags) {
+        if (!pmem_arena->ContainsBlock(block_num)) {
+            return;
+        }
+        char *block = pmem_arena->GetBlockWithBlockNum(block_num);
+        char *filter_addr = block + sizeof(AllocatedBlockListNode);
+        // block 头用于 IsFilterBlock 的判断
+        PREFETCH(block, 0, 1);
+        PREFETCH(GetBucketSlots(filter_addr, tags.tag1), 0, 1);
+        PREFETCH(GetBucketSlots(filter_addr, tags.tag2), 0, 1);
+    }
+
+    bool CuckooFilter::KeyExists(PersistentArena *pmem_arena, uint64_t block_num,
+                                 const KeyTags &tags) {
+        char *filter_addr = pmem_arena->GetBlockWithBlockNum(block_num) +
+                            sizeof(AllocatedBlockListNode);
+        PmemLatencyEmulator *emulator = pmem_arena->GetEmulator();
+        const size_t bucket_bytes = sizeof(CuckooSlot) * SLOT_PER_BUCKET;
+        std::lock_guard<std::mutex> lock(pmem_arena->GetBlockMutex(block_num));
+        if (pmem_arena->IsSaturated(block_num)) {
+            return true;
+        }
+        // 1. tag1 确定 bucket
+        CuckooSlot *slots = GetBucketSlots(filter_addr, tags.tag1);
+        if (emulator) {
+            emulator->ChargeRead(slots, bucket_bytes);
+        }
+        for (size_t i = 0; i < SLOT_PER_BUCKET; i++) {
+            if (slots[i].tag_ == tags.tag2 && slots[i].status_ == CuckooSlot::OCCUPIED) {
+                return true;
+            }
+        }
+        // 2. tag2 确定 bucket
+        slots = GetBucketSlots(filter_addr, tags.tag2);
+        if (emulator) {
+            emulator->ChargeRead(slots, bucket_bytes);
+        }
+        for (size_t i = 0; i < SLOT_PER_BUCKET; i++) {
+            if (slots[i].tag_ == tags.tag1 && slots[i].status_ == CuckooSlot::OCCUPIED) {
+                return true;
+            }
+        }
+        return false;
     }
 
     int CuckooFilter::CuckooCollide(uint64_t *tags) {
@@ -95,6 +223,7 @@ namespace rocksdb {
         uint64_t victim_tags[2] = {tags[0], bucket->pmem_slots_[0].tag_};
         bucket->pmem_slots_[0].tag_ = tags[1];
         bucket->pmem_slots_[0].status_ = CuckooSlot::OCCUPIED;
+        ChargeWrite(&bucket->pmem_slots_[0]);
 
         // 为受害者寻找新的 slot
         int indicator = 1;
@@ -103,12 +232,14 @@ namespace rocksdb {
 
         while (true) {
             bucket = pmem_buckets_[victim_tags[indicator]];
+            ChargeRead(bucket);
             for (size_t i = 0; i < bucket->slot_size_; i++) {
                 CuckooSlot::STATUS slot_status = bucket->pmem_slots_[i].status_;
                 if (slot_status == CuckooSlot::AVAILIBLE ||
                     slot_status == CuckooSlot::DELETED) {
                     bucket->pmem_slots_[i].status_ = CuckooSlot::OCCUPIED;
                     bucket->pmem_slots_[i].tag_ = victim_tags[indicator ^ 1];
+                    ChargeWrite(&bucket->pmem_slots_[i]);
                     return 0;
                 }
             }
@@ -129,23 +260,61 @@ namespace rocksdb {
             uint64_t tmp_tag = victim_tags[indicator ^ 1];
             victim_tags[indicator ^ 1] = bucket->pmem_slots_[which_slot].tag_;
             bucket->pmem_slots_[which_slot].tag_ = tmp_tag;
+            ChargeWrite(&bucket->pmem_slots_[which_slot]);
             indicator ^= 1;
         }
     }
 
     void CuckooFilter::CuckooPutKey(const char *str, size_t size) {
+        if (!IsValid()) {
+            return;
+        }
         uint64_t tag1 = CuckooHash1(str, size);
         uint64_t tag2 = CuckooHash2(str, size);
         if (tag1 == tag2) {
             tag2 = (tag2 + 1) % bucket_size_;
         }
+
+        cuckoo_mutex_->lock();
+        PutTagsLocked(tag1, tag2);
+        cuckoo_mutex_->unlock();
+    }
+
+    void CuckooFilter::CuckooPutPrefix(const char *prefix, size_t size) {
+        if (!IsValid()) {
+            return;
+        }
+        KeyTags prefix_tags = ComputePrefixTags(pmem_arena_->GetBlockSize(), prefix, size);
+
+        std::lock_guard<std::mutex> lock(*cuckoo_mutex_);
+        // filter 中不会删除 prefix 指纹, 所以同一个 prefix 只需要插入一次
+        if (!TagsExistLocked(prefix_tags.tag1, prefix_tags.tag2)) {
+            PutTagsLocked(prefix_tags.tag1, prefix_tags.tag2);
+        }
+    }
+
+    bool CuckooFilter::TagsExistLocked(uint64_t tag1, uint64_t tag2) {
         uint64_t tags[2] = {tag1, tag2};
+        for (size_t tag_idx = 0; tag_idx < 2; tag_idx++) {
+            CuckooBucket *bucket = pmem_buckets_[tags[tag_idx]];
+            ChargeRead(bucket);
+            for (size_t i = 0; i < bucket->slot_size_; i++) {
+                if (bucket->pmem_slots_[i].tag_ == tags[tag_idx ^ 1] &&
+                    bucket->pmem_slots_[i].status_ == CuckooSlot::OCCUPIED) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 
-        cuckoo_mutex.lock();
+    void CuckooFilter::PutTagsLocked(uint64_t tag1, uint64_t tag2) {
+        uint64_t tags[2] = {tag1, tag2};
         // 先查找 tag1，再查找 tag2
         bool tag_found = false;
         for (size_t tag_idx = 0; tag_idx < 2; tag_idx++) {
             CuckooBucket *tag_bucket = pmem_buckets_[tags[tag_idx]];
+            ChargeRead(tag_bucket);
             for (size_t i = 0; i < tag_bucket->slot_size_; i++) {
                 CuckooSlot::STATUS slot_status = tag_bucket->pmem_slots_[i].status_;
                 if (slot_status == CuckooSlot::AVAILIBLE ||
@@ -153,6 +322,7 @@ namespace rocksdb {
                     tag_bucket->pmem_slots_[i].status_ = CuckooSlot::OCCUPIED;
                     tag_bucket->pmem_slots_[i].tag_ = (tag_idx == 0) ?
                                                       tag2 : tag1;
+                    ChargeWrite(&tag_bucket->pmem_slots_[i]);
                     tag_found = true;
                     // TODO: slot 还需要保存这个key属于该 level 的哪一个 group
                     break;
@@ -165,28 +335,35 @@ namespace rocksdb {
         if (!tag_found) {
             // 都没有找到空位，碰撞处理
             int need_rehash = CuckooCollide(tags);
-            assert(need_rehash == 0);
+            if (need_rehash != 0) {
+                // 被踢出的指纹已经丢失, 不能再对任何 key 给出否定的回答
+                pmem_arena_->SetSaturated(block_num_);
+            }
         }
-        cuckoo_mutex.unlock();
-        return;
     }
 
     void CuckooFilter::CuckooDeleteKey(const char *str, size_t size) {
+        if (!IsValid()) {
+            return;
+        }
         uint64_t tag1 = CuckooHash1(str, size);
         uint64_t tag2 = CuckooHash2(str, size);
         if (tag1 == tag2) {
             tag2 = (tag2 + 1) % bucket_size_;
         }
         // uint64_t tags[2] = {tag1, tag2};
-        cuckoo_mutex.lock();
+        cuckoo_mutex_->lock();
         // 两种情况
         // 1. tag1 确定 bucket
         CuckooBucket *bucket = pmem_buckets_[tag1];
+        ChargeRead(bucket);
         for (size_t i = 0; i < bucket->slot_size_; i++) {
             if (bucket->pmem_slots_[i].tag_ == tag2) {
                 if (bucket->pmem_slots_[i].status_ ==
                     CuckooSlot::OCCUPIED) {
                     bucket->pmem_slots_[i].status_ = CuckooSlot::DELETED;
+                    ChargeWrite(&bucket->pmem_slots_[i]);
+                    cuckoo_mutex_->unlock();
                     return;
                 }
             }
@@ -194,20 +371,26 @@ namespace rocksdb {
 
         // 2. tag2 确定 bucket
         bucket = pmem_buckets_[tag2];
+        ChargeRead(bucket);
         for (size_t i = 0; i < bucket->slot_size_; i++) {
             if (bucket->pmem_slots_[i].tag_ == tag1) {
                 if (bucket->pmem_slots_[i].status_ ==
                     CuckooSlot::OCCUPIED) {
                     bucket->pmem_slots_[i].status_ = CuckooSlot::DELETED;
+                    ChargeWrite(&bucket->pmem_slots_[i]);
+                    cuckoo_mutex_->unlock();
                     return;
                 }
             }
         }
-        cuckoo_mutex.unlock();
+        cuckoo_mutex_->unlock();
         return;
     }
 
     bool CuckooFilter::CuckooKeyExists(const char *str, size_t size) {
+        if (!IsValid()) {
+            return true;
+        }
         uint64_t tag1 = CuckooHash1(str, size);
         uint64_t tag2 = CuckooHash2(str, size);
         if (tag1 == tag2) {
@@ -217,15 +400,21 @@ namespace rocksdb {
 #ifdef PMEM_CUCKOO_DEBUG
         printf("[CuckooKeyExists] tag1=%ld, tag2=%ld\n", tag1, tag2);
 #endif
-        cuckoo_mutex.lock();
+        cuckoo_mutex_->lock();
+        if (pmem_arena_->IsSaturated(block_num_)) {
+            cuckoo_mutex_->unlock();
+            return true;
+        }
         // 两种情况
         // 1. tag1 确定 bucket
         CuckooBucket *bucket = pmem_buckets_[tag1];
+        ChargeRead(bucket);
 
         for (size_t i = 0; i < bucket->slot_size_; i++) {
             if (bucket->pmem_slots_[i].tag_ == tag2) {
                 if (bucket->pmem_slots_[i].status_ ==
                     CuckooSlot::OCCUPIED) {
+                    cuckoo_mutex_->unlock();
                     return true;
                 }
             }
@@ -233,15 +422,17 @@ namespace rocksdb {
 
         // 2. tag2 确定 bucket
         bucket = pmem_buckets_[tag2];
+        ChargeRead(bucket);
         for (size_t i = 0; i < bucket->slot_size_; i++) {
             if (bucket->pmem_slots_[i].tag_ == tag1) {
                 if (bucket->pmem_slots_[i].status_ ==
                     CuckooSlot::OCCUPIED) {
+                    cuckoo_mutex_->unlock();
                     return true;
                 }
             }
         }
-        cuckoo_mutex.unlock();
+        cuckoo_mutex_->unlock();
         return false;
     }
 }
\ No newline at end of file
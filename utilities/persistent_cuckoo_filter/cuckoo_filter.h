@@ -30,29 +30,105 @@ namespace rocksdb {
     class CuckooFilter {
     public:
         // 用于创建一个新的 CuckooFilter
-        CuckooFilter(PersistentArena *pmem_arena, uint64_t level, uint64_t &block_num);
+        // pool 拒绝分配时 block_num 置为 0, 得到一个无效的 filter:
+        // 插入和删除不做任何事情, 查询总是返回 true
+        CuckooFilter(PersistentArena *pmem_arena, uint32_t cf_id, uint64_t level,
+                     uint64_t &block_num);
 
         // 用于恢复一个 CuckooFilter
         CuckooFilter(PersistentArena *pmem_arena, uint64_t block_num);
 
         ~CuckooFilter();
 
+        bool IsValid() const { return filter_addr_ != nullptr; }
+
+        // 曾经有指纹因为碰撞次数过多而被丢弃, 查询总是返回 true.
+        // 继续使用这个 filter 的 group 需要换一个新的 block
+        bool IsSaturated();
+
+        // 当前被占用的 slot 数, 需要扫描整个 filter, 只在 compaction 中
+        // 判断复用的 filter 是否还有足够的空间时使用
+        uint64_t OccupiedSlotNum();
+
+        // 大小为 block_size 的 block 中的 bucket 数
+        static uint64_t BucketNum(uint64_t block_size) {
+            return (block_size - sizeof(AllocatedBlockListNode)) /
+                   sizeof(CuckooSlot) / SLOT_PER_BUCKET;
+        }
+
+        // 大小为 block_size 的 block 在 90% 装载率下可以容纳的 key 数,
+        // 超过这个数量后插入很可能因为碰撞次数过多而失败
+        static uint64_t MaxKeyNum(uint64_t block_size) {
+            return BucketNum(block_size) * SLOT_PER_BUCKET * 9 / 10;
+        }
+
+        // 一个 key 的两个候选 bucket. 只与 block 大小有关, 所以一次查询在
+        // 各层的 group filter 中可以复用, 不需要重复计算 hash
+        struct KeyTags {
+            uint64_t tag1;
+            uint64_t tag2;
+        };
+
+        static KeyTags ComputeKeyTags(uint64_t block_size, const char *str, size_t size);
+
+        // prefix 指纹与 key 指纹保存在同一个 filter 中, 计算前在 prefix
+        // 之后追加一个 key 中不会单独出现的后缀, 避免与等于 prefix 的 key 混淆
+        static KeyTags ComputePrefixTags(uint64_t block_size, const char *prefix,
+                                         size_t size);
+
+        // 发出 block_num 中 key 的两个候选 bucket 以及 block 头的软件预取,
+        // 使多个 filter 的 cache miss 可以相互重叠. block_num 可以是任意值
+        static void PrefetchKey(PersistentArena *pmem_arena, uint64_t block_num,
+                                const KeyTags &tags);
+
+        // 与 CuckooKeyExists 相同, 但不需要构造 CuckooFilter 对象.
+        // 调用者需要保证 block_num 是有效的 filter block. 饱和的 filter 总是返回 true
+        static bool KeyExists(PersistentArena *pmem_arena, uint64_t block_num,
+                              const KeyTags &tags);
+
         uint64_t CuckooHash1(const char *str, size_t size);
 
         uint64_t CuckooHash2(const char *str, size_t size);
 
         void CuckooPutKey(const char *str, size_t size);
 
+        // 插入 prefix 指纹, 已经存在时不重复插入
+        void CuckooPutPrefix(const char *prefix, size_t size);
+
         void CuckooDeleteKey(const char *str, size_t size);
 
         bool CuckooKeyExists(const char *str, size_t size);
 
     private:
-        std::mutex cuckoo_mutex;
+        static uint64_t BKDRHash(const char *str, size_t size);
+
+        static uint64_t APHash(const char *str, size_t size);
+
+        static CuckooSlot *GetBucketSlots(char *filter_addr, uint64_t bucket) {
+            return (CuckooSlot *) (filter_addr + bucket * sizeof(CuckooSlot) * SLOT_PER_BUCKET);
+        }
+
+        // 同一个 block 的 filter 可能同时被多个 CuckooFilter 对象访问
+        // (读路径每次查询都会构造一个), 所以锁由 pool 按 block 提供
+        std::mutex *cuckoo_mutex_;
 
         int CuckooCollide(uint64_t *tags);
 
+        // 以下两个函数需要持有 cuckoo_mutex_.
+        // 碰撞处理失败时被踢出的指纹无法放回, 此时将 block 标记为饱和
+        void PutTagsLocked(uint64_t tag1, uint64_t tag2);
+
+        bool TagsExistLocked(uint64_t tag1, uint64_t tag2);
+
+        // 计费对 bucket 的访问, 没有开启 emulation 时为 nullptr.
+        // 写入 slot 之后需要 flush 才能持久化, ChargeWrite 同时计费 flush
+        void ChargeRead(CuckooBucket *bucket);
+
+        void ChargeWrite(CuckooSlot *slot);
+
         PersistentArena *pmem_arena_;
+        PmemLatencyEmulator *emulator_;
+        uint64_t block_num_;
         char *filter_addr_;
         uint64_t bucket_size_;
         CuckooBucket **pmem_buckets_;
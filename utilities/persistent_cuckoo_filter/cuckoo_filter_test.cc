@@ -0,0 +1,227 @@
+#include "cuckoo_filter.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+
+namespace rocksdb {
+    class CuckooFilterTest : public testing::Test {
+    public:
+        static const uint64_t kBlockSize = 64 << 10;
+
+        CuckooFilterTest() {
+            dir_ = test::PerThreadDBPath("cuckoo_filter_test");
+            EXPECT_OK(Env::Default()->CreateDirIfMissing(dir_));
+            path_ = dir_ + "/cuckoo_filters.pool";
+            remove(path_.c_str());
+            arena_.reset(new PersistentArena(path_, 1 << 20, kBlockSize, 1 << 20));
+        }
+
+        ~CuckooFilterTest() override {
+            arena_.reset();
+            remove(path_.c_str());
+            Env::Default()->DeleteDir(dir_);
+        }
+
+        static std::string Key(int i) {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "key%06d", i);
+            return buf;
+        }
+
+        static CuckooFilter::KeyTags Tags(const std::string &key) {
+            return CuckooFilter::ComputeKeyTags(kBlockSize, key.data(), key.size());
+        }
+
+        std::string dir_;
+        std::string path_;
+        std::unique_ptr<PersistentArena> arena_;
+    };
+
+    const uint64_t CuckooFilterTest::kBlockSize;
+
+    TEST_F(CuckooFilterTest, ComputeKeyTags) {
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        const uint64_t bucket_num = CuckooFilter::BucketNum(kBlockSize);
+        for (int i = 0; i < 1000; i++) {
+            std::string key = Key(i);
+            CuckooFilter::KeyTags tags = Tags(key);
+            ASSERT_LT(tags.tag1, bucket_num);
+            ASSERT_LT(tags.tag2, bucket_num);
+            ASSERT_NE(tags.tag1, tags.tag2);
+            // 与 filter 对象自己计算的 bucket 相同
+            ASSERT_EQ(filter.CuckooHash1(key.data(), key.size()), tags.tag1);
+            uint64_t tag2 = filter.CuckooHash2(key.data(), key.size());
+            if (tag2 == tags.tag1) {
+                tag2 = (tag2 + 1) % bucket_num;
+            }
+            ASSERT_EQ(tag2, tags.tag2);
+        }
+    }
+
+    TEST_F(CuckooFilterTest, KeyExists) {
+        const int kNumKeys = 1000;
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        uint64_t empty_block_num;
+        CuckooFilter empty_filter(arena_.get(), 1, 1, empty_block_num);
+        ASSERT_NE(0U, block_num);
+        ASSERT_NE(0U, empty_block_num);
+        for (int i = 0; i < kNumKeys; i += 2) {
+            std::string key = Key(i);
+            filter.CuckooPutKey(key.data(), key.size());
+        }
+
+        int false_positives = 0;
+        for (int i = 0; i < kNumKeys; i++) {
+            std::string key = Key(i);
+            // 同一组 tag 可以用于同样大小的任意 block
+            CuckooFilter::KeyTags tags = Tags(key);
+            bool exists = CuckooFilter::KeyExists(arena_.get(), block_num, tags);
+            ASSERT_EQ(filter.CuckooKeyExists(key.data(), key.size()), exists);
+            if (i % 2 == 0) {
+                ASSERT_TRUE(exists);
+            } else if (exists) {
+                false_positives++;
+            }
+            ASSERT_FALSE(CuckooFilter::KeyExists(arena_.get(), empty_block_num, tags));
+        }
+        ASSERT_LT(false_positives, kNumKeys / 20);
+
+        // 恢复出来的 filter 与 KeyExists 看到同样的内容
+        CuckooFilter recovered(arena_.get(), block_num);
+        for (int i = 0; i < kNumKeys; i += 2) {
+            std::string key = Key(i);
+            ASSERT_TRUE(recovered.CuckooKeyExists(key.data(), key.size()));
+        }
+
+        // 删除之后不再存在
+        std::string key = Key(0);
+        filter.CuckooDeleteKey(key.data(), key.size());
+        ASSERT_FALSE(CuckooFilter::KeyExists(arena_.get(), block_num, Tags(key)));
+    }
+
+    TEST_F(CuckooFilterTest, KeyExistsInSaturatedFilter) {
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        std::string key = Key(1);
+        ASSERT_FALSE(CuckooFilter::KeyExists(arena_.get(), block_num, Tags(key)));
+        arena_->SetSaturated(block_num);
+        ASSERT_TRUE(CuckooFilter::KeyExists(arena_.get(), block_num, Tags(key)));
+        ASSERT_TRUE(filter.CuckooKeyExists(key.data(), key.size()));
+    }
+
+    TEST_F(CuckooFilterTest, ReleaseMutexOnEarlyReturn) {
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        std::mutex &mutex = arena_->GetBlockMutex(block_num);
+        auto assert_unlocked = [&]() {
+            ASSERT_TRUE(mutex.try_lock());
+            mutex.unlock();
+        };
+        for (int i = 0; i < 100; i++) {
+            std::string key = Key(i);
+            filter.CuckooPutKey(key.data(), key.size());
+            assert_unlocked();
+        }
+        // 找到 key 之后提前返回的路径同样需要释放锁
+        for (int i = 0; i < 100; i++) {
+            std::string key = Key(i);
+            ASSERT_TRUE(filter.CuckooKeyExists(key.data(), key.size()));
+            assert_unlocked();
+            ASSERT_TRUE(CuckooFilter::KeyExists(arena_.get(), block_num, Tags(key)));
+            assert_unlocked();
+            filter.CuckooDeleteKey(key.data(), key.size());
+            assert_unlocked();
+        }
+        arena_->SetSaturated(block_num);
+        std::string key = Key(0);
+        ASSERT_TRUE(filter.CuckooKeyExists(key.data(), key.size()));
+        assert_unlocked();
+        ASSERT_TRUE(CuckooFilter::KeyExists(arena_.get(), block_num, Tags(key)));
+        assert_unlocked();
+    }
+
+    TEST_F(CuckooFilterTest, PrefetchKey) {
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        CuckooFilter::KeyTags tags = Tags(Key(1));
+        CuckooFilter::PrefetchKey(arena_.get(), block_num, tags);
+        // 不属于 pool 的 block 号被忽略
+        CuckooFilter::PrefetchKey(arena_.get(), 0, tags);
+        CuckooFilter::PrefetchKey(arena_.get(), (1 << 20) / kBlockSize, tags);
+        CuckooFilter::PrefetchKey(arena_.get(), UINT64_MAX, tags);
+        ASSERT_TRUE(arena_->ContainsBlock(block_num));
+        ASSERT_FALSE(arena_->ContainsBlock(0));
+        ASSERT_FALSE(arena_->ContainsBlock((1 << 20) / kBlockSize));
+    }
+
+    TEST_F(CuckooFilterTest, PrefixTags) {
+        for (int i = 0; i < 100; i++) {
+            std::string key = Key(i);
+            CuckooFilter::KeyTags key_tags = Tags(key);
+            CuckooFilter::KeyTags prefix_tags =
+                    CuckooFilter::ComputePrefixTags(kBlockSize, key.data(), key.size());
+            // 等于 prefix 的 key 与 prefix 使用不同的指纹
+            ASSERT_FALSE(key_tags.tag1 == prefix_tags.tag1 &&
+                         key_tags.tag2 == prefix_tags.tag2);
+            ASSERT_NE(prefix_tags.tag1, prefix_tags.tag2);
+        }
+    }
+
+    TEST_F(CuckooFilterTest, PutPrefix) {
+        uint64_t block_num;
+        CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        const std::string prefix = "pre";
+        CuckooFilter::KeyTags prefix_tags =
+                CuckooFilter::ComputePrefixTags(kBlockSize, prefix.data(), prefix.size());
+
+        filter.CuckooPutKey(prefix.data(), prefix.size());
+        ASSERT_EQ(1U, filter.OccupiedSlotNum());
+        ASSERT_FALSE(CuckooFilter::KeyExists(arena_.get(), block_num, prefix_tags));
+
+        // 同一个 prefix 只插入一次
+        filter.CuckooPutPrefix(prefix.data(), prefix.size());
+        filter.CuckooPutPrefix(prefix.data(), prefix.size());
+        ASSERT_EQ(2U, filter.OccupiedSlotNum());
+        ASSERT_TRUE(CuckooFilter::KeyExists(arena_.get(), block_num, prefix_tags));
+
+        // 删除等于 prefix 的 key 不影响 prefix 指纹
+        filter.CuckooDeleteKey(prefix.data(), prefix.size());
+        ASSERT_FALSE(filter.CuckooKeyExists(prefix.data(), prefix.size()));
+        ASSERT_TRUE(CuckooFilter::KeyExists(arena_.get(), block_num, prefix_tags));
+
+        const std::string other = "prf";
+        ASSERT_FALSE(CuckooFilter::KeyExists(
+                arena_.get(), block_num,
+                CuckooFilter::ComputePrefixTags(kBlockSize, other.data(), other.size())));
+    }
+
+    TEST_F(CuckooFilterTest, PrefixId) {
+        uint64_t block_num;
+        {
+            CuckooFilter filter(arena_.get(), 1, 1, block_num);
+        }
+        // 新分配的 block 没有 prefix 指纹
+        ASSERT_EQ(0U, arena_->GetPrefixId(block_num));
+        arena_->SetPrefixId(block_num, 42);
+        ASSERT_EQ(42U, arena_->GetPrefixId(block_num));
+
+        // 重新打开 pool 之后仍然保留
+        arena_.reset(new PersistentArena(path_, 1 << 20, kBlockSize, 1 << 20));
+        ASSERT_TRUE(arena_->IsFilterBlock(1, block_num));
+        ASSERT_EQ(42U, arena_->GetPrefixId(block_num));
+        arena_->SetPrefixId(block_num, 0);
+        ASSERT_EQ(0U, arena_->GetPrefixId(block_num));
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
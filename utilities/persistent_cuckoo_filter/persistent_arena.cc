@@ -1,108 +1,444 @@
 #include "persistent_arena.h"
 
+#include <sys/mman.h>
+#include <algorithm>
+#ifdef NUMA
+#include <numa.h>
+#endif
+#include "util/coding.h"
+
+#define POOL_META_OFFSET (BLOCK_NEXT_FREE_BLOCK_SIZE + LEVEL_NUM * sizeof(int64_t))
+#define HUGE_PAGE_SIZE (2ull * 1024 * 1024)
+// 后台预取时每次领取的范围
+#define PREFAULT_CHUNK_SIZE (64ull * 1024 * 1024)
+
 namespace rocksdb {
-    PersistentArena::PersistentArena(std::string &path, uint64_t pmem_size) {
-        // 将 pmem_size 按照 BLOCK_SIZE 进行对齐
-        pmem_size = ((pmem_size + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE;
+    namespace {
+        uint64_t Gcd(uint64_t a, uint64_t b) {
+            while (b != 0) {
+                uint64_t t = a % b;
+                a = b;
+                b = t;
+            }
+            return a;
+        }
 
-        char *pmemaddr = nullptr;
-        size_t mapped_size;
-        int is_pmem;
+        bool IsZero(const char *data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                if (data[i] != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
 
-        bool file_is_exists = access(path.c_str(), F_OK) ? false : true;
+        // 访问 [addr, addr + size) 中的每一页, 建立页表项
+        void PrefaultRange(char *addr, size_t size) {
+#ifdef MADV_POPULATE_READ
+            if (madvise(addr, size, MADV_POPULATE_READ) == 0) {
+                return;
+            }
+#endif
+            static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            volatile char sink = 0;
+            for (size_t off = 0; off < size; off += page_size) {
+                sink = sink ^ addr[off];
+            }
+            (void) sink;
+        }
+    }
+
+    PersistentArena::PersistentArena(const std::string &path, uint64_t pmem_size,
+                                     uint64_t block_size, uint64_t max_pmem_size,
+                                     const PmemEmulationOptions &emulation,
+                                     Statistics *statistics,
+                                     const PmemMappingOptions &mapping)
+            : path_(path), segment_num_(0), is_pmem_(0), free_blocks_(0),
+              free_list_dirty_(false), mapping_(mapping), prefault_stop_(false),
+              prefault_pending_(0) {
+        if (emulation.Enabled()) {
+            emulator_.reset(new PmemLatencyEmulator(emulation, statistics));
+        }
+        // block 中至少需要放下链表节点, 所以过小的 block_size 没有意义
+        assert(block_size > sizeof(AllocatedBlockListNode));
+        // block 0 中需要放下空闲链表头, 各层的链表头以及 pool 的元信息
+        assert(block_size >= POOL_META_OFFSET + sizeof(PersistentPoolMeta));
+        block_size_ = block_size;
+        // 将 pmem_size 按照 block_size_ 进行对齐, 使用大页时同时按 2MB 对齐
+        uint64_t align = block_size_;
+        if (mapping_.huge_pages) {
+            align = block_size_ / Gcd(block_size_, HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+        }
+        pmem_size = ((pmem_size + align - 1) / align) * align;
+        segment_size_ = pmem_size;
+        blocks_per_segment_ = segment_size_ / block_size_;
+        assert(blocks_per_segment_ > 1);
+
+        bool file_is_exists = access(path_.c_str(), F_OK) ? false : true;
 #ifdef PMEM_CUCKOO_DEBUG
         printf("[%s] pmem_size: %ld, file_is_exists: %d\n",__FUNCTION__, pmem_size, file_is_exists);
-        printf("[%s] delete existed file %s [%d]\n", __FUNCTION__, path.c_str(), remove(path.c_str()));
-        file_is_exists = false;
 #endif
-        pmemaddr = (char *) pmem_map_file(path.c_str(), pmem_size,
-                                          PMEM_FILE_CREATE, 0666, &mapped_size, &is_pmem);
-        assert(pmemaddr != NULL);
+        uint64_t existing_segment_num = 0;
+        if (file_is_exists) {
+            // 已经存在的 pool 沿用创建时的 block 大小以及段大小
+            PersistentPoolMeta meta;
+            FILE *fp = fopen(path_.c_str(), "rb");
+            bool valid = fp != nullptr &&
+                         fseek(fp, POOL_META_OFFSET, SEEK_SET) == 0 &&
+                         fread(&meta, sizeof(meta), 1, fp) == 1 &&
+                         meta.magic_ == PERSISTENT_POOL_MAGIC;
+            if (fp != nullptr) {
+                fclose(fp);
+            }
+            if (valid) {
+                block_size_ = meta.block_size_;
+                blocks_per_segment_ = meta.blocks_per_segment_;
+                segment_size_ = block_size_ * blocks_per_segment_;
+                existing_segment_num = meta.segment_num_;
+            } else {
+                // 没有写完元信息的 pool, 其中不可能有已经被 MANIFEST 引用的 filter
+                remove(path_.c_str());
+                file_is_exists = false;
+            }
+        }
+
+        max_segment_num_ = max_pmem_size / segment_size_;
+        if (max_segment_num_ < 1) {
+            max_segment_num_ = 1;
+        }
+        if (max_segment_num_ < existing_segment_num) {
+            max_segment_num_ = existing_segment_num;
+        }
+        segments_.assign(max_segment_num_, nullptr);
+
+        segments_[0] = MapSegment(0, !file_is_exists);
+        assert(segments_[0] != nullptr);
+        first_free_block_ = (int64_t *) segments_[0];
+        first_filter_block_in_level_ =
+                (int64_t *) (segments_[0] + BLOCK_NEXT_FREE_BLOCK_SIZE);
+        meta_ = (PersistentPoolMeta *) (segments_[0] + POOL_META_OFFSET);
 
-        pmem_raw_ = pmemaddr;
-        mapped_len_ = mapped_size;
-        assert(mapped_len_ == pmem_size);
-        is_pmem_ = is_pmem;
-        block_num_ = pmem_size / BLOCK_SIZE;
         if (!file_is_exists) {
             // 创建
-            uint64_t block_num = block_num_;
 #ifdef PMEM_CUCKOO_DEBUG
-            printf("[PersistentArena] block_num: %ld\n",block_num);
+            printf("[PersistentArena] block_num: %ld\n", blocks_per_segment_);
 #endif
-            for (size_t i = 0; i < block_num - 1; i++) {
-                *((int64_t *) (pmem_raw_ + i * BLOCK_SIZE)) = (i + 1);
+            for (uint64_t i = 1; i < blocks_per_segment_; i++) {
+                AllocatedBlockListNode *node =
+                        (AllocatedBlockListNode *) (segments_[0] + i * block_size_);
+                node->next_block_ = (i == blocks_per_segment_ - 1) ?
+                                    NO_MORE_FREE_BLOCK : (int64_t) (i + 1);
+                node->level_ = FREE_BLOCK_LEVEL;
+                node->cf_id_ = 0;
+                node->prefix_id_ = 0;
+                node->flags_ = 0;
             }
-
-            *((int64_t *) (pmem_raw_ + (block_num - 1) * BLOCK_SIZE)) =
-                    NO_MORE_FREE_BLOCK;
-
-            int64_t *filter_block_hdr_list_ptr =
-                    (int64_t *) (pmem_raw_ + BLOCK_NEXT_FREE_BLOCK_SIZE);
+            *first_free_block_ = 1;
             for (size_t i = 0; i < LEVEL_NUM; i++) {
-                filter_block_hdr_list_ptr[i] = NO_MORE_NEXT_VALID_BLOCK;
+                first_filter_block_in_level_[i] = NO_MORE_NEXT_VALID_BLOCK;
+            }
+            meta_->block_size_ = block_size_;
+            meta_->blocks_per_segment_ = blocks_per_segment_;
+            meta_->segment_num_ = 1;
+            pmem_persist(segments_[0], segment_size_);
+            // magic 最后写入, 保证元信息完整
+            meta_->magic_ = PERSISTENT_POOL_MAGIC;
+            pmem_persist(&meta_->magic_, sizeof(meta_->magic_));
+            segment_num_.store(1, std::memory_order_release);
+        } else {
+            for (uint64_t seg = 1; seg < existing_segment_num; seg++) {
+                segments_[seg] = MapSegment(seg, false);
+                assert(segments_[seg] != nullptr);
+            }
+            segment_num_.store(existing_segment_num, std::memory_order_release);
+            // 新建的 pool 在初始化时已经访问过每一个 block, 只有已有的 pool
+            // 需要预取. 新分配的 filter 在创建时会被整体初始化
+            if (mapping_.prefault_threads > 0) {
+                StartPrefault(mapping_.prefault_threads);
             }
         }
-        first_free_block_ = (int64_t *) pmem_raw_;
-        first_filter_block_in_level_ =
-                (int64_t *) (pmem_raw_ + BLOCK_NEXT_FREE_BLOCK_SIZE);
+
+        // 重建 DRAM 中的统计信息
+        uint64_t total_blocks = GetTotalBlocks();
+        for (uint64_t i = 1; i < total_blocks; i++) {
+            AllocatedBlockListNode *node = GetNode(i);
+            if (node->level_ == FREE_BLOCK_LEVEL) {
+                free_blocks_++;
+            } else {
+                used_blocks_[node->cf_id_]++;
+            }
+        }
+    }
+
+    bool PersistentArena::ReadPoolDbId(const std::string &path, std::string *db_id) {
+        PersistentPoolMeta meta;
+        FILE *fp = fopen(path.c_str(), "rb");
+        bool valid = fp != nullptr &&
+                     fseek(fp, POOL_META_OFFSET, SEEK_SET) == 0 &&
+                     fread(&meta, sizeof(meta), 1, fp) == 1 &&
+                     meta.magic_ == PERSISTENT_POOL_MAGIC;
+        if (fp != nullptr) {
+            fclose(fp);
+        }
+        if (valid) {
+            db_id->assign(meta.db_id_, strnlen(meta.db_id_, POOL_DB_ID_SIZE));
+        }
+        return valid;
+    }
+
+    std::string PersistentArena::GetDbId() const {
+        return std::string(meta_->db_id_, strnlen(meta_->db_id_, POOL_DB_ID_SIZE));
+    }
+
+    void PersistentArena::SetDbId(const std::string &db_id) {
+        size_t size = std::min(db_id.size(), static_cast<size_t>(POOL_DB_ID_SIZE - 1));
+        memset(meta_->db_id_, 0, POOL_DB_ID_SIZE);
+        memcpy(meta_->db_id_, db_id.data(), size);
+        pmem_persist(meta_->db_id_, POOL_DB_ID_SIZE);
     }
 
     PersistentArena::~PersistentArena() {
+        StopPrefault();
         Sync();
-        pmem_unmap(pmem_raw_, mapped_len_);
+        uint64_t segment_num = segment_num_.load(std::memory_order_acquire);
+        for (uint64_t seg = 0; seg < segment_num; seg++) {
+            pmem_unmap(segments_[seg], segment_size_);
+        }
 #ifdef PMEM_CUCKOO_DEBUG
         printf("[%s]\n", __FUNCTION__);
 #endif
     }
 
-    char *PersistentArena::AllocateBlock(uint64_t level, uint64_t &block_num) {
+    std::string PersistentArena::SegmentPath(uint64_t segment) const {
+        if (segment == 0) {
+            return path_;
+        }
+        return path_ + "." + std::to_string(segment);
+    }
+
+    char *PersistentArena::MapSegment(uint64_t segment, bool create) {
+        size_t mapped_size;
+        int is_pmem;
+        char *pmemaddr = (char *) pmem_map_file(SegmentPath(segment).c_str(),
+                                                create ? segment_size_ : 0,
+                                                create ? PMEM_FILE_CREATE : 0,
+                                                0666, &mapped_size, &is_pmem);
+        if (pmemaddr == nullptr) {
+            return nullptr;
+        }
+        assert(mapped_size == segment_size_);
+        is_pmem_ = is_pmem;
+        ApplyMappingPolicy(pmemaddr, mapped_size);
+        return pmemaddr;
+    }
+
+    void PersistentArena::ApplyMappingPolicy(char *addr, size_t size) {
+        if (mapping_.huge_pages) {
+#ifdef MADV_HUGEPAGE
+            // 失败 (例如内核不支持) 时退化为普通页, 不影响正确性
+            madvise(addr, size, MADV_HUGEPAGE);
+#endif
+        }
+#ifdef NUMA
+        if (numa_available() >= 0) {
+            if (mapping_.numa_node >= 0) {
+                numa_tonode_memory(addr, size, mapping_.numa_node);
+            } else if (mapping_.numa_interleave) {
+                numa_interleave_memory(addr, size, numa_all_nodes_ptr);
+            }
+        }
+#else
+        (void) addr;
+        (void) size;
+#endif
+    }
+
+    void PersistentArena::StartPrefault(int threads) {
+        uint64_t segment_num = segment_num_.load(std::memory_order_acquire);
+        uint64_t chunks_per_segment =
+                (segment_size_ + PREFAULT_CHUNK_SIZE - 1) / PREFAULT_CHUNK_SIZE;
+        uint64_t total_chunks = segment_num * chunks_per_segment;
+        prefault_pending_.store(total_chunks, std::memory_order_release);
+
+        // 各线程从同一个计数器领取 chunk, 段的地址在预取期间不会改变
+        std::shared_ptr<std::atomic<uint64_t>> next_chunk =
+                std::make_shared<std::atomic<uint64_t>>(0);
+        std::vector<char *> segments(segments_.begin(), segments_.begin() + segment_num);
+        uint64_t segment_size = segment_size_;
+        for (int i = 0; i < threads; i++) {
+            prefault_threads_.emplace_back([this, next_chunk, segments, segment_size,
+                                                   chunks_per_segment, total_chunks]() {
+                uint64_t chunk;
+                while (!prefault_stop_.load(std::memory_order_relaxed) &&
+                       (chunk = next_chunk->fetch_add(1, std::memory_order_relaxed)) <
+                       total_chunks) {
+                    uint64_t offset = (chunk % chunks_per_segment) * PREFAULT_CHUNK_SIZE;
+                    uint64_t size = std::min<uint64_t>(PREFAULT_CHUNK_SIZE, segment_size - offset);
+                    PrefaultRange(segments[chunk / chunks_per_segment] + offset, size);
+                    prefault_pending_.fetch_sub(1, std::memory_order_acq_rel);
+                }
+            });
+        }
+    }
+
+    void PersistentArena::StopPrefault() {
+        prefault_stop_.store(true, std::memory_order_relaxed);
+        for (auto &thread : prefault_threads_) {
+            thread.join();
+        }
+        prefault_threads_.clear();
+    }
+
+    bool PersistentArena::Grow() {
+        uint64_t seg = segment_num_.load(std::memory_order_acquire);
+        if (seg >= max_segment_num_) {
+            return false;
+        }
+        char *addr = MapSegment(seg, true);
+        if (addr == nullptr) {
+            // 设备空间不足, 之后不再尝试增长
+            max_segment_num_ = seg;
+            return false;
+        }
+        segments_[seg] = addr;
+
+        uint64_t first = seg * blocks_per_segment_;
+        uint64_t last = first + blocks_per_segment_ - 1;
+        for (uint64_t i = first; i <= last; i++) {
+            AllocatedBlockListNode *node =
+                    (AllocatedBlockListNode *) (addr + (i - first) * block_size_);
+            node->next_block_ = (i == last) ? *first_free_block_ : (int64_t) (i + 1);
+            node->level_ = FREE_BLOCK_LEVEL;
+            node->cf_id_ = 0;
+            node->prefix_id_ = 0;
+            node->flags_ = 0;
+        }
+        pmem_persist(addr, segment_size_);
+        if (emulator_) {
+            emulator_->ChargeWrite(addr, segment_size_);
+            emulator_->ChargeFlush(addr, segment_size_);
+        }
+        segment_num_.store(seg + 1, std::memory_order_release);
+        meta_->segment_num_ = seg + 1;
+        pmem_persist(&meta_->segment_num_, sizeof(meta_->segment_num_));
+        *first_free_block_ = first;
+        free_blocks_ += blocks_per_segment_;
+        return true;
+    }
+
+    uint64_t PersistentArena::SoftQuota() const {
+        uint64_t max_blocks = max_segment_num_ * blocks_per_segment_ - 1;
+        return registered_cfs_.empty() ? max_blocks : max_blocks / registered_cfs_.size();
+    }
+
+    void PersistentArena::RegisterColumnFamily(uint32_t cf_id) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        registered_cfs_.insert(cf_id);
+    }
+
+    void PersistentArena::UnregisterColumnFamily(uint32_t cf_id) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        registered_cfs_.erase(cf_id);
+        degraded_cfs_.erase(cf_id);
+    }
+
+    char *PersistentArena::AllocateBlock(uint32_t cf_id, uint64_t level, uint64_t &block_num) {
         assert(level < LEVEL_NUM);
 
-        alloc_dispose_mutex_.lock();
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
 
-        if (*first_free_block_ == NO_MORE_FREE_BLOCK)
+        if (*first_free_block_ == NO_MORE_FREE_BLOCK) {
+            Grow();
+        }
+        // pool 已经无法增长并且只剩下 1/8 的空闲空间时, 超出软配额的
+        // column family 不再分配新的 filter, 将剩余空间留给其他 column family
+        bool under_pressure =
+                segment_num_.load(std::memory_order_relaxed) >= max_segment_num_ &&
+                free_blocks_ <= max_segment_num_ * blocks_per_segment_ / 8;
+        if (*first_free_block_ == NO_MORE_FREE_BLOCK ||
+            (under_pressure && used_blocks_[cf_id] >= SoftQuota())) {
+            degraded_cfs_.insert(cf_id);
             return nullptr;
+        }
+        degraded_cfs_.erase(cf_id);
 
         int64_t free_block_num = *first_free_block_;
 #ifdef PMEM_CUCKOO_DEBUG
         printf("[%s] free_block_num=%ld\n", __FUNCTION__, free_block_num);
 #endif
-        AllocatedBlockListNode *node =
-                (AllocatedBlockListNode *) (pmem_raw_ + free_block_num * BLOCK_SIZE);
+        AllocatedBlockListNode *node = GetNode(free_block_num);
         node->level_ = level;
+        node->cf_id_ = cf_id;
+        node->prefix_id_ = 0;
+        node->flags_ = 0;
         *first_free_block_ = node->next_block_;
 #ifdef PMEM_CUCKOO_DEBUG
         printf("[PersistentArena::AllocateBlock] current first_block_num=%ld\n", *first_free_block_);
 #endif
-        node->next_block_ = first_filter_block_in_level_[level];
-#ifdef PMEM_CUCKOO_DEBUG
-        printf("[PersistentArena::AllocateBlock] next_block=%ld\n", node->next_block_);
-#endif
-        if (node->next_block_ != NO_MORE_NEXT_VALID_BLOCK) {
-            AllocatedBlockListNode *next_node =
-                    (AllocatedBlockListNode *) (pmem_raw_ +
-                                                first_filter_block_in_level_[level] * BLOCK_SIZE);
-            next_node->pre_block_ = free_block_num;
+        LinkToLevelList(free_block_num, level);
+        pmem_persist(node, sizeof(AllocatedBlockListNode));
+        if (emulator_) {
+            emulator_->ChargeFlush(node, sizeof(AllocatedBlockListNode));
         }
-        node->pre_block_ = 0;
-        first_filter_block_in_level_[level] = free_block_num;
         block_num = free_block_num;
 
-        alloc_dispose_mutex_.unlock();
+        free_blocks_--;
+        used_blocks_[cf_id]++;
+        pending_blocks_.insert(block_num);
 
-        return pmem_raw_ + free_block_num * BLOCK_SIZE;
+        return (char *) node;
     }
 
     void PersistentArena::DisposeBlock(uint64_t block_num) {
-        alloc_dispose_mutex_.lock();
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        DisposeBlockLocked(block_num);
+    }
 
-        AllocatedBlockListNode *node =
-                (AllocatedBlockListNode *) (pmem_raw_ + block_num * BLOCK_SIZE);
+    void PersistentArena::DisposeBlockLocked(uint64_t block_num) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        assert(node->level_ != FREE_BLOCK_LEVEL);
+        UnlinkFromLevelList(block_num);
+
+        auto used = used_blocks_.find(node->cf_id_);
+        if (used != used_blocks_.end() && used->second > 0) {
+            used->second--;
+        }
+        node->level_ = FREE_BLOCK_LEVEL;
+        node->cf_id_ = 0;
+        node->prefix_id_ = 0;
+        node->flags_ = 0;
+        node->next_block_ = *first_free_block_;
+        *first_free_block_ = block_num;
+
+        free_blocks_++;
+        pending_blocks_.erase(block_num);
+    }
+
+    void PersistentArena::LinkToLevelList(uint64_t block_num, uint64_t level) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if (emulator_) {
+            emulator_->ChargeWrite(node, sizeof(AllocatedBlockListNode));
+        }
+        node->next_block_ = first_filter_block_in_level_[level];
+#ifdef PMEM_CUCKOO_DEBUG
+        printf("[PersistentArena::LinkToLevelList] next_block=%ld\n", node->next_block_);
+#endif
+        if (node->next_block_ != NO_MORE_NEXT_VALID_BLOCK) {
+            GetNode(first_filter_block_in_level_[level])->pre_block_ = block_num;
+        }
+        node->pre_block_ = 0;
+        first_filter_block_in_level_[level] = block_num;
+    }
+
+    void PersistentArena::UnlinkFromLevelList(uint64_t block_num) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if (emulator_) {
+            emulator_->ChargeWrite(node, sizeof(AllocatedBlockListNode));
+        }
         AllocatedBlockListNode *pre_node = node->pre_block_ == 0 ? nullptr :
-                                           (AllocatedBlockListNode *) (pmem_raw_ + node->pre_block_ * BLOCK_SIZE);
+                                           GetNode(node->pre_block_);
         AllocatedBlockListNode *next_node = node->next_block_ == NO_MORE_NEXT_VALID_BLOCK ? nullptr :
-                                            (AllocatedBlockListNode *) (pmem_raw_ + node->next_block_ * BLOCK_SIZE);
+                                            GetNode(node->next_block_);
 
         if (pre_node) {
             pre_node->next_block_ = node->next_block_;
@@ -113,23 +449,280 @@ namespace rocksdb {
         if (next_node) {
             next_node->pre_block_ = node->pre_block_;
         }
+    }
 
-        node->next_block_ = *first_free_block_;
-        *first_free_block_ = block_num;
+    void PersistentArena::SetBlockLevel(uint64_t block_num, uint64_t level) {
+        assert(level < LEVEL_NUM);
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        AllocatedBlockListNode *node = GetNode(block_num);
+        assert(node->level_ != FREE_BLOCK_LEVEL);
+        if (node->level_ == static_cast<int>(level)) {
+            return;
+        }
+        UnlinkFromLevelList(block_num);
+        node->level_ = level;
+        LinkToLevelList(block_num, level);
+        pmem_persist(node, sizeof(AllocatedBlockListNode));
+        if (emulator_) {
+            emulator_->ChargeFlush(node, sizeof(AllocatedBlockListNode));
+        }
+    }
 
-        alloc_dispose_mutex_.unlock();
+    void PersistentArena::CommitBlock(uint64_t block_num) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        pending_blocks_.erase(block_num);
     }
 
-    void PersistentArena::Sync() {
-        if (is_pmem_) {
-            pmem_persist(pmem_raw_, mapped_len_);
+    uint64_t PersistentArena::ReclaimBlocks(
+            const std::unordered_map<uint32_t, std::unordered_set<uint64_t>> &live_blocks) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+
+        std::vector<uint64_t> unreferenced;
+        for (size_t level = 0; level < LEVEL_NUM; level++) {
+            for (int64_t b = first_filter_block_in_level_[level];
+                 b != NO_MORE_NEXT_VALID_BLOCK; b = GetNode(b)->next_block_) {
+                if (pending_blocks_.count(b) > 0) {
+                    continue;
+                }
+                uint32_t cf_id = GetNode(b)->cf_id_;
+                if (registered_cfs_.count(cf_id) > 0) {
+                    auto live = live_blocks.find(cf_id);
+                    // 没有提供引用信息的 column family 保守起见不回收
+                    if (live == live_blocks.end() || live->second.count(b) > 0) {
+                        continue;
+                    }
+                }
+                // 已经被 drop 的 column family 的 block 直接回收
+                unreferenced.push_back(b);
+            }
+        }
+        for (uint64_t b : unreferenced) {
+            DisposeBlockLocked(b);
+        }
+        return unreferenced.size();
+    }
+
+    bool PersistentArena::IsFilterBlock(uint32_t cf_id, uint64_t block_num) {
+        if (block_num == 0 || block_num >= GetTotalBlocks()) {
+            return false;
+        }
+        AllocatedBlockListNode *node = GetNode(block_num);
+        return node->level_ != FREE_BLOCK_LEVEL && node->cf_id_ == cf_id;
+    }
+
+    uint64_t PersistentArena::GetUsedBlocks(uint32_t cf_id) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        auto used = used_blocks_.find(cf_id);
+        return used == used_blocks_.end() ? 0 : used->second;
+    }
+
+    bool PersistentArena::IsDegraded(uint32_t cf_id) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        return degraded_cfs_.count(cf_id) > 0;
+    }
+
+    void PersistentArena::SetPrefixId(uint64_t block_num, uint32_t prefix_id) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        node->prefix_id_ = prefix_id;
+        pmem_persist(&node->prefix_id_, sizeof(node->prefix_id_));
+        if (emulator_) {
+            emulator_->ChargeWrite(&node->prefix_id_, sizeof(node->prefix_id_));
+            emulator_->ChargeFlush(&node->prefix_id_, sizeof(node->prefix_id_));
+        }
+    }
+
+    void PersistentArena::SetSaturated(uint64_t block_num) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        node->flags_ |= BLOCK_FLAG_SATURATED;
+        pmem_persist(&node->flags_, sizeof(node->flags_));
+        if (emulator_) {
+            emulator_->ChargeWrite(&node->flags_, sizeof(node->flags_));
+            emulator_->ChargeFlush(&node->flags_, sizeof(node->flags_));
+        }
+    }
+
+    bool PersistentArena::IsSaturated(uint64_t block_num) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if (emulator_) {
+            emulator_->ChargeRead(&node->flags_, sizeof(node->flags_));
+        }
+        return (node->flags_ & BLOCK_FLAG_SATURATED) != 0;
+    }
+
+    uint32_t PersistentArena::GetPrefixId(uint64_t block_num) {
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if (emulator_) {
+            emulator_->ChargeRead(&node->prefix_id_, sizeof(node->prefix_id_));
+        }
+        return node->prefix_id_;
+    }
+
+    bool PersistentArena::CopyFilterBlock(uint32_t cf_id, uint64_t block_num, int *level,
+                                          uint32_t *prefix_id, std::string *data) {
+        if (!IsFilterBlock(cf_id, block_num)) {
+            return false;
+        }
+        // 与正在写这个 filter 的 compaction 互斥, 导出的 filter 至少包含
+        // 导出时已经插入的所有 key
+        std::lock_guard<std::mutex> lock(GetBlockMutex(block_num));
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if ((node->flags_ & BLOCK_FLAG_SATURATED) != 0) {
+            // 导出格式中没有这个标识, 导入后会产生误判, 不导出
+            return false;
+        }
+        *level = node->level_;
+        *prefix_id = node->prefix_id_;
+        if (emulator_) {
+            emulator_->ChargeRead(node, block_size_);
+        }
+        // 只导出非 0 的部分, 每一段为: 与上一段之间 0 的字节数 (varint64),
+        // 段长度 (varint64), 段内容. 以 8 字节为单位扫描
+        const char *filter = (char *) node + sizeof(AllocatedBlockListNode);
+        size_t size = block_size_ - sizeof(AllocatedBlockListNode);
+        size_t last_end = 0;
+        size_t pos = 0;
+        while (pos < size) {
+            size_t len = std::min(sizeof(uint64_t), size - pos);
+            if (IsZero(filter + pos, len)) {
+                pos += len;
+                continue;
+            }
+            size_t start = pos;
+            while (pos < size) {
+                len = std::min(sizeof(uint64_t), size - pos);
+                if (IsZero(filter + pos, len)) {
+                    break;
+                }
+                pos += len;
+            }
+            PutVarint64(data, start - last_end);
+            PutVarint64(data, pos - start);
+            data->append(filter + start, pos - start);
+            last_end = pos;
+        }
+        return true;
+    }
+
+    AllocatedBlockListNode *PersistentArena::ClaimBlockLocked(uint32_t cf_id, uint64_t block_num,
+                                                              int level, uint32_t prefix_id,
+                                                              uint32_t flags) {
+        if (level < 0 || level >= LEVEL_NUM) {
+            return nullptr;
+        }
+        while (block_num >= GetTotalBlocks() && Grow()) {
+        }
+        if (block_num == 0 || block_num >= GetTotalBlocks()) {
+            return nullptr;
+        }
+
+        AllocatedBlockListNode *node = GetNode(block_num);
+        if (node->level_ == FREE_BLOCK_LEVEL) {
+            // 直接从空闲链表中摘除代价太高, 在 FinishImport 中统一重建
+            free_list_dirty_ = true;
+            free_blocks_--;
         } else {
-            pmem_msync(pmem_raw_, mapped_len_);
+            UnlinkFromLevelList(block_num);
+            auto used = used_blocks_.find(node->cf_id_);
+            if (used != used_blocks_.end() && used->second > 0) {
+                used->second--;
+            }
         }
+        node->level_ = level;
+        node->cf_id_ = cf_id;
+        node->prefix_id_ = prefix_id;
+        node->flags_ = flags;
+        LinkToLevelList(block_num, level);
+        used_blocks_[cf_id]++;
+        return node;
     }
 
-    char *PersistentArena::GetBlockWithBlockNum(uint64_t block_num) {
-        assert(block_num < block_num_ && block_num > 0);
-        return pmem_raw_ + block_num * BLOCK_SIZE;
+    bool PersistentArena::ImportFilterBlock(uint32_t cf_id, uint64_t block_num, int level,
+                                            uint32_t prefix_id, const char *filter,
+                                            size_t size) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+
+        // 先检查所有的段都在 filter 范围内, 格式错误时不占用 block
+        const uint64_t filter_size = block_size_ - sizeof(AllocatedBlockListNode);
+        Slice input(filter, size);
+        uint64_t pos = 0;
+        while (!input.empty()) {
+            uint64_t skip;
+            uint64_t len;
+            if (!GetVarint64(&input, &skip) || !GetVarint64(&input, &len) ||
+                skip > filter_size - pos || len > filter_size - pos - skip ||
+                len > input.size()) {
+                return false;
+            }
+            pos += skip + len;
+            input.remove_prefix(static_cast<size_t>(len));
+        }
+        AllocatedBlockListNode *node = ClaimBlockLocked(cf_id, block_num, level, prefix_id, 0);
+        if (node == nullptr) {
+            return false;
+        }
+        char *dst = (char *) node + sizeof(AllocatedBlockListNode);
+        memset(dst, 0, filter_size);
+        input = Slice(filter, size);
+        pos = 0;
+        while (!input.empty()) {
+            uint64_t skip;
+            uint64_t len;
+            GetVarint64(&input, &skip);
+            GetVarint64(&input, &len);
+            pos += skip;
+            memcpy(dst + pos, input.data(), static_cast<size_t>(len));
+            pos += len;
+            input.remove_prefix(static_cast<size_t>(len));
+        }
+        pmem_persist(node, block_size_);
+        if (emulator_) {
+            emulator_->ChargeWrite(node, block_size_);
+            emulator_->ChargeFlush(node, block_size_);
+        }
+        return true;
+    }
+
+    bool PersistentArena::ReserveBlock(uint32_t cf_id, uint64_t block_num, int level) {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+
+        AllocatedBlockListNode *node =
+                ClaimBlockLocked(cf_id, block_num, level, 0, BLOCK_FLAG_SATURATED);
+        if (node == nullptr) {
+            return false;
+        }
+        // 饱和的 filter 不会被查询, 只需要持久化链表节点
+        pmem_persist(node, sizeof(AllocatedBlockListNode));
+        if (emulator_) {
+            emulator_->ChargeFlush(node, sizeof(AllocatedBlockListNode));
+        }
+        return true;
+    }
+
+    void PersistentArena::FinishImport() {
+        std::lock_guard<std::mutex> lock(alloc_dispose_mutex_);
+        if (!free_list_dirty_) {
+            return;
+        }
+        int64_t first_free = NO_MORE_FREE_BLOCK;
+        for (uint64_t i = GetTotalBlocks() - 1; i > 0; i--) {
+            AllocatedBlockListNode *node = GetNode(i);
+            if (node->level_ == FREE_BLOCK_LEVEL) {
+                node->next_block_ = first_free;
+                first_free = i;
+            }
+        }
+        *first_free_block_ = first_free;
+        free_list_dirty_ = false;
+    }
+
+    void PersistentArena::Sync() {
+        uint64_t segment_num = segment_num_.load(std::memory_order_acquire);
+        for (uint64_t seg = 0; seg < segment_num; seg++) {
+            if (is_pmem_) {
+                pmem_persist(segments_[seg], segment_size_);
+            } else {
+                pmem_msync(segments_[seg], segment_size_);
+            }
+        }
     }
-}
\ No newline at end of file
+}
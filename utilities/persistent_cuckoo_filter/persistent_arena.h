@@ -5,16 +5,60 @@
 #include <libpmem.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "port/port.h"
 #include "pmem_format.h"
+#include "pmem_emulator.h"
 
 #define LEVEL_NUM 10
+#define BLOCK_MUTEX_NUM 64
 
 namespace rocksdb {
+    // pool 的映射方式
+    struct PmemMappingOptions {
+        // 大于 0 时, 打开已有的 pool 后由这么多个后台线程预先访问所有页,
+        // 避免重启之后的查询承担缺页的开销
+        int prefault_threads = 0;
+        // 新建的 pool 的段大小按 2MB 对齐, 并对映射调用 madvise(MADV_HUGEPAGE).
+        // DAX 设备上 libpmem 本身按 2MB 对齐映射地址; tmpfs 上需要将
+        // transparent_hugepage/shmem_enabled 设为 advise 或 always
+        bool huge_pages = false;
+        // 大于等于 0 时将 pool 的内存绑定到这个 NUMA 节点, 否则
+        // numa_interleave 为 true 时在所有节点间交错分布.
+        // 需要以 WITH_NUMA 编译, 对 DAX 设备 (内存位置固定) 不起作用
+        int numa_node = -1;
+        bool numa_interleave = false;
+    };
+
+    // 整个 DB 共享的 group filter pool, 所有 column family 的 group filter
+    // 都从这里分配 block.
+    //
+    // - pool 初始大小为 pmem_size, 空间不足时按 pmem_size 追加新的段文件,
+    //   最多增长到 max_pmem_size.
+    // - 每个 column family 有一个软配额 (最大 block 数 / column family 数).
+    //   pool 无法继续增长且空闲 block 不足时, 超出配额的 column family
+    //   分配失败, 进入降级模式: 新生成的 group 不带 filter (block 号为 0),
+    //   读路径退化为按 key range 判断. 分配失败不会影响 compaction 的正确性.
+    // - 新分配的 block 在 CommitBlock 之前处于 pending 状态, ReclaimBlocks
+    //   只回收不被任何存活 Version 引用, 也不处于 pending 状态的 block.
+    // - emulation 开启时, 对 filter 的访问按照 PMem 的代价模型计费,
+    //   见 PmemLatencyEmulator.
+    // - 映射方式 (预取, 大页, NUMA 策略) 见 PmemMappingOptions.
     class PersistentArena {
     public:
-        PersistentArena(std::string &path, uint64_t pmem_size = PMEM_SIZE);
+        PersistentArena(const std::string &path, uint64_t pmem_size = PMEM_SIZE,
+                        uint64_t block_size = BLOCK_SIZE,
+                        uint64_t max_pmem_size = 0,
+                        const PmemEmulationOptions &emulation = PmemEmulationOptions(),
+                        Statistics *statistics = nullptr,
+                        const PmemMappingOptions &mapping = PmemMappingOptions());
 
         PersistentArena(const PersistentArena &) = delete;
 
@@ -22,26 +66,175 @@ namespace rocksdb {
 
         ~PersistentArena();
 
-        size_t GetMappedSize() { return mapped_len_; }
+        size_t GetMappedSize() {
+            return segment_num_.load(std::memory_order_acquire) * segment_size_;
+        }
+
+        uint64_t GetBlockSize() const { return block_size_; }
+
+        // 读取 path 处已有 pool 所属的 DB id, pool 不存在或者不完整时返回 false.
+        // 用于在打开 pool 之前判断它是否属于正在打开的 DB
+        static bool ReadPoolDbId(const std::string &path, std::string *db_id);
+
+        // pool 所属的 DB id, 还没有被任何 DB 使用时为空
+        std::string GetDbId() const;
+
+        void SetDbId(const std::string &db_id);
 
-        char *AllocateBlock(uint64_t level, uint64_t &block_num);
+        void RegisterColumnFamily(uint32_t cf_id);
+
+        // drop 掉的 column family 的 block 会在下一次 ReclaimBlocks 时回收
+        void UnregisterColumnFamily(uint32_t cf_id);
+
+        // 分配失败 (降级) 时返回 nullptr
+        char *AllocateBlock(uint32_t cf_id, uint64_t level, uint64_t &block_num);
 
         void DisposeBlock(uint64_t block_num);
 
+        // 将 block 移到 level 的链表中. 用于分配时还不知道最终 level 的 filter
+        void SetBlockLevel(uint64_t block_num, uint64_t level);
+
+        // block 已经被安装到 Version 中 (或者分配它的 compaction 已经失败),
+        // 之后由 ReclaimBlocks 根据引用情况决定是否回收
+        void CommitBlock(uint64_t block_num);
+
+        // live_blocks: 每个已注册的 column family 在所有存活 Version 中
+        // 引用的 block. 返回回收的 block 数
+        uint64_t ReclaimBlocks(
+            const std::unordered_map<uint32_t, std::unordered_set<uint64_t>> &live_blocks);
+
+        // block_num 是否是 cf_id 正在使用的 filter block
+        bool IsFilterBlock(uint32_t cf_id, uint64_t block_num);
+
+        uint64_t GetUsedBlocks(uint32_t cf_id);
+
+        bool IsDegraded(uint32_t cf_id);
+
+        // 访问同一个 block 中 filter 的所有 CuckooFilter 对象共用的锁
+        std::mutex &GetBlockMutex(uint64_t block_num) {
+            return block_mutexes_[block_num % BLOCK_MUTEX_NUM];
+        }
+
+        // filter 中 prefix 指纹的标识, 0 表示没有 prefix 指纹.
+        // 对已经被 Version 引用的 block 只能将其清为 0
+        void SetPrefixId(uint64_t block_num, uint32_t prefix_id);
+
+        uint32_t GetPrefixId(uint64_t block_num);
+
+        // filter 插入失败时设置, 之后查询总是返回 true. 设置之后不会清除,
+        // 继续向这个 group 写入的 compaction 需要分配新的 block
+        void SetSaturated(uint64_t block_num);
+
+        bool IsSaturated(uint64_t block_num);
+
+        // 将 cf_id 的 filter block 中的 filter 部分 (不含链表节点) 中非 0 的
+        // 字节追加到 data 之后, 用于 checkpoint / backup 导出. 未使用的 slot
+        // 全为 0, 导出的大小与 filter 中的 key 数成正比.
+        // block 不属于 cf_id 或已经饱和时返回 false
+        bool CopyFilterBlock(uint32_t cf_id, uint64_t block_num, int *level,
+                             uint32_t *prefix_id, std::string *data);
+
+        // 将 CopyFilterBlock 导出的 filter 写回 block_num, 没有导出的部分置 0.
+        // 只能在打开 DB 时调用, 全部导入之后需要调用 FinishImport
+        bool ImportFilterBlock(uint32_t cf_id, uint64_t block_num, int level,
+                               uint32_t prefix_id, const char *filter, size_t size);
+
+        // 将 Version 引用但没有导入 filter 的 block 标记为 cf_id 的饱和 filter
+        // (查询总是返回 true), 避免它被重新分配给其他 group 之后, 旧的文件
+        // 按照新 group 的 filter 被误判为不存在. 调用时机同 ImportFilterBlock
+        bool ReserveBlock(uint32_t cf_id, uint64_t block_num, int level);
+
+        // 根据 block 头重建空闲链表
+        void FinishImport();
+
         void Sync();
 
-        char *GetBlockWithBlockNum(uint64_t block_num);
+        // 没有开启 emulation 时返回 nullptr
+        PmemLatencyEmulator *GetEmulator() { return emulator_.get(); }
+
+        // 后台预取是否已经完成 (没有开启预取时总是 true)
+        bool IsPrefaultDone() const {
+            return prefault_pending_.load(std::memory_order_acquire) == 0;
+        }
+
+        // block_num 是否位于已经映射的段中
+        bool ContainsBlock(uint64_t block_num) {
+            return block_num > 0 && block_num < GetTotalBlocks();
+        }
+
+        char *GetBlockWithBlockNum(uint64_t block_num) {
+            assert(block_num > 0 && block_num < GetTotalBlocks());
+            return segments_[block_num / blocks_per_segment_] +
+                   (block_num % blocks_per_segment_) * block_size_;
+        }
 
     private:
+        uint64_t GetTotalBlocks() {
+            return segment_num_.load(std::memory_order_acquire) * blocks_per_segment_;
+        }
+
+        AllocatedBlockListNode *GetNode(uint64_t block_num) {
+            return (AllocatedBlockListNode *) GetBlockWithBlockNum(block_num);
+        }
+
+        std::string SegmentPath(uint64_t segment) const;
+
+        char *MapSegment(uint64_t segment, bool create);
+
+        // 对新映射的段应用大页以及 NUMA 策略
+        void ApplyMappingPolicy(char *addr, size_t size);
+
+        // 启动后台线程预取当前已经映射的所有段
+        void StartPrefault(int threads);
+
+        void StopPrefault();
+
+        // 映射一个新的段, 并将其中的 block 全部加入空闲链表
+        bool Grow();
+
+        uint64_t SoftQuota() const;
+
+        void DisposeBlockLocked(uint64_t block_num);
+
+        // 将 block 改为属于 cf_id, 原来空闲的 block 留到 FinishImport 时
+        // 从空闲链表中摘除. block_num 超出 pool 时先尝试增长
+        AllocatedBlockListNode *ClaimBlockLocked(uint32_t cf_id, uint64_t block_num, int level,
+                                                 uint32_t prefix_id, uint32_t flags);
+
+        void LinkToLevelList(uint64_t block_num, uint64_t level);
+
+        void UnlinkFromLevelList(uint64_t block_num);
+
         std::mutex alloc_dispose_mutex_;
-        char *pmem_raw_;             // PM mmap后在内存中的首地址
+        std::string path_;
+        std::vector<char *> segments_;         // 每个段 mmap 后在内存中的首地址
+        std::atomic<uint64_t> segment_num_;
+        uint64_t max_segment_num_;
+        uint64_t segment_size_;
+        uint64_t blocks_per_segment_;
         int64_t *first_free_block_;  // 首个空闲的block编号
         // RocksDB 默认的 level 层数为7,这里设置为10,以防万一
         int64_t *first_filter_block_in_level_;
-        size_t mapped_len_;
+        PersistentPoolMeta *meta_;
         int is_pmem_;
-        uint64_t block_num_;
+        uint64_t block_size_;       // 每个 block 的大小, 即一个 group filter 的大小
+
+        // 以下为 DRAM 中的统计信息, 打开 pool 时通过扫描 block 头重建
+        uint64_t free_blocks_;
+        std::unordered_map<uint32_t, uint64_t> used_blocks_;
+        std::unordered_set<uint32_t> registered_cfs_;
+        std::unordered_set<uint32_t> degraded_cfs_;
+        std::unordered_set<uint64_t> pending_blocks_;
+        bool free_list_dirty_;
+
+        std::mutex block_mutexes_[BLOCK_MUTEX_NUM];
+        std::unique_ptr<PmemLatencyEmulator> emulator_;
+
+        PmemMappingOptions mapping_;
+        std::vector<port::Thread> prefault_threads_;
+        std::atomic<bool> prefault_stop_;
+        std::atomic<uint64_t> prefault_pending_;  // 尚未预取的 chunk 数
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,414 @@
+#include "persistent_arena.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cuckoo_filter.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+#include "util/coding.h"
+
+namespace rocksdb {
+    class PersistentArenaTest : public testing::Test {
+    public:
+        static const uint64_t kBlockSize = 64 << 10;
+        static const uint64_t kSegmentSize = 1 << 20;
+
+        PersistentArenaTest() {
+            dir_ = test::PerThreadDBPath("persistent_arena_test");
+            EXPECT_OK(Env::Default()->CreateDirIfMissing(dir_));
+            path_ = dir_ + "/cuckoo_filters.pool";
+            DeletePool();
+        }
+
+        ~PersistentArenaTest() override {
+            DeletePool();
+            Env::Default()->DeleteDir(dir_);
+        }
+
+        void DeletePool() {
+            remove(path_.c_str());
+            for (int segment = 1; segment < 4; segment++) {
+                remove((path_ + "." + std::to_string(segment)).c_str());
+            }
+        }
+
+        std::unique_ptr<PersistentArena> Open(const PmemMappingOptions &mapping,
+                                              uint64_t block_size = kBlockSize) {
+            return std::unique_ptr<PersistentArena>(new PersistentArena(
+                    path_, kSegmentSize, block_size, 3 * kSegmentSize,
+                    PmemEmulationOptions(), nullptr, mapping));
+        }
+
+        // 创建一个有 3 个段的 pool, 每个 filter 中插入自己的 block 号
+        void CreatePool(std::vector<uint64_t> *block_nums) {
+            std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+            const uint64_t blocks = 3 * kSegmentSize / kBlockSize - 1;
+            for (uint64_t i = 0; i < blocks; i++) {
+                uint64_t block_num;
+                CuckooFilter filter(arena.get(), 1, 1, block_num);
+                ASSERT_NE(0U, block_num);
+                std::string key = std::to_string(block_num);
+                filter.CuckooPutKey(key.data(), key.size());
+                block_nums->push_back(block_num);
+            }
+            ASSERT_EQ(3 * kSegmentSize, arena->GetMappedSize());
+        }
+
+        static void VerifyPool(PersistentArena *arena,
+                               const std::vector<uint64_t> &block_nums) {
+            ASSERT_EQ(3 * kSegmentSize, arena->GetMappedSize());
+            for (uint64_t block_num : block_nums) {
+                ASSERT_TRUE(arena->IsFilterBlock(1, block_num));
+                CuckooFilter filter(arena, block_num);
+                std::string key = std::to_string(block_num);
+                ASSERT_TRUE(filter.CuckooKeyExists(key.data(), key.size()));
+            }
+        }
+
+        std::string dir_;
+        std::string path_;
+    };
+
+    const uint64_t PersistentArenaTest::kBlockSize;
+    const uint64_t PersistentArenaTest::kSegmentSize;
+
+    TEST_F(PersistentArenaTest, PrefaultExistingPool) {
+        std::vector<uint64_t> block_nums;
+        CreatePool(&block_nums);
+
+        PmemMappingOptions mapping;
+        mapping.prefault_threads = 2;
+        std::unique_ptr<PersistentArena> arena = Open(mapping);
+        for (int i = 0; i < 10000 && !arena->IsPrefaultDone(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(arena->IsPrefaultDone());
+        VerifyPool(arena.get(), block_nums);
+    }
+
+    TEST_F(PersistentArenaTest, NoPrefaultForNewPool) {
+        PmemMappingOptions mapping;
+        mapping.prefault_threads = 2;
+        std::unique_ptr<PersistentArena> arena = Open(mapping);
+        ASSERT_TRUE(arena->IsPrefaultDone());
+        ASSERT_EQ(kSegmentSize, arena->GetMappedSize());
+    }
+
+    TEST_F(PersistentArenaTest, CloseWhilePrefaulting) {
+        std::vector<uint64_t> block_nums;
+        CreatePool(&block_nums);
+
+        // 预取线程在 unmap 之前被停止并回收
+        PmemMappingOptions mapping;
+        mapping.prefault_threads = 4;
+        for (int i = 0; i < 10; i++) {
+            Open(mapping).reset();
+        }
+        VerifyPool(Open(PmemMappingOptions()).get(), block_nums);
+    }
+
+    TEST_F(PersistentArenaTest, HugePagesAlignSegments) {
+        // 96KB 的 block 与 2MB 的公倍数为 6MB
+        const uint64_t block_size = 96 << 10;
+        const uint64_t huge_page_size = 2 << 20;
+        PmemMappingOptions mapping;
+        mapping.huge_pages = true;
+        uint64_t block_num;
+        {
+            std::unique_ptr<PersistentArena> arena = Open(mapping, block_size);
+            ASSERT_EQ(6U << 20, arena->GetMappedSize());
+            ASSERT_EQ(0U, arena->GetMappedSize() % huge_page_size);
+            ASSERT_EQ(0U, arena->GetMappedSize() % block_size);
+            CuckooFilter filter(arena.get(), 1, 1, block_num);
+            ASSERT_NE(0U, block_num);
+            filter.CuckooPutKey("key", 3);
+        }
+
+        // 已有的 pool 沿用创建时的段大小
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        ASSERT_EQ(block_size, arena->GetBlockSize());
+        ASSERT_EQ(6U << 20, arena->GetMappedSize());
+        CuckooFilter filter(arena.get(), block_num);
+        ASSERT_TRUE(filter.CuckooKeyExists("key", 3));
+    }
+
+    TEST_F(PersistentArenaTest, NumaPolicy) {
+        // 没有以 WITH_NUMA 编译或者没有 NUMA 时不起作用, 但都不影响 pool 的使用
+        PmemMappingOptions interleave;
+        interleave.numa_interleave = true;
+        PmemMappingOptions bind;
+        bind.numa_node = 0;
+        for (const PmemMappingOptions &mapping : {interleave, bind}) {
+            DeletePool();
+            std::unique_ptr<PersistentArena> arena = Open(mapping);
+            uint64_t block_num;
+            CuckooFilter filter(arena.get(), 1, 1, block_num);
+            ASSERT_NE(0U, block_num);
+            filter.CuckooPutKey("key", 3);
+            ASSERT_TRUE(filter.CuckooKeyExists("key", 3));
+        }
+    }
+
+
+    TEST_F(PersistentArenaTest, GrowAcrossSegments) {
+        const uint64_t blocks_per_segment = kSegmentSize / kBlockSize;
+        std::vector<uint64_t> block_nums;
+        {
+            std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+            arena->RegisterColumnFamily(1);
+            ASSERT_EQ(kSegmentSize, arena->GetMappedSize());
+            // block 0 存放 pool 的元信息, 之后每个段的 block 全部可用
+            for (uint64_t segments = 1; segments <= 3; segments++) {
+                while (block_nums.size() < segments * blocks_per_segment - 1) {
+                    uint64_t block_num;
+                    CuckooFilter filter(arena.get(), 1, 1, block_num);
+                    ASSERT_NE(0U, block_num);
+                    ASSERT_LT(block_num, segments * blocks_per_segment);
+                    std::string key = std::to_string(block_num);
+                    filter.CuckooPutKey(key.data(), key.size());
+                    arena->CommitBlock(block_num);
+                    block_nums.push_back(block_num);
+                }
+                ASSERT_EQ(segments * kSegmentSize, arena->GetMappedSize());
+            }
+            ASSERT_EQ(block_nums.size(), arena->GetUsedBlocks(1));
+
+            // 达到 max_pmem_size 之后不再增长
+            uint64_t block_num;
+            ASSERT_EQ(nullptr, arena->AllocateBlock(1, 1, block_num));
+            ASSERT_TRUE(arena->IsDegraded(1));
+            ASSERT_EQ(3 * kSegmentSize, arena->GetMappedSize());
+        }
+
+        // 重新打开时映射所有的段
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        VerifyPool(arena.get(), block_nums);
+        ASSERT_EQ(block_nums.size(), arena->GetUsedBlocks(1));
+    }
+
+    TEST_F(PersistentArenaTest, SoftQuota) {
+        // 3 个段共 47 个 block, 每个 column family 的配额为 23 个.
+        // 空闲 block 不超过 1/8 (6 个) 时才按配额限制分配
+        const uint64_t total_blocks = 3 * kSegmentSize / kBlockSize - 1;
+        const uint64_t reserve = 3 * kSegmentSize / kBlockSize / 8;
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        arena->RegisterColumnFamily(1);
+        arena->RegisterColumnFamily(2);
+
+        uint64_t block_num;
+        std::vector<uint64_t> cf1_blocks;
+        while (arena->AllocateBlock(1, 1, block_num) != nullptr) {
+            cf1_blocks.push_back(block_num);
+        }
+        ASSERT_EQ(total_blocks - reserve, cf1_blocks.size());
+        ASSERT_TRUE(arena->IsDegraded(1));
+        ASSERT_FALSE(arena->IsDegraded(2));
+
+        // 剩余的空间留给没有超出配额的 column family
+        std::vector<uint64_t> cf2_blocks;
+        while (arena->AllocateBlock(2, 1, block_num) != nullptr) {
+            cf2_blocks.push_back(block_num);
+        }
+        ASSERT_EQ(reserve, cf2_blocks.size());
+        ASSERT_TRUE(arena->IsDegraded(2));
+
+        // 释放的 block 仍然只分配给没有超出配额的 column family
+        arena->DisposeBlock(cf1_blocks.back());
+        cf1_blocks.pop_back();
+        ASSERT_EQ(nullptr, arena->AllocateBlock(1, 1, block_num));
+        ASSERT_TRUE(arena->IsDegraded(1));
+        ASSERT_NE(nullptr, arena->AllocateBlock(2, 1, block_num));
+        ASSERT_FALSE(arena->IsDegraded(2));
+        ASSERT_EQ(cf1_blocks.size(), arena->GetUsedBlocks(1));
+        ASSERT_EQ(reserve + 1, arena->GetUsedBlocks(2));
+    }
+
+    TEST_F(PersistentArenaTest, DegradedFilter) {
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        arena->RegisterColumnFamily(1);
+        std::vector<uint64_t> block_nums;
+        uint64_t block_num;
+        do {
+            CuckooFilter filter(arena.get(), 1, 1, block_num);
+            ASSERT_EQ(block_num != 0, filter.IsValid());
+            block_nums.push_back(block_num);
+        } while (block_num != 0);
+        ASSERT_EQ(3 * kSegmentSize / kBlockSize, block_nums.size());
+        ASSERT_TRUE(arena->IsDegraded(1));
+
+        // 分配失败的 filter 对应 block 0, 不是任何 column family 的 filter,
+        // 读路径不会查询它
+        ASSERT_FALSE(arena->IsFilterBlock(1, 0));
+
+        // 有空闲 block 之后恢复分配
+        arena->DisposeBlock(block_nums.front());
+        CuckooFilter filter(arena.get(), 1, 1, block_num);
+        ASSERT_TRUE(filter.IsValid());
+        ASSERT_EQ(block_nums.front(), block_num);
+        ASSERT_FALSE(arena->IsDegraded(1));
+    }
+
+    TEST_F(PersistentArenaTest, ReclaimAfterDrop) {
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        arena->RegisterColumnFamily(1);
+        arena->RegisterColumnFamily(2);
+        std::unordered_map<uint32_t, std::unordered_set<uint64_t>> live;
+        for (uint32_t cf_id = 1; cf_id <= 2; cf_id++) {
+            for (int i = 0; i < 5; i++) {
+                uint64_t block_num;
+                ASSERT_NE(nullptr, arena->AllocateBlock(cf_id, 1, block_num));
+                arena->CommitBlock(block_num);
+                live[cf_id].insert(block_num);
+            }
+        }
+        // 还没有提交的 block 不会被回收
+        uint64_t pending;
+        ASSERT_NE(nullptr, arena->AllocateBlock(2, 2, pending));
+
+        // 没有提供引用信息的 column family 不回收
+        std::unordered_map<uint32_t, std::unordered_set<uint64_t>> cf1_live;
+        cf1_live[1] = live[1];
+        ASSERT_EQ(0U, arena->ReclaimBlocks(cf1_live));
+        ASSERT_EQ(6U, arena->GetUsedBlocks(2));
+
+        // drop 之后它的 block 不再被引用
+        arena->UnregisterColumnFamily(2);
+        ASSERT_EQ(5U, arena->ReclaimBlocks(cf1_live));
+        ASSERT_EQ(1U, arena->GetUsedBlocks(2));
+        ASSERT_EQ(5U, arena->GetUsedBlocks(1));
+        for (uint64_t block_num : live[1]) {
+            ASSERT_TRUE(arena->IsFilterBlock(1, block_num));
+        }
+        for (uint64_t block_num : live[2]) {
+            ASSERT_FALSE(arena->IsFilterBlock(2, block_num));
+        }
+        ASSERT_TRUE(arena->IsFilterBlock(2, pending));
+
+        arena->CommitBlock(pending);
+        ASSERT_EQ(1U, arena->ReclaimBlocks(cf1_live));
+        ASSERT_EQ(0U, arena->GetUsedBlocks(2));
+
+        // 回收的 block 可以再分配给其他 column family
+        std::unordered_set<uint64_t> reused;
+        for (int i = 0; i < 6; i++) {
+            uint64_t block_num;
+            ASSERT_NE(nullptr, arena->AllocateBlock(1, 1, block_num));
+            reused.insert(block_num);
+        }
+        for (uint64_t block_num : live[2]) {
+            ASSERT_EQ(1U, reused.count(block_num));
+        }
+    }
+    TEST_F(PersistentArenaTest, CopyAndImportFilterBlock) {
+        std::string data;
+        int level;
+        uint32_t prefix_id;
+        uint64_t block_num;
+        {
+            std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+            arena->RegisterColumnFamily(1);
+            // 复用的 block 中残留着旧 filter 的内容
+            {
+                CuckooFilter old_filter(arena.get(), 1, 1, block_num);
+                for (int i = 0; i < 1000; i++) {
+                    std::string key = "old" + std::to_string(i);
+                    old_filter.CuckooPutKey(key.data(), key.size());
+                }
+            }
+            arena->DisposeBlock(block_num);
+            CuckooFilter filter(arena.get(), 1, 2, block_num);
+            ASSERT_TRUE(filter.IsValid());
+            arena->SetPrefixId(block_num, 7);
+            for (int i = 0; i < 100; i++) {
+                std::string key = "key" + std::to_string(i);
+                filter.CuckooPutKey(key.data(), key.size());
+            }
+            ASSERT_FALSE(arena->CopyFilterBlock(2, block_num, &level, &prefix_id, &data));
+            ASSERT_TRUE(arena->CopyFilterBlock(1, block_num, &level, &prefix_id, &data));
+            ASSERT_EQ(2, level);
+            ASSERT_EQ(7U, prefix_id);
+        }
+        // 只导出了 100 个 slot 的内容, 而不是整个 block
+        ASSERT_LT(data.size(), 100 * (sizeof(CuckooSlot) + 4));
+        DeletePool();
+
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        arena->RegisterColumnFamily(1);
+        // 不完整或者超出 filter 范围的导出内容不会占用 block
+        ASSERT_FALSE(arena->ImportFilterBlock(1, block_num, level, prefix_id, data.data(),
+                                              data.size() - 1));
+        std::string beyond;
+        PutVarint64(&beyond, kBlockSize);
+        PutVarint64(&beyond, 1);
+        beyond.push_back('x');
+        ASSERT_FALSE(arena->ImportFilterBlock(1, block_num, level, prefix_id, beyond.data(),
+                                              beyond.size()));
+        ASSERT_FALSE(arena->IsFilterBlock(1, block_num));
+
+        ASSERT_TRUE(arena->ImportFilterBlock(1, block_num, level, prefix_id, data.data(),
+                                             data.size()));
+        arena->FinishImport();
+        ASSERT_TRUE(arena->IsFilterBlock(1, block_num));
+        ASSERT_EQ(7U, arena->GetPrefixId(block_num));
+        CuckooFilter filter(arena.get(), block_num);
+        for (int i = 0; i < 100; i++) {
+            std::string key = "key" + std::to_string(i);
+            ASSERT_TRUE(filter.CuckooKeyExists(key.data(), key.size()));
+        }
+        for (int i = 0; i < 1000; i++) {
+            std::string key = "old" + std::to_string(i);
+            ASSERT_FALSE(filter.CuckooKeyExists(key.data(), key.size()));
+        }
+    }
+
+    TEST_F(PersistentArenaTest, ReserveBlock) {
+        uint64_t reserved = 3;
+        uint64_t beyond = kSegmentSize / kBlockSize + 2;
+        {
+            std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+            arena->RegisterColumnFamily(1);
+            // 空闲的 block 以及超出当前 pool 的 block 都可以被保留
+            ASSERT_TRUE(arena->ReserveBlock(1, reserved, 1));
+            ASSERT_TRUE(arena->ReserveBlock(1, beyond, 2));
+            ASSERT_FALSE(arena->ReserveBlock(1, 0, 1));
+            arena->FinishImport();
+            ASSERT_EQ(2 * kSegmentSize, arena->GetMappedSize());
+            ASSERT_EQ(2U, arena->GetUsedBlocks(1));
+            ASSERT_TRUE(arena->IsFilterBlock(1, reserved));
+            ASSERT_FALSE(arena->IsFilterBlock(2, reserved));
+            ASSERT_TRUE(arena->IsSaturated(reserved));
+            ASSERT_TRUE(CuckooFilter::KeyExists(
+                    arena.get(), reserved, CuckooFilter::ComputeKeyTags(kBlockSize, "key", 3)));
+        }
+
+        // 重新打开之后, 保留的 block 不会再被分配
+        std::unique_ptr<PersistentArena> arena = Open(PmemMappingOptions());
+        arena->RegisterColumnFamily(1);
+        ASSERT_TRUE(arena->IsSaturated(reserved));
+        ASSERT_TRUE(arena->IsSaturated(beyond));
+        const uint64_t blocks = 2 * kSegmentSize / kBlockSize - 1;
+        for (uint64_t i = 2; i < blocks; i++) {
+            uint64_t block_num;
+            ASSERT_NE(nullptr, arena->AllocateBlock(2, 1, block_num));
+            ASSERT_NE(reserved, block_num);
+            ASSERT_NE(beyond, block_num);
+        }
+
+        // 引用结束之后正常回收
+        std::unordered_map<uint32_t, std::unordered_set<uint64_t>> live;
+        live[1].insert(beyond);
+        ASSERT_EQ(1U, arena->ReclaimBlocks(live));
+        ASSERT_FALSE(arena->IsFilterBlock(1, reserved));
+        ASSERT_TRUE(arena->IsFilterBlock(1, beyond));
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include "pmem_emulator.h"
+
+#include <chrono>
+
+#include "monitoring/statistics.h"
+#include "port/port.h"
+
+namespace rocksdb {
+    namespace {
+        // 每个线程最近一次访问的 granule, 模拟设备内部的读写缓冲
+        thread_local uint64_t last_granule = UINT64_MAX;
+    }
+
+    PmemLatencyEmulator::PmemLatencyEmulator(const PmemEmulationOptions &options,
+                                             Statistics *statistics)
+            : options_(options), statistics_(statistics) {
+        if (options_.access_granularity == 0) {
+            options_.access_granularity = 1;
+        }
+    }
+
+    void PmemLatencyEmulator::GranuleRange(const void *addr, size_t size,
+                                           uint64_t *first, uint64_t *last) const {
+        uint64_t start = reinterpret_cast<uintptr_t>(addr);
+        *first = start / options_.access_granularity;
+        *last = (start + (size == 0 ? 0 : size - 1)) / options_.access_granularity;
+    }
+
+    void PmemLatencyEmulator::ChargeRead(const void *addr, size_t size) {
+        uint64_t first, last;
+        GranuleRange(addr, size, &first, &last);
+        uint64_t granules = last - first + 1;
+        if (first == last_granule) {
+            granules--;
+        }
+        last_granule = last;
+        if (granules == 0) {
+            return;
+        }
+        RecordTick(statistics_, TIER_PMEM_EMULATED_READS, granules);
+        Stall(granules * options_.read_latency_ns);
+    }
+
+    void PmemLatencyEmulator::ChargeWrite(const void *addr, size_t size) {
+        uint64_t first, last;
+        GranuleRange(addr, size, &first, &last);
+        uint64_t granules = last - first + 1;
+        uint64_t g = options_.access_granularity;
+        uint64_t start = reinterpret_cast<uintptr_t>(addr);
+        // 首尾 granule 没有被完整覆盖时需要先读出; 已经在缓冲中的不需要
+        bool head_partial = start % g != 0 && first != last_granule;
+        bool tail_partial = (start + size) % g != 0;
+        uint64_t partial;
+        if (first == last) {
+            partial = (head_partial || (tail_partial && first != last_granule)) ? 1 : 0;
+        } else {
+            partial = (head_partial ? 1 : 0) + (tail_partial ? 1 : 0);
+        }
+        last_granule = last;
+        RecordTick(statistics_, TIER_PMEM_EMULATED_WRITES, granules);
+        if (partial > 0) {
+            RecordTick(statistics_, TIER_PMEM_EMULATED_READS, partial);
+        }
+        Stall(granules * options_.write_latency_ns + partial * options_.read_latency_ns);
+    }
+
+    void PmemLatencyEmulator::ChargeFlush(const void *addr, size_t size) {
+        // pmem_persist 逐个 cache line 执行 flush, 每个 cache line 付出一次延迟
+        uint64_t start = reinterpret_cast<uintptr_t>(addr);
+        uint64_t first = start / CACHE_LINE_SIZE;
+        uint64_t last = (start + (size == 0 ? 0 : size - 1)) / CACHE_LINE_SIZE;
+        uint64_t lines = last - first + 1;
+        RecordTick(statistics_, TIER_PMEM_EMULATED_FLUSHES, lines);
+        Stall(lines * options_.flush_latency_ns);
+    }
+
+    void PmemLatencyEmulator::Stall(uint64_t nanos) {
+        if (nanos == 0) {
+            return;
+        }
+        RecordTick(statistics_, TIER_PMEM_EMULATED_STALL_NANOS, nanos);
+        // 几百纳秒的等待无法通过 sleep 实现, 只能自旋
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanos);
+        while (std::chrono::steady_clock::now() < deadline) {
+            port::AsmVolatilePause();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rocksdb {
+    class Statistics;
+
+    // 在没有 Optane 的机器上模拟 PMem 的访问代价.
+    // pool 仍然映射普通的文件 (放在 /dev/shm 等 tmpfs 上即完全位于 DRAM 中),
+    // 对 filter 的每次访问按照下面的代价模型自旋等待相应的时间:
+    //
+    // - PMem 内部以 access_granularity (Optane 为 256 字节) 为单位读写介质,
+    //   一次访问涉及的每个 granule 都要付出一次延迟.
+    // - 同一个线程连续访问同一个 granule 时命中设备内部的缓冲, 不再计费.
+    // - 不足一个 granule 的写入需要先读出整个 granule (read-modify-write).
+    // - 持久化 (pmem_persist) 涉及的每个 cache line 额外付出一次 flush 延迟.
+    struct PmemEmulationOptions {
+        uint64_t read_latency_ns = 0;
+        uint64_t write_latency_ns = 0;
+        uint64_t flush_latency_ns = 0;
+        uint64_t access_granularity = 256;
+
+        bool Enabled() const {
+            return read_latency_ns > 0 || write_latency_ns > 0 || flush_latency_ns > 0;
+        }
+    };
+
+    class PmemLatencyEmulator {
+    public:
+        // statistics 可以为空, 不为空时记录 TIER_PMEM_EMULATED_* ticker
+        PmemLatencyEmulator(const PmemEmulationOptions &options, Statistics *statistics);
+
+        void ChargeRead(const void *addr, size_t size);
+
+        void ChargeWrite(const void *addr, size_t size);
+
+        void ChargeFlush(const void *addr, size_t size);
+
+    private:
+        // [addr, addr + size) 涉及的第一个以及最后一个 granule 的编号
+        void GranuleRange(const void *addr, size_t size, uint64_t *first,
+                          uint64_t *last) const;
+
+        void Stall(uint64_t nanos);
+
+        PmemEmulationOptions options_;
+        Statistics *statistics_;
+    };
+}
@@ -0,0 +1,210 @@
+#include "pmem_emulator.h"
+
+#include <memory>
+#include <string>
+
+#include "cuckoo_filter.h"
+#include "monitoring/statistics.h"
+#include "port/port.h"
+#include "rocksdb/env.h"
+#include "rocksdb/statistics.h"
+#include "test_util/testharness.h"
+#include "test_util/testutil.h"
+
+namespace rocksdb {
+    class PmemEmulatorTest : public testing::Test {
+    public:
+        PmemEmulatorTest() : statistics_(CreateDBStatistics()) {
+            options_.read_latency_ns = 300;
+            options_.write_latency_ns = 100;
+            options_.flush_latency_ns = 1000;
+            options_.access_granularity = 256;
+            // 测试对象是 new 出来的, alignas 不保证生效, 手动按 granule 对齐.
+            // buf_ 之前至少留出一个字节
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw_) + 1;
+            buf_ = reinterpret_cast<char *>((start + 255) / 256 * 256);
+            memset(raw_, 0, sizeof(raw_));
+            // 之前的测试留下的 "最近访问的 granule" 可能落在 buf_ 中,
+            // 先访问一次 buf_ 之前的地址
+            PmemLatencyEmulator(options_, nullptr).ChargeRead(buf_ - 1, 1);
+        }
+
+        std::unique_ptr<PmemLatencyEmulator> NewEmulator() {
+            return std::unique_ptr<PmemLatencyEmulator>(
+                    new PmemLatencyEmulator(options_, statistics_.get()));
+        }
+
+        uint64_t Ticker(Tickers ticker) {
+            return statistics_->getAndResetTickerCount(ticker);
+        }
+
+        // 第 i 个 granule 的起始地址
+        char *Granule(size_t i) { return buf_ + i * 256; }
+
+        PmemEmulationOptions options_;
+        std::shared_ptr<Statistics> statistics_;
+        char raw_[17 * 256];
+        char *buf_;
+    };
+
+    TEST_F(PmemEmulatorTest, Enabled) {
+        PmemEmulationOptions options;
+        ASSERT_FALSE(options.Enabled());
+        options.read_latency_ns = 1;
+        ASSERT_TRUE(options.Enabled());
+        options = PmemEmulationOptions();
+        options.write_latency_ns = 1;
+        ASSERT_TRUE(options.Enabled());
+        options = PmemEmulationOptions();
+        options.flush_latency_ns = 1;
+        ASSERT_TRUE(options.Enabled());
+    }
+
+    TEST_F(PmemEmulatorTest, ChargeReadPerGranule) {
+        auto emulator = NewEmulator();
+        // 跨越 3 个 granule
+        emulator->ChargeRead(Granule(1) + 100, 2 * 256);
+        ASSERT_EQ(3U, Ticker(TIER_PMEM_EMULATED_READS));
+        ASSERT_EQ(3U * 300, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+
+        // 最近访问的 granule 命中设备缓冲, 只有之后的 granule 计费
+        emulator->ChargeRead(Granule(3), 256 + 1);
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_READS));
+        ASSERT_EQ(300U, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+        emulator->ChargeRead(Granule(4) + 8, 8);
+        ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_READS));
+        ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+
+        // 离开之后再回来需要重新计费
+        emulator->ChargeRead(Granule(8), 1);
+        emulator->ChargeRead(Granule(4), 1);
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_READS));
+    }
+
+    TEST_F(PmemEmulatorTest, ChargeWrite) {
+        auto emulator = NewEmulator();
+        // 完整覆盖的 granule 不需要先读出
+        emulator->ChargeWrite(Granule(0), 2 * 256);
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_READS));
+        ASSERT_EQ(2U * 100, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+
+        // 不足一个 granule 的写入需要 read-modify-write
+        emulator->ChargeWrite(Granule(5) + 16, 16);
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_READS));
+        ASSERT_EQ(100U + 300, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+
+        // 已经在缓冲中的 granule 不需要再读出
+        emulator->ChargeWrite(Granule(5) + 64, 16);
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_READS));
+
+        // 首尾都不完整的写入, 首个 granule 在缓冲中
+        emulator->ChargeWrite(Granule(5) + 128, 2 * 256);
+        ASSERT_EQ(3U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_READS));
+
+        // 首尾都不完整, 都需要读出
+        emulator->ChargeWrite(Granule(10) + 128, 256);
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_READS));
+    }
+
+    TEST_F(PmemEmulatorTest, ChargeFlush) {
+        auto emulator = NewEmulator();
+        emulator->ChargeFlush(Granule(0), 8);
+        emulator->ChargeFlush(Granule(0), 8);
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+        ASSERT_EQ(2U * 1000, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+
+        // 按照涉及的 cache line 计费
+        emulator->ChargeFlush(Granule(1), 256);
+        ASSERT_EQ(256U / CACHE_LINE_SIZE, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+        ASSERT_EQ(256U / CACHE_LINE_SIZE * 1000, Ticker(TIER_PMEM_EMULATED_STALL_NANOS));
+        emulator->ChargeFlush(Granule(2) - 1, 2);
+        ASSERT_EQ(2U, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+        emulator->ChargeFlush(Granule(2), 0);
+        ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+    }
+
+    TEST_F(PmemEmulatorTest, Stall) {
+        options_.read_latency_ns = 1000 * 1000;
+        auto emulator = NewEmulator();
+        Env *env = Env::Default();
+        uint64_t start = env->NowNanos();
+        emulator->ChargeRead(Granule(0), 2 * 256);
+        ASSERT_GE(env->NowNanos() - start, 2U * 1000 * 1000);
+    }
+
+    TEST_F(PmemEmulatorTest, ZeroGranularity) {
+        options_.access_granularity = 0;
+        auto emulator = NewEmulator();
+        emulator->ChargeRead(Granule(0), 10);
+        ASSERT_EQ(10U, Ticker(TIER_PMEM_EMULATED_READS));
+        emulator->ChargeWrite(Granule(1), 10);
+        ASSERT_EQ(10U, Ticker(TIER_PMEM_EMULATED_WRITES));
+        ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_READS));
+    }
+
+    TEST_F(PmemEmulatorTest, NoStatistics) {
+        PmemLatencyEmulator emulator(options_, nullptr);
+        emulator.ChargeRead(Granule(0), 256);
+        emulator.ChargeWrite(Granule(1) + 1, 1);
+        emulator.ChargeFlush(Granule(1), 1);
+    }
+
+    TEST_F(PmemEmulatorTest, FilterPool) {
+        std::string dir = test::PerThreadDBPath("pmem_emulator_test");
+        ASSERT_OK(Env::Default()->CreateDirIfMissing(dir));
+        std::string path = dir + "/cuckoo_filters.pool";
+        remove(path.c_str());
+        {
+            // 没有开启 emulation 时不计费
+            PersistentArena arena(path, 1 << 20, 64 << 10, 1 << 20,
+                                  PmemEmulationOptions(), statistics_.get());
+            ASSERT_TRUE(arena.GetEmulator() == nullptr);
+            uint64_t block_num;
+            CuckooFilter filter(&arena, 1, 1, block_num);
+            filter.CuckooPutKey("key", 3);
+            ASSERT_TRUE(filter.CuckooKeyExists("key", 3));
+            ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_WRITES));
+            ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_READS));
+        }
+        remove(path.c_str());
+        {
+            PersistentArena arena(path, 1 << 20, 64 << 10, 1 << 20, options_,
+                                  statistics_.get());
+            ASSERT_TRUE(arena.GetEmulator() != nullptr);
+            uint64_t block_num;
+            CuckooFilter filter(&arena, 1, 1, block_num);
+            ASSERT_NE(0U, block_num);
+            // 创建时初始化了整个 filter
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_WRITES), (64U << 10) / 256 - 1);
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_FLUSHES), (64U << 10) / CACHE_LINE_SIZE - 1);
+            Ticker(TIER_PMEM_EMULATED_READS);
+
+            // 插入的 slot 需要持久化
+            filter.CuckooPutKey("key", 3);
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_WRITES), 1U);
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_READS), 1U);
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_FLUSHES), 1U);
+
+            ASSERT_TRUE(filter.CuckooKeyExists("key", 3));
+            ASSERT_GE(Ticker(TIER_PMEM_EMULATED_READS), 1U);
+            ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_WRITES));
+            ASSERT_EQ(0U, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+
+            arena.SetSaturated(block_num);
+            ASSERT_EQ(1U, Ticker(TIER_PMEM_EMULATED_FLUSHES));
+            ASSERT_GT(Ticker(TIER_PMEM_EMULATED_STALL_NANOS), 0U);
+        }
+        remove(path.c_str());
+        Env::Default()->DeleteDir(dir);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
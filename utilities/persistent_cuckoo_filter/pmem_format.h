@@ -15,6 +15,12 @@
 *   | L1 第一个Filter所在Block号 |
 *   |             .....          |
 *   +----------------------------+
+*   |  PersistentPoolMeta        |   magic, block 大小, 每个段的 block 数,
+*   |                            |   已经创建的段数, 所属 DB 的 id
+*   +----------------------------+
+*
+*   pool 由若干个大小相同的段文件组成 (path, path.1, path.2, ...),
+*   block 号在所有段中全局连续编号, 空间不足时追加新的段, 已映射的段不会移动
 *
 *
 *   +----------------+
@@ -28,7 +34,13 @@
 *   |  该层的前一个GroupFilter   |
 *   |     所在的Block号          |
 *   +----------------------------+
-*   |    属于哪一层（非空闲使用）|
+*   |    属于哪一层（非空闲使用）|   空闲 block 为 FREE_BLOCK_LEVEL
+*   +----------------------------+
+*   |    属于哪一个 column family|
+*   +----------------------------+
+*   |  prefix section 的标识     |   0 表示 filter 中没有 prefix 指纹
+*   +----------------------------+
+*   |  flags                     |   BLOCK_FLAG_SATURATED 等
 *   +----------------------------+
 *   |   smallest_key size        |
 *   +----------------------------+
@@ -45,6 +57,11 @@
 #define BLOCK_NEXT_FREE_BLOCK_SIZE (sizeof(int64_t))
 #define NO_MORE_FREE_BLOCK -1
 #define NO_MORE_NEXT_VALID_BLOCK -2
+#define FREE_BLOCK_LEVEL -1
+// filter 插入失败, 丢失了一个被踢出的指纹, 查询必须总是返回 true
+#define BLOCK_FLAG_SATURATED 0x1u
+#define PERSISTENT_POOL_MAGIC 0x43554b4f4f504f32ULL   // "CUKOOPO2"
+#define POOL_DB_ID_SIZE 64
 #define BLOCK_SIZE (1024*1024)            // 暂定一个 Cuckoo Filter 占用 1MB
 #define PMEM_SIZE (1024*1024*1024)         // 本地测试开辟的 PM 的大小 128MB  
 
@@ -53,5 +70,20 @@ namespace rocksdb {
         int64_t next_block_;
         int64_t pre_block_;
         int level_;
+        uint32_t cf_id_;
+        // 非 0 时 filter 中还保存了 group 中所有 key 的 prefix 指纹,
+        // 值为生成这些指纹的 prefix_extractor 的标识
+        uint32_t prefix_id_;
+        uint32_t flags_;
+    };
+
+    struct PersistentPoolMeta {
+        uint64_t magic_;
+        uint64_t block_size_;
+        uint64_t blocks_per_segment_;
+        uint64_t segment_num_;
+        // 使用这个 pool 的 DB 的 id (以 '\0' 结尾), 全 0 表示还没有被任何 DB 使用.
+        // 加入这个字段之前创建的 pool 中这里同样为 0, 所以不需要修改 magic
+        char db_id_[POOL_DB_ID_SIZE];
     };
 }
\ No newline at end of file
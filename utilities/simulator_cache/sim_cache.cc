@@ -164,6 +164,8 @@ class SimCacheImpl : public SimCache {
   ~SimCacheImpl() override {}
   void SetCapacity(size_t capacity) override { cache_->SetCapacity(capacity); }
 
+  bool IsDraining() const override { return cache_->IsDraining(); }
+
   void SetStrictCapacityLimit(bool strict_capacity_limit) override {
     cache_->SetStrictCapacityLimit(strict_capacity_limit);
   }
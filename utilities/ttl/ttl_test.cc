@@ -5,8 +5,10 @@
 
 #ifndef ROCKSDB_LITE
 
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include "rocksdb/compaction_filter.h"
 #include "rocksdb/utilities/db_ttl.h"
 #include "test_util/testharness.h"
@@ -225,6 +227,29 @@ class TtlTest : public testing::Test {
     }
   }
 
+  // Looks up every key of kvmap_ with GetAsync(), which has to strip the
+  // timestamps like Get()
+  void SimpleGetAsyncTest() {
+    std::mutex mu;
+    std::condition_variable cv;
+    size_t num_done = 0;
+    KVMap results;
+    for (auto& kv : kvmap_) {
+      const std::string key = kv.first;
+      db_ttl_->GetAsync(ReadOptions(), db_ttl_->DefaultColumnFamily(), key,
+                        [&, key](const Status& s, const Slice& value) {
+                          std::lock_guard<std::mutex> lock(mu);
+                          results[key] =
+                              s.ok() ? value.ToString() : s.ToString();
+                          num_done++;
+                          cv.notify_all();
+                        });
+    }
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return num_done == kvmap_.size(); });
+    ASSERT_EQ(kvmap_, results);
+  }
+
   // Sleeps for slp_tim then runs a manual compaction
   // Checks span starting from st_pos from kvmap_ in the db and
   // Gets should return true if check is true and false otherwise
@@ -605,6 +630,19 @@ TEST_F(TtlTest, MultiGetTest) {
   CloseTtl();
 }
 
+TEST_F(TtlTest, GetAsync) {
+  MakeKVMap(kSampleSize_);
+  env_->SetBackgroundThreads(2, Env::Priority::USER);
+
+  OpenTtl();
+  PutValues(0, kSampleSize_, false);
+
+  SimpleGetAsyncTest();
+
+  CloseTtl();
+  env_->SetBackgroundThreads(0, Env::Priority::USER);
+}
+
 TEST_F(TtlTest, ColumnFamiliesTest) {
   DB* db;
   Options options;